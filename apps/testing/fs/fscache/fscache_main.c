@@ -0,0 +1,960 @@
+/****************************************************************************
+ * apps/testing/fs/fscache/fscache_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define FSCACHE_FILE    "fscache.dat"
+#define FSCACHE_RENAMED "fscache.new"
+#define FSCACHE_LOWER   "fscache.case"
+#define FSCACHE_UPPER   "FSCACHE.CASE"
+#define FSCACHE_DIR     "fscache.dir"
+#define FSCACHE_MISSING "fscache.none"
+
+#define FSCACHE_WRCHUNK 333  /* Odd sizes so that I/O straddles blocks */
+#define FSCACHE_RDCHUNK 512
+#define FSCACHE_BADFD   1000 /* Not an open descriptor */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static char g_mountpt[PATH_MAX];
+static int g_filesize;
+static int g_delay;
+static uint8_t g_buffer[FSCACHE_RDCHUNK];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fscache_path
+ ****************************************************************************/
+
+static FAR const char *fscache_path(FAR char *path, FAR const char *name)
+{
+  snprintf(path, PATH_MAX, "%s/%s", g_mountpt, name);
+  return path;
+}
+
+/****************************************************************************
+ * Name: fscache_byte
+ *
+ * Description:
+ *   The expected content of the test file at 'offset' after it was written
+ *   with 'seed'.
+ *
+ ****************************************************************************/
+
+static uint8_t fscache_byte(off_t offset, uint8_t seed)
+{
+  return (uint8_t)(offset * 7 + (offset >> 8) + seed);
+}
+
+/****************************************************************************
+ * Name: fscache_expect
+ *
+ * Description:
+ *   Check the return value of a call: a count or zero when 'expected' is
+ *   not negative, otherwise a failure with errno set to -expected.
+ *
+ ****************************************************************************/
+
+static int fscache_expect(FAR const char *what, ssize_t ret,
+                          ssize_t expected)
+{
+  int errcode = ret < 0 ? errno : 0;
+
+  if ((expected >= 0 && ret != expected) ||
+      (expected < 0 && (ret >= 0 || errcode != -expected)))
+    {
+      printf("fscache: ERROR %s returned %zd, errno=%d, expected %zd\n",
+             what, ret, errcode, expected);
+      return 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fscache_write
+ *
+ * Description:
+ *   Write 'len' bytes of the pattern for 'seed' at 'offset', in chunks
+ *   that don't line up with any block size.
+ *
+ ****************************************************************************/
+
+static int fscache_write(int fd, off_t offset, size_t len, uint8_t seed)
+{
+  size_t nbytes;
+  size_t i;
+
+  while (len > 0)
+    {
+      nbytes = len < FSCACHE_WRCHUNK ? len : FSCACHE_WRCHUNK;
+      for (i = 0; i < nbytes; i++)
+        {
+          g_buffer[i] = fscache_byte(offset + i, seed);
+        }
+
+      if (pwrite(fd, g_buffer, nbytes, offset) != nbytes)
+        {
+          printf("fscache: ERROR pwrite at %ld failed, errno=%d\n",
+                 (long)offset, errno);
+          return 1;
+        }
+
+      offset += nbytes;
+      len    -= nbytes;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fscache_verify
+ *
+ * Description:
+ *   Read 'len' bytes at 'offset' through the file position of 'fd' and
+ *   compare them with the pattern for 'seed', or with zeros when 'seed' is
+ *   negative.
+ *
+ ****************************************************************************/
+
+static int fscache_verify(FAR const char *what, int fd, off_t offset,
+                          size_t len, int seed)
+{
+  ssize_t nread;
+  uint8_t expect;
+  size_t i;
+
+  if (lseek(fd, offset, SEEK_SET) != offset)
+    {
+      printf("fscache: ERROR %s: lseek failed, errno=%d\n", what, errno);
+      return 1;
+    }
+
+  while (len > 0)
+    {
+      nread = read(fd, g_buffer, len < FSCACHE_RDCHUNK ?
+                                 len : FSCACHE_RDCHUNK);
+      if (nread <= 0)
+        {
+          printf("fscache: ERROR %s: read at %ld returned %zd, errno=%d\n",
+                 what, (long)offset, nread, nread < 0 ? errno : 0);
+          return 1;
+        }
+
+      for (i = 0; i < nread; i++)
+        {
+          expect = seed < 0 ? 0 : fscache_byte(offset + i, seed);
+          if (g_buffer[i] != expect)
+            {
+              printf("fscache: ERROR %s: byte %ld is 0x%02x, "
+                     "expected 0x%02x\n",
+                     what, (long)(offset + i), g_buffer[i], expect);
+              return 1;
+            }
+        }
+
+      offset += nread;
+      len    -= nread;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fscache_size
+ *
+ * Description:
+ *   Check the size of a file as seen by fstat() and by stat().
+ *
+ ****************************************************************************/
+
+static int fscache_size(FAR const char *what, int fd, FAR const char *path,
+                        off_t size)
+{
+  struct stat buf;
+
+  buf.st_size = -1;
+  if (fstat(fd, &buf) < 0 || buf.st_size != size)
+    {
+      printf("fscache: ERROR %s: fstat size %ld, expected %ld\n",
+             what, (long)buf.st_size, (long)size);
+      return 1;
+    }
+
+  buf.st_size = -1;
+  if (stat(path, &buf) < 0 || buf.st_size != size)
+    {
+      printf("fscache: ERROR %s: stat size %ld, expected %ld\n",
+             what, (long)buf.st_size, (long)size);
+      return 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fscache_listed
+ *
+ * Description:
+ *   Return true if 'name' is listed in the test directory.
+ *
+ ****************************************************************************/
+
+static bool fscache_listed(FAR const char *name)
+{
+  FAR struct dirent *entry;
+  FAR DIR *dirp;
+  bool found = false;
+
+  dirp = opendir(g_mountpt);
+  if (dirp == NULL)
+    {
+      printf("fscache: ERROR opendir %s failed, errno=%d\n",
+             g_mountpt, errno);
+      return false;
+    }
+
+  while ((entry = readdir(dirp)) != NULL)
+    {
+      if (strcmp(entry->d_name, name) == 0)
+        {
+          found = true;
+        }
+    }
+
+  closedir(dirp);
+  return found;
+}
+
+/****************************************************************************
+ * Name: fscache_check_listed
+ ****************************************************************************/
+
+static int fscache_check_listed(FAR const char *what, FAR const char *name,
+                                bool listed)
+{
+  if (fscache_listed(name) != listed)
+    {
+      printf("fscache: ERROR %s: %s %s listed\n",
+             what, name, listed ? "not" : "still");
+      return 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fscache_rdwr
+ *
+ * Description:
+ *   Write the test file in odd chunks and read it back in aligned ones,
+ *   before and after the delayed write-back had a chance to run, and after
+ *   reopening it.
+ *
+ ****************************************************************************/
+
+static int fscache_rdwr(void)
+{
+  char path[PATH_MAX];
+  int nerrors = 0;
+  int fd;
+
+  printf("fscache: Write and read back\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      return 1;
+    }
+
+  nerrors += fscache_write(fd, 0, g_filesize, 1);
+  nerrors += fscache_verify("written", fd, 0, g_filesize, 1);
+  nerrors += fscache_size("written", fd, path, g_filesize);
+
+  usleep(g_delay * 1000);
+  nerrors += fscache_verify("after write-back", fd, 0, g_filesize, 1);
+  nerrors += fscache_expect("fsync", fsync(fd), 0);
+  nerrors += fscache_expect("close", close(fd), 0);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR reopen %s failed, errno=%d\n", path, errno);
+      return nerrors + 1;
+    }
+
+  nerrors += fscache_verify("reopened", fd, 0, g_filesize, 1);
+
+  /* Reading past the end returns nothing */
+
+  lseek(fd, g_filesize, SEEK_SET);
+  nerrors += fscache_expect("read at the end",
+                            read(fd, g_buffer, sizeof(g_buffer)), 0);
+
+  close(fd);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_overwrite
+ *
+ * Description:
+ *   Overwrite parts of the file through a second descriptor while the
+ *   first one is reading it sequentially, so that the first one has data
+ *   read ahead and cached that is now stale.
+ *
+ ****************************************************************************/
+
+static int fscache_overwrite(void)
+{
+  char path[PATH_MAX];
+  int nerrors = 0;
+  int half = g_filesize / 2;
+  int rdfd;
+  int wrfd;
+
+  printf("fscache: Overwrite through another descriptor\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  rdfd = open(path, O_RDONLY);
+  wrfd = open(path, O_WRONLY);
+  if (rdfd < 0 || wrfd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      nerrors++;
+      goto out;
+    }
+
+  /* Start a sequential read, then overwrite ahead of it and behind it */
+
+  nerrors += fscache_verify("before overwrite", rdfd, 0, half, 1);
+  nerrors += fscache_write(wrfd, half, g_filesize - half, 2);
+  nerrors += fscache_write(wrfd, 0, half, 3);
+
+  nerrors += fscache_verify("overwritten ahead", rdfd, half,
+                            g_filesize - half, 2);
+  nerrors += fscache_verify("overwritten behind", rdfd, 0, half, 3);
+
+  /* The same holds once the writer is done and the cache written back */
+
+  nerrors += fscache_expect("fsync", fsync(wrfd), 0);
+  nerrors += fscache_expect("close", close(wrfd), 0);
+  wrfd = -1;
+
+  usleep(g_delay * 1000);
+  nerrors += fscache_verify("after write-back", rdfd, half,
+                            g_filesize - half, 2);
+  nerrors += fscache_verify("after write-back, behind", rdfd, 0, half, 3);
+
+out:
+  if (wrfd >= 0)
+    {
+      close(wrfd);
+    }
+
+  if (rdfd >= 0)
+    {
+      close(rdfd);
+    }
+
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_check_partial
+ ****************************************************************************/
+
+static int fscache_check_partial(FAR const char *what, int fd)
+{
+  int nerrors = 0;
+
+  printf("fscache: %s\n", what);
+
+  nerrors += fscache_verify("partial, before", fd, 0, 511, 3);
+  nerrors += fscache_verify("partial, first", fd, 511, 2, 4);
+  nerrors += fscache_verify("partial, between", fd, 513, 4095 - 513, 3);
+  nerrors += fscache_verify("partial, second", fd, 4095, 2, 4);
+  nerrors += fscache_verify("partial, after", fd, 4097,
+                            g_filesize / 2 - 4097, 3);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_partial
+ *
+ * Description:
+ *   Overwrite single bytes across block boundaries, so that the caches
+ *   merge them into blocks that are otherwise unchanged.
+ *
+ ****************************************************************************/
+
+static int fscache_partial(void)
+{
+  char path[PATH_MAX];
+  int nerrors = 0;
+  int fd;
+
+  printf("fscache: Partial block writes\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  fd = open(path, O_RDWR);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      return 1;
+    }
+
+  nerrors += fscache_write(fd, 511, 2, 4);
+  nerrors += fscache_write(fd, 4095, 2, 4);
+  nerrors += fscache_check_partial("cached", fd);
+
+  usleep(g_delay * 1000);
+  nerrors += fscache_check_partial("after write-back", fd);
+  nerrors += fscache_expect("close", close(fd), 0);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR reopen %s failed, errno=%d\n", path, errno);
+      return nerrors + 1;
+    }
+
+  nerrors += fscache_check_partial("reopened", fd);
+  close(fd);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_truncate
+ *
+ * Description:
+ *   Shrink and extend the file through one descriptor and check the size
+ *   and content seen through another one and through stat().
+ *
+ ****************************************************************************/
+
+static int fscache_truncate(void)
+{
+  char path[PATH_MAX];
+  int nerrors = 0;
+  int half = g_filesize / 2;
+  int rdfd;
+  int wrfd;
+
+  printf("fscache: Truncate\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  rdfd = open(path, O_RDONLY);
+  wrfd = open(path, O_WRONLY);
+  if (rdfd < 0 || wrfd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      nerrors++;
+      goto out;
+    }
+
+  /* Have the tail cached before it goes away */
+
+  nerrors += fscache_verify("before truncate", rdfd, half,
+                            g_filesize - half, 2);
+
+  nerrors += fscache_expect("ftruncate, shrink", ftruncate(wrfd, half), 0);
+  nerrors += fscache_size("shrunk", rdfd, path, half);
+
+  lseek(rdfd, half, SEEK_SET);
+  nerrors += fscache_expect("read past a shrunk end",
+                            read(rdfd, g_buffer, sizeof(g_buffer)), 0);
+
+  /* Extending the file reads back zeros, not the old tail */
+
+  nerrors += fscache_expect("ftruncate, extend",
+                            ftruncate(wrfd, g_filesize), 0);
+  nerrors += fscache_size("extended", rdfd, path, g_filesize);
+  nerrors += fscache_verify("extended, head", rdfd, 0, 511, 3);
+  nerrors += fscache_verify("extended, tail", rdfd, half,
+                            g_filesize - half, -1);
+
+  /* O_TRUNC empties it */
+
+  close(wrfd);
+  wrfd = open(path, O_WRONLY | O_TRUNC);
+  if (wrfd < 0)
+    {
+      printf("fscache: ERROR open O_TRUNC failed, errno=%d\n", errno);
+      nerrors++;
+      goto out;
+    }
+
+  nerrors += fscache_size("O_TRUNC", rdfd, path, 0);
+  lseek(rdfd, 0, SEEK_SET);
+  nerrors += fscache_expect("read an empty file",
+                            read(rdfd, g_buffer, sizeof(g_buffer)), 0);
+
+out:
+  if (wrfd >= 0)
+    {
+      close(wrfd);
+    }
+
+  if (rdfd >= 0)
+    {
+      close(rdfd);
+    }
+
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_metadata
+ *
+ * Description:
+ *   Check that cached attributes, listings and negative lookups follow
+ *   create, write, rename and unlink.
+ *
+ ****************************************************************************/
+
+static int fscache_metadata(void)
+{
+  char path[PATH_MAX];
+  char newpath[PATH_MAX];
+  struct stat buf;
+  int nerrors = 0;
+  int fd;
+
+  printf("fscache: Metadata\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  fscache_path(newpath, FSCACHE_RENAMED);
+
+  /* A missing file stays missing, and is found once created */
+
+  nerrors += fscache_expect("stat, missing", stat(newpath, &buf), -ENOENT);
+  nerrors += fscache_check_listed("missing", FSCACHE_RENAMED, false);
+  nerrors += fscache_expect("stat, missing again", stat(newpath, &buf),
+                            -ENOENT);
+
+  fd = open(newpath, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR create %s failed, errno=%d\n", newpath, errno);
+      return nerrors + 1;
+    }
+
+  nerrors += fscache_size("created", fd, newpath, 0);
+  nerrors += fscache_check_listed("created", FSCACHE_RENAMED, true);
+
+  /* Writes show up in stat() through the path */
+
+  nerrors += fscache_write(fd, 0, 1000, 5);
+  nerrors += fscache_size("grown", fd, newpath, 1000);
+  close(fd);
+
+  nerrors += fscache_expect("create, existing",
+                            open(newpath, O_WRONLY | O_CREAT | O_EXCL,
+                                 0666), -EEXIST);
+
+  /* Rename over the test file */
+
+  nerrors += fscache_expect("unlink", unlink(path), 0);
+  nerrors += fscache_expect("rename", rename(newpath, path), 0);
+  nerrors += fscache_expect("stat, renamed from", stat(newpath, &buf),
+                            -ENOENT);
+  nerrors += fscache_expect("open, renamed from", open(newpath, O_RDONLY),
+                            -ENOENT);
+  nerrors += fscache_check_listed("renamed from", FSCACHE_RENAMED, false);
+  nerrors += fscache_check_listed("renamed to", FSCACHE_FILE, true);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      return nerrors + 1;
+    }
+
+  nerrors += fscache_size("renamed to", fd, path, 1000);
+  nerrors += fscache_verify("renamed to", fd, 0, 1000, 5);
+  close(fd);
+
+  /* Unlink it */
+
+  nerrors += fscache_expect("unlink", unlink(path), 0);
+  nerrors += fscache_expect("stat, unlinked", stat(path, &buf), -ENOENT);
+  nerrors += fscache_expect("open, unlinked", open(path, O_RDONLY),
+                            -ENOENT);
+  nerrors += fscache_expect("unlink, unlinked", unlink(path), -ENOENT);
+  nerrors += fscache_check_listed("unlinked", FSCACHE_FILE, false);
+
+  /* Directories */
+
+  fscache_path(path, FSCACHE_DIR);
+  nerrors += fscache_expect("mkdir", mkdir(path, 0777), 0);
+  nerrors += fscache_expect("mkdir, existing", mkdir(path, 0777), -EEXIST);
+  nerrors += fscache_check_listed("mkdir", FSCACHE_DIR, true);
+
+  strlcat(path, "/" FSCACHE_FILE, sizeof(path));
+  fd = open(path, O_WRONLY | O_CREAT, 0666);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR create %s failed, errno=%d\n", path, errno);
+      nerrors++;
+    }
+  else
+    {
+      close(fd);
+      fscache_path(newpath, FSCACHE_DIR);
+      nerrors += fscache_expect("rmdir, not empty", rmdir(newpath),
+                                -ENOTEMPTY);
+      nerrors += fscache_expect("unlink", unlink(path), 0);
+    }
+
+  fscache_path(path, FSCACHE_DIR);
+  nerrors += fscache_expect("rmdir", rmdir(path), 0);
+  nerrors += fscache_expect("stat, rmdir", stat(path, &buf), -ENOENT);
+  nerrors += fscache_check_listed("rmdir", FSCACHE_DIR, false);
+
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_case
+ *
+ * Description:
+ *   Whether a name that differs only in case finds a file is up to the
+ *   file system, but the answer must not change once the directory was
+ *   listed and its entries are cached.
+ *
+ ****************************************************************************/
+
+static int fscache_case(void)
+{
+  char lower[PATH_MAX];
+  char upper[PATH_MAX];
+  struct stat buf;
+  int nerrors = 0;
+  int before;
+  int after;
+  int fd;
+
+  printf("fscache: Lookups differing in case\n");
+
+  fscache_path(lower, FSCACHE_LOWER);
+  fscache_path(upper, FSCACHE_UPPER);
+
+  fd = open(lower, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR create %s failed, errno=%d\n", lower, errno);
+      return 1;
+    }
+
+  close(fd);
+
+  before = stat(upper, &buf) < 0 ? errno : 0;
+  fscache_listed(FSCACHE_LOWER);
+  after = stat(upper, &buf) < 0 ? errno : 0;
+  if (before != after)
+    {
+      printf("fscache: ERROR stat %s: errno %d before listing, %d after\n",
+             upper, before, after);
+      nerrors++;
+    }
+
+  after = open(upper, O_RDONLY);
+  if (after >= 0)
+    {
+      close(after);
+      after = 0;
+    }
+  else
+    {
+      after = errno;
+    }
+
+  if (before != after)
+    {
+      printf("fscache: ERROR open %s: errno %d, stat gave %d\n",
+             upper, after, before);
+      nerrors++;
+    }
+
+  nerrors += fscache_expect("unlink", unlink(lower), 0);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_append
+ *
+ * Description:
+ *   Append large buffers through two descriptors in turn.  Each write()
+ *   covers many blocks, or many requests on a network file system mounted
+ *   with a small message size, and must land as a whole at the end that
+ *   the previous one left, so that the file reads back as one pattern.
+ *
+ ****************************************************************************/
+
+static int fscache_append(void)
+{
+  char path[PATH_MAX];
+  FAR uint8_t *data;
+  off_t end[3];
+  off_t offset = 0;
+  int nerrors = 0;
+  int fd[2];
+  int i;
+
+  printf("fscache: Large O_APPEND writes\n");
+
+  data = malloc(g_filesize);
+  if (data == NULL)
+    {
+      printf("fscache: ERROR no memory for %d bytes\n", g_filesize);
+      return 1;
+    }
+
+  for (i = 0; i < g_filesize; i++)
+    {
+      data[i] = fscache_byte(i, 7);
+    }
+
+  fscache_path(path, FSCACHE_FILE);
+  fd[0] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  fd[1] = open(path, O_RDWR | O_APPEND);
+  if (fd[0] < 0 || fd[1] < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      nerrors++;
+      goto errout;
+    }
+
+  end[0] = g_filesize / 3;
+  end[1] = g_filesize / 2 + 1;
+  end[2] = g_filesize;
+  for (i = 0; i < 3; i++)
+    {
+      nerrors += fscache_expect("append", write(fd[i % 2], data + offset,
+                                                end[i] - offset),
+                                end[i] - offset);
+      nerrors += fscache_size("appended", fd[1], path, end[i]);
+      offset = end[i];
+    }
+
+  nerrors += fscache_expect("fsync", fsync(fd[0]), 0);
+  nerrors += fscache_verify("appended", fd[1], 0, g_filesize, 7);
+  nerrors += fscache_expect("unlink", unlink(path), 0);
+
+errout:
+  if (fd[0] >= 0)
+    {
+      close(fd[0]);
+    }
+
+  if (fd[1] >= 0)
+    {
+      close(fd[1]);
+    }
+
+  free(data);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: fscache_sync
+ *
+ * Description:
+ *   Check the sync paths and the errors of operations that the descriptor
+ *   doesn't allow.
+ *
+ ****************************************************************************/
+
+static int fscache_sync(void)
+{
+  char path[PATH_MAX];
+  int nerrors = 0;
+  int fd;
+  int ret;
+
+  printf("fscache: Sync and bad descriptors\n");
+
+  fscache_path(path, FSCACHE_FILE);
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      return 1;
+    }
+
+  nerrors += fscache_write(fd, 0, g_filesize, 6);
+  nerrors += fscache_expect("fsync", fsync(fd), 0);
+
+  /* A file system without syncfs() reports EBADF */
+
+  ret = syncfs(fd);
+  if (ret < 0 && errno != EBADF)
+    {
+      printf("fscache: ERROR syncfs failed, errno=%d\n", errno);
+      nerrors++;
+    }
+
+  nerrors += fscache_expect("read, write only",
+                            read(fd, g_buffer, sizeof(g_buffer)), -EBADF);
+  nerrors += fscache_expect("close", close(fd), 0);
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("fscache: ERROR open %s failed, errno=%d\n", path, errno);
+      return nerrors + 1;
+    }
+
+  nerrors += fscache_expect("write, read only",
+                            write(fd, g_buffer, sizeof(g_buffer)), -EBADF);
+  nerrors += fscache_verify("synced", fd, 0, g_filesize, 6);
+  close(fd);
+
+  nerrors += fscache_expect("fsync, bad descriptor", fsync(FSCACHE_BADFD),
+                            -EBADF);
+  nerrors += fscache_expect("syncfs, bad descriptor",
+                            syncfs(FSCACHE_BADFD), -EBADF);
+
+  fscache_path(path, FSCACHE_MISSING);
+  nerrors += fscache_expect("open, missing", open(path, O_RDONLY), -ENOENT);
+
+  fscache_path(path, FSCACHE_FILE);
+  nerrors += fscache_expect("unlink", unlink(path), 0);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: show_useage
+ ****************************************************************************/
+
+static void show_useage(void)
+{
+  printf("Usage : fscache [OPTION [ARG]] ...\n");
+  printf("-h    show this help statement\n");
+  printf("-m    mount point to be tested e.g. [%s]\n",
+         CONFIG_TESTING_FSCACHE_MOUNTPT);
+  printf("-s    size of the test file e.g. [%d]\n",
+         CONFIG_TESTING_FSCACHE_FILESIZE);
+  printf("-d    write-back delay in ms e.g. [%d]\n",
+         CONFIG_TESTING_FSCACHE_DELAY);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fscache_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  size_t len;
+  int nerrors = 0;
+  int option;
+
+  strlcpy(g_mountpt, CONFIG_TESTING_FSCACHE_MOUNTPT, sizeof(g_mountpt));
+  g_filesize = CONFIG_TESTING_FSCACHE_FILESIZE;
+  g_delay    = CONFIG_TESTING_FSCACHE_DELAY;
+
+  while ((option = getopt(argc, argv, ":d:hm:s:")) != -1)
+    {
+      switch (option)
+        {
+          case 'd':
+            g_delay = atoi(optarg);
+            break;
+          case 'h':
+            show_useage();
+            return EXIT_SUCCESS;
+          case 'm':
+            strlcpy(g_mountpt, optarg, sizeof(g_mountpt));
+            break;
+          case 's':
+            g_filesize = atoi(optarg);
+            break;
+          case ':':
+            printf("Error: Missing required argument\n");
+            return EXIT_FAILURE;
+          case '?':
+            printf("Error: Unrecognized option\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+  /* The file has to span a few 4 KiB blocks */
+
+  if (g_filesize < 8200)
+    {
+      printf("Error: The file size must be at least 8200\n");
+      return EXIT_FAILURE;
+    }
+
+  len = strlen(g_mountpt);
+  while (len > 1 && g_mountpt[len - 1] == '/')
+    {
+      g_mountpt[--len] = '\0';
+    }
+
+  printf("fscache: Testing %s\n", g_mountpt);
+
+  nerrors += fscache_rdwr();
+  nerrors += fscache_overwrite();
+  nerrors += fscache_partial();
+  nerrors += fscache_truncate();
+  nerrors += fscache_metadata();
+  nerrors += fscache_case();
+  nerrors += fscache_append();
+  nerrors += fscache_sync();
+
+  printf("fscache: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+  return nerrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -32,6 +32,7 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <sys/param.h>
 
 #ifdef CONFIG_TESTING_MM_POWEROFF
 #include <sys/boardctl.h>
@@ -341,6 +342,191 @@ static void do_frees(FAR void **mem, FAR const int *size,
     }
 }
 
+#if CONFIG_MM_HEAP_LARGE_THRESHOLD > 0
+static void large_fill(FAR void *mem, size_t size, uint8_t seed)
+{
+  FAR uint8_t *ptr = mem;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      ptr[i] = (uint8_t)(seed + i);
+    }
+}
+
+static void large_check(FAR const char *what, FAR const void *mem,
+                        size_t size, uint8_t seed)
+{
+  FAR const uint8_t *ptr = mem;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      if (ptr[i] != (uint8_t)(seed + i))
+        {
+          fprintf(stderr, "   ERROR %s: %p corrupted at offset %zu\n",
+                  what, mem, i);
+          exit(1);
+        }
+    }
+}
+
+/* Exercise the page granular large allocation area: recycling of freed
+ * blocks, realloc() and memalign() across the threshold, and the fallback
+ * to the general heap once the area is exhausted.
+ */
+
+static void do_large(void)
+{
+  const size_t threshold = CONFIG_MM_HEAP_LARGE_THRESHOLD;
+  const size_t bigsize = MAX(threshold, CONFIG_MM_HEAP_LARGE_SIZE / 4);
+  FAR void *mem[8];
+  struct mallinfo before;
+  FAR void *ptr;
+  size_t align;
+  int i;
+
+  /* The request that sets up the area is served by the general heap */
+
+  free(malloc(threshold));
+  before = mallinfo();
+
+  /* A freed block is handed out again to a request of the same size */
+
+  printf("Large: recycling\n");
+  ptr = malloc(threshold);
+  if (ptr == NULL || malloc_size(ptr) < threshold)
+    {
+      fprintf(stderr, "   ERROR large malloc of %zu failed\n", threshold);
+      exit(1);
+    }
+
+  large_fill(ptr, threshold, 1);
+  free(ptr);
+  mem[0] = malloc(threshold);
+#if CONFIG_MM_HEAP_LARGE_NCACHE > 0
+  if (mem[0] != ptr)
+    {
+      fprintf(stderr, "   ERROR freed block %p not recycled, got %p\n",
+              ptr, mem[0]);
+      exit(1);
+    }
+#endif
+
+  free(mem[0]);
+
+  /* realloc() keeps the contents when moving in and out of the area */
+
+  printf("Large: realloc across the threshold\n");
+  ptr = malloc(64);
+  if (ptr == NULL)
+    {
+      fprintf(stderr, "   ERROR malloc of 64 bytes failed\n");
+      exit(1);
+    }
+
+  large_fill(ptr, 64, 2);
+  ptr = realloc(ptr, 2 * threshold);
+  if (ptr == NULL)
+    {
+      fprintf(stderr, "   ERROR realloc to %zu failed\n", 2 * threshold);
+      exit(1);
+    }
+
+  large_check("grown into the area", ptr, 64, 2);
+  large_fill(ptr, 2 * threshold, 3);
+  ptr = realloc(ptr, 3 * threshold);
+  if (ptr == NULL)
+    {
+      fprintf(stderr, "   ERROR realloc to %zu failed\n", 3 * threshold);
+      exit(1);
+    }
+
+  large_check("grown in the area", ptr, 2 * threshold, 3);
+  ptr = realloc(ptr, 64);
+  if (ptr == NULL)
+    {
+      fprintf(stderr, "   ERROR realloc to 64 bytes failed\n");
+      exit(1);
+    }
+
+  large_check("shrunk out of the area", ptr, 64, 3);
+  free(ptr);
+
+  /* memalign() of large blocks, interleaved with large mallocs */
+
+  printf("Large: memalign\n");
+  for (align = sizeof(uintptr_t); align <= 4 * threshold; align <<= 2)
+    {
+      mem[0] = memalign(align, threshold);
+      mem[1] = malloc(threshold);
+      if (mem[0] == NULL || mem[1] == NULL)
+        {
+          fprintf(stderr, "   ERROR large memalign to %zu failed\n",
+                  align);
+          exit(1);
+        }
+
+      if (((uintptr_t)mem[0] % align) != 0)
+        {
+          fprintf(stderr, "   ERROR wrong alignment: ptr %p, "
+                  "alignment %zu\n", mem[0], align);
+          exit(1);
+        }
+
+      large_fill(mem[0], threshold, 4);
+      large_fill(mem[1], threshold, 5);
+      large_check("aligned block", mem[0], threshold, 4);
+      free(mem[0]);
+      large_check("next to an aligned block", mem[1], threshold, 5);
+      free(mem[1]);
+    }
+
+  /* Exhaust the area, the requests it can't serve go to the general
+   * heap.
+   */
+
+  printf("Large: exhausting the area\n");
+  g_alloc_info = mallinfo();
+  for (i = 0; i < nitems(mem); i++)
+    {
+      mem[i] = malloc(bigsize);
+      if (mem[i] == NULL)
+        {
+          if (bigsize <= g_alloc_info.mxordblk)
+            {
+              fprintf(stderr, "   ERROR large malloc %d failed, largest "
+                      "free block is %lu\n", i,
+                      (unsigned long)g_alloc_info.mxordblk);
+              exit(1);
+            }
+
+          break;
+        }
+
+      large_fill(mem[i], bigsize, i);
+      g_alloc_info = mallinfo();
+    }
+
+  while (i-- > 0)
+    {
+      large_check("exhausted area", mem[i], bigsize, i);
+      free(mem[i]);
+    }
+
+  /* Recycled blocks are accounted as free space */
+
+  mm_showmallinfo();
+  if (g_alloc_info.uordblks > before.uordblks)
+    {
+      fprintf(stderr, "   ERROR %lu bytes still in use after the large "
+              "allocation test\n",
+              (unsigned long)(g_alloc_info.uordblks - before.uordblks));
+      exit(1);
+    }
+}
+#endif
+
 static int mm_stress_test(int delay, int prio, int maxsize)
 {
   FAR unsigned char *tmp;
@@ -471,6 +657,12 @@ int main(int argc, FAR char *argv[])
 
   do_frees(g_allocs, g_alloc_small_sizes, g_random1, NTEST_ALLOCS);
 
+#if CONFIG_MM_HEAP_LARGE_THRESHOLD > 0
+  /* Allocate and release blocks of the large allocation area */
+
+  do_large();
+#endif
+
   printf("TEST COMPLETE\n");
 
 #ifdef CONFIG_TESTING_MM_POWEROFF
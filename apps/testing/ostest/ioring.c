@@ -0,0 +1,407 @@
+/****************************************************************************
+ * apps/testing/ostest/ioring.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/ioctl.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nuttx/fs/ioring.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define IORING_TEST_ENTRIES 3    /* Rounded up to 4, 8 completions */
+#define IORING_TIMEOUT_MS   100  /* Timeout of the waits that give up */
+#define IORING_SLACK_MS     1000 /* Upper bound on how late a timeout is */
+#define IORING_BADFD        1000 /* Not an open descriptor */
+#define IORING_BADOP        99   /* Not an operation */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int ioring_expect(FAR const char *what, int ret, int expected)
+{
+  int errcode = ret < 0 ? errno : 0;
+
+  if ((expected >= 0 && ret != expected) ||
+      (expected < 0 && (ret >= 0 || errcode != -expected)))
+    {
+      printf("ioring_test: ERROR %s returned %d, errno=%d, expected %d\n",
+             what, ret, errcode, expected);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+/* Queue one entry, the submission queue must have room for it */
+
+static int ioring_prep(FAR struct ioring_s *ring, uint8_t opcode, int fd,
+                       FAR void *addr, uint32_t len, uint64_t user_data)
+{
+  FAR struct ioring_sqe_s *sqe = ioring_get_sqe(ring);
+
+  if (sqe == NULL)
+    {
+      printf("ioring_test: ERROR submission queue full\n");
+      ASSERT(false);
+      return 1;
+    }
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->off       = -1;
+  sqe->addr      = addr;
+  sqe->len       = len;
+  sqe->user_data = user_data;
+  ioring_queue_sqe(ring);
+  return 0;
+}
+
+/* Consume the oldest completion and check it */
+
+static int ioring_reap(FAR struct ioring_s *ring, uint64_t user_data,
+                       int32_t res)
+{
+  FAR struct ioring_cqe_s *cqe = ioring_peek_cqe(ring);
+  int nerrors = 0;
+
+  if (cqe == NULL)
+    {
+      printf("ioring_test: ERROR no completion for %llu\n",
+             (unsigned long long)user_data);
+      ASSERT(false);
+      return 1;
+    }
+
+  if (cqe->user_data != user_data || cqe->res != res)
+    {
+      printf("ioring_test: ERROR completion %llu res %" PRId32
+             ", expected %llu res %" PRId32 "\n",
+             (unsigned long long)cqe->user_data, cqe->res,
+             (unsigned long long)user_data, res);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  ioring_cqe_seen(ring);
+  return nerrors;
+}
+
+static int ioring_pollin(int fd)
+{
+  struct pollfd pfd;
+
+  pfd.fd      = fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+
+  return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN) != 0;
+}
+
+#ifdef CONFIG_PIPES
+/* Real I/O through a pipe */
+
+static int ioring_pipe(int fd, FAR struct ioring_s *ring)
+{
+  char rbuf[8];
+  int pipefd[2];
+  int nerrors = 0;
+
+  printf("ioring_test: Pipe I/O\n");
+
+  if (pipe(pipefd) < 0)
+    {
+      printf("ioring_test: ERROR pipe failed, errno=%d\n", errno);
+      ASSERT(false);
+      return 1;
+    }
+
+  nerrors += ioring_prep(ring, IORING_OP_WRITE, pipefd[1],
+                         (FAR void *)"ioring", 6, 5);
+  nerrors += ioring_expect("enter, write", ioring_enter(fd, 1, 1, 5000), 1);
+  nerrors += ioring_reap(ring, 5, 6);
+
+  memset(rbuf, 0, sizeof(rbuf));
+  nerrors += ioring_prep(ring, IORING_OP_READ, pipefd[0], rbuf,
+                         sizeof(rbuf), 6);
+  nerrors += ioring_expect("enter, read", ioring_enter(fd, 1, 1, 5000), 1);
+  nerrors += ioring_reap(ring, 6, 6);
+  if (memcmp(rbuf, "ioring", 6) != 0)
+    {
+      printf("ioring_test: ERROR read back \"%.6s\"\n", rbuf);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  close(pipefd[0]);
+  close(pipefd[1]);
+  return nerrors;
+}
+
+/* Closing a ring cancels a read blocked on an empty pipe, without taking
+ * any data written afterwards.
+ */
+
+static int ioring_cancel(void)
+{
+  struct ioring_params_s params;
+  struct timespec start;
+  struct timespec now;
+  char rbuf[8];
+  int pipefd[2];
+  int nerrors = 0;
+  int elapsed;
+  int fd;
+
+  printf("ioring_test: Closing with a blocked request\n");
+
+  if (pipe(pipefd) < 0)
+    {
+      printf("ioring_test: ERROR pipe failed, errno=%d\n", errno);
+      ASSERT(false);
+      return 1;
+    }
+
+  fd = open(IORING_DEVPATH, O_RDWR);
+  if (fd < 0)
+    {
+      printf("ioring_test: ERROR open %s failed, errno=%d\n",
+             IORING_DEVPATH, errno);
+      ASSERT(false);
+      nerrors++;
+      goto errout;
+    }
+
+  memset(&params, 0, sizeof(params));
+  params.sq_entries = 1;
+  if (ioring_expect("setup", ioctl(fd, IORING_IOC_SETUP,
+                                   (unsigned long)(uintptr_t)&params),
+                    0) != 0)
+    {
+      close(fd);
+      nerrors++;
+      goto errout;
+    }
+
+  nerrors += ioring_prep(params.ring, IORING_OP_READ, pipefd[0], rbuf,
+                         sizeof(rbuf), 20);
+  nerrors += ioring_expect("enter, blocking read",
+                           ioring_enter(fd, 1, 1, IORING_TIMEOUT_MS), 1);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  close(fd);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+            (now.tv_nsec - start.tv_nsec) / 1000000;
+  if (elapsed > IORING_SLACK_MS)
+    {
+      printf("ioring_test: ERROR close took %d ms\n", elapsed);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  memset(rbuf, 0, sizeof(rbuf));
+  nerrors += ioring_expect("write after close",
+                           write(pipefd[1], "cancel", 6), 6);
+  nerrors += ioring_expect("read after close",
+                           read(pipefd[0], rbuf, sizeof(rbuf)), 6);
+  if (memcmp(rbuf, "cancel", 6) != 0)
+    {
+      printf("ioring_test: ERROR read back \"%.6s\"\n", rbuf);
+      ASSERT(false);
+      nerrors++;
+    }
+
+errout:
+  close(pipefd[0]);
+  close(pipefd[1]);
+  return nerrors;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void ioring_test(void)
+{
+  struct ioring_params_s params;
+  FAR struct ioring_s *ring;
+  struct timespec start;
+  struct timespec now;
+  char rbuf[8];
+  uint32_t tail;
+  int nerrors = 0;
+  int elapsed;
+  int fd;
+  int ret;
+  int i;
+
+  fd = open(IORING_DEVPATH, O_RDWR);
+  if (fd < 0)
+    {
+      printf("ioring_test: ERROR open %s failed, errno=%d\n",
+             IORING_DEVPATH, errno);
+      ASSERT(false);
+      return;
+    }
+
+  /* Setup */
+
+  nerrors += ioring_expect("enter before setup",
+                           ioring_enter(fd, 1, 0, 0), -EINVAL);
+
+  memset(&params, 0, sizeof(params));
+  nerrors += ioring_expect("setup without entries",
+                           ioctl(fd, IORING_IOC_SETUP,
+                                 (unsigned long)(uintptr_t)&params),
+                           -EINVAL);
+
+  params.sq_entries = IORING_TEST_ENTRIES;
+  ret = ioctl(fd, IORING_IOC_SETUP, (unsigned long)(uintptr_t)&params);
+  if (ioring_expect("setup", ret, 0) != 0)
+    {
+      nerrors++;
+      goto out;
+    }
+
+  ring = params.ring;
+  if (params.sq_entries != 4 || params.cq_entries != 8 ||
+      ring->sq_entries != 4 || ring->cq_entries != 8)
+    {
+      printf("ioring_test: ERROR ring of %" PRIu32 "/%" PRIu32
+             " entries\n", params.sq_entries, params.cq_entries);
+      ASSERT(false);
+      nerrors++;
+      goto out;
+    }
+
+  nerrors += ioring_expect("second setup",
+                           ioctl(fd, IORING_IOC_SETUP,
+                                 (unsigned long)(uintptr_t)&params),
+                           -EBUSY);
+
+  /* Waiting for completions that never come */
+
+  printf("ioring_test: Waiting on an idle ring\n");
+
+  nerrors += ioring_expect("poll, idle", ioring_pollin(fd), 0);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = ioring_enter(fd, 0, 1, IORING_TIMEOUT_MS);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+            (now.tv_nsec - start.tv_nsec) / 1000000;
+  nerrors += ioring_expect("enter, idle", ret, -ETIMEDOUT);
+  if (elapsed < IORING_TIMEOUT_MS - 10 ||
+      elapsed > IORING_TIMEOUT_MS + IORING_SLACK_MS)
+    {
+      printf("ioring_test: ERROR timed out after %d ms\n", elapsed);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  /* Requests that fail complete with a negated errno */
+
+  printf("ioring_test: Failing requests\n");
+
+  nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 1);
+  nerrors += ioring_prep(ring, IORING_OP_READ, IORING_BADFD, rbuf,
+                         sizeof(rbuf), 2);
+  nerrors += ioring_prep(ring, IORING_OP_FSYNC, IORING_BADFD, NULL, 0, 3);
+  nerrors += ioring_prep(ring, IORING_BADOP, fd, NULL, 0, 4);
+  nerrors += ioring_expect("enter", ioring_enter(fd, 4, 4, 5000), 4);
+  nerrors += ioring_expect("poll, completed", ioring_pollin(fd), 1);
+  nerrors += ioring_reap(ring, 1, 0);
+  nerrors += ioring_reap(ring, 2, -EBADF);
+  nerrors += ioring_reap(ring, 3, -EBADF);
+  nerrors += ioring_reap(ring, 4, -ENOSYS);
+
+#ifdef CONFIG_PIPES
+  nerrors += ioring_pipe(fd, ring);
+  nerrors += ioring_cancel();
+#endif
+
+  /* The submitter owns sq_tail, nonsense in it is refused */
+
+  printf("ioring_test: Inconsistent submission queue\n");
+
+  tail = atomic_read(&ring->sq_tail);
+  atomic_set(&ring->sq_tail, tail + 100);
+  nerrors += ioring_expect("enter, bad sq_tail",
+                           ioring_enter(fd, 1, 0, 0), -EINVAL);
+  atomic_set(&ring->sq_tail, tail);
+
+  /* Completions that are not consumed stop further submissions */
+
+  printf("ioring_test: Full completion queue\n");
+
+  for (i = 0; i < 2; i++)
+    {
+      nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 10 + 4 * i);
+      nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 11 + 4 * i);
+      nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 12 + 4 * i);
+      nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 13 + 4 * i);
+      nerrors += ioring_expect("enter, NOPs", ioring_enter(fd, 4, 0, 0), 4);
+    }
+
+  nerrors += ioring_prep(ring, IORING_OP_NOP, -1, NULL, 0, 18);
+  nerrors += ioring_expect("enter, full", ioring_enter(fd, 1, 0, 0),
+                           -EBUSY);
+
+  for (i = 0; i < 8; i++)
+    {
+      nerrors += ioring_reap(ring, 10 + i, 0);
+    }
+
+  /* The refused entry goes once there is room again */
+
+  nerrors += ioring_expect("enter, room", ioring_enter(fd, 1, 1, 5000), 1);
+  nerrors += ioring_reap(ring, 18, 0);
+  nerrors += ioring_expect("poll, drained", ioring_pollin(fd), 0);
+
+out:
+  close(fd);
+  printf("ioring_test: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+}
@@ -0,0 +1,389 @@
+/****************************************************************************
+ * apps/testing/ostest/nxring.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <nuttx/nxring.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RING_NAME       "nxring_test"
+#define RING_MPSCNAME   "nxring_mpsc"
+#define RING_SLOTSIZE   32
+#define RING_NSLOTS     3    /* Rounded up to 4 */
+#define RING_TIMEOUT_MS 100  /* Timeout of the waits that give up */
+#define RING_SLACK_MS   1000 /* Upper bound on how late a timeout may be */
+#define RING_NPRODUCERS 2
+#define RING_NFRAMES    64   /* Frames sent by each MPSC producer */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct ring_frame_s
+{
+  uint32_t producer;
+  uint32_t seq;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int ring_elapsed(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000 +
+         (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int ring_expect(FAR const char *what, int ret, int expected)
+{
+  if (ret != expected)
+    {
+      printf("nxring_test: ERROR %s returned %d, expected %d\n",
+             what, ret, expected);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+/* Check that a wait gave up with -ETIMEDOUT after about RING_TIMEOUT_MS */
+
+static int ring_expect_timeout(FAR const char *what, int ret,
+                               FAR const struct timespec *start)
+{
+  int elapsed = ring_elapsed(start);
+
+  if (ring_expect(what, ret, -ETIMEDOUT) != 0)
+    {
+      return 1;
+    }
+
+  if (elapsed < RING_TIMEOUT_MS - 10 ||
+      elapsed > RING_TIMEOUT_MS + RING_SLACK_MS)
+    {
+      printf("nxring_test: ERROR %s timed out after %d ms\n",
+             what, elapsed);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+static FAR void *ring_producer(FAR void *arg)
+{
+  FAR struct nxring_s *ring;
+  FAR struct ring_frame_s *frame;
+  FAR void *buf;
+  uint32_t id = (uintptr_t)arg;
+  int nerrors = 0;
+  int ret;
+  int i;
+
+  ret = nxring_open(&ring, RING_MPSCNAME);
+  if (ret < 0)
+    {
+      printf("ring_producer: ERROR nxring_open failed: %d\n", ret);
+      ASSERT(false);
+      return (FAR void *)1;
+    }
+
+  for (i = 0; i < RING_NFRAMES; i++)
+    {
+      ret = nxring_reserve(ring, &buf, 5000);
+      if (ret < 0)
+        {
+          printf("ring_producer: ERROR nxring_reserve %" PRIu32 ".%d "
+                 "failed: %d\n", id, i, ret);
+          ASSERT(false);
+          nerrors++;
+          break;
+        }
+
+      frame           = buf;
+      frame->producer = id;
+      frame->seq      = i;
+      nerrors += ring_expect("nxring_commit",
+                             nxring_commit(ring, buf, sizeof(*frame)), 0);
+    }
+
+  nxring_close(ring);
+  return (FAR void *)(uintptr_t)nerrors;
+}
+
+/* Fill and drain a single producer ring from one thread, checking the
+ * argument checks and the full and empty ring paths.
+ */
+
+static int ring_spsc(void)
+{
+  FAR struct nxring_s *producer;
+  FAR struct nxring_s *consumer;
+  FAR struct nxring_s *ring;
+  struct timespec start;
+  FAR void *buf;
+  ssize_t len;
+  int nerrors = 0;
+  int ret;
+  int i;
+
+  printf("nxring_test: Single producer ring\n");
+
+  nerrors += ring_expect("nxring_create, no slot size",
+                         nxring_create(&ring, RING_NAME, 0, 4, 0),
+                         -EINVAL);
+  nerrors += ring_expect("nxring_create, no slots",
+                         nxring_create(&ring, RING_NAME, 16, 0, 0),
+                         -EINVAL);
+  nerrors += ring_expect("nxring_open, no ring",
+                         nxring_open(&ring, RING_NAME), -ENOENT);
+
+  ret = nxring_create(&producer, RING_NAME, RING_SLOTSIZE, RING_NSLOTS, 0);
+  if (ret < 0)
+    {
+      printf("nxring_test: ERROR nxring_create failed: %d\n", ret);
+      ASSERT(false);
+      return nerrors + 1;
+    }
+
+  nerrors += ring_expect("nxring_create, existing ring",
+                         nxring_create(&ring, RING_NAME, RING_SLOTSIZE,
+                                       RING_NSLOTS, 0), -EEXIST);
+
+  ret = nxring_open(&consumer, RING_NAME);
+  if (ret < 0)
+    {
+      printf("nxring_test: ERROR nxring_open failed: %d\n", ret);
+      ASSERT(false);
+      nerrors++;
+      goto out_producer;
+    }
+
+  nerrors += ring_expect("nxring_slotsize", nxring_slotsize(consumer),
+                         RING_SLOTSIZE);
+
+  /* An empty ring */
+
+  nerrors += ring_expect("nxring_acquire, empty",
+                         nxring_acquire(consumer, &buf, 0), -EAGAIN);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = nxring_acquire(consumer, &buf, RING_TIMEOUT_MS);
+  nerrors += ring_expect_timeout("nxring_acquire, empty", ret, &start);
+
+  /* Fill the ring, the slot count was rounded up to a power of two */
+
+  for (i = 0; i < 4; i++)
+    {
+      ret = nxring_reserve(producer, &buf, 0);
+      if (ring_expect("nxring_reserve", ret, 0) != 0)
+        {
+          nerrors++;
+          break;
+        }
+
+      if (i == 0)
+        {
+          nerrors += ring_expect("nxring_commit, oversized",
+                                 nxring_commit(producer, buf,
+                                               RING_SLOTSIZE + 1),
+                                 -EMSGSIZE);
+        }
+
+      memset(buf, 'a' + i, i + 1);
+      nerrors += ring_expect("nxring_commit",
+                             nxring_commit(producer, buf, i + 1), 0);
+    }
+
+  /* A full ring */
+
+  nerrors += ring_expect("nxring_reserve, full",
+                         nxring_reserve(producer, &buf, 0), -EAGAIN);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = nxring_reserve(producer, &buf, RING_TIMEOUT_MS);
+  nerrors += ring_expect_timeout("nxring_reserve, full", ret, &start);
+
+  /* The frames come out in order and in place */
+
+  for (i = 0; i < 4; i++)
+    {
+      len = nxring_acquire(consumer, &buf, 0);
+      if (ring_expect("nxring_acquire", len, i + 1) != 0)
+        {
+          nerrors++;
+          break;
+        }
+
+      if (((FAR const char *)buf)[i] != 'a' + i)
+        {
+          printf("nxring_test: ERROR frame %d corrupted\n", i);
+          ASSERT(false);
+          nerrors++;
+        }
+
+      nxring_release(consumer);
+    }
+
+  nerrors += ring_expect("nxring_acquire, drained",
+                         nxring_acquire(consumer, &buf, 0), -EAGAIN);
+
+  nxring_close(consumer);
+
+out_producer:
+  nxring_close(producer);
+  nerrors += ring_expect("nxring_unlink", nxring_unlink(RING_NAME), 0);
+  nerrors += ring_expect("nxring_unlink, no ring",
+                         nxring_unlink(RING_NAME), -ENOENT);
+  return nerrors;
+}
+
+/* Stream frames from several producer threads through a small ring, so
+ * that the producers sleep on a full ring and the consumer on an empty
+ * one.
+ */
+
+static int ring_mpsc(void)
+{
+  uint32_t next[RING_NPRODUCERS];
+  pthread_t threads[RING_NPRODUCERS];
+  FAR struct ring_frame_s *frame;
+  FAR struct nxring_s *ring;
+  pthread_attr_t attr;
+  FAR void *result;
+  FAR void *buf;
+  ssize_t len;
+  int nthreads;
+  int nerrors = 0;
+  int ret;
+  int i;
+
+  printf("nxring_test: Multiple producer ring\n");
+
+  ret = nxring_create(&ring, RING_MPSCNAME, sizeof(*frame), RING_NSLOTS,
+                      NXRING_MPSC);
+  if (ret < 0)
+    {
+      printf("nxring_test: ERROR nxring_create failed: %d\n", ret);
+      ASSERT(false);
+      return 1;
+    }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, STACKSIZE);
+  for (nthreads = 0; nthreads < RING_NPRODUCERS; nthreads++)
+    {
+      next[nthreads] = 0;
+      ret = pthread_create(&threads[nthreads], &attr, ring_producer,
+                           (FAR void *)(uintptr_t)nthreads);
+      if (ret != 0)
+        {
+          printf("nxring_test: ERROR pthread_create failed: %d\n", ret);
+          ASSERT(false);
+          nerrors++;
+          break;
+        }
+    }
+
+  pthread_attr_destroy(&attr);
+
+  /* Each producer's frames arrive in the order it sent them */
+
+  for (i = 0; i < nthreads * RING_NFRAMES; i++)
+    {
+      len = nxring_acquire(ring, &buf, 5000);
+      if (ring_expect("nxring_acquire", len, sizeof(*frame)) != 0)
+        {
+          nerrors++;
+          break;
+        }
+
+      frame = buf;
+      if (frame->producer >= nthreads ||
+          frame->seq != next[frame->producer])
+        {
+          printf("nxring_test: ERROR frame %" PRIu32 ".%" PRIu32
+                 " out of order\n", frame->producer, frame->seq);
+          ASSERT(false);
+          nerrors++;
+        }
+      else
+        {
+          next[frame->producer]++;
+        }
+
+      nxring_release(ring);
+    }
+
+  while (nthreads-- > 0)
+    {
+      pthread_join(threads[nthreads], &result);
+      nerrors += (int)(uintptr_t)result;
+    }
+
+  nxring_close(ring);
+  nxring_unlink(RING_MPSCNAME);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void nxring_test(void)
+{
+  int nerrors = 0;
+
+  /* The doorbells live in this directory */
+
+  mkdir(CONFIG_LIBC_NXRING_VFS_PATH, 0777);
+
+  nerrors += ring_spsc();
+  nerrors += ring_mpsc();
+
+  printf("nxring_test: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+}
@@ -109,6 +109,12 @@ int setvbuf_test(void);
 int dev_null_test(void);
 #endif
 
+/* splice.c *****************************************************************/
+
+#if defined(CONFIG_PIPES) && !defined(CONFIG_DISABLE_PTHREAD)
+void splice_test(void);
+#endif
+
 /* fpu.c ********************************************************************/
 
 void fpu_test(void);
@@ -119,6 +125,12 @@ void fpu_test(void);
 void aio_test(void);
 #endif
 
+/* ioring.c *****************************************************************/
+
+#ifdef CONFIG_FS_IORING
+void ioring_test(void);
+#endif
+
 /* restart.c ****************************************************************/
 
 #ifndef CONFIG_BUILD_KERNEL
@@ -177,6 +189,14 @@ void mqueue_test(void);
 
 void timedmqueue_test(void);
 
+/* spscmqueue.c *************************************************************/
+
+void spscmqueue_test(void);
+
+/* nxring.c *****************************************************************/
+
+void nxring_test(void);
+
 /* cancel.c *****************************************************************/
 
 void cancel_test(void);
@@ -266,6 +286,10 @@ void barrier_test(void);
 
 void priority_inheritance(void);
 
+/* priodonate.c *************************************************************/
+
+void priority_donation_test(void);
+
 /* schedlock.c **************************************************************/
 
 void sched_lock_test(void);
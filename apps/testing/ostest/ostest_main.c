@@ -347,6 +347,14 @@ static int user_main(int argc, char *argv[])
       check_test_memory_usage();
 #endif
 
+#if defined(CONFIG_PIPES) && !defined(CONFIG_DISABLE_PTHREAD)
+      /* Check splice(), tee() and vmsplice() on pipes */
+
+      printf("\nuser_main: splice test\n");
+      splice_test();
+      check_test_memory_usage();
+#endif
+
 #ifdef CONFIG_TESTING_OSTEST_AIO
       /* Check asynchronous I/O */
 
@@ -355,6 +363,14 @@ static int user_main(int argc, char *argv[])
       check_test_memory_usage();
 #endif
 
+#ifdef CONFIG_FS_IORING
+      /* Check the submission/completion ring I/O device */
+
+      printf("\nuser_main: I/O ring test\n");
+      ioring_test();
+      check_test_memory_usage();
+#endif
+
 #if defined(CONFIG_ARCH_FPU) && !defined(CONFIG_TESTING_OSTEST_FPUTESTDISABLE) && \
     defined(CONFIG_BUILD_FLAT)
       /* Check that the FPU is properly supported during context switching */
@@ -511,6 +527,23 @@ static int user_main(int argc, char *argv[])
       check_test_memory_usage();
 #endif
 
+#if !defined(CONFIG_DISABLE_MQUEUE) && !defined(CONFIG_DISABLE_PTHREAD) && \
+    defined(CONFIG_MQ_SPSC)
+      /* Verify the lock-free single producer, single consumer queues */
+
+      printf("\nuser_main: SPSC message queue test\n");
+      spscmqueue_test();
+      check_test_memory_usage();
+#endif
+
+#if defined(CONFIG_LIBC_NXRING) && !defined(CONFIG_DISABLE_PTHREAD)
+      /* Verify the shared memory ring channels */
+
+      printf("\nuser_main: nxring test\n");
+      nxring_test();
+      check_test_memory_usage();
+#endif
+
       /* Verify that we can modify the signal mask */
 
       printf("\nuser_main: sigprocmask test\n");
@@ -600,6 +633,15 @@ static int user_main(int argc, char *argv[])
       check_test_memory_usage();
 #endif /* CONFIG_PRIORITY_INHERITANCE && !CONFIG_DISABLE_PTHREAD */
 
+#if defined(CONFIG_PRIORITY_INHERITANCE) && !defined(CONFIG_DISABLE_PTHREAD) && \
+    CONFIG_SEM_PREALLOCHOLDERS > 0
+      /* Verify how donated priorities are tracked and withdrawn */
+
+      printf("\nuser_main: priority donation test\n");
+      priority_donation_test();
+      check_test_memory_usage();
+#endif
+
 #ifndef CONFIG_DISABLE_PTHREAD
       printf("\nuser_main: scheduler lock test\n");
       sched_lock_test();
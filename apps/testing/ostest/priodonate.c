@@ -0,0 +1,475 @@
+/****************************************************************************
+ * apps/testing/ostest/priodonate.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define DONATE_TIMEOUT_MS 300  /* Timeout of the waits that give up */
+#define DONATE_SETTLE_MS  2000 /* Longest wait for a priority change */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static sem_t g_sema;     /* Priority inheritance semaphores */
+static sem_t g_semb;
+static sem_t g_step;     /* Lets the holder thread go on */
+static int g_basepri;    /* The lowest priority of the test threads */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: donate_getprio
+ ****************************************************************************/
+
+static int donate_getprio(pthread_t thread)
+{
+  struct sched_param sparam;
+  int policy;
+
+  if (pthread_getschedparam(thread, &policy, &sparam) != 0)
+    {
+      return -1;
+    }
+
+  return sparam.sched_priority;
+}
+
+/****************************************************************************
+ * Name: donate_expect
+ *
+ * Description:
+ *   Wait for the priority of a thread to settle at 'prio' and report an
+ *   error if it doesn't.
+ *
+ ****************************************************************************/
+
+static int donate_expect(FAR const char *what, pthread_t thread, int prio)
+{
+  int actual;
+  int ms;
+
+  for (ms = 0; ms < DONATE_SETTLE_MS; ms += 10)
+    {
+      actual = donate_getprio(thread);
+      if (actual == prio)
+        {
+          return 0;
+        }
+
+      usleep(10 * 1000);
+    }
+
+  printf("priority_donation: ERROR %s: priority %d, expected %d\n",
+         what, actual, prio);
+  ASSERT(false);
+  return 1;
+}
+
+/****************************************************************************
+ * Name: donate_taken
+ *
+ * Description:
+ *   Wait until the count of a semaphore drops to 'value' or below.
+ *
+ ****************************************************************************/
+
+static int donate_taken(FAR sem_t *sem, int value)
+{
+  int sval;
+  int ms;
+
+  for (ms = 0; ms < DONATE_SETTLE_MS; ms += 10)
+    {
+      sem_getvalue(sem, &sval);
+      if (sval <= value)
+        {
+          return 0;
+        }
+
+      usleep(10 * 1000);
+    }
+
+  printf("priority_donation: ERROR semaphore count stuck at %d\n", sval);
+  ASSERT(false);
+  return 1;
+}
+
+/****************************************************************************
+ * Name: donate_start
+ ****************************************************************************/
+
+static int donate_start(FAR pthread_t *thread, int prio,
+                        pthread_startroutine_t entry)
+{
+  struct sched_param sparam;
+  pthread_attr_t attr;
+  int status;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, STACKSIZE);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  sparam.sched_priority = prio;
+  pthread_attr_setschedparam(&attr, &sparam);
+
+  status = pthread_create(thread, &attr, entry, NULL);
+  pthread_attr_destroy(&attr);
+  if (status != 0)
+    {
+      printf("priority_donation: ERROR pthread_create failed: %d\n",
+             status);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: donate_setprio
+ ****************************************************************************/
+
+static void donate_setprio(pthread_t thread, int prio)
+{
+  struct sched_param sparam;
+
+  sparam.sched_priority = prio;
+  if (pthread_setschedparam(thread, SCHED_FIFO, &sparam) != 0)
+    {
+      printf("priority_donation: ERROR pthread_setschedparam failed\n");
+      ASSERT(false);
+    }
+}
+
+/****************************************************************************
+ * Name: donate_join
+ ****************************************************************************/
+
+static int donate_join(pthread_t thread)
+{
+  FAR void *result;
+
+  pthread_join(thread, &result);
+  return (int)(intptr_t)result;
+}
+
+/****************************************************************************
+ * Name: holder_both
+ *
+ * Description:
+ *   Hold both semaphores, then release them one step at a time.
+ *
+ ****************************************************************************/
+
+static FAR void *holder_both(FAR void *arg)
+{
+  sem_wait(&g_sema);
+  sem_wait(&g_semb);
+
+  sem_wait(&g_step);
+  sem_post(&g_sema);
+
+  sem_wait(&g_step);
+  sem_post(&g_semb);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: holder_a
+ ****************************************************************************/
+
+static FAR void *holder_a(FAR void *arg)
+{
+  sem_wait(&g_sema);
+  sem_wait(&g_step);
+  sem_post(&g_sema);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: holder_b_waiter_a
+ *
+ * Description:
+ *   Hold semaphore B while blocked on semaphore A, the middle link of a
+ *   chain of blocked holders.
+ *
+ ****************************************************************************/
+
+static FAR void *holder_b_waiter_a(FAR void *arg)
+{
+  sem_wait(&g_semb);
+  sem_wait(&g_sema);
+  sem_post(&g_sema);
+  sem_post(&g_semb);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: waiter_a
+ ****************************************************************************/
+
+static FAR void *waiter_a(FAR void *arg)
+{
+  sem_wait(&g_sema);
+  sem_post(&g_sema);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: waiter_b_timeout
+ *
+ * Description:
+ *   Wait for semaphore B, which is never released in time, and check that
+ *   the wait times out.
+ *
+ ****************************************************************************/
+
+static FAR void *waiter_b_timeout(FAR void *arg)
+{
+  struct timespec ts;
+  int ret;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += DONATE_TIMEOUT_MS * 1000000;
+  ts.tv_sec  += ts.tv_nsec / 1000000000;
+  ts.tv_nsec %= 1000000000;
+
+  ret = sem_timedwait(&g_semb, &ts);
+  if (ret == 0)
+    {
+      sem_post(&g_semb);
+      printf("priority_donation: ERROR sem_timedwait succeeded\n");
+      ASSERT(false);
+      return (FAR void *)1;
+    }
+
+  if (errno != ETIMEDOUT)
+    {
+      printf("priority_donation: ERROR sem_timedwait errno=%d\n", errno);
+      ASSERT(false);
+      return (FAR void *)1;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: donate_two_semaphores
+ *
+ * Description:
+ *   A thread holding two semaphores runs at the highest priority donated
+ *   through either of them.  Donations are withdrawn when a waiter times
+ *   out, follow a waiter that is reprioritized and go away with the
+ *   semaphore they were made through.
+ *
+ ****************************************************************************/
+
+static int donate_two_semaphores(void)
+{
+  pthread_t holder;
+  pthread_t waiter1;
+  pthread_t waiter2;
+  int nerrors = 0;
+
+  printf("priority_donation: Donations through two semaphores\n");
+
+  if (donate_start(&holder, g_basepri, holder_both) != 0)
+    {
+      return 1;
+    }
+
+  nerrors += donate_taken(&g_semb, 0);
+
+  if (donate_start(&waiter1, g_basepri + 10, waiter_a) != 0)
+    {
+      nerrors++;
+      goto out_holder;
+    }
+
+  nerrors += donate_expect("waiter on A", holder, g_basepri + 10);
+
+  if (donate_start(&waiter2, g_basepri + 20, waiter_b_timeout) != 0)
+    {
+      nerrors++;
+      goto out_waiter1;
+    }
+
+  nerrors += donate_expect("waiters on A and B", holder, g_basepri + 20);
+
+  /* The waiter on B times out and its donation is withdrawn */
+
+  nerrors += donate_join(waiter2);
+  nerrors += donate_expect("B timed out", holder, g_basepri + 10);
+
+  /* The donation follows the priority of the waiter on A */
+
+  donate_setprio(waiter1, g_basepri + 15);
+  nerrors += donate_expect("waiter raised", holder, g_basepri + 15);
+
+  donate_setprio(waiter1, g_basepri + 5);
+  nerrors += donate_expect("waiter lowered", holder, g_basepri + 5);
+
+  /* Releasing A gives it to the waiter and ends the donation */
+
+  sem_post(&g_step);
+  nerrors += donate_expect("A released", holder, g_basepri);
+
+out_waiter1:
+  sem_post(&g_step);
+  nerrors += donate_join(waiter1);
+
+out_holder:
+  sem_post(&g_step);
+  sem_post(&g_step);
+  nerrors += donate_join(holder);
+
+  /* Consume the steps that the holder didn't need */
+
+  while (sem_trywait(&g_step) == 0);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Name: donate_chain
+ *
+ * Description:
+ *   A donation made to a blocked holder is passed on to the holder of the
+ *   semaphore that it waits for, and withdrawn along the chain when the
+ *   donor times out.
+ *
+ ****************************************************************************/
+
+static int donate_chain(void)
+{
+  pthread_t low;
+  pthread_t middle;
+  pthread_t high;
+  int nerrors = 0;
+
+  printf("priority_donation: Donations along a chain of holders\n");
+
+  if (donate_start(&low, g_basepri, holder_a) != 0)
+    {
+      return 1;
+    }
+
+  nerrors += donate_taken(&g_sema, 0);
+
+  if (donate_start(&middle, g_basepri + 10, holder_b_waiter_a) != 0)
+    {
+      nerrors++;
+      goto out_low;
+    }
+
+  nerrors += donate_taken(&g_semb, 0);
+  nerrors += donate_expect("middle blocked", low, g_basepri + 10);
+
+  if (donate_start(&high, g_basepri + 20, waiter_b_timeout) != 0)
+    {
+      nerrors++;
+      goto out_middle;
+    }
+
+  nerrors += donate_expect("chain, middle", middle, g_basepri + 20);
+  nerrors += donate_expect("chain, low", low, g_basepri + 20);
+
+  /* The top of the chain times out */
+
+  nerrors += donate_join(high);
+  nerrors += donate_expect("timed out, middle", middle, g_basepri + 10);
+  nerrors += donate_expect("timed out, low", low, g_basepri + 10);
+
+out_middle:
+  sem_post(&g_step);
+  nerrors += donate_join(middle);
+
+out_low:
+  sem_post(&g_step);
+  nerrors += donate_join(low);
+
+  while (sem_trywait(&g_step) == 0);
+  return nerrors;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: priority_donation_test
+ ****************************************************************************/
+
+void priority_donation_test(void)
+{
+  struct sched_param sparam;
+  int nerrors = 0;
+
+  /* Keep all of the test threads below this one, so that it observes
+   * them without being preempted.
+   */
+
+  sched_getparam(0, &sparam);
+  g_basepri = sparam.sched_priority - 30;
+  if (g_basepri < sched_get_priority_min(SCHED_FIFO))
+    {
+      g_basepri = sched_get_priority_min(SCHED_FIFO);
+    }
+
+  sem_init(&g_sema, 0, 1);
+  sem_init(&g_semb, 0, 1);
+  sem_init(&g_step, 0, 0);
+  sem_setprotocol(&g_sema, SEM_PRIO_INHERIT);
+  sem_setprotocol(&g_semb, SEM_PRIO_INHERIT);
+  sem_setprotocol(&g_step, SEM_PRIO_NONE);
+
+  nerrors += donate_two_semaphores();
+  nerrors += donate_chain();
+
+  sem_destroy(&g_step);
+  sem_destroy(&g_semb);
+  sem_destroy(&g_sema);
+
+  printf("priority_donation: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+}
@@ -0,0 +1,355 @@
+/****************************************************************************
+ * apps/testing/ostest/splice.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SPLICE_BADFD   1000  /* Not an open descriptor */
+#define SPLICE_BIGSIZE 700   /* Two of these wrap around the pipe buffer */
+#define SPLICE_PARTIAL 40    /* Data offered to a socket with less room */
+#define SPLICE_ROOM    16    /* Room left in that socket */
+
+/* The file transfers use /dev/null.  Two of them in a row have to wrap
+ * around the end of the pipe buffer, so that the data leaves the buffer
+ * in two pieces.
+ */
+
+#if defined(CONFIG_DEV_NULL) && CONFIG_DEV_PIPE_SIZE >= SPLICE_BIGSIZE && \
+    CONFIG_DEV_PIPE_SIZE < 2 * SPLICE_BIGSIZE
+#  define SPLICE_FILES
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_hello[] = "hello, ";
+static const char g_world[] = "splice";
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int splice_expect(FAR const char *what, ssize_t ret,
+                         ssize_t expected)
+{
+  int errcode = ret < 0 ? errno : 0;
+
+  if ((expected >= 0 && ret != expected) ||
+      (expected < 0 && (ret >= 0 || errcode != -expected)))
+    {
+      printf("splice_test: ERROR %s returned %zd, errno=%d, "
+             "expected %zd\n", what, ret, errcode, expected);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+static int splice_readback(FAR const char *what, int fd,
+                           FAR const char *data, size_t len)
+{
+  char buffer[32];
+  ssize_t nread;
+
+  nread = read(fd, buffer, sizeof(buffer));
+  if (nread != len || memcmp(buffer, data, len) != 0)
+    {
+      printf("splice_test: ERROR %s read back %zd bytes\n", what, nread);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+static FAR void *splice_writer(FAR void *arg)
+{
+  int fd = (intptr_t)arg;
+
+  usleep(100 * 1000);
+  write(fd, g_world, strlen(g_world));
+  return NULL;
+}
+
+#ifdef CONFIG_NET_LOCAL_STREAM
+/* A socket that takes only part of the data leaves the rest in the pipe */
+
+static int splice_partial(FAR int *pa)
+{
+  char buffer[SPLICE_PARTIAL];
+  char tail[SPLICE_ROOM];
+  char c = 'x';
+  int nerrors = 0;
+  int sv[2];
+  int i;
+
+  printf("splice_test: Partial writes\n");
+
+  if (socketpair(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+    {
+      printf("splice_test: ERROR socketpair failed, errno=%d\n", errno);
+      ASSERT(false);
+      return 1;
+    }
+
+  /* Fill the socket, then make room for SPLICE_ROOM bytes */
+
+  while (write(sv[0], &c, 1) == 1);
+  nerrors += splice_expect("read, socket",
+                           read(sv[1], tail, SPLICE_ROOM), SPLICE_ROOM);
+
+  for (i = 0; i < SPLICE_PARTIAL; i++)
+    {
+      buffer[i] = 'a' + i;
+    }
+
+  nerrors += splice_expect("write", write(pa[1], buffer, SPLICE_PARTIAL),
+                           SPLICE_PARTIAL);
+  nerrors += splice_expect("splice, partial",
+                           splice(pa[0], NULL, sv[0], NULL,
+                                  SPLICE_PARTIAL, 0), SPLICE_ROOM);
+  nerrors += splice_expect("splice, socket full",
+                           splice(pa[0], NULL, sv[0], NULL,
+                                  SPLICE_PARTIAL, 0), -EAGAIN);
+
+  /* What the socket didn't take is still in the pipe */
+
+  nerrors += splice_readback("splice, partial", pa[0],
+                             buffer + SPLICE_ROOM,
+                             SPLICE_PARTIAL - SPLICE_ROOM);
+
+  /* And what it took ends the socket data */
+
+  while (read(sv[1], &c, 1) == 1)
+    {
+      memmove(tail, tail + 1, SPLICE_ROOM - 1);
+      tail[SPLICE_ROOM - 1] = c;
+    }
+
+  if (memcmp(tail, buffer, SPLICE_ROOM) != 0)
+    {
+      printf("splice_test: ERROR partial data corrupted\n");
+      ASSERT(false);
+      nerrors++;
+    }
+
+  close(sv[0]);
+  close(sv[1]);
+  return nerrors;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void splice_test(void)
+{
+  struct iovec iov[2];
+  pthread_attr_t attr;
+  pthread_t writer;
+  size_t hellolen = strlen(g_hello);
+  size_t worldlen = strlen(g_world);
+  int nerrors = 0;
+  int pa[2];
+  int pb[2];
+  int pc[2];
+  off_t off = 0;
+#ifdef SPLICE_FILES
+  char big[SPLICE_BIGSIZE];
+  int null;
+  int i;
+#endif
+  int ret;
+
+  if (pipe(pa) < 0 || pipe(pb) < 0 || pipe(pc) < 0)
+    {
+      printf("splice_test: ERROR pipe failed, errno=%d\n", errno);
+      ASSERT(false);
+      return;
+    }
+
+  /* Bad arguments */
+
+  printf("splice_test: Bad arguments\n");
+
+  nerrors += splice_expect("splice, bad descriptor",
+                           splice(SPLICE_BADFD, NULL, pb[1], NULL, 1, 0),
+                           -EBADF);
+  nerrors += splice_expect("splice, from a write end",
+                           splice(pa[1], NULL, pb[1], NULL, 1, 0), -EBADF);
+  nerrors += splice_expect("splice, offset on a pipe",
+                           splice(pa[0], &off, pb[1], NULL, 1, 0),
+                           -ESPIPE);
+  nerrors += splice_expect("splice, into itself",
+                           splice(pa[0], NULL, pa[1], NULL, 1, 0),
+                           -EINVAL);
+  nerrors += splice_expect("vmsplice, not a pipe",
+                           vmsplice(SPLICE_BADFD, iov, 1, 0), -EBADF);
+
+  /* Empty pipes */
+
+  printf("splice_test: Empty pipes\n");
+
+  nerrors += splice_expect("splice, empty",
+                           splice(pa[0], NULL, pb[1], NULL, 16,
+                                  SPLICE_F_NONBLOCK), -EAGAIN);
+  nerrors += splice_expect("tee, empty",
+                           tee(pa[0], pb[1], 16, SPLICE_F_NONBLOCK),
+                           -EAGAIN);
+
+  /* vmsplice() in, tee() copies, splice() moves */
+
+  printf("splice_test: vmsplice, tee and splice\n");
+
+  iov[0].iov_base = (FAR void *)g_hello;
+  iov[0].iov_len  = hellolen;
+  iov[1].iov_base = (FAR void *)g_world;
+  iov[1].iov_len  = worldlen;
+  nerrors += splice_expect("vmsplice", vmsplice(pa[1], iov, 2, 0),
+                           hellolen + worldlen);
+
+  nerrors += splice_expect("tee", tee(pa[0], pb[1], hellolen, 0), hellolen);
+  nerrors += splice_readback("tee", pb[0], g_hello, hellolen);
+
+  nerrors += splice_expect("splice",
+                           splice(pa[0], NULL, pc[1], NULL, 64, 0),
+                           hellolen + worldlen);
+  nerrors += splice_readback("splice", pc[0], "hello, splice",
+                             hellolen + worldlen);
+  nerrors += splice_expect("splice, drained",
+                           splice(pa[0], NULL, pb[1], NULL, 16,
+                                  SPLICE_F_NONBLOCK), -EAGAIN);
+
+  /* A blocking splice() waits for the writer */
+
+  printf("splice_test: Blocking splice\n");
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, STACKSIZE);
+  ret = pthread_create(&writer, &attr, splice_writer,
+                       (FAR void *)(intptr_t)pa[1]);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+    {
+      printf("splice_test: ERROR pthread_create failed: %d\n", ret);
+      ASSERT(false);
+      nerrors++;
+    }
+  else
+    {
+      nerrors += splice_expect("splice, blocking",
+                               splice(pa[0], NULL, pb[1], NULL, 64, 0),
+                               worldlen);
+      pthread_join(writer, NULL);
+      nerrors += splice_readback("splice, blocking", pb[0],
+                                 g_world, worldlen);
+    }
+
+#ifdef SPLICE_FILES
+  /* To and from a file, across the end of the pipe buffer */
+
+  printf("splice_test: Files\n");
+
+  null = open("/dev/null", O_RDWR);
+  if (null < 0)
+    {
+      printf("splice_test: ERROR open /dev/null failed, errno=%d\n", errno);
+      ASSERT(false);
+      nerrors++;
+    }
+  else
+    {
+      nerrors += splice_expect("splice, no pipe",
+                               splice(null, NULL, null, NULL, 1, 0),
+                               -EINVAL);
+      nerrors += splice_expect("tee, no pipe",
+                               tee(null, pb[1], 1, 0), -EINVAL);
+
+      memset(big, 0x5a, sizeof(big));
+      for (i = 0; i < 2; i++)
+        {
+          nerrors += splice_expect("write",
+                                   write(pa[1], big, sizeof(big)),
+                                   sizeof(big));
+          nerrors += splice_expect("splice, to a file",
+                                   splice(pa[0], NULL, null, NULL,
+                                          sizeof(big), 0), sizeof(big));
+        }
+
+      nerrors += splice_expect("splice, from a file at its end",
+                               splice(null, NULL, pa[1], NULL,
+                                      sizeof(big), 0), 0);
+      close(null);
+    }
+#endif
+
+#ifdef CONFIG_NET_LOCAL_STREAM
+  nerrors += splice_partial(pa);
+#endif
+
+  /* The other end of the pipes went away */
+
+  printf("splice_test: Closed pipes\n");
+
+  nerrors += splice_expect("write", write(pa[1], g_hello, hellolen),
+                           hellolen);
+  close(pb[0]);
+  nerrors += splice_expect("splice, no reader",
+                           splice(pa[0], NULL, pb[1], NULL, 64, 0),
+                           -EPIPE);
+  nerrors += splice_readback("splice, no reader", pa[0], g_hello,
+                             hellolen);
+
+  close(pa[1]);
+  nerrors += splice_expect("splice, no writer",
+                           splice(pa[0], NULL, pc[1], NULL, 64, 0), 0);
+
+  close(pa[0]);
+  close(pb[1]);
+  close(pc[0]);
+  close(pc[1]);
+
+  printf("splice_test: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+}
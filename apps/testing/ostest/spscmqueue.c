@@ -0,0 +1,359 @@
+/****************************************************************************
+ * apps/testing/ostest/spscmqueue.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ostest.h"
+
+/****************************************************************************
+ * Private Definitions
+ ****************************************************************************/
+
+#define SPSC_MQNAME     "spscmq"
+#define SPSC_MSGSIZE    16
+#define SPSC_MAXMSG     4    /* Already a power of two, no rounding */
+#define SPSC_NMSGS      64   /* Messages streamed through the ring */
+#define SPSC_TIMEOUT_MS 100  /* Timeout of the timed operations */
+#define SPSC_SLACK_MS   1000 /* Upper bound on how late a timeout may be */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static mqd_t spsc_open(int oflags)
+{
+  struct mq_attr attr;
+
+  attr.mq_maxmsg  = SPSC_MAXMSG;
+  attr.mq_msgsize = SPSC_MSGSIZE;
+  attr.mq_flags   = MQ_SPSC;
+
+  return mq_open(SPSC_MQNAME, oflags | O_CREAT, 0666, &attr);
+}
+
+static void spsc_deadline(FAR struct timespec *ts, int msec)
+{
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_nsec += (msec % 1000) * 1000000;
+  ts->tv_sec  += msec / 1000 + ts->tv_nsec / 1000000000;
+  ts->tv_nsec %= 1000000000;
+}
+
+static int spsc_elapsed(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000 +
+         (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/* Check that a timed operation failed with ETIMEDOUT after about
+ * SPSC_TIMEOUT_MS, and neither early nor much later.
+ */
+
+static int spsc_check_timeout(FAR const char *what, int ret,
+                              FAR const struct timespec *start)
+{
+  int elapsed = spsc_elapsed(start);
+
+  if (ret >= 0 || errno != ETIMEDOUT)
+    {
+      printf("spscmqueue_test: ERROR %s returned %d, errno=%d, "
+             "expected ETIMEDOUT\n", what, ret, ret < 0 ? errno : 0);
+      ASSERT(false);
+      return 1;
+    }
+
+  if (elapsed < SPSC_TIMEOUT_MS - 10 ||
+      elapsed > SPSC_TIMEOUT_MS + SPSC_SLACK_MS)
+    {
+      printf("spscmqueue_test: ERROR %s timed out after %d ms\n",
+             what, elapsed);
+      ASSERT(false);
+      return 1;
+    }
+
+  return 0;
+}
+
+static FAR void *spsc_consumer(FAR void *arg)
+{
+  char msg[SPSC_MSGSIZE];
+  struct timespec ts;
+  uint32_t seq;
+  ssize_t nbytes;
+  int nerrors = 0;
+  mqd_t mqfd;
+  int i;
+
+  mqfd = spsc_open(O_RDONLY);
+  if (mqfd == (mqd_t)-1)
+    {
+      printf("spsc_consumer: ERROR mq_open failed, errno=%d\n", errno);
+      ASSERT(false);
+      return (FAR void *)1;
+    }
+
+  for (i = 0; i < SPSC_NMSGS; i++)
+    {
+      spsc_deadline(&ts, 5000);
+      nbytes = mq_timedreceive(mqfd, msg, sizeof(msg), NULL, &ts);
+      if (nbytes != sizeof(seq))
+        {
+          printf("spsc_consumer: ERROR mq_timedreceive %d returned %zd, "
+                 "errno=%d\n", i, nbytes, errno);
+          ASSERT(false);
+          nerrors++;
+          break;
+        }
+
+      memcpy(&seq, msg, sizeof(seq));
+      if (seq != (uint32_t)i)
+        {
+          printf("spsc_consumer: ERROR got message %" PRIu32
+                 ", expected %d\n", seq, i);
+          ASSERT(false);
+          nerrors++;
+        }
+    }
+
+  mq_close(mqfd);
+  return (FAR void *)((uintptr_t)nerrors);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void spscmqueue_test(void)
+{
+  static const unsigned int prios[SPSC_MAXMSG] =
+  {
+    1, 4, 2, 3
+  };
+
+  char msg[SPSC_MSGSIZE + 1];
+  struct timespec start;
+  struct timespec ts;
+  struct mq_attr attr;
+  pthread_attr_t pattr;
+  pthread_t consumer;
+  FAR void *result;
+  unsigned int prio;
+  uint32_t seq;
+  ssize_t nbytes;
+  int nerrors = 0;
+  mqd_t wrfd;
+  mqd_t rdfd;
+  mqd_t nbwrfd;
+  mqd_t nbrdfd;
+  int ret;
+  int i;
+
+  wrfd   = spsc_open(O_WRONLY);
+  rdfd   = spsc_open(O_RDONLY);
+  nbwrfd = spsc_open(O_WRONLY | O_NONBLOCK);
+  nbrdfd = spsc_open(O_RDONLY | O_NONBLOCK);
+  if (wrfd == (mqd_t)-1 || rdfd == (mqd_t)-1 ||
+      nbwrfd == (mqd_t)-1 || nbrdfd == (mqd_t)-1)
+    {
+      printf("spscmqueue_test: ERROR mq_open failed, errno=%d\n", errno);
+      ASSERT(false);
+      goto errout;
+    }
+
+  ret = mq_getattr(wrfd, &attr);
+  if (ret < 0 || (attr.mq_flags & MQ_SPSC) == 0 ||
+      attr.mq_maxmsg != SPSC_MAXMSG || attr.mq_curmsgs != 0)
+    {
+      printf("spscmqueue_test: ERROR not an empty MQ_SPSC queue\n");
+      ASSERT(false);
+      goto errout;
+    }
+
+  /* An empty ring: EAGAIN without waiting, ETIMEDOUT after waiting */
+
+  printf("spscmqueue_test: Receiving from an empty queue\n");
+
+  nbytes = mq_receive(nbrdfd, msg, SPSC_MSGSIZE, NULL);
+  if (nbytes >= 0 || errno != EAGAIN)
+    {
+      printf("spscmqueue_test: ERROR non-blocking mq_receive returned "
+             "%zd, errno=%d\n", nbytes, errno);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  spsc_deadline(&ts, SPSC_TIMEOUT_MS);
+  nbytes = mq_timedreceive(rdfd, msg, SPSC_MSGSIZE, NULL, &ts);
+  nerrors += spsc_check_timeout("mq_timedreceive", nbytes, &start);
+
+  /* Fill the ring with priorities out of order */
+
+  printf("spscmqueue_test: Filling the queue\n");
+
+  for (i = 0; i < SPSC_MAXMSG; i++)
+    {
+      seq = i;
+      memset(msg, 0, sizeof(msg));
+      memcpy(msg, &seq, sizeof(seq));
+      if (mq_send(wrfd, msg, sizeof(seq), prios[i]) < 0)
+        {
+          printf("spscmqueue_test: ERROR mq_send %d failed, errno=%d\n",
+                 i, errno);
+          ASSERT(false);
+          nerrors++;
+        }
+    }
+
+  /* A full ring: EAGAIN without waiting, ETIMEDOUT after waiting */
+
+  printf("spscmqueue_test: Sending to a full queue\n");
+
+  ret = mq_send(nbwrfd, msg, sizeof(seq), 1);
+  if (ret >= 0 || errno != EAGAIN)
+    {
+      printf("spscmqueue_test: ERROR non-blocking mq_send returned %d, "
+             "errno=%d\n", ret, errno);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  spsc_deadline(&ts, SPSC_TIMEOUT_MS);
+  ret = mq_timedsend(wrfd, msg, sizeof(seq), 1, &ts);
+  nerrors += spsc_check_timeout("mq_timedsend", ret, &start);
+
+  /* Oversized messages and undersized buffers are refused */
+
+  ret = mq_send(nbwrfd, msg, SPSC_MSGSIZE + 1, 1);
+  if (ret >= 0 || errno != EMSGSIZE)
+    {
+      printf("spscmqueue_test: ERROR oversized mq_send returned %d, "
+             "errno=%d\n", ret, errno);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  nbytes = mq_receive(nbrdfd, msg, SPSC_MSGSIZE - 1, NULL);
+  if (nbytes >= 0 || errno != EMSGSIZE)
+    {
+      printf("spscmqueue_test: ERROR short mq_receive returned %zd, "
+             "errno=%d\n", nbytes, errno);
+      ASSERT(false);
+      nerrors++;
+    }
+
+  /* The messages come out in FIFO order, with their priorities */
+
+  printf("spscmqueue_test: Draining the queue\n");
+
+  for (i = 0; i < SPSC_MAXMSG; i++)
+    {
+      nbytes = mq_receive(nbrdfd, msg, SPSC_MSGSIZE, &prio);
+      memcpy(&seq, msg, sizeof(seq));
+      if (nbytes != sizeof(seq) || seq != (uint32_t)i || prio != prios[i])
+        {
+          printf("spscmqueue_test: ERROR message %d: size %zd seq %" PRIu32
+                 " prio %u\n", i, nbytes, seq, prio);
+          ASSERT(false);
+          nerrors++;
+        }
+    }
+
+  /* Stream through the ring with the consumer blocking on empty and the
+   * producer blocking on full.
+   */
+
+  printf("spscmqueue_test: Streaming %d messages\n", SPSC_NMSGS);
+
+  pthread_attr_init(&pattr);
+  pthread_attr_setstacksize(&pattr, STACKSIZE);
+  ret = pthread_create(&consumer, &pattr, spsc_consumer, NULL);
+  pthread_attr_destroy(&pattr);
+  if (ret != 0)
+    {
+      printf("spscmqueue_test: ERROR pthread_create failed: %d\n", ret);
+      ASSERT(false);
+      goto errout;
+    }
+
+  for (i = 0; i < SPSC_NMSGS; i++)
+    {
+      seq = i;
+      spsc_deadline(&ts, 5000);
+      if (mq_timedsend(wrfd, (FAR const char *)&seq, sizeof(seq), 1,
+                       &ts) < 0)
+        {
+          printf("spscmqueue_test: ERROR mq_timedsend %d failed, "
+                 "errno=%d\n", i, errno);
+          ASSERT(false);
+          nerrors++;
+          break;
+        }
+    }
+
+  pthread_join(consumer, &result);
+  nerrors += (int)(uintptr_t)result;
+
+errout:
+  if (nbrdfd != (mqd_t)-1)
+    {
+      mq_close(nbrdfd);
+    }
+
+  if (nbwrfd != (mqd_t)-1)
+    {
+      mq_close(nbwrfd);
+    }
+
+  if (rdfd != (mqd_t)-1)
+    {
+      mq_close(rdfd);
+    }
+
+  if (wrfd != (mqd_t)-1)
+    {
+      mq_close(wrfd);
+    }
+
+  mq_unlink(SPSC_MQNAME);
+  printf("spscmqueue_test: %s, nerrors=%d\n",
+         nerrors == 0 ? "PASSED" : "FAILED", nerrors);
+}
@@ -45,7 +45,7 @@ struct __lock
 #  if CONFIG_SEM_PREALLOCHOLDERS > 0
   int reserved[6];
 #  else
-  int reserved[9];
+  int reserved[13];
 #  endif
 #else
   int reserved[5];
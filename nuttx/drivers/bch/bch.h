@@ -35,6 +35,7 @@
 
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/drivers/blkcache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -42,6 +43,20 @@
 
 #define MAX_OPENCNT       (255)                  /* Limit of uint8_t */
 
+/* Transfers to the block driver, through the block cache if enabled */
+
+#ifdef CONFIG_BCH_BLKCACHE
+#  define bchlib_readblocks(b, buf, s, n)  \
+     blkcache_read(&(b)->cache, s, n, buf)
+#  define bchlib_writeblocks(b, buf, s, n) \
+     blkcache_write(&(b)->cache, s, n, buf)
+#else
+#  define bchlib_readblocks(b, buf, s, n)  \
+     (b)->inode->u.i_bops->read((b)->inode, buf, s, n)
+#  define bchlib_writeblocks(b, buf, s, n) \
+     (b)->inode->u.i_bops->write((b)->inode, buf, s, n)
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -59,6 +74,10 @@ struct bchlib_s
   bool unlinked;           /* true: The driver has been unlinked */
   FAR uint8_t *buffer;     /* One sector buffer */
 
+#ifdef CONFIG_BCH_BLKCACHE
+  struct blkcache_s cache; /* Multi-sector cache of the block driver */
+#endif
+
 #if defined(CONFIG_BCH_ENCRYPTION)
   uint8_t key[CONFIG_BCH_ENCRYPTION_KEY_SIZE];  /* Encryption key */
 #endif
@@ -173,6 +173,9 @@ static int bch_close(FAR struct file *filep)
   /* Flush any dirty pages remaining in the cache */
 
   bchlib_flushsector(bch, false);
+#ifdef CONFIG_BCH_BLKCACHE
+  blkcache_flush(&bch->cache);
+#endif
 
   /* Decrement the reference count (I don't use bchlib_decref() because I
    * want the entire close operation to be atomic wrt other driver
@@ -439,6 +442,24 @@ static int bch_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
         {
           /* Invalidate the sector so next read is from the device- */
 
+#ifdef CONFIG_BCH_BLKCACHE
+          /* The cache may hold writes that aren't on the device yet, write
+           * them back before dropping the cached copies.
+           */
+
+          ret = bchlib_flushsector(bch, false);
+          if (ret >= 0)
+            {
+              ret = blkcache_flush(&bch->cache);
+            }
+
+          if (ret < 0)
+            {
+              break;
+            }
+
+          blkcache_invalidate(&bch->cache);
+#endif
           bch->sector = (size_t)-1;
           goto ioctl_default;
         }
@@ -448,6 +469,13 @@ static int bch_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
           /* Flush any dirty pages remaining in the cache */
 
           ret = bchlib_flushsector(bch, false);
+#ifdef CONFIG_BCH_BLKCACHE
+          if (ret >= 0)
+            {
+              ret = blkcache_flush(&bch->cache);
+            }
+#endif
+
           if (ret < 0)
             {
               break;
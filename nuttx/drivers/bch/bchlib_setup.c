@@ -42,6 +42,36 @@
 
 #include "bch.h"
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bchlib_cachereload and bchlib_cacheflush
+ *
+ * Description:
+ *   Block cache callouts to the underlying block driver
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_BCH_BLKCACHE
+static ssize_t bchlib_cachereload(FAR void *dev, FAR uint8_t *buffer,
+                                  off_t startblock, size_t nblocks)
+{
+  FAR struct inode *inode = dev;
+
+  return inode->u.i_bops->read(inode, buffer, startblock, nblocks);
+}
+
+static ssize_t bchlib_cacheflush(FAR void *dev, FAR const uint8_t *buffer,
+                                 off_t startblock, size_t nblocks)
+{
+  FAR struct inode *inode = dev;
+
+  return inode->u.i_bops->write(inode, buffer, startblock, nblocks);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -113,6 +143,29 @@ int bchlib_setup(FAR const char *blkdev, int oflags, FAR void **handle)
   bch->sectsize = geo.geo_sectorsize;
   bch->sector   = (size_t)-1;
   bch->readonly = readonly;
+
+#ifdef CONFIG_BCH_BLKCACHE
+  /* Set up the multi-sector cache in front of the block driver */
+
+  bch->cache.blocksize    = geo.geo_sectorsize;
+  bch->cache.nblocks      = geo.geo_nsectors;
+  bch->cache.nlines       = CONFIG_DRVR_BLKCACHE_NLINES;
+  bch->cache.lineblocks   = CONFIG_DRVR_BLKCACHE_LINEBLOCKS;
+  bch->cache.maxreadahead = CONFIG_DRVR_BLKCACHE_READAHEAD;
+  bch->cache.wrdelay      = CONFIG_DRVR_BLKCACHE_WRDELAY;
+  bch->cache.dev          = bch->inode;
+  bch->cache.reload       = bchlib_cachereload;
+  bch->cache.flush        = bchlib_cacheflush;
+
+  ret = blkcache_initialize(&bch->cache);
+  if (ret < 0)
+    {
+      ferr("ERROR: blkcache_initialize failed: %d\n", -ret);
+      nxmutex_destroy(&bch->lock);
+      goto errout_with_bch;
+    }
+#endif
+
   *handle = bch;
   return OK;
 
@@ -66,6 +66,12 @@ int bchlib_teardown(FAR void *handle)
 
   bchlib_flushsector(bch, false);
 
+#ifdef CONFIG_BCH_BLKCACHE
+  /* Write back and release the multi-sector cache */
+
+  blkcache_uninitialize(&bch->cache);
+#endif
+
   /* Close the block driver */
 
   close_blockdriver(bch->inode);
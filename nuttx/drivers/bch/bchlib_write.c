@@ -187,8 +187,8 @@ ssize_t bchlib_write(FAR void *handle, FAR const char *buffer, off_t offset,
 
       /* Write the contiguous sectors */
 
-      ret = bch->inode->u.i_bops->write(bch->inode, (FAR uint8_t *)buffer,
-                                        sector, nsectors);
+      ret = bchlib_writeblocks(bch, (FAR uint8_t *)buffer, sector,
+                               nsectors);
       if (ret < 0)
         {
           ferr("ERROR: Write failed: %d\n", ret);
@@ -0,0 +1,999 @@
+/****************************************************************************
+ * drivers/misc/blkcache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/drivers/blkcache.h>
+
+#ifdef CONFIG_DRVR_BLKCACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BLKCACHE_MAXLINEBLOCKS  32
+#define BLKCACHE_MAXRETRY       3
+
+#define blkcache_linesize(c)    ((size_t)(c)->lineblocks * (c)->blocksize)
+#define blkcache_firstblock(c, l) ((off_t)(l) * (c)->lineblocks)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: blkcache_mask
+ *
+ * Description:
+ *   Return the dirty mask of 'nblocks' blocks starting at block 'offset' of
+ *   a line.
+ *
+ ****************************************************************************/
+
+static inline uint32_t blkcache_mask(unsigned int offset,
+                                     unsigned int nblocks)
+{
+  return (nblocks >= BLKCACHE_MAXLINEBLOCKS ?
+          UINT32_MAX : (UINT32_C(1) << nblocks) - 1) << offset;
+}
+
+/****************************************************************************
+ * Name: blkcache_lineblocks
+ *
+ * Description:
+ *   Return the number of blocks of a line, the last line of the device may
+ *   be short.
+ *
+ ****************************************************************************/
+
+static inline size_t blkcache_lineblocks(FAR struct blkcache_s *cache,
+                                         off_t line)
+{
+  size_t remaining = cache->nblocks - blkcache_firstblock(cache, line);
+
+  return remaining < cache->lineblocks ? remaining : cache->lineblocks;
+}
+
+/****************************************************************************
+ * Name: blkcache_find
+ ****************************************************************************/
+
+static FAR struct blkcache_line_s *
+blkcache_find(FAR struct blkcache_s *cache, off_t line)
+{
+  FAR struct blkcache_line_s *l;
+
+  for (l = cache->hash[line & cache->hmask]; l != NULL; l = l->hnext)
+    {
+      if (l->line == line)
+        {
+          break;
+        }
+    }
+
+  return l;
+}
+
+/****************************************************************************
+ * Name: blkcache_sethash
+ ****************************************************************************/
+
+static void blkcache_sethash(FAR struct blkcache_s *cache,
+                             FAR struct blkcache_line_s *l, off_t line)
+{
+  FAR struct blkcache_line_s **bucket = &cache->hash[line & cache->hmask];
+
+  l->line  = line;
+  l->hnext = *bucket;
+  *bucket  = l;
+}
+
+/****************************************************************************
+ * Name: blkcache_unhash
+ ****************************************************************************/
+
+static void blkcache_unhash(FAR struct blkcache_s *cache,
+                            FAR struct blkcache_line_s *l)
+{
+  FAR struct blkcache_line_s **prev = &cache->hash[l->line & cache->hmask];
+
+  while (*prev != l)
+    {
+      prev = &(*prev)->hnext;
+    }
+
+  *prev    = l->hnext;
+  l->hnext = NULL;
+  l->line  = -1;
+}
+
+/****************************************************************************
+ * Name: blkcache_touch
+ *
+ * Description:
+ *   Make a line the most recently used one.
+ *
+ ****************************************************************************/
+
+static inline void blkcache_touch(FAR struct blkcache_s *cache,
+                                  FAR struct blkcache_line_s *l)
+{
+  list_delete(&l->node);
+  list_add_head(&cache->lru, &l->node);
+}
+
+/****************************************************************************
+ * Name: blkcache_failed
+ *
+ * Description:
+ *   Account a failed write back of a line.  The line stays dirty until it
+ *   is written back, so the data is never lost silently.  After
+ *   BLKCACHE_MAXRETRY failures in a row the write back timer stops
+ *   retrying it, but every blkcache_flush() and every attempt to evict it
+ *   still do.  The error is kept for blkcache_flush().
+ *
+ ****************************************************************************/
+
+static int blkcache_failed(FAR struct blkcache_s *cache,
+                           FAR struct blkcache_line_s *l, int error)
+{
+  cache->error = error;
+  if (l->nfail < BLKCACHE_MAXRETRY && ++l->nfail == BLKCACHE_MAXRETRY)
+    {
+      ferr("ERROR: Line %jd keeps failing to be written back\n",
+           (intmax_t)l->line);
+    }
+
+  return error;
+}
+
+/****************************************************************************
+ * Name: blkcache_retry
+ *
+ * Description:
+ *   Return true if a dirty line is worth another write back attempt by the
+ *   timer.
+ *
+ ****************************************************************************/
+
+static bool blkcache_retry(FAR struct blkcache_s *cache)
+{
+  size_t i;
+
+  for (i = 0; i < cache->nlines; i++)
+    {
+      if (cache->lines[i].dirty != 0 &&
+          cache->lines[i].nfail < BLKCACHE_MAXRETRY)
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: blkcache_writeline
+ *
+ * Description:
+ *   Write the dirty blocks of a line back to the device, one transfer per
+ *   run of consecutive dirty blocks.
+ *
+ ****************************************************************************/
+
+static int blkcache_writeline(FAR struct blkcache_s *cache,
+                              FAR struct blkcache_line_s *l)
+{
+  off_t first = blkcache_firstblock(cache, l->line);
+  size_t nblocks = blkcache_lineblocks(cache, l->line);
+  size_t i = 0;
+  size_t j;
+  ssize_t ret;
+
+  while (i < nblocks)
+    {
+      if ((l->dirty & (UINT32_C(1) << i)) == 0)
+        {
+          i++;
+          continue;
+        }
+
+      for (j = i + 1; j < nblocks && (l->dirty & (UINT32_C(1) << j)); j++);
+
+      ret = cache->flush(cache->dev, &l->data[i * cache->blocksize],
+                         first + i, j - i);
+      if (ret != (ssize_t)(j - i))
+        {
+          ferr("ERROR: Write of %zu blocks at %jd failed: %zd\n",
+               j - i, (intmax_t)(first + i), ret);
+          return blkcache_failed(cache, l, ret < 0 ? ret : -EIO);
+        }
+
+      i = j;
+    }
+
+  l->dirty = 0;
+  l->nfail = 0;
+  cache->ndirty--;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: blkcache_flushall
+ *
+ * Description:
+ *   Write all dirty lines back in ascending order.  Runs of consecutive,
+ *   completely dirty lines are written with a single transfer through the
+ *   staging buffer.  A line that fails doesn't hold up the lines after it,
+ *   the first error is returned once all were tried.
+ *
+ * Assumptions:
+ *   The caller holds the cache lock
+ *
+ ****************************************************************************/
+
+static int blkcache_flushall(FAR struct blkcache_s *cache)
+{
+  FAR struct blkcache_line_s *first;
+  FAR struct blkcache_line_s *l;
+  size_t linesize = blkcache_linesize(cache);
+  off_t next = 0;
+  size_t nblocks;
+  size_t count;
+  size_t i;
+  ssize_t ret;
+  int error = OK;
+
+  while (cache->ndirty > 0)
+    {
+      /* Find the dirty line with the lowest line number not tried yet */
+
+      first = NULL;
+      for (i = 0; i < cache->nlines; i++)
+        {
+          l = &cache->lines[i];
+          if (l->dirty != 0 && l->line >= next &&
+              (first == NULL || l->line < first->line))
+            {
+              first = l;
+            }
+        }
+
+      if (first == NULL)
+        {
+          break;
+        }
+
+      /* Collect the completely dirty lines following it */
+
+      nblocks = blkcache_lineblocks(cache, first->line);
+      count   = 1;
+
+      if (cache->rabuffer != NULL &&
+          first->dirty == blkcache_mask(0, nblocks))
+        {
+          while (count <= cache->maxreadahead)
+            {
+              l = blkcache_find(cache, first->line + count);
+              if (l == NULL || l->dirty !=
+                  blkcache_mask(0, blkcache_lineblocks(cache, l->line)))
+                {
+                  break;
+                }
+
+              memcpy(&cache->rabuffer[count * linesize], l->data,
+                     linesize);
+              nblocks += blkcache_lineblocks(cache, l->line);
+              count++;
+            }
+        }
+
+      next = first->line + count;
+      if (count == 1)
+        {
+          ret = blkcache_writeline(cache, first);
+          if (ret < 0 && error == OK)
+            {
+              error = ret;
+            }
+
+          continue;
+        }
+
+      memcpy(cache->rabuffer, first->data, linesize);
+      ret = cache->flush(cache->dev, cache->rabuffer,
+                         blkcache_firstblock(cache, first->line), nblocks);
+      if (ret != (ssize_t)nblocks)
+        {
+          /* Retry the lines one by one, to find the failing ones */
+
+          ferr("ERROR: Write of %zu blocks failed: %zd\n", nblocks, ret);
+          for (i = 0; i < count; i++)
+            {
+              ret = blkcache_writeline(cache,
+                                       blkcache_find(cache,
+                                                     first->line + i));
+              if (ret < 0 && error == OK)
+                {
+                  error = ret;
+                }
+            }
+
+          continue;
+        }
+
+      for (i = 0; i < count; i++)
+        {
+          l = blkcache_find(cache, first->line + i);
+          l->dirty = 0;
+          l->nfail = 0;
+        }
+
+      cache->ndirty -= count;
+    }
+
+  return error;
+}
+
+/****************************************************************************
+ * Name: blkcache_flushrange
+ *
+ * Description:
+ *   Write back the dirty lines overlapping a range of blocks.
+ *
+ ****************************************************************************/
+
+static int blkcache_flushrange(FAR struct blkcache_s *cache,
+                               off_t startblock, size_t nblocks)
+{
+  FAR struct blkcache_line_s *l;
+  off_t first;
+  size_t i;
+  int ret;
+
+  for (i = 0; i < cache->nlines && cache->ndirty > 0; i++)
+    {
+      l = &cache->lines[i];
+      if (l->dirty == 0)
+        {
+          continue;
+        }
+
+      first = blkcache_firstblock(cache, l->line);
+      if (first < startblock + (off_t)nblocks &&
+          startblock < first + cache->lineblocks)
+        {
+          ret = blkcache_writeline(cache, l);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: blkcache_victim
+ *
+ * Description:
+ *   Free the least recently used line for reuse, writing it back if it is
+ *   dirty.  A line that can't be written back is moved to the head of the
+ *   LRU list, to be retried later, and the next one is tried instead.
+ *
+ ****************************************************************************/
+
+static int blkcache_victim(FAR struct blkcache_s *cache,
+                           FAR struct blkcache_line_s **victim)
+{
+  FAR struct blkcache_line_s *l;
+  int ret = OK;
+  size_t i;
+
+  for (i = 0; i < cache->nlines; i++)
+    {
+      l = list_last_entry(&cache->lru, struct blkcache_line_s, node);
+      if (l->line >= 0)
+        {
+          if (l->dirty != 0)
+            {
+              ret = blkcache_writeline(cache, l);
+              if (ret < 0 && l->dirty != 0)
+                {
+                  blkcache_touch(cache, l);
+                  continue;
+                }
+            }
+
+          blkcache_unhash(cache, l);
+        }
+
+      *victim = l;
+      return OK;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: blkcache_load
+ *
+ * Description:
+ *   Load 'count' consecutive lines, none of them cached yet, with a single
+ *   device transfer and return the first of them.
+ *
+ ****************************************************************************/
+
+static int blkcache_load(FAR struct blkcache_s *cache, off_t line,
+                         size_t count, FAR struct blkcache_line_s **first)
+{
+  FAR struct blkcache_line_s *l;
+  size_t linesize = blkcache_linesize(cache);
+  off_t startblock = blkcache_firstblock(cache, line);
+  size_t nblocks;
+  ssize_t ret;
+  size_t i;
+
+  nblocks = cache->nblocks - startblock;
+  if (nblocks > count * cache->lineblocks)
+    {
+      nblocks = count * cache->lineblocks;
+    }
+
+  if (count == 1)
+    {
+      ret = blkcache_victim(cache, &l);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = cache->reload(cache->dev, l->data, startblock, nblocks);
+      if (ret != (ssize_t)nblocks)
+        {
+          goto errout;
+        }
+
+      blkcache_sethash(cache, l, line);
+      blkcache_touch(cache, l);
+      *first = l;
+      return OK;
+    }
+
+  ret = cache->reload(cache->dev, cache->rabuffer, startblock, nblocks);
+  if (ret != (ssize_t)nblocks)
+    {
+      goto errout;
+    }
+
+  /* Hand out the lines in reverse order so that the requested line ends up
+   * as the most recently used one.
+   */
+
+  for (i = count; i-- > 0; )
+    {
+      ret = blkcache_victim(cache, &l);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      memcpy(l->data, &cache->rabuffer[i * linesize], linesize);
+      blkcache_sethash(cache, l, line + i);
+      blkcache_touch(cache, l);
+    }
+
+  *first = l;
+  return OK;
+
+errout:
+  ferr("ERROR: Read of %zu blocks at %jd failed: %zd\n",
+       nblocks, (intmax_t)startblock, ret);
+  return ret < 0 ? ret : -EIO;
+}
+
+/****************************************************************************
+ * Name: blkcache_timeout
+ ****************************************************************************/
+
+static void blkcache_timeout(FAR void *arg)
+{
+  FAR struct blkcache_s *cache = arg;
+  int ret;
+
+  if (nxmutex_lock(&cache->lock) < 0)
+    {
+      return;
+    }
+
+  /* Try again later if a line couldn't be written back.  The timer gives
+   * up on a line after a few attempts, so this does not go on forever,
+   * but the line stays dirty and the error is left for blkcache_flush().
+   */
+
+  ret = blkcache_flushall(cache);
+  if (ret < 0 && blkcache_retry(cache))
+    {
+      work_queue(LPWORK, &cache->work, blkcache_timeout, cache,
+                 MSEC2TICK(cache->wrdelay));
+    }
+
+  nxmutex_unlock(&cache->lock);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: blkcache_initialize
+ ****************************************************************************/
+
+int blkcache_initialize(FAR struct blkcache_s *cache)
+{
+  size_t linesize;
+  size_t i;
+
+  DEBUGASSERT(cache != NULL && cache->reload != NULL);
+  DEBUGASSERT(cache->blocksize > 0);
+
+  list_initialize(&cache->lru);
+  cache->seqblock = -1;
+
+  if (cache->nlines == 0)
+    {
+      return OK;
+    }
+
+  if (cache->lineblocks == 0 || cache->lineblocks > BLKCACHE_MAXLINEBLOCKS)
+    {
+      return -EINVAL;
+    }
+
+  if (cache->maxreadahead >= cache->nlines)
+    {
+      cache->maxreadahead = cache->nlines - 1;
+    }
+
+  for (cache->hmask = 1; cache->hmask < cache->nlines; cache->hmask <<= 1);
+  cache->hmask--;
+
+  linesize     = blkcache_linesize(cache);
+  cache->lines = kmm_zalloc(cache->nlines * sizeof(struct blkcache_line_s));
+  cache->hash  = kmm_zalloc((cache->hmask + 1) *
+                            sizeof(FAR struct blkcache_line_s *));
+  cache->buffer = kmm_malloc(cache->nlines * linesize);
+  if (cache->maxreadahead > 0)
+    {
+      cache->rabuffer = kmm_malloc((cache->maxreadahead + 1) * linesize);
+    }
+
+  if (cache->lines == NULL || cache->hash == NULL ||
+      cache->buffer == NULL ||
+      (cache->maxreadahead > 0 && cache->rabuffer == NULL))
+    {
+      ferr("ERROR: Failed to allocate a cache of %u lines\n",
+           cache->nlines);
+      kmm_free(cache->rabuffer);
+      kmm_free(cache->buffer);
+      kmm_free(cache->hash);
+      kmm_free(cache->lines);
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < cache->nlines; i++)
+    {
+      cache->lines[i].line = -1;
+      cache->lines[i].data = &cache->buffer[i * linesize];
+      list_add_tail(&cache->lru, &cache->lines[i].node);
+    }
+
+  nxmutex_init(&cache->lock);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: blkcache_uninitialize
+ ****************************************************************************/
+
+void blkcache_uninitialize(FAR struct blkcache_s *cache)
+{
+  if (cache->nlines == 0)
+    {
+      return;
+    }
+
+  work_cancel_sync(LPWORK, &cache->work);
+  blkcache_flush(cache);
+
+  kmm_free(cache->rabuffer);
+  kmm_free(cache->buffer);
+  kmm_free(cache->hash);
+  kmm_free(cache->lines);
+  nxmutex_destroy(&cache->lock);
+}
+
+/****************************************************************************
+ * Name: blkcache_read
+ ****************************************************************************/
+
+ssize_t blkcache_read(FAR struct blkcache_s *cache, off_t startblock,
+                      size_t nblocks, FAR uint8_t *rdbuffer)
+{
+  FAR struct blkcache_line_s *l;
+  size_t remaining = nblocks;
+  size_t offset;
+  size_t count;
+  size_t n;
+  off_t line;
+  ssize_t ret;
+
+  if (cache->nlines == 0)
+    {
+      return cache->reload(cache->dev, rdbuffer, startblock, nblocks);
+    }
+
+  if (startblock < 0 || startblock + nblocks > cache->nblocks)
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmutex_lock(&cache->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Widen the read-ahead window on sequential reads, close it on random
+   * ones.
+   */
+
+  if (startblock == cache->seqblock)
+    {
+      count = cache->readahead ? cache->readahead << 1 : 1;
+      cache->readahead = count < cache->maxreadahead ?
+                         count : cache->maxreadahead;
+    }
+  else
+    {
+      cache->readahead = 0;
+    }
+
+  cache->seqblock = startblock + nblocks;
+
+  /* Large transfers would only thrash the cache, read them directly */
+
+  if (nblocks >= (size_t)cache->nlines * cache->lineblocks / 2)
+    {
+      ret = blkcache_flushrange(cache, startblock, nblocks);
+      if (ret >= 0)
+        {
+          ret = cache->reload(cache->dev, rdbuffer, startblock, nblocks);
+        }
+
+      goto out;
+    }
+
+  while (remaining > 0)
+    {
+      line   = startblock / cache->lineblocks;
+      offset = startblock - blkcache_firstblock(cache, line);
+      n      = cache->lineblocks - offset;
+      if (n > remaining)
+        {
+          n = remaining;
+        }
+
+      l = blkcache_find(cache, line);
+      if (l == NULL)
+        {
+          /* Load the missing line together with the uncached lines of the
+           * read-ahead window that follow it.
+           */
+
+          for (count = 1;
+               count <= cache->readahead &&
+               blkcache_firstblock(cache, line + count) <
+               (off_t)cache->nblocks &&
+               blkcache_find(cache, line + count) == NULL;
+               count++);
+
+          ret = blkcache_load(cache, line, count, &l);
+          if (ret < 0)
+            {
+              goto out;
+            }
+        }
+      else
+        {
+          blkcache_touch(cache, l);
+        }
+
+      memcpy(rdbuffer, &l->data[offset * cache->blocksize],
+             n * cache->blocksize);
+
+      startblock += n;
+      rdbuffer   += n * cache->blocksize;
+      remaining  -= n;
+    }
+
+  ret = nblocks;
+
+out:
+  nxmutex_unlock(&cache->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: blkcache_write
+ ****************************************************************************/
+
+ssize_t blkcache_write(FAR struct blkcache_s *cache, off_t startblock,
+                       size_t nblocks, FAR const uint8_t *wrbuffer)
+{
+  FAR struct blkcache_line_s *l;
+  size_t remaining = nblocks;
+  size_t offset;
+  size_t n;
+  off_t first;
+  off_t line;
+  ssize_t ret;
+  size_t i;
+
+  if (cache->nlines == 0)
+    {
+      return cache->flush(cache->dev, wrbuffer, startblock, nblocks);
+    }
+
+  if (startblock < 0 || startblock + nblocks > cache->nblocks)
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmutex_lock(&cache->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Large transfers go directly to the device.  The cached copies of the
+   * blocks are updated and are clean afterwards.
+   */
+
+  if (nblocks >= (size_t)cache->nlines * cache->lineblocks / 2)
+    {
+      ret = cache->flush(cache->dev, wrbuffer, startblock, nblocks);
+      if (ret != (ssize_t)nblocks)
+        {
+          ret = ret < 0 ? ret : -EIO;
+          goto out;
+        }
+
+      for (i = 0; i < cache->nlines; i++)
+        {
+          off_t start;
+          off_t end;
+
+          l = &cache->lines[i];
+          if (l->line < 0)
+            {
+              continue;
+            }
+
+          first = blkcache_firstblock(cache, l->line);
+          start = first > startblock ? first : startblock;
+          end   = first + (off_t)cache->lineblocks;
+          if (end > startblock + (off_t)nblocks)
+            {
+              end = startblock + nblocks;
+            }
+
+          if (start >= end)
+            {
+              continue;
+            }
+
+          memcpy(&l->data[(start - first) * cache->blocksize],
+                 &wrbuffer[(start - startblock) * cache->blocksize],
+                 (end - start) * cache->blocksize);
+
+          if (l->dirty != 0)
+            {
+              l->dirty &= ~blkcache_mask(start - first, end - start);
+              if (l->dirty == 0)
+                {
+                  cache->ndirty--;
+                }
+            }
+        }
+
+      goto out;
+    }
+
+  while (remaining > 0)
+    {
+      line   = startblock / cache->lineblocks;
+      first  = blkcache_firstblock(cache, line);
+      offset = startblock - first;
+      n      = cache->lineblocks - offset;
+      if (n > remaining)
+        {
+          n = remaining;
+        }
+
+      l = blkcache_find(cache, line);
+      if (l == NULL)
+        {
+          /* A line that is overwritten completely need not be read */
+
+          if (offset == 0 && n == blkcache_lineblocks(cache, line))
+            {
+              ret = blkcache_victim(cache, &l);
+              if (ret >= 0)
+                {
+                  blkcache_sethash(cache, l, line);
+                  blkcache_touch(cache, l);
+                }
+            }
+          else
+            {
+              ret = blkcache_load(cache, line, 1, &l);
+            }
+
+          if (ret < 0)
+            {
+              goto out;
+            }
+        }
+      else
+        {
+          blkcache_touch(cache, l);
+        }
+
+      memcpy(&l->data[offset * cache->blocksize], wrbuffer,
+             n * cache->blocksize);
+
+      if (l->dirty == 0)
+        {
+          cache->ndirty++;
+        }
+
+      l->dirty |= blkcache_mask(offset, n);
+
+      startblock += n;
+      wrbuffer   += n * cache->blocksize;
+      remaining  -= n;
+    }
+
+  /* Write through, or write back after a period without writes */
+
+  if (cache->wrdelay == 0)
+    {
+      ret = blkcache_flushall(cache);
+      if (ret < 0)
+        {
+          cache->error = OK;
+          goto out;
+        }
+    }
+  else
+    {
+      work_queue(LPWORK, &cache->work, blkcache_timeout, cache,
+                 MSEC2TICK(cache->wrdelay));
+    }
+
+  ret = nblocks;
+
+out:
+  nxmutex_unlock(&cache->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: blkcache_flush
+ ****************************************************************************/
+
+int blkcache_flush(FAR struct blkcache_s *cache)
+{
+  int ret;
+
+  if (cache->nlines == 0)
+    {
+      return OK;
+    }
+
+  ret = nxmutex_lock(&cache->lock);
+  if (ret >= 0)
+    {
+      /* Also report the failures of earlier write backs */
+
+      ret = blkcache_flushall(cache);
+      if (cache->error < 0)
+        {
+          ret = cache->error;
+          cache->error = OK;
+        }
+
+      nxmutex_unlock(&cache->lock);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: blkcache_invalidate
+ ****************************************************************************/
+
+int blkcache_invalidate(FAR struct blkcache_s *cache)
+{
+  size_t i;
+  int ret;
+
+  if (cache->nlines == 0)
+    {
+      return OK;
+    }
+
+  work_cancel(LPWORK, &cache->work);
+
+  ret = nxmutex_lock(&cache->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (i = 0; i < cache->nlines; i++)
+    {
+      cache->lines[i].line  = -1;
+      cache->lines[i].hnext = NULL;
+      cache->lines[i].dirty = 0;
+      cache->lines[i].nfail = 0;
+    }
+
+  memset(cache->hash, 0,
+         (cache->hmask + 1) * sizeof(FAR struct blkcache_line_s *));
+  cache->ndirty    = 0;
+  cache->readahead = 0;
+  cache->seqblock  = -1;
+  cache->error     = OK;
+
+  nxmutex_unlock(&cache->lock);
+  return OK;
+}
+
+#endif /* CONFIG_DRVR_BLKCACHE */
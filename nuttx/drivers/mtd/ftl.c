@@ -41,11 +41,14 @@
 #include <errno.h>
 #include <fcntl.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/mtd/mtd.h>
+#include <nuttx/mutex.h>
 #include <nuttx/drivers/rwbuffer.h>
+#include <nuttx/wqueue.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -63,10 +66,40 @@
 
 #define DEV_NAME_MAX    (NAME_MAX + 5)
 
+/* Page bitmap helpers for the erase block cache */
+
+#define FTL_MAP_SIZE(n) (((n) + 7) / 8)
+#define FTL_MAP_SET(m, i) ((m)[(i) >> 3] |= 1 << ((i) & 7))
+#define FTL_MAP_TEST(m, i) (((m)[(i) >> 3] & (1 << ((i) & 7))) != 0)
+
+/* A failed delayed write-back is retried after the flush delay doubled up
+ * to this many times.
+ */
+
+#define FTL_CACHE_MAXBACKOFF 5
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_FTL_CACHE
+/* One cached erase block.  'valid' marks the pages whose content is in
+ * 'buffer', 'dirty' the subset of those that still have to be written
+ * back.  'seq' records when the erase block was first modified so that
+ * flushes can follow the order of the writes.
+ */
+
+struct ftl_cache_s
+{
+  FAR uint8_t          *buffer;   /* One erase block of data */
+  FAR uint8_t          *valid;    /* Bitmap of pages present in buffer */
+  FAR uint8_t          *dirty;    /* Bitmap of pages not yet on flash */
+  off_t                 eblock;   /* Logical erase block, -1 if unused */
+  uint32_t              seq;      /* First modification, 0 if clean */
+  uint32_t              stamp;    /* Last access, for LRU replacement */
+};
+#endif
+
 struct ftl_struct_s
 {
   FAR struct mtd_dev_s *mtd;      /* Contained MTD interface */
@@ -84,6 +117,18 @@ struct ftl_struct_s
 
   FAR off_t            *lptable;
   off_t                 lpcount;
+
+#ifdef CONFIG_FTL_CACHE
+  /* The erase block write-back cache */
+
+  mutex_t               lock;     /* Protects the cache */
+  struct work_s         work;     /* Delayed write-back */
+  struct ftl_cache_s    cache[CONFIG_FTL_CACHE_NBLOCKS];
+  uint32_t              seq;      /* Modification sequence counter */
+  uint32_t              stamp;    /* Access counter */
+  off_t                 rdnext;   /* Block following the last read */
+  uint8_t               backoff;  /* Failed delayed write-backs in a row */
+#endif
 };
 
 /****************************************************************************
@@ -101,6 +146,10 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
 static ssize_t ftl_flush_direct(FAR struct ftl_struct_s *dev,
                                 FAR const uint8_t *buffer,
                                 off_t startblock, size_t nblocks);
+#ifdef CONFIG_FTL_CACHE
+static int     ftl_cache_sync(FAR struct ftl_struct_s *dev);
+static void    ftl_cache_uninitialize(FAR struct ftl_struct_s *dev);
+#endif
 static ssize_t ftl_write(FAR struct inode *inode,
                  FAR const unsigned char *buffer, blkcnt_t start_sector,
                  unsigned int nsectors);
@@ -235,6 +284,7 @@ static int ftl_open(FAR struct inode *inode)
 static int ftl_close(FAR struct inode *inode)
 {
   FAR struct ftl_struct_s *dev;
+  int ret = OK;
 
   DEBUGASSERT(inode->i_private);
   dev = inode->i_private;
@@ -243,10 +293,22 @@ static int ftl_close(FAR struct inode *inode)
   rwb_flush(&dev->rwb);
 #endif
 
+#ifdef CONFIG_FTL_CACHE
+  ret = nxmutex_lock(&dev->lock);
+  if (ret >= 0)
+    {
+      ret = ftl_cache_sync(dev);
+      nxmutex_unlock(&dev->lock);
+    }
+#endif
+
   if (--dev->refs == 0 && dev->unlinked)
     {
 #ifdef FTL_HAVE_RWBUFFER
       rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_CACHE
+      ftl_cache_uninitialize(dev);
 #endif
       if (dev->eblock)
         {
@@ -256,7 +318,7 @@ static int ftl_close(FAR struct inode *inode)
       kmm_free(dev);
     }
 
-  return OK;
+  return ret;
 }
 
 /****************************************************************************
@@ -419,6 +481,495 @@ static ssize_t ftl_mtd_erase(FAR struct ftl_struct_s *dev, off_t startblock)
     }
 }
 
+#ifdef CONFIG_FTL_CACHE
+
+/****************************************************************************
+ * Name: ftl_cache_fill
+ *
+ * Description:
+ *   Read the pages of a cached erase block that are not valid yet.  Runs
+ *   of missing pages are read with a single MTD transfer.
+ *
+ ****************************************************************************/
+
+static int ftl_cache_fill(FAR struct ftl_struct_s *dev,
+                          FAR struct ftl_cache_s *cache)
+{
+  off_t startblock = cache->eblock * dev->blkper;
+  size_t blocksize = dev->geo.blocksize;
+  size_t count;
+  ssize_t ret;
+  size_t i;
+
+  for (i = 0; i < dev->blkper; i += count)
+    {
+      if (FTL_MAP_TEST(cache->valid, i))
+        {
+          count = 1;
+          continue;
+        }
+
+      for (count = 1; i + count < dev->blkper &&
+                      !FTL_MAP_TEST(cache->valid, i + count); count++);
+
+      ret = ftl_mtd_bread(dev, startblock + i, count,
+                          cache->buffer + i * blocksize);
+      if (ret != count)
+        {
+          return ret < 0 ? ret : -EIO;
+        }
+    }
+
+  memset(cache->valid, 0xff, FTL_MAP_SIZE(dev->blkper));
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_writeback
+ *
+ * Description:
+ *   Write one dirty erase block back to flash: read the pages that were
+ *   never written, erase the block and program it in one pass.
+ *
+ ****************************************************************************/
+
+static int ftl_cache_writeback(FAR struct ftl_struct_s *dev,
+                               FAR struct ftl_cache_s *cache)
+{
+  ssize_t ret;
+
+  if (cache->seq == 0)
+    {
+      return OK;
+    }
+
+  ret = ftl_cache_fill(dev, cache);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = ftl_mtd_erase(dev, cache->eblock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = ftl_mtd_bwrite(dev, cache->eblock * dev->blkper, cache->buffer);
+  if (ret != dev->blkper)
+    {
+      return ret < 0 ? ret : -EIO;
+    }
+
+  memset(cache->dirty, 0, FTL_MAP_SIZE(dev->blkper));
+  cache->seq = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_oldest
+ *
+ * Description:
+ *   Return the dirty erase block that was modified first, or NULL.
+ *
+ ****************************************************************************/
+
+static FAR struct ftl_cache_s *
+ftl_cache_oldest(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_cache_s *oldest = NULL;
+  int i;
+
+  for (i = 0; i < CONFIG_FTL_CACHE_NBLOCKS; i++)
+    {
+      FAR struct ftl_cache_s *cache = &dev->cache[i];
+
+      if (cache->seq != 0 &&
+          (oldest == NULL || (int32_t)(cache->seq - oldest->seq) < 0))
+        {
+          oldest = cache;
+        }
+    }
+
+  return oldest;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_sync
+ *
+ * Description:
+ *   Flush barrier: write back every dirty erase block, oldest modification
+ *   first, and return only when all of them are on flash.  The cache lock
+ *   must be held.
+ *
+ ****************************************************************************/
+
+static int ftl_cache_sync(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_cache_s *cache;
+  int ret;
+
+  while ((cache = ftl_cache_oldest(dev)) != NULL)
+    {
+      ret = ftl_cache_writeback(dev, cache);
+      if (ret < 0)
+        {
+          ferr("ERROR: Write back of erase block %" PRIdOFF
+               " failed: %d\n", cache->eblock, ret);
+          return ret;
+        }
+    }
+
+  dev->backoff = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_worker
+ *
+ * Description:
+ *   Delayed write-back of the dirty erase blocks.  The lock is dropped
+ *   between erase blocks so that readers are not held off for the whole
+ *   flush.  If a write-back fails, the dirty blocks stay in the cache and
+ *   the flush is retried with an increasing delay; a synchronous flush
+ *   (fsync(), close()) in the meantime retries at once and returns the
+ *   error if it persists.
+ *
+ ****************************************************************************/
+
+static void ftl_cache_worker(FAR void *arg)
+{
+  FAR struct ftl_struct_s *dev = arg;
+  FAR struct ftl_cache_s *cache;
+  int ret;
+
+  for (; ; )
+    {
+      ret = nxmutex_lock(&dev->lock);
+      if (ret < 0)
+        {
+          return;
+        }
+
+      cache = ftl_cache_oldest(dev);
+      if (cache == NULL)
+        {
+          dev->backoff = 0;
+          break;
+        }
+
+      ret = ftl_cache_writeback(dev, cache);
+      if (ret < 0)
+        {
+          if (dev->backoff < FTL_CACHE_MAXBACKOFF)
+            {
+              dev->backoff++;
+            }
+
+          ferr("ERROR: Write back of erase block %" PRIdOFF
+               " failed: %d, retrying in %d ms\n", cache->eblock, ret,
+               CONFIG_FTL_CACHE_FLUSH_DELAY << dev->backoff);
+
+          if (work_available(&dev->work))
+            {
+              work_queue(LPWORK, &dev->work, ftl_cache_worker, dev,
+                         MSEC2TICK(CONFIG_FTL_CACHE_FLUSH_DELAY) <<
+                         dev->backoff);
+            }
+
+          break;
+        }
+
+      nxmutex_unlock(&dev->lock);
+    }
+
+  nxmutex_unlock(&dev->lock);
+}
+
+/****************************************************************************
+ * Name: ftl_cache_find
+ *
+ * Description:
+ *   Return the cache entry holding an erase block, or NULL.
+ *
+ ****************************************************************************/
+
+static FAR struct ftl_cache_s *ftl_cache_find(FAR struct ftl_struct_s *dev,
+                                              off_t eblock)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FTL_CACHE_NBLOCKS; i++)
+    {
+      if (dev->cache[i].eblock == eblock)
+        {
+          dev->cache[i].stamp = ++dev->stamp;
+          return &dev->cache[i];
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_get
+ *
+ * Description:
+ *   Return the cache entry for an erase block, replacing another erase
+ *   block if needed.  Clean entries are replaced least recently used
+ *   first.  If all entries are dirty, the oldest modification is written
+ *   back and replaced so that the write order is preserved.
+ *
+ ****************************************************************************/
+
+static FAR struct ftl_cache_s *ftl_cache_get(FAR struct ftl_struct_s *dev,
+                                             off_t eblock, FAR int *err)
+{
+  FAR struct ftl_cache_s *cache;
+  size_t mapsize;
+  int i;
+
+  cache = ftl_cache_find(dev, eblock);
+  if (cache != NULL)
+    {
+      return cache;
+    }
+
+  for (i = 0; i < CONFIG_FTL_CACHE_NBLOCKS; i++)
+    {
+      FAR struct ftl_cache_s *entry = &dev->cache[i];
+
+      if (entry->seq == 0 &&
+          (cache == NULL || entry->eblock < 0 ||
+           (cache->eblock >= 0 &&
+            (int32_t)(entry->stamp - cache->stamp) < 0)))
+        {
+          cache = entry;
+        }
+    }
+
+  if (cache == NULL)
+    {
+      cache = ftl_cache_oldest(dev);
+      *err = ftl_cache_writeback(dev, cache);
+      if (*err < 0)
+        {
+          return NULL;
+        }
+    }
+
+  mapsize = FTL_MAP_SIZE(dev->blkper);
+  if (cache->buffer == NULL)
+    {
+      cache->buffer = kmm_malloc(dev->geo.erasesize + 2 * mapsize);
+      if (cache->buffer == NULL)
+        {
+          *err = -ENOMEM;
+          return NULL;
+        }
+
+      cache->valid = cache->buffer + dev->geo.erasesize;
+      cache->dirty = cache->valid + mapsize;
+    }
+
+  memset(cache->valid, 0, 2 * mapsize);
+  cache->eblock = eblock;
+  cache->stamp  = ++dev->stamp;
+  return cache;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_read
+ *
+ * Description:
+ *   Read through the cache.  Erase blocks already in the cache are served
+ *   from it, with missing pages filled in from flash.  A read continuing
+ *   the previous one loads its whole erase block, which gives read-ahead
+ *   for sequential access.  Other reads go straight to flash.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_cache_read(FAR struct ftl_struct_s *dev,
+                              FAR uint8_t *buffer, off_t startblock,
+                              size_t nblocks)
+{
+  FAR struct ftl_cache_s *cache;
+  size_t blocksize = dev->geo.blocksize;
+  size_t remaining = nblocks;
+  bool sequential;
+  off_t offset;
+  size_t count;
+  ssize_t ret;
+  int err = OK;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  sequential = startblock == dev->rdnext;
+  while (remaining > 0)
+    {
+      offset = startblock & (dev->blkper - 1);
+      count  = MIN(dev->blkper - offset, remaining);
+
+      cache = ftl_cache_find(dev, startblock / dev->blkper);
+      if (cache == NULL && sequential)
+        {
+          cache = ftl_cache_get(dev, startblock / dev->blkper, &err);
+          if (cache == NULL)
+            {
+              ret = err;
+              break;
+            }
+        }
+
+      if (cache != NULL)
+        {
+          ret = ftl_cache_fill(dev, cache);
+          if (ret < 0)
+            {
+              break;
+            }
+
+          memcpy(buffer, cache->buffer + offset * blocksize,
+                 count * blocksize);
+        }
+      else
+        {
+          ret = ftl_mtd_bread(dev, startblock, count, buffer);
+          if (ret != count)
+            {
+              if (ret >= 0)
+                {
+                  remaining -= ret;
+                  ret = -EIO;
+                }
+
+              break;
+            }
+        }
+
+      startblock += count;
+      remaining  -= count;
+      buffer     += count * blocksize;
+    }
+
+  dev->rdnext = startblock;
+  nxmutex_unlock(&dev->lock);
+  return remaining != nblocks ? nblocks - remaining : ret;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_write
+ *
+ * Description:
+ *   Merge a write into the cache and schedule the delayed write-back.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_cache_write(FAR struct ftl_struct_s *dev,
+                               FAR const uint8_t *buffer, off_t startblock,
+                               size_t nblocks)
+{
+  FAR struct ftl_cache_s *cache;
+  size_t blocksize = dev->geo.blocksize;
+  size_t remaining = nblocks;
+  off_t offset;
+  size_t count;
+  size_t i;
+  int ret;
+
+  ret = nxmutex_lock(&dev->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  while (remaining > 0)
+    {
+      offset = startblock & (dev->blkper - 1);
+      count  = MIN(dev->blkper - offset, remaining);
+
+      cache = ftl_cache_get(dev, startblock / dev->blkper, &ret);
+      if (cache == NULL)
+        {
+          break;
+        }
+
+      memcpy(cache->buffer + offset * blocksize, buffer,
+             count * blocksize);
+      for (i = offset; i < offset + count; i++)
+        {
+          FTL_MAP_SET(cache->valid, i);
+          FTL_MAP_SET(cache->dirty, i);
+        }
+
+      if (cache->seq == 0)
+        {
+          cache->seq = ++dev->seq;
+          if (cache->seq == 0)
+            {
+              cache->seq = ++dev->seq;
+            }
+        }
+
+      startblock += count;
+      remaining  -= count;
+      buffer     += count * blocksize;
+    }
+
+  if (remaining != nblocks && work_available(&dev->work))
+    {
+      work_queue(LPWORK, &dev->work, ftl_cache_worker, dev,
+                 MSEC2TICK(CONFIG_FTL_CACHE_FLUSH_DELAY));
+    }
+
+  nxmutex_unlock(&dev->lock);
+  return remaining != nblocks ? nblocks - remaining : ret;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_initialize
+ ****************************************************************************/
+
+static void ftl_cache_initialize(FAR struct ftl_struct_s *dev)
+{
+  int i;
+
+  nxmutex_init(&dev->lock);
+  for (i = 0; i < CONFIG_FTL_CACHE_NBLOCKS; i++)
+    {
+      dev->cache[i].eblock = -1;
+    }
+
+  dev->rdnext = -1;
+}
+
+/****************************************************************************
+ * Name: ftl_cache_uninitialize
+ ****************************************************************************/
+
+static void ftl_cache_uninitialize(FAR struct ftl_struct_s *dev)
+{
+  int i;
+
+  work_cancel_sync(LPWORK, &dev->work);
+  nxmutex_lock(&dev->lock);
+  ftl_cache_sync(dev);
+  nxmutex_unlock(&dev->lock);
+
+  for (i = 0; i < CONFIG_FTL_CACHE_NBLOCKS; i++)
+    {
+      kmm_free(dev->cache[i].buffer);
+    }
+
+  nxmutex_destroy(&dev->lock);
+}
+
+#endif /* CONFIG_FTL_CACHE */
+
 /****************************************************************************
  * Name: ftl_reload
  *
@@ -431,6 +982,13 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 {
   struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
 
+#ifdef CONFIG_FTL_CACHE
+  if (!(dev->oflags & O_DIRECT))
+    {
+      return ftl_cache_read(dev, buffer, startblock, nblocks);
+    }
+#endif
+
   /* Read the full erase block into the buffer */
 
   return ftl_mtd_bread(dev, startblock, nblocks, buffer);
@@ -467,6 +1025,7 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
  *
  ****************************************************************************/
 
+#ifndef CONFIG_FTL_CACHE
 static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
 {
   if (dev->eblock == NULL)
@@ -478,6 +1037,7 @@ static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
 
   return dev->eblock != NULL ? OK : -ENOMEM;
 }
+#endif
 
 /****************************************************************************
  * Name: ftl_flush_direct
@@ -551,6 +1111,7 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
                          off_t startblock, size_t nblocks)
 {
   struct ftl_struct_s *dev = (struct ftl_struct_s *)priv;
+#ifndef CONFIG_FTL_CACHE
   off_t  alignedblock;
   off_t  mask;
   off_t  rwblock;
@@ -560,6 +1121,7 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
   size_t nxfrd;
   int    nbytes;
   int    ret;
+#endif
 
   if (dev->oflags & O_DIRECT)
     {
@@ -568,6 +1130,9 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
       return ftl_flush_direct(dev, buffer, startblock, nblocks);
     }
 
+#ifdef CONFIG_FTL_CACHE
+  return ftl_cache_write(dev, buffer, startblock, nblocks);
+#else
   /* Get the aligned block.  Here is is assumed: (1) The number of R/W blocks
    * per erase block is a power of 2, and (2) the erase begins with that same
    * alignment.
@@ -726,6 +1291,7 @@ static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
     }
 
   return nblocks;
+#endif
 }
 
 /****************************************************************************
@@ -817,6 +1383,20 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
     {
 #ifdef CONFIG_FTL_WRITEBUFFER
       rwb_flush(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_CACHE
+      ret = nxmutex_lock(&dev->lock);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = ftl_cache_sync(dev);
+      nxmutex_unlock(&dev->lock);
+      if (ret < 0)
+        {
+          return ret;
+        }
 #endif
     }
 
@@ -854,6 +1434,9 @@ static int ftl_unlink(FAR struct inode *inode)
     {
 #ifdef FTL_HAVE_RWBUFFER
       rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_CACHE
+      ftl_cache_uninitialize(dev);
 #endif
       if (dev->eblock)
         {
@@ -954,6 +1537,10 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
         }
 #endif
 
+#ifdef CONFIG_FTL_CACHE
+      ftl_cache_initialize(dev);
+#endif
+
       if (MTD_ISBAD(dev->mtd, 0) != -ENOSYS)
         {
           ret = ftl_init_map(dev);
@@ -973,6 +1560,9 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd,
 out:
 #ifdef FTL_HAVE_RWBUFFER
           rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_CACHE
+          ftl_cache_uninitialize(dev);
 #endif
           kmm_free(dev);
         }
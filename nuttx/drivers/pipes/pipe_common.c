@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -85,6 +86,760 @@ static void pipecommon_wakeup(FAR sem_t *sem)
     }
 }
 
+/****************************************************************************
+ * Name: pipecommon_readable and pipecommon_writable
+ *
+ * Description:
+ *   A splice to or from a file works on the buffer in place with d_bflock
+ *   released.  Meanwhile it owns the buffered data (PIPE_FLAG_RDBUSY) or
+ *   the free space (PIPE_FLAG_WRBUSY), and the other readers or writers
+ *   see the pipe as empty or full.
+ *
+ ****************************************************************************/
+
+static bool pipecommon_readable(FAR struct pipe_dev_s *dev)
+{
+  return !circbuf_is_empty(&dev->d_buffer) &&
+         (dev->d_flags & PIPE_FLAG_RDBUSY) == 0;
+}
+
+static bool pipecommon_writable(FAR struct pipe_dev_s *dev)
+{
+  return !circbuf_is_full(&dev->d_buffer) &&
+         (dev->d_flags & PIPE_FLAG_WRBUSY) == 0;
+}
+
+/****************************************************************************
+ * Name: pipecommon_relock
+ *
+ * Description:
+ *   Take d_bflock back after the file I/O of a splice.  The splice has to
+ *   give up what it owns, so this can't fail because of a signal.
+ *
+ ****************************************************************************/
+
+static void pipecommon_relock(FAR struct pipe_dev_s *dev)
+{
+  while (nxrmutex_lock(&dev->d_bflock) < 0);
+}
+
+/****************************************************************************
+ * Name: pipecommon_doread
+ *
+ * Description:
+ *   Read from the pipe, either waiting for data or failing with -EAGAIN
+ *   when it is empty.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_doread(FAR struct pipe_dev_s *dev,
+                                 FAR char *buffer, size_t len,
+                                 bool nonblock)
+{
+  ssize_t nread = 0;
+  int     ret;
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  /* Make sure that we have exclusive access to the device structure */
+
+  ret = nxrmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      /* May fail because a signal was received or if the task was
+       * canceled.
+       */
+
+      return ret;
+    }
+
+  /* If the pipe is empty, then wait for something to be written to it */
+
+  while (!pipecommon_readable(dev))
+    {
+      /* If there are no writers on the pipe, then return end of file */
+
+      if (circbuf_is_empty(&dev->d_buffer) && dev->d_nwriters <= 0 &&
+          PIPE_IS_POLICY_0(dev->d_flags))
+        {
+          nxrmutex_unlock(&dev->d_bflock);
+          return 0;
+        }
+
+      /* If O_NONBLOCK was set, then return EGAIN */
+
+      if (nonblock)
+        {
+          nxrmutex_unlock(&dev->d_bflock);
+          return -EAGAIN;
+        }
+
+      /* Otherwise, wait for something to be written to the pipe */
+
+      nxrmutex_unlock(&dev->d_bflock);
+      ret = nxsem_wait(&dev->d_rdsem);
+
+      if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
+        {
+          /* May fail because a signal was received or if the task was
+           * canceled.
+           */
+
+          return ret;
+        }
+    }
+
+  /* Then return whatever is available in the pipe (which is at least one
+   * byte).
+   */
+
+  nread = circbuf_read(&dev->d_buffer, buffer, len);
+
+  /* Notify all poll/select waiters that they can write to the
+   * FIFO when buffer can accept more than d_polloutthrd bytes.
+   */
+
+  if (circbuf_used(&dev->d_buffer) <= (dev->d_bufsize - dev->d_polloutthrd))
+    {
+      poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
+    }
+
+  /* Notify all waiting writers that bytes have been removed from the
+   * buffer.
+   */
+
+  pipecommon_wakeup(&dev->d_wrsem);
+
+  nxrmutex_unlock(&dev->d_bflock);
+  pipe_dumpbuffer("From PIPE:", buffer, nread);
+  return nread;
+}
+
+/****************************************************************************
+ * Name: pipecommon_dowrite
+ *
+ * Description:
+ *   Write to the pipe, either waiting for room or returning what fitted
+ *   (-EAGAIN if nothing did) when it is full.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_dowrite(FAR struct pipe_dev_s *dev,
+                                  FAR const char *buffer, size_t len,
+                                  bool nonblock)
+{
+  ssize_t nwritten = 0;
+  ssize_t last;
+  int     ret;
+
+  pipe_dumpbuffer("To PIPE:", (FAR uint8_t *)buffer, len);
+
+  /* Handle zero-length writes */
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  /* At present, this method cannot be called from interrupt handlers.  That
+   * is because it calls nxrmutex_lock() and nxrmutex_lock() cannot be called
+   * form interrupt level. This actually happens fairly commonly
+   * IF [a-z]err() is called from interrupt handlers and stdout is being
+   * redirected via a pipe.  In that case, the debug output will try to go
+   * out the pipe (interrupt handlers should use the _err() APIs).
+   *
+   * On the other hand, it would be very valuable to be able to feed the pipe
+   * from an interrupt handler!  TODO:  Consider disabling interrupts instead
+   * of taking semaphores so that pipes can be written from interrupt
+   * handlers.
+   */
+
+  DEBUGASSERT(up_interrupt_context() == false);
+
+  /* Make sure that we have exclusive access to the device structure */
+
+  ret = nxrmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      /* May fail because a signal was received or if the task was
+       * canceled.
+       */
+
+      return ret;
+    }
+
+  /* Loop until all of the bytes have been written */
+
+  last = 0;
+  for (; ; )
+    {
+      /* REVISIT:  "If all file descriptors referring to the read end of a
+       * pipe have been closed, then a write will cause a SIGPIPE signal to
+       * be generated for the calling process.  If the calling process is
+       * ignoring this signal, then write(2) fails with the error EPIPE."
+       */
+
+      if (dev->d_nreaders <= 0 && PIPE_IS_POLICY_0(dev->d_flags))
+        {
+          nxrmutex_unlock(&dev->d_bflock);
+          return nwritten == 0 ? -EPIPE : nwritten;
+        }
+
+      /* Would the next write overflow the circular buffer? */
+
+      if (pipecommon_writable(dev))
+        {
+          /* Loop until all of the bytes have been written */
+
+          nwritten += circbuf_write(&dev->d_buffer,
+                                    buffer + nwritten, len - nwritten);
+
+          if ((size_t)nwritten == len)
+            {
+              /* Notify all poll/select waiters that they can read from the
+               * FIFO when buffer used exceeds poll threshold.
+               */
+
+              if (circbuf_used(&dev->d_buffer) > dev->d_pollinthrd)
+                {
+                  poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS,
+                              POLLIN);
+                }
+
+              /* Yes.. Notify all of the waiting readers that more data is
+               * available.
+               */
+
+              pipecommon_wakeup(&dev->d_rdsem);
+
+              /* Return the number of bytes written */
+
+              nxrmutex_unlock(&dev->d_bflock);
+              return len;
+            }
+        }
+      else
+        {
+          /* There is not enough room for the next byte.  Was anything
+           * written in this pass?
+           */
+
+          if (last < nwritten)
+            {
+              /* Notify all poll/select waiters that they can read from the
+               * FIFO.
+               */
+
+              poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
+
+              /* Yes.. Notify all of the waiting readers that more data is
+               * available.
+               */
+
+              pipecommon_wakeup(&dev->d_rdsem);
+            }
+
+          last = nwritten;
+
+          /* If O_NONBLOCK was set, then return partial bytes written or
+           * EGAIN.
+           */
+
+          if (nonblock)
+            {
+              if (nwritten == 0)
+                {
+                  nwritten = -EAGAIN;
+                }
+
+              nxrmutex_unlock(&dev->d_bflock);
+              return nwritten;
+            }
+
+          /* There is more to be written.. wait for data to be removed from
+           * the pipe
+           */
+
+          nxrmutex_unlock(&dev->d_bflock);
+          ret = nxsem_wait(&dev->d_wrsem);
+          if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
+            {
+              /* Either call nxsem_wait may fail because a signal was
+               * received or if the task was canceled.
+               */
+
+              return nwritten == 0 ? (ssize_t)ret : nwritten;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_pipe
+ *
+ * Description:
+ *   Copy data from one pipe buffer straight into another, optionally
+ *   draining the source (splice) or leaving it untouched (tee).  Both
+ *   pipes are locked in address order so that opposite transfers between
+ *   the same two pipes cannot deadlock.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice_pipe(FAR struct pipe_dev_s *src,
+                                      FAR struct pipe_dev_s *dst,
+                                      FAR struct pipe_splice_s *splice)
+{
+  FAR struct pipe_dev_s *first  = src < dst ? src : dst;
+  FAR struct pipe_dev_s *second = src < dst ? dst : src;
+  FAR uint8_t           *data;
+  FAR sem_t             *sem;
+  size_t                 nxfer;
+  size_t                 size;
+  size_t                 n;
+  ssize_t                ret;
+
+  if (src == dst)
+    {
+      return -EINVAL;
+    }
+
+  for (; ; )
+    {
+      ret = nxrmutex_lock(&first->d_bflock);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = nxrmutex_lock(&second->d_bflock);
+      if (ret < 0)
+        {
+          nxrmutex_unlock(&first->d_bflock);
+          return ret;
+        }
+
+      if (circbuf_is_empty(&src->d_buffer) ||
+          (splice->ps_mode != PIPE_SPLICE_TEE && !pipecommon_readable(src)))
+        {
+          /* If there are no writers on the source, then return end of
+           * file.
+           */
+
+          if (circbuf_is_empty(&src->d_buffer) && src->d_nwriters <= 0 &&
+              PIPE_IS_POLICY_0(src->d_flags))
+            {
+              goto errout;
+            }
+
+          sem = &src->d_rdsem;
+        }
+      else if (dst->d_nreaders <= 0 && PIPE_IS_POLICY_0(dst->d_flags))
+        {
+          ret = -EPIPE;
+          goto errout;
+        }
+      else if (!pipecommon_writable(dst))
+        {
+          sem = &dst->d_wrsem;
+        }
+      else
+        {
+          break;
+        }
+
+      nxrmutex_unlock(&second->d_bflock);
+      nxrmutex_unlock(&first->d_bflock);
+
+      if (splice->ps_nonblock)
+        {
+          return -EAGAIN;
+        }
+
+      ret = nxsem_wait(sem);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  nxfer = MIN(splice->ps_len, circbuf_used(&src->d_buffer));
+  nxfer = MIN(nxfer, circbuf_space(&dst->d_buffer));
+
+  for (n = 0; n < nxfer; n += size)
+    {
+      data = circbuf_get_writeptr(&dst->d_buffer, &size);
+      size = MIN(size, nxfer - n);
+      circbuf_peekat(&src->d_buffer, src->d_buffer.tail + n, data, size);
+      circbuf_writecommit(&dst->d_buffer, size);
+    }
+
+  if (splice->ps_mode != PIPE_SPLICE_TEE)
+    {
+      circbuf_skip(&src->d_buffer, nxfer);
+
+      if (circbuf_used(&src->d_buffer) <=
+          (src->d_bufsize - src->d_polloutthrd))
+        {
+          poll_notify(src->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
+        }
+
+      pipecommon_wakeup(&src->d_wrsem);
+    }
+
+  if (circbuf_used(&dst->d_buffer) > dst->d_pollinthrd)
+    {
+      poll_notify(dst->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
+    }
+
+  pipecommon_wakeup(&dst->d_rdsem);
+  ret = nxfer;
+
+errout:
+  nxrmutex_unlock(&second->d_bflock);
+  nxrmutex_unlock(&first->d_bflock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_file
+ *
+ * Description:
+ *   Read a chunk from (PIPE_SPLICE_IN) or write it to the file side of a
+ *   splice, at the given offset or at the file position.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice_file(FAR struct pipe_splice_s *splice,
+                                      FAR uint8_t *buffer, size_t size)
+{
+  ssize_t ret;
+
+  if (splice->ps_mode == PIPE_SPLICE_IN)
+    {
+      ret = splice->ps_offset != NULL ?
+            file_pread(splice->ps_file, buffer, size, *splice->ps_offset) :
+            file_read(splice->ps_file, buffer, size);
+    }
+  else
+    {
+      ret = splice->ps_offset != NULL ?
+            file_pwrite(splice->ps_file, buffer, size, *splice->ps_offset) :
+            file_write(splice->ps_file, buffer, size);
+    }
+
+  if (ret > 0 && splice->ps_offset != NULL)
+    {
+      *splice->ps_offset += ret;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_out
+ *
+ * Description:
+ *   Drain the pipe into a file or socket.  The data is written straight
+ *   from the pipe buffer with d_bflock released, so that a slow or blocking
+ *   file never stalls the writers of the pipe.  Only what the file took is
+ *   removed from the pipe, the rest stays there if the file fails.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice_out(FAR struct pipe_dev_s *dev,
+                                     FAR struct pipe_splice_s *splice)
+{
+  FAR uint8_t *data;
+  ssize_t      nxfer = 0;
+  ssize_t      ret;
+  size_t       size;
+  size_t       n;
+
+  ret = nxrmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Wait for data that no other splice owns */
+
+  while (!pipecommon_readable(dev))
+    {
+      if (circbuf_is_empty(&dev->d_buffer) && dev->d_nwriters <= 0 &&
+          PIPE_IS_POLICY_0(dev->d_flags))
+        {
+          goto errout;
+        }
+
+      if (splice->ps_nonblock)
+        {
+          ret = -EAGAIN;
+          goto errout;
+        }
+
+      nxrmutex_unlock(&dev->d_bflock);
+      ret = nxsem_wait(&dev->d_rdsem);
+      if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
+        {
+          return ret;
+        }
+    }
+
+  dev->d_flags |= PIPE_FLAG_RDBUSY;
+
+  while ((size_t)nxfer < splice->ps_len &&
+         !circbuf_is_empty(&dev->d_buffer))
+    {
+      data = circbuf_get_readptr(&dev->d_buffer, &size);
+      size = MIN(size, splice->ps_len - nxfer);
+      nxrmutex_unlock(&dev->d_bflock);
+
+      for (n = 0; n < size; n += ret)
+        {
+          ret = pipecommon_splice_file(splice, data + n, size - n);
+          if (ret <= 0)
+            {
+              break;
+            }
+        }
+
+      pipecommon_relock(dev);
+      if (n > 0)
+        {
+          circbuf_readcommit(&dev->d_buffer, n);
+          nxfer += n;
+
+          if (circbuf_used(&dev->d_buffer) <=
+              (dev->d_bufsize - dev->d_polloutthrd))
+            {
+              poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
+            }
+
+          pipecommon_wakeup(&dev->d_wrsem);
+        }
+
+      if (n < size)
+        {
+          ret = ret < 0 ? ret : -EIO;
+          break;
+        }
+    }
+
+  ret = nxfer > 0 ? nxfer : ret;
+
+  /* Let the other readers in */
+
+  dev->d_flags &= ~PIPE_FLAG_RDBUSY;
+  pipecommon_wakeup(&dev->d_rdsem);
+
+errout:
+  nxrmutex_unlock(&dev->d_bflock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_in
+ *
+ * Description:
+ *   Fill the pipe from a file or socket.  The input is read straight into
+ *   the free space of the pipe buffer with d_bflock released, and becomes
+ *   visible to the readers once the read returned.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice_in(FAR struct pipe_dev_s *dev,
+                                    FAR struct pipe_splice_s *splice)
+{
+  FAR uint8_t *data;
+  ssize_t      nxfer = 0;
+  ssize_t      ret;
+  size_t       size;
+
+  ret = nxrmutex_lock(&dev->d_bflock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Wait for room that no other splice owns */
+
+  for (; ; )
+    {
+      if (dev->d_nreaders <= 0 && PIPE_IS_POLICY_0(dev->d_flags))
+        {
+          ret = -EPIPE;
+          goto errout;
+        }
+
+      if (pipecommon_writable(dev))
+        {
+          break;
+        }
+
+      if (splice->ps_nonblock)
+        {
+          ret = -EAGAIN;
+          goto errout;
+        }
+
+      nxrmutex_unlock(&dev->d_bflock);
+      ret = nxsem_wait(&dev->d_wrsem);
+      if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
+        {
+          return ret;
+        }
+    }
+
+  dev->d_flags |= PIPE_FLAG_WRBUSY;
+
+  while ((size_t)nxfer < splice->ps_len &&
+         !circbuf_is_full(&dev->d_buffer))
+    {
+      data = circbuf_get_writeptr(&dev->d_buffer, &size);
+      size = MIN(size, splice->ps_len - nxfer);
+      nxrmutex_unlock(&dev->d_bflock);
+
+      ret = pipecommon_splice_file(splice, data, size);
+
+      pipecommon_relock(dev);
+      if (ret <= 0)
+        {
+          break;
+        }
+
+      circbuf_writecommit(&dev->d_buffer, ret);
+      nxfer += ret;
+
+      if (circbuf_used(&dev->d_buffer) > dev->d_pollinthrd)
+        {
+          poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
+        }
+
+      pipecommon_wakeup(&dev->d_rdsem);
+
+      /* A short read means that the input has nothing more for now */
+
+      if ((size_t)ret < size)
+        {
+          break;
+        }
+    }
+
+  ret = nxfer > 0 ? nxfer : ret;
+
+  /* Let the other writers in */
+
+  dev->d_flags &= ~PIPE_FLAG_WRBUSY;
+  pipecommon_wakeup(&dev->d_wrsem);
+
+errout:
+  nxrmutex_unlock(&dev->d_bflock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice_user
+ *
+ * Description:
+ *   Copy user memory into the pipe or drain the pipe into it (vmsplice()).
+ *   Once some data was read, the remaining segments only take what is
+ *   already in the pipe.
+ *
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice_user(FAR struct pipe_dev_s *dev,
+                                      FAR struct pipe_splice_s *splice)
+{
+  FAR const struct iovec *iov;
+  ssize_t                 nxfer = 0;
+  ssize_t                 ret   = 0;
+  size_t                  i;
+
+  for (i = 0; i < splice->ps_niov; i++)
+    {
+      iov = &splice->ps_iov[i];
+      if (iov->iov_len == 0)
+        {
+          continue;
+        }
+
+      if (splice->ps_mode == PIPE_SPLICE_VMIN)
+        {
+          ret = pipecommon_dowrite(dev, iov->iov_base, iov->iov_len,
+                                   splice->ps_nonblock);
+        }
+      else
+        {
+          ret = pipecommon_doread(dev, iov->iov_base, iov->iov_len,
+                                  splice->ps_nonblock || nxfer > 0);
+        }
+
+      if (ret <= 0)
+        {
+          break;
+        }
+
+      nxfer += ret;
+      if ((size_t)ret < iov->iov_len)
+        {
+          break;
+        }
+    }
+
+  return nxfer > 0 ? nxfer : ret;
+}
+
+/****************************************************************************
+ * Name: pipecommon_splice
+ ****************************************************************************/
+
+static ssize_t pipecommon_splice(FAR struct pipe_dev_s *dev,
+                                 FAR struct pipe_splice_s *splice)
+{
+  FAR struct inode *peer;
+
+  DEBUGASSERT(splice != NULL);
+
+  if (splice->ps_mode == PIPE_SPLICE_VMIN ||
+      splice->ps_mode == PIPE_SPLICE_VMOUT)
+    {
+      return pipecommon_splice_user(dev, splice);
+    }
+
+  DEBUGASSERT(splice->ps_file != NULL);
+
+  peer = splice->ps_file->f_inode;
+  if (peer != NULL && INODE_IS_PIPE(peer))
+    {
+      if (splice->ps_offset != NULL)
+        {
+          return -ESPIPE;
+        }
+
+      if (splice->ps_mode == PIPE_SPLICE_IN)
+        {
+          return pipecommon_splice_pipe(peer->i_private, dev, splice);
+        }
+
+      return pipecommon_splice_pipe(dev, peer->i_private, splice);
+    }
+
+  switch (splice->ps_mode)
+    {
+      case PIPE_SPLICE_OUT:
+        return pipecommon_splice_out(dev, splice);
+
+      case PIPE_SPLICE_IN:
+        return pipecommon_splice_in(dev, splice);
+
+      default:
+        return -EINVAL;
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -416,87 +1171,11 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
 {
   FAR struct inode      *inode = filep->f_inode;
   FAR struct pipe_dev_s *dev   = inode->i_private;
-  ssize_t                nread = 0;
-  int                    ret;
 
   DEBUGASSERT(dev);
 
-  if (len == 0)
-    {
-      return 0;
-    }
-
-  /* Make sure that we have exclusive access to the device structure */
-
-  ret = nxrmutex_lock(&dev->d_bflock);
-  if (ret < 0)
-    {
-      /* May fail because a signal was received or if the task was
-       * canceled.
-       */
-
-      return ret;
-    }
-
-  /* If the pipe is empty, then wait for something to be written to it */
-
-  while (circbuf_is_empty(&dev->d_buffer))
-    {
-      /* If there are no writers on the pipe, then return end of file */
-
-      if (dev->d_nwriters <= 0 && PIPE_IS_POLICY_0(dev->d_flags))
-        {
-          nxrmutex_unlock(&dev->d_bflock);
-          return 0;
-        }
-
-      /* If O_NONBLOCK was set, then return EGAIN */
-
-      if (filep->f_oflags & O_NONBLOCK)
-        {
-          nxrmutex_unlock(&dev->d_bflock);
-          return -EAGAIN;
-        }
-
-      /* Otherwise, wait for something to be written to the pipe */
-
-      nxrmutex_unlock(&dev->d_bflock);
-      ret = nxsem_wait(&dev->d_rdsem);
-
-      if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
-        {
-          /* May fail because a signal was received or if the task was
-           * canceled.
-           */
-
-          return ret;
-        }
-    }
-
-  /* Then return whatever is available in the pipe (which is at least one
-   * byte).
-   */
-
-  nread = circbuf_read(&dev->d_buffer, buffer, len);
-
-  /* Notify all poll/select waiters that they can write to the
-   * FIFO when buffer can accept more than d_polloutthrd bytes.
-   */
-
-  if (circbuf_used(&dev->d_buffer) <= (dev->d_bufsize - dev->d_polloutthrd))
-    {
-      poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLOUT);
-    }
-
-  /* Notify all waiting writers that bytes have been removed from the
-   * buffer.
-   */
-
-  pipecommon_wakeup(&dev->d_wrsem);
-
-  nxrmutex_unlock(&dev->d_bflock);
-  pipe_dumpbuffer("From PIPE:", buffer, nread);
-  return nread;
+  return pipecommon_doread(dev, buffer, len,
+                           (filep->f_oflags & O_NONBLOCK) != 0);
 }
 
 /****************************************************************************
@@ -506,153 +1185,13 @@ ssize_t pipecommon_read(FAR struct file *filep, FAR char *buffer, size_t len)
 ssize_t pipecommon_write(FAR struct file *filep, FAR const char *buffer,
                          size_t len)
 {
-  FAR struct inode      *inode    = filep->f_inode;
-  FAR struct pipe_dev_s *dev      = inode->i_private;
-  ssize_t                nwritten = 0;
-  ssize_t                last;
-  int                    ret;
+  FAR struct inode      *inode = filep->f_inode;
+  FAR struct pipe_dev_s *dev   = inode->i_private;
 
   DEBUGASSERT(dev);
-  pipe_dumpbuffer("To PIPE:", (FAR uint8_t *)buffer, len);
-
-  /* Handle zero-length writes */
-
-  if (len == 0)
-    {
-      return 0;
-    }
-
-  /* At present, this method cannot be called from interrupt handlers.  That
-   * is because it calls nxrmutex_lock() and nxrmutex_lock() cannot be called
-   * form interrupt level. This actually happens fairly commonly
-   * IF [a-z]err() is called from interrupt handlers and stdout is being
-   * redirected via a pipe.  In that case, the debug output will try to go
-   * out the pipe (interrupt handlers should use the _err() APIs).
-   *
-   * On the other hand, it would be very valuable to be able to feed the pipe
-   * from an interrupt handler!  TODO:  Consider disabling interrupts instead
-   * of taking semaphores so that pipes can be written from interrupt
-   * handlers.
-   */
-
-  DEBUGASSERT(up_interrupt_context() == false);
-
-  /* Make sure that we have exclusive access to the device structure */
-
-  ret = nxrmutex_lock(&dev->d_bflock);
-  if (ret < 0)
-    {
-      /* May fail because a signal was received or if the task was
-       * canceled.
-       */
-
-      return ret;
-    }
-
-  /* Loop until all of the bytes have been written */
-
-  last = 0;
-  for (; ; )
-    {
-      /* REVISIT:  "If all file descriptors referring to the read end of a
-       * pipe have been closed, then a write will cause a SIGPIPE signal to
-       * be generated for the calling process.  If the calling process is
-       * ignoring this signal, then write(2) fails with the error EPIPE."
-       */
-
-      if (dev->d_nreaders <= 0 && PIPE_IS_POLICY_0(dev->d_flags))
-        {
-          nxrmutex_unlock(&dev->d_bflock);
-          return nwritten == 0 ? -EPIPE : nwritten;
-        }
-
-      /* Would the next write overflow the circular buffer? */
-
-      if (!circbuf_is_full(&dev->d_buffer))
-        {
-          /* Loop until all of the bytes have been written */
-
-          nwritten += circbuf_write(&dev->d_buffer,
-                                    buffer + nwritten, len - nwritten);
-
-          if ((size_t)nwritten == len)
-            {
-              /* Notify all poll/select waiters that they can read from the
-               * FIFO when buffer used exceeds poll threshold.
-               */
-
-              if (circbuf_used(&dev->d_buffer) > dev->d_pollinthrd)
-                {
-                  poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS,
-                              POLLIN);
-                }
-
-              /* Yes.. Notify all of the waiting readers that more data is
-               * available.
-               */
-
-              pipecommon_wakeup(&dev->d_rdsem);
-
-              /* Return the number of bytes written */
-
-              nxrmutex_unlock(&dev->d_bflock);
-              return len;
-            }
-        }
-      else
-        {
-          /* There is not enough room for the next byte.  Was anything
-           * written in this pass?
-           */
-
-          if (last < nwritten)
-            {
-              /* Notify all poll/select waiters that they can read from the
-               * FIFO.
-               */
-
-              poll_notify(dev->d_fds, CONFIG_DEV_PIPE_NPOLLWAITERS, POLLIN);
-
-              /* Yes.. Notify all of the waiting readers that more data is
-               * available.
-               */
-
-              pipecommon_wakeup(&dev->d_rdsem);
-            }
-
-          last = nwritten;
-
-          /* If O_NONBLOCK was set, then return partial bytes written or
-           * EGAIN.
-           */
-
-          if (filep->f_oflags & O_NONBLOCK)
-            {
-              if (nwritten == 0)
-                {
-                  nwritten = -EAGAIN;
-                }
-
-              nxrmutex_unlock(&dev->d_bflock);
-              return nwritten;
-            }
-
-          /* There is more to be written.. wait for data to be removed from
-           * the pipe
-           */
-
-          nxrmutex_unlock(&dev->d_bflock);
-          ret = nxsem_wait(&dev->d_wrsem);
-          if (ret < 0 || (ret = nxrmutex_lock(&dev->d_bflock)) < 0)
-            {
-              /* Either call nxsem_wait may fail because a signal was
-               * received or if the task was canceled.
-               */
 
-              return nwritten == 0 ? (ssize_t)ret : nwritten;
-            }
-        }
-    }
+  return pipecommon_dowrite(dev, buffer, len,
+                            (filep->f_oflags & O_NONBLOCK) != 0);
 }
 
 /****************************************************************************
@@ -793,6 +1332,14 @@ int pipecommon_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
     }
 #endif
 
+  /* Splicing waits on the pipe(s) and takes the locks itself */
+
+  if (cmd == PIPEIOC_SPLICE)
+    {
+      return pipecommon_splice(dev,
+                               (FAR struct pipe_splice_s *)(uintptr_t)arg);
+    }
+
   ret = nxrmutex_lock(&dev->d_bflock);
   if (ret < 0)
     {
@@ -865,6 +1412,14 @@ int pipecommon_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
               break;
             }
 
+          /* A splice may be using the buffer with the lock released */
+
+          if ((dev->d_flags & (PIPE_FLAG_RDBUSY | PIPE_FLAG_WRBUSY)) != 0)
+            {
+              ret = -EBUSY;
+              break;
+            }
+
           size = MIN(size, CONFIG_DEV_PIPE_MAXSIZE);
           ret = circbuf_resize(&dev->d_buffer, size);
           if (ret != 0)
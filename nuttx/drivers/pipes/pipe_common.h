@@ -87,6 +87,8 @@
 
 #define PIPE_FLAG_POLICY    (1 << 0) /* Bit 0: Policy=Free buffer when empty */
 #define PIPE_FLAG_UNLINKED  (1 << 1) /* Bit 1: The driver has been unlinked */
+#define PIPE_FLAG_RDBUSY    (1 << 2) /* Bit 2: A splice owns the buffered data */
+#define PIPE_FLAG_WRBUSY    (1 << 3) /* Bit 3: A splice owns the free space */
 
 #define PIPE_POLICY_0(f)    do { (f) &= ~PIPE_FLAG_POLICY; } while (0)
 #define PIPE_POLICY_1(f)    do { (f) |= PIPE_FLAG_POLICY; } while (0)
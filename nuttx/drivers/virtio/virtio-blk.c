@@ -24,12 +24,16 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/param.h>
+
 #include <debug.h>
 #include <errno.h>
 #include <stdio.h>
 
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
+#include <nuttx/list.h>
+#include <nuttx/sched.h>
 #include <nuttx/semaphore.h>
 #include <nuttx/spinlock.h>
 #include <nuttx/virtio/virtio.h>
@@ -48,6 +52,11 @@
 #define VIRTIO_BLK_F_RO             5  /* Disk is read-only */
 #define VIRTIO_BLK_F_BLK_SIZE       6  /* Block size of disk is available */
 #define VIRTIO_BLK_F_FLUSH          9  /* Cache flush command support */
+#define VIRTIO_BLK_F_MQ             12 /* Support more than one vq */
+
+/* Ring feature bits */
+
+#define VIRTIO_BLK_RING_F_EVENT_IDX 29 /* Used/avail event index */
 
 /* Block request type */
 
@@ -114,10 +123,40 @@ begin_packed_struct struct virtio_blk_config_s
   uint32_t secure_erase_sector_alignment;
 } end_packed_struct;
 
+/* One block request, living on the stack of the caller until it is
+ * completed.  Requests that are waiting for ring space sit on the pending
+ * list of their queue; adjacent ones are merged behind the first one and
+ * share its headers and its completion.  The caller returns as soon as
+ * it sees the completion, so the completer must not touch the request
+ * after signalling it.
+ */
+
+struct virtio_blk_request_s
+{
+  struct virtio_blk_req_s       req;            /* Block out header */
+  struct virtio_blk_resp_s      resp;           /* Block in header */
+  struct list_node              node;           /* Pending/merged list link */
+  struct list_node              merged;         /* Requests merged into us */
+  FAR void                     *buffer;         /* Data, NULL for flush */
+  size_t                        len;            /* Data length in bytes */
+  uint8_t                       status;         /* Completion status */
+  bool                          poll;           /* Caller polls 'done' */
+  volatile bool                 done;           /* Completed, if polling */
+  sem_t                         sem;            /* Completed, otherwise */
+};
+
+struct virtio_blk_queue_s
+{
+  FAR struct virtqueue         *vq;             /* Request virtqueue */
+  spinlock_t                    lock;           /* Lock */
+  struct list_node              pending;        /* Waiting for ring space */
+};
+
 struct virtio_blk_priv_s
 {
   FAR struct virtio_device     *vdev;           /* Virtio device */
-  spinlock_t                    lock;           /* Lock */
+  struct virtio_blk_queue_s     queues[CONFIG_DRIVERS_VIRTIO_BLK_NQUEUES];
+  uint16_t                      nqueues;        /* Queues in use */
   uint64_t                      nsectors;       /* Sectore numbers */
   uint32_t                      block_size;     /* Block size */
   char                          name[NAME_MAX]; /* Device name */
@@ -184,119 +223,269 @@ static int g_virtio_blk_idx = 0;
  ****************************************************************************/
 
 /****************************************************************************
- * Name: virtio_blk_wait_complete
+ * Name: virtio_blk_signal
  *
  * Description:
- *   Wait the virtio block request complete
+ *   Hand the status to the caller of one request.  Exactly one of 'done'
+ *   and 'sem' is used, whichever the caller waits on, and it is the last
+ *   access to the request.
  *
  ****************************************************************************/
 
-static void virtio_blk_wait_complete(FAR struct virtqueue *vq,
-                                     FAR sem_t *respsem)
+static void virtio_blk_signal(FAR struct virtio_blk_request_s *r,
+                              uint8_t status)
 {
-  FAR struct virtio_blk_priv_s *priv = vq->vq_dev->priv;
-  FAR sem_t *sem;
+  r->status = status;
+  if (r->poll)
+    {
+      UP_DMB();
+      r->done = true;
+    }
+  else
+    {
+      nxsem_post(&r->sem);
+    }
+}
 
-  if (up_interrupt_context())
+/****************************************************************************
+ * Name: virtio_blk_complete
+ *
+ * Description:
+ *   Complete a request together with the requests merged into it
+ *
+ ****************************************************************************/
+
+static void virtio_blk_complete(FAR struct virtio_blk_request_s *r)
+{
+  FAR struct virtio_blk_request_s *merged;
+  FAR struct virtio_blk_request_s *tmp;
+  uint8_t status = r->resp.status;
+
+  list_for_every_entry_safe(&r->merged, merged, tmp,
+                            struct virtio_blk_request_s, node)
     {
-      for (; ; )
+      virtio_blk_signal(merged, status);
+    }
+
+  virtio_blk_signal(r, status);
+}
+
+/****************************************************************************
+ * Name: virtio_blk_submit
+ *
+ * Description:
+ *   Move pending requests to the virtqueue as long as there is ring space.
+ *   Following requests of the same direction that continue the sectors of
+ *   the first one are merged into it: they are added as extra data
+ *   buffers of a single virtio request.  Must be called with the queue
+ *   lock held.
+ *
+ ****************************************************************************/
+
+static void virtio_blk_submit(FAR struct virtio_blk_queue_s *queue)
+{
+  FAR struct virtqueue_buf vb[CONFIG_DRIVERS_VIRTIO_BLK_MERGE + 2];
+  FAR struct virtqueue *vq = queue->vq;
+  FAR struct virtio_blk_request_s *next;
+  FAR struct virtio_blk_request_s *r;
+  bool kick = false;
+  uint64_t sector;
+  int readnum;
+  int ret;
+  int n;
+
+  while ((r = list_peek_head_type(&queue->pending,
+                                  struct virtio_blk_request_s,
+                                  node)) != NULL)
+    {
+      if (vq->vq_free_cnt < (r->buffer != NULL ? 3 : 2))
         {
-          sem = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
-          if (sem == respsem)
-            {
-              break;
-            }
-          else if (sem != NULL)
+          break;
+        }
+
+      list_delete(&r->node);
+
+      /* Fill the virtqueue buffer:
+       * Buffer 0: the block out header;
+       * Buffer 1..n-2: the read/write buffers;
+       * Buffer n-1: the block in header, return the status.
+       */
+
+      n = 0;
+      vb[n].buf = &r->req;
+      vb[n++].len = VIRTIO_BLK_REQ_HEADER_SIZE;
+
+      if (r->buffer != NULL)
+        {
+          vb[n].buf = r->buffer;
+          vb[n++].len = r->len;
+          sector = r->req.sector + (r->len >> VIRTIO_BLK_SECTOR_BITS);
+
+          while (n <= CONFIG_DRIVERS_VIRTIO_BLK_MERGE &&
+                 vq->vq_free_cnt >= n + 2)
             {
-              nxsem_post(sem);
+              next = list_peek_head_type(&queue->pending,
+                                         struct virtio_blk_request_s, node);
+              if (next == NULL || next->buffer == NULL ||
+                  next->req.type != r->req.type ||
+                  next->req.sector != sector)
+                {
+                  break;
+                }
+
+              list_delete(&next->node);
+              list_add_tail(&r->merged, &next->node);
+              vb[n].buf = next->buffer;
+              vb[n++].len = next->len;
+              sector += next->len >> VIRTIO_BLK_SECTOR_BITS;
             }
         }
+
+      vb[n].buf = &r->resp;
+      vb[n++].len = VIRTIO_BLK_RESP_HEADER_SIZE;
+
+      readnum = r->req.type == VIRTIO_BLK_T_IN ? 1 : n - 1;
+      ret = virtqueue_add_buffer(vq, vb, readnum, n - readnum, r);
+      if (ret < 0)
+        {
+          vrterr("virtqueue_add_buffer failed, ret=%d\n", ret);
+          virtio_blk_complete(r);
+          continue;
+        }
+
+      kick = true;
     }
-  else
+
+  if (kick)
     {
-      nxsem_wait_uninterruptible(respsem);
+      virtqueue_kick(vq);
     }
 }
 
 /****************************************************************************
- * Name: virtio_blk_rdwr
+ * Name: virtio_blk_reap
  *
  * Description:
- *   Common function for read and write
+ *   Complete the finished requests of a queue and refill the ring
  *
  ****************************************************************************/
 
-static ssize_t virtio_blk_rdwr(FAR struct virtio_blk_priv_s *priv,
-                               FAR void *buffer, blkcnt_t startsector,
-                               unsigned int nsectors, bool write)
+static void virtio_blk_reap(FAR struct virtio_blk_queue_s *queue)
 {
-  FAR struct virtio_device *vdev = priv->vdev;
-  FAR struct virtqueue *vq = vdev->vrings_info[0].vq;
-  FAR struct virtqueue_buf vb[3];
-  struct virtio_blk_resp_s resp;
-  struct virtio_blk_req_s req;
+  FAR struct virtio_blk_request_s *r;
   irqstate_t flags;
-  sem_t respsem;
-  ssize_t ret;
-  int readnum;
 
-  nxsem_init(&respsem, 0, 0);
+  for (; ; )
+    {
+      r = virtqueue_get_buffer_lock(queue->vq, NULL, NULL, &queue->lock);
+      if (r == NULL)
+        {
+          break;
+        }
 
-  /* Build the block request */
+      virtio_blk_complete(r);
+    }
 
-  req.type     = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
-  req.reserved = 0;
-  req.sector   = startsector * priv->block_size >> VIRTIO_BLK_SECTOR_BITS;
-  resp.status  = VIRTIO_BLK_S_IOERR;
+  flags = spin_lock_irqsave(&queue->lock);
+  virtio_blk_submit(queue);
+  spin_unlock_irqrestore(&queue->lock, flags);
+}
 
-  /* Fill the virtqueue buffer:
-   * Buffer 0: the block out header;
-   * Buffer 1: the read/write buffer;
-   * Buffer 2: the block in header, return the status.
-   */
+/****************************************************************************
+ * Name: virtio_blk_request
+ *
+ * Description:
+ *   Queue a block request on the queue of the current CPU and wait for its
+ *   completion.  Any number of callers may have requests outstanding at
+ *   the same time; requests that do not fit into the ring wait on the
+ *   pending list and are submitted, possibly merged, as earlier ones
+ *   complete.
+ *
+ ****************************************************************************/
 
-  vb[0].buf = &req;
-  vb[0].len = VIRTIO_BLK_REQ_HEADER_SIZE;
-  vb[1].buf = buffer;
-  vb[1].len = nsectors * priv->block_size;
-  vb[2].buf = &resp;
-  vb[2].len = VIRTIO_BLK_RESP_HEADER_SIZE;
-  readnum = write ? 2 : 1;
+static int virtio_blk_request(FAR struct virtio_blk_priv_s *priv,
+                              uint32_t type, uint64_t sector,
+                              FAR void *buffer, size_t len)
+{
+  FAR struct virtio_blk_queue_s *queue;
+  struct virtio_blk_request_s r;
+  irqstate_t flags;
+  bool intctx;
 
-  if (up_interrupt_context())
-    {
-      virtqueue_disable_cb_lock(vq, &priv->lock);
-    }
+  queue = &priv->queues[this_cpu() % priv->nqueues];
+  intctx = up_interrupt_context();
 
-  flags = spin_lock_irqsave(&priv->lock);
-  ret = virtqueue_add_buffer(vq, vb, readnum, 3 - readnum, &respsem);
-  if (ret < 0)
+  /* Build the block request */
+
+  r.req.type     = type;
+  r.req.reserved = 0;
+  r.req.sector   = sector;
+  r.resp.status  = VIRTIO_BLK_S_IOERR;
+  r.buffer       = buffer;
+  r.len          = len;
+  r.poll         = intctx;
+  r.done         = false;
+  list_initialize(&r.merged);
+  nxsem_init(&r.sem, 0, 0);
+
+  if (intctx)
     {
-      spin_unlock_irqrestore(&priv->lock, flags);
-      vrterr("virtqueue_add_buffer failed, ret=%zd\n", ret);
-      goto err;
+      virtqueue_disable_cb_lock(queue->vq, &queue->lock);
     }
 
-  virtqueue_kick(vq);
-  spin_unlock_irqrestore(&priv->lock, flags);
+  flags = spin_lock_irqsave(&queue->lock);
+  list_add_tail(&queue->pending, &r.node);
+  virtio_blk_submit(queue);
+  spin_unlock_irqrestore(&queue->lock, flags);
 
-  /* Wait for the request completion */
+  /* Wait for the request completion, polling the queue if we can not
+   * sleep.
+   */
 
-  virtio_blk_wait_complete(vq, &respsem);
+  if (intctx)
+    {
+      while (!r.done)
+        {
+          virtio_blk_reap(queue);
+        }
 
-  if (resp.status != VIRTIO_BLK_S_OK)
+      UP_DMB();
+      virtqueue_enable_cb_lock(queue->vq, &queue->lock);
+    }
+  else
     {
-      vrterr("%s Error\n", write ? "Write" : "Read");
-      ret = -EIO;
+      nxsem_wait_uninterruptible(&r.sem);
     }
 
-err:
-  if (up_interrupt_context())
+  nxsem_destroy(&r.sem);
+  return r.status == VIRTIO_BLK_S_OK ? OK : -EIO;
+}
+
+/****************************************************************************
+ * Name: virtio_blk_rdwr
+ *
+ * Description:
+ *   Common function for read and write
+ *
+ ****************************************************************************/
+
+static ssize_t virtio_blk_rdwr(FAR struct virtio_blk_priv_s *priv,
+                               FAR void *buffer, blkcnt_t startsector,
+                               unsigned int nsectors, bool write)
+{
+  int ret;
+
+  ret = virtio_blk_request(priv, write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+                           startsector * priv->block_size >>
+                           VIRTIO_BLK_SECTOR_BITS,
+                           buffer, nsectors * priv->block_size);
+  if (ret < 0)
     {
-      virtqueue_enable_cb_lock(vq, &priv->lock);
+      vrterr("%s Error\n", write ? "Write" : "Read");
+      return ret;
     }
 
-  return ret >= 0 ? nsectors : ret;
+  return nsectors;
 }
 
 /****************************************************************************
@@ -406,47 +595,12 @@ static int virtio_blk_geometry(FAR struct inode *inode,
 
 static int virtio_blk_flush(FAR struct virtio_blk_priv_s *priv)
 {
-  FAR struct virtio_device *vdev = priv->vdev;
-  FAR struct virtqueue *vq = vdev->vrings_info[0].vq;
-  FAR struct virtqueue_buf vb[2];
-  struct virtio_blk_resp_s resp;
-  struct virtio_blk_req_s req;
-  irqstate_t flags;
-  sem_t respsem;
   int ret;
 
-  nxsem_init(&respsem, 0, 0);
-
-  /* Build the block request */
-
-  req.type     = VIRTIO_BLK_T_FLUSH;
-  req.reserved = 0;
-  req.sector   = 0;
-  resp.status  = VIRTIO_BLK_S_IOERR;
-
-  vb[0].buf = &req;
-  vb[0].len = VIRTIO_BLK_REQ_HEADER_SIZE;
-  vb[1].buf = &resp;
-  vb[1].len = VIRTIO_BLK_RESP_HEADER_SIZE;
-
-  flags = spin_lock_irqsave(&priv->lock);
-  ret = virtqueue_add_buffer(vq, vb, 1, 1, &respsem);
+  ret = virtio_blk_request(priv, VIRTIO_BLK_T_FLUSH, 0, NULL, 0);
   if (ret < 0)
-    {
-      spin_unlock_irqrestore(&priv->lock, flags);
-      return ret;
-    }
-
-  virtqueue_kick(vq);
-  spin_unlock_irqrestore(&priv->lock, flags);
-
-  /* Wait for the request completion */
-
-  nxsem_wait_uninterruptible(&respsem);
-  if (resp.status != VIRTIO_BLK_S_OK)
     {
       vrterr("Flush Error\n");
-      ret = -EIO;
     }
 
   return ret;
@@ -485,18 +639,8 @@ static int virtio_blk_ioctl(FAR struct inode *inode, int cmd,
 static void virtio_blk_done(FAR struct virtqueue *vq)
 {
   FAR struct virtio_blk_priv_s *priv = vq->vq_dev->priv;
-  FAR sem_t *respsem;
-
-  for (; ; )
-    {
-      respsem = virtqueue_get_buffer_lock(vq, NULL, NULL, &priv->lock);
-      if (respsem == NULL)
-        {
-          break;
-        }
 
-      nxsem_post(respsem);
-    }
+  virtio_blk_reap(&priv->queues[vq->vq_queue_index]);
 }
 
 /****************************************************************************
@@ -506,33 +650,61 @@ static void virtio_blk_done(FAR struct virtqueue *vq)
 static int virtio_blk_init(FAR struct virtio_blk_priv_s *priv,
                            FAR struct virtio_device *vdev)
 {
-  FAR const char *vqname[1];
-  vq_callback callback[1];
+  FAR const char *vqname[CONFIG_DRIVERS_VIRTIO_BLK_NQUEUES];
+  vq_callback callback[CONFIG_DRIVERS_VIRTIO_BLK_NQUEUES];
+  uint16_t nqueues = 1;
   int ret;
+  int i;
 
   priv->vdev = vdev;
   vdev->priv = priv;
-  spin_lock_init(&priv->lock);
 
   /* Initialize the virtio device */
 
   virtio_set_status(vdev, VIRTIO_CONFIG_STATUS_DRIVER);
   virtio_negotiate_features(vdev, (1UL << VIRTIO_BLK_F_RO) |
                                   (1UL << VIRTIO_BLK_F_BLK_SIZE) |
-                                  (1UL << VIRTIO_BLK_F_FLUSH), NULL);
+                                  (1UL << VIRTIO_BLK_F_FLUSH) |
+                                  (1UL << VIRTIO_BLK_F_MQ) |
+                                  (1UL << VIRTIO_BLK_RING_F_EVENT_IDX),
+                            NULL);
   virtio_set_status(vdev, VIRTIO_CONFIG_FEATURES_OK);
 
-  vqname[0]   = "virtio_blk_vq";
-  callback[0] = virtio_blk_done;
-  ret = virtio_create_virtqueues(vdev, 0, 1, vqname, callback, NULL);
+  if (virtio_has_feature(vdev, VIRTIO_BLK_F_MQ))
+    {
+      virtio_read_config_member(vdev, struct virtio_blk_config_s,
+                                num_queues, &nqueues);
+      nqueues = MAX(MIN(nqueues, CONFIG_DRIVERS_VIRTIO_BLK_NQUEUES), 1);
+    }
+
+  for (i = 0; i < nqueues; i++)
+    {
+      vqname[i]   = "virtio_blk_vq";
+      callback[i] = virtio_blk_done;
+    }
+
+  ret = virtio_create_virtqueues(vdev, 0, nqueues, vqname, callback, NULL);
   if (ret < 0)
     {
       vrterr("virtio_device_create_virtqueue failed, ret=%d\n", ret);
       return ret;
     }
 
+  priv->nqueues = nqueues;
+  for (i = 0; i < nqueues; i++)
+    {
+      priv->queues[i].vq = vdev->vrings_info[i].vq;
+      spin_lock_init(&priv->queues[i].lock);
+      list_initialize(&priv->queues[i].pending);
+    }
+
   virtio_set_status(vdev, VIRTIO_CONFIG_STATUS_DRIVER_OK);
-  virtqueue_enable_cb(vdev->vrings_info[0].vq);
+  for (i = 0; i < nqueues; i++)
+    {
+      virtqueue_enable_cb(priv->queues[i].vq);
+    }
+
+  vrtinfo("Virtio blk using %u queues\n", nqueues);
   return ret;
 }
 
@@ -0,0 +1,923 @@
+/****************************************************************************
+ * fs/aio/ioring.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/clock.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioring.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/kthread.h>
+#include <nuttx/list.h>
+#include <nuttx/mm/map.h>
+#include <nuttx/mutex.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/signal.h>
+#include <nuttx/spinlock.h>
+
+#ifdef CONFIG_NET
+#  include <nuttx/net/net.h>
+#endif
+
+#ifdef CONFIG_FS_IORING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define IORING_NPOLLWAITERS 2
+
+/* Sent to the workers of a ring being closed to interrupt the requests
+ * blocked in a driver.  Its default action is to ignore it, so the only
+ * effect is that the blocking wait returns -EINTR.
+ */
+
+#define IORING_SIGCANCEL    SIGURG
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One request in flight */
+
+struct ioring_req_s
+{
+  struct list_node  node;          /* Link in the free or a pending list */
+  FAR struct ioring_ctx_s *ctx;    /* The ring that submitted it */
+  FAR struct file  *filep;         /* Referenced until completion */
+  struct ioring_sqe_s sqe;         /* Private copy of the SQE */
+};
+
+/* The state of one open of the I/O ring device.  Every ring has workers
+ * of its own: a request that blocks, e.g. a read of an empty pipe, only
+ * ever holds up the ring that submitted it.
+ */
+
+struct ioring_ctx_s
+{
+  mutex_t           lock;          /* Serializes setup and submission */
+  sem_t             waitsem;       /* Posted on completion for waiters */
+  spinlock_t        cqlock;        /* Serializes posting the CQEs */
+  atomic_t          waiters;       /* Threads waiting for completions */
+  atomic_t          inflight;      /* Requests handed to the workers */
+  spinlock_t        pendlock;      /* Protects pending and closing */
+  sem_t             pendsem;       /* Counts the pending requests */
+  sem_t             exitsem;       /* Posted by the workers on exit */
+  struct list_node  pending;       /* Requests not picked up by a worker */
+  bool              closing;       /* Cancel instead of executing */
+  bool              stop;          /* Workers exit once idle */
+  int               nworkers;      /* Number of workers started */
+  pid_t             workers[CONFIG_FS_IORING_NWORKERS];
+  FAR struct ioring_s *ring;       /* The shared ring memory */
+  size_t            size;          /* Size of the shared ring memory */
+
+  /* Private copies of the ring layout and of the indexes owned by the
+   * kernel.  The shared memory can be overwritten by the submitter at any
+   * time, so it is only ever written, or read and bounds checked.
+   */
+
+  FAR struct ioring_sqe_s *sqes;   /* The submission queue entries */
+  FAR struct ioring_cqe_s *cqes;   /* The completion queue entries */
+  uint32_t          sq_mask;       /* sq_entries - 1 */
+  uint32_t          cq_mask;       /* cq_entries - 1 */
+  uint32_t          sq_head;       /* Next SQE to be consumed */
+  uint32_t          cq_tail;       /* Next CQE to be posted */
+  FAR struct ioring_req_s *reqs;   /* cq_entries request containers */
+  struct list_node  free;          /* Free request containers */
+  FAR struct pollfd *fds[IORING_NPOLLWAITERS];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int ioring_open(FAR struct file *filep);
+static int ioring_close(FAR struct file *filep);
+static int ioring_ioctl(FAR struct file *filep, int cmd, unsigned long arg);
+static int ioring_mmap(FAR struct file *filep,
+                       FAR struct mm_map_entry_s *map);
+static int ioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                       bool setup);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct file_operations g_ioring_fops =
+{
+  ioring_open,     /* open */
+  ioring_close,    /* close */
+  NULL,            /* read */
+  NULL,            /* write */
+  NULL,            /* seek */
+  ioring_ioctl,    /* ioctl */
+  ioring_mmap,     /* mmap */
+  NULL,            /* truncate */
+  ioring_poll      /* poll */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ioring_complete
+ *
+ * Description:
+ *   Post the completion of a request on its ring, release the request and
+ *   wake up anybody waiting for completions.
+ *
+ ****************************************************************************/
+
+static void ioring_complete(FAR struct ioring_ctx_s *ctx,
+                            FAR struct ioring_req_s *req, int32_t res)
+{
+  FAR struct ioring_cqe_s *cqe;
+  irqstate_t flags;
+  int semcount = 0;
+
+  flags = spin_lock_irqsave(&ctx->cqlock);
+
+  /* The submission logic keeps room for every request in flight, so the
+   * completion queue cannot overflow here.
+   */
+
+  cqe = &ctx->cqes[ctx->cq_tail & ctx->cq_mask];
+  cqe->user_data = req->sqe.user_data;
+  cqe->res       = res;
+  cqe->flags     = 0;
+  ctx->cq_tail++;
+  atomic_set_release(&ctx->ring->cq_tail, ctx->cq_tail);
+
+  list_add_tail(&ctx->free, &req->node);
+  atomic_fetch_sub(&ctx->inflight, 1);
+
+  poll_notify(ctx->fds, IORING_NPOLLWAITERS, POLLIN);
+  spin_unlock_irqrestore(&ctx->cqlock, flags);
+
+  if (atomic_read(&ctx->waiters) > 0)
+    {
+      nxsem_get_value(&ctx->waitsem, &semcount);
+      if (semcount < 1)
+        {
+          nxsem_post(&ctx->waitsem);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: ioring_execute
+ *
+ * Description:
+ *   Perform one request on a worker thread.
+ *
+ ****************************************************************************/
+
+static int32_t ioring_execute(FAR struct ioring_req_s *req)
+{
+  FAR struct ioring_sqe_s *sqe = &req->sqe;
+  FAR struct file *filep = req->filep;
+#ifdef CONFIG_NET
+  FAR struct socket *psock;
+#endif
+
+  switch (sqe->opcode)
+    {
+      case IORING_OP_READ:
+        if (sqe->off < 0)
+          {
+            return file_read(filep, sqe->addr, sqe->len);
+          }
+
+        return file_pread(filep, sqe->addr, sqe->len, sqe->off);
+
+      case IORING_OP_WRITE:
+        if (sqe->off < 0)
+          {
+            return file_write(filep, sqe->addr, sqe->len);
+          }
+
+        return file_pwrite(filep, sqe->addr, sqe->len, sqe->off);
+
+      case IORING_OP_FSYNC:
+        return file_fsync(filep);
+
+#ifdef CONFIG_NET
+      case IORING_OP_SEND:
+        psock = file_socket(filep);
+        if (psock == NULL)
+          {
+            return -ENOTSOCK;
+          }
+
+        return psock_send(psock, sqe->addr, sqe->len, sqe->msgflags);
+
+      case IORING_OP_RECV:
+        psock = file_socket(filep);
+        if (psock == NULL)
+          {
+            return -ENOTSOCK;
+          }
+
+        return psock_recv(psock, sqe->addr, sqe->len, sqe->msgflags);
+#endif
+
+      default:
+        return -ENOSYS;
+    }
+}
+
+/****************************************************************************
+ * Name: ioring_worker
+ *
+ * Description:
+ *   The body of the worker threads of one ring.  They only exit when the
+ *   ring is closed, after all its requests completed.
+ *
+ ****************************************************************************/
+
+static int ioring_worker(int argc, FAR char *argv[])
+{
+  FAR struct ioring_ctx_s *ctx;
+  FAR struct ioring_req_s *req;
+  irqstate_t flags;
+  bool closing;
+  int32_t res;
+
+  DEBUGASSERT(argc >= 2);
+  ctx = (FAR struct ioring_ctx_s *)((uintptr_t)strtoul(argv[1], NULL, 16));
+
+  for (; ; )
+    {
+      nxsem_wait_uninterruptible(&ctx->pendsem);
+
+      flags = spin_lock_irqsave(&ctx->pendlock);
+      if (ctx->stop)
+        {
+          spin_unlock_irqrestore(&ctx->pendlock, flags);
+          break;
+        }
+
+      req = list_remove_head_type(&ctx->pending, struct ioring_req_s,
+                                  node);
+      closing = ctx->closing;
+      spin_unlock_irqrestore(&ctx->pendlock, flags);
+
+      if (req != NULL)
+        {
+          res = closing ? -ECANCELED : ioring_execute(req);
+
+          /* Interrupted by ioring_close() */
+
+          if (res == -EINTR && ctx->closing)
+            {
+              res = -ECANCELED;
+            }
+
+          file_put(req->filep);
+          ioring_complete(ctx, req, res);
+        }
+    }
+
+  nxsem_post(&ctx->exitsem);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ioring_start
+ *
+ * Description:
+ *   Start the workers of a ring.
+ *
+ ****************************************************************************/
+
+static int ioring_start(FAR struct ioring_ctx_s *ctx)
+{
+  FAR char *argv[2];
+  char arg[32];
+  int ret = OK;
+
+  snprintf(arg, sizeof(arg), "%p", ctx);
+  argv[0] = arg;
+  argv[1] = NULL;
+
+  while (ctx->nworkers < CONFIG_FS_IORING_NWORKERS)
+    {
+      ret = kthread_create("ioring", CONFIG_FS_IORING_PRIORITY,
+                           CONFIG_FS_IORING_STACKSIZE, ioring_worker, argv);
+      if (ret < 0)
+        {
+          ferr("ERROR: Failed to start worker: %d\n", ret);
+          break;
+        }
+
+      ctx->workers[ctx->nworkers++] = (pid_t)ret;
+    }
+
+  /* Fewer workers only means less parallelism */
+
+  return ctx->nworkers > 0 ? OK : ret;
+}
+
+/****************************************************************************
+ * Name: ioring_stop
+ *
+ * Description:
+ *   Cancel the requests of a ring that is being closed and stop its
+ *   workers.  The pending requests complete with -ECANCELED without being
+ *   started.  The ones blocked in a driver are interrupted with a signal,
+ *   repeated until they return in case it came before they blocked.
+ *
+ ****************************************************************************/
+
+static void ioring_stop(FAR struct ioring_ctx_s *ctx)
+{
+  FAR struct ioring_req_s *req;
+  struct list_node pending;
+  irqstate_t flags;
+  int i;
+
+  list_initialize(&pending);
+
+  flags = spin_lock_irqsave(&ctx->pendlock);
+  ctx->closing = true;
+  while ((req = list_remove_head_type(&ctx->pending, struct ioring_req_s,
+                                      node)) != NULL)
+    {
+      list_add_tail(&pending, &req->node);
+    }
+
+  spin_unlock_irqrestore(&ctx->pendlock, flags);
+
+  while ((req = list_remove_head_type(&pending, struct ioring_req_s,
+                                      node)) != NULL)
+    {
+      file_put(req->filep);
+      ioring_complete(ctx, req, -ECANCELED);
+    }
+
+  /* The completions do not need to be consumed, there is always room for
+   * them.
+   */
+
+  while (atomic_read(&ctx->inflight) > 0)
+    {
+      for (i = 0; i < ctx->nworkers; i++)
+        {
+          nxsig_kill(ctx->workers[i], IORING_SIGCANCEL);
+        }
+
+      atomic_fetch_add(&ctx->waiters, 1);
+      nxsem_tickwait_uninterruptible(&ctx->waitsem, MSEC2TICK(10));
+      atomic_fetch_sub(&ctx->waiters, 1);
+    }
+
+  flags = spin_lock_irqsave(&ctx->pendlock);
+  ctx->stop = true;
+  spin_unlock_irqrestore(&ctx->pendlock, flags);
+
+  for (i = 0; i < ctx->nworkers; i++)
+    {
+      nxsem_post(&ctx->pendsem);
+    }
+
+  for (i = 0; i < ctx->nworkers; i++)
+    {
+      nxsem_wait_uninterruptible(&ctx->exitsem);
+    }
+}
+
+/****************************************************************************
+ * Name: ioring_reserve
+ *
+ * Description:
+ *   Reserve a request container and the room for its completion.  The
+ *   check and the reservation are made under cqlock, so that completions
+ *   posted at the same time by the workers are accounted for.
+ *
+ * Returned Value:
+ *   The request container, or NULL with *err set to -EBUSY if the
+ *   completion queue is full, or to -EINVAL if the head written by the
+ *   submitter is inconsistent.
+ *
+ ****************************************************************************/
+
+static FAR struct ioring_req_s *ioring_reserve(FAR struct ioring_ctx_s *ctx,
+                                               FAR int *err)
+{
+  FAR struct ioring_req_s *req = NULL;
+  irqstate_t flags;
+  uint32_t pending;
+
+  flags = spin_lock_irqsave(&ctx->cqlock);
+
+  pending = ctx->cq_tail -
+            (uint32_t)atomic_read_acquire(&ctx->ring->cq_head);
+  if (pending > ctx->cq_mask + 1)
+    {
+      *err = -EINVAL;
+    }
+  else if (pending + (uint32_t)atomic_read(&ctx->inflight) > ctx->cq_mask)
+    {
+      *err = -EBUSY;
+    }
+  else
+    {
+      req = list_remove_head_type(&ctx->free, struct ioring_req_s, node);
+      DEBUGASSERT(req != NULL);
+      atomic_fetch_add(&ctx->inflight, 1);
+    }
+
+  spin_unlock_irqrestore(&ctx->cqlock, flags);
+  return req;
+}
+
+/****************************************************************************
+ * Name: ioring_submit_one
+ *
+ * Description:
+ *   Either complete a reserved request at once or hand it to the workers
+ *   of the ring.  The file descriptor is resolved here, in the context of
+ *   the submitter.
+ *
+ ****************************************************************************/
+
+static void ioring_submit_one(FAR struct ioring_ctx_s *ctx,
+                              FAR struct ioring_req_s *req)
+{
+  irqstate_t flags;
+  int ret;
+
+  if (req->sqe.opcode == IORING_OP_NOP)
+    {
+      ioring_complete(ctx, req, OK);
+      return;
+    }
+
+  ret = file_get(req->sqe.fd, &req->filep);
+  if (ret < 0)
+    {
+      ioring_complete(ctx, req, ret);
+      return;
+    }
+
+  flags = spin_lock_irqsave(&ctx->pendlock);
+  list_add_tail(&ctx->pending, &req->node);
+  spin_unlock_irqrestore(&ctx->pendlock, flags);
+
+  nxsem_post(&ctx->pendsem);
+}
+
+/****************************************************************************
+ * Name: ioring_submit
+ *
+ * Description:
+ *   Consume up to 'to_submit' entries of the submission queue.  No more
+ *   entries are consumed than there is room for their completions.
+ *
+ * Returned Value:
+ *   The number of entries consumed, -EBUSY if none could be consumed
+ *   because the completion queue is full, or -EINVAL if the indexes
+ *   written by the submitter are inconsistent.
+ *
+ ****************************************************************************/
+
+static int ioring_submit(FAR struct ioring_ctx_s *ctx, uint32_t to_submit)
+{
+  FAR struct ioring_s *ring = ctx->ring;
+  FAR struct ioring_req_s *req;
+  uint32_t tail;
+  uint32_t submitted = 0;
+  int ret;
+
+  while (submitted < to_submit)
+    {
+      tail = atomic_read_acquire(&ring->sq_tail);
+      if (tail == ctx->sq_head)
+        {
+          break;
+        }
+
+      if (tail - ctx->sq_head > ctx->sq_mask + 1)
+        {
+          return submitted > 0 ? submitted : -EINVAL;
+        }
+
+      req = ioring_reserve(ctx, &ret);
+      if (req == NULL)
+        {
+          return submitted > 0 ? submitted : ret;
+        }
+
+      /* Copy the entry before handing the slot back to the submitter */
+
+      memcpy(&req->sqe, &ctx->sqes[ctx->sq_head & ctx->sq_mask],
+             sizeof(struct ioring_sqe_s));
+      ctx->sq_head++;
+      atomic_set_release(&ring->sq_head, ctx->sq_head);
+
+      ioring_submit_one(ctx, req);
+      submitted++;
+    }
+
+  return submitted;
+}
+
+/****************************************************************************
+ * Name: ioring_wait
+ *
+ * Description:
+ *   Wait until at least 'min_complete' completions are waiting to be
+ *   consumed.  'timeout' is in milliseconds, negative to wait forever.
+ *
+ ****************************************************************************/
+
+static int ioring_wait(FAR struct ioring_ctx_s *ctx, uint32_t min_complete,
+                       int timeout)
+{
+  FAR struct ioring_s *ring = ctx->ring;
+  uint32_t ready;
+  int ret = OK;
+
+  atomic_fetch_add(&ctx->waiters, 1);
+
+  for (; ; )
+    {
+      ready = ctx->cq_tail - (uint32_t)atomic_read(&ring->cq_head);
+      if (ready > ctx->cq_mask + 1)
+        {
+          ret = -EINVAL;
+          break;
+        }
+
+      if (ready >= min_complete)
+        {
+          break;
+        }
+
+      if (timeout < 0)
+        {
+          ret = nxsem_wait(&ctx->waitsem);
+        }
+      else
+        {
+          ret = nxsem_tickwait(&ctx->waitsem, MSEC2TICK(timeout));
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  atomic_fetch_sub(&ctx->waiters, 1);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ioring_setup
+ *
+ * Description:
+ *   Allocate the shared ring memory and the request containers, and start
+ *   the workers.
+ *
+ ****************************************************************************/
+
+static int ioring_setup(FAR struct ioring_ctx_s *ctx,
+                        FAR struct ioring_params_s *params)
+{
+  FAR struct ioring_s *ring;
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  size_t size;
+  uint32_t i;
+  int ret;
+
+  if (ctx->ring != NULL)
+    {
+      return -EBUSY;
+    }
+
+  if (params->sq_entries == 0 ||
+      params->sq_entries > CONFIG_FS_IORING_MAXENTRIES ||
+      params->cq_entries > 2 * CONFIG_FS_IORING_MAXENTRIES)
+    {
+      return -EINVAL;
+    }
+
+  /* Round the queue sizes up to powers of two */
+
+  sq_entries = 1;
+  while (sq_entries < params->sq_entries)
+    {
+      sq_entries <<= 1;
+    }
+
+  i = params->cq_entries ? params->cq_entries : 2 * sq_entries;
+  cq_entries = 1;
+  while (cq_entries < i)
+    {
+      cq_entries <<= 1;
+    }
+
+  /* The ring is allocated from the user heap so that the submitter can
+   * access it directly.
+   */
+
+  size = sizeof(struct ioring_s) +
+         sq_entries * sizeof(struct ioring_sqe_s) +
+         cq_entries * sizeof(struct ioring_cqe_s);
+
+  ring = kumm_zalloc(size);
+  if (ring == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ctx->reqs = kmm_zalloc(cq_entries * sizeof(struct ioring_req_s));
+  if (ctx->reqs == NULL)
+    {
+      kumm_free(ring);
+      return -ENOMEM;
+    }
+
+  ret = ioring_start(ctx);
+  if (ret < 0)
+    {
+      kmm_free(ctx->reqs);
+      kumm_free(ring);
+      return ret;
+    }
+
+  ctx->sqes    = (FAR struct ioring_sqe_s *)(ring + 1);
+  ctx->cqes    = (FAR struct ioring_cqe_s *)(ctx->sqes + sq_entries);
+  ctx->sq_mask = sq_entries - 1;
+  ctx->cq_mask = cq_entries - 1;
+
+  ring->sq_entries = sq_entries;
+  ring->cq_entries = cq_entries;
+  ring->sqes = ctx->sqes;
+  ring->cqes = ctx->cqes;
+
+  for (i = 0; i < cq_entries; i++)
+    {
+      ctx->reqs[i].ctx = ctx;
+      list_add_tail(&ctx->free, &ctx->reqs[i].node);
+    }
+
+  ctx->ring = ring;
+  ctx->size = size;
+
+  params->sq_entries = sq_entries;
+  params->cq_entries = cq_entries;
+  params->ring       = ring;
+  params->size       = size;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ioring_open
+ ****************************************************************************/
+
+static int ioring_open(FAR struct file *filep)
+{
+  FAR struct ioring_ctx_s *ctx;
+
+  ctx = kmm_zalloc(sizeof(struct ioring_ctx_s));
+  if (ctx == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  nxmutex_init(&ctx->lock);
+  nxsem_init(&ctx->waitsem, 0, 0);
+  nxsem_init(&ctx->pendsem, 0, 0);
+  nxsem_init(&ctx->exitsem, 0, 0);
+  spin_lock_init(&ctx->cqlock);
+  spin_lock_init(&ctx->pendlock);
+  list_initialize(&ctx->free);
+  list_initialize(&ctx->pending);
+
+  filep->f_priv = ctx;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ioring_close
+ ****************************************************************************/
+
+static int ioring_close(FAR struct file *filep)
+{
+  FAR struct ioring_ctx_s *ctx = filep->f_priv;
+
+  if (ctx->ring != NULL)
+    {
+      /* The workers still reference the rings */
+
+      ioring_stop(ctx);
+      kmm_free(ctx->reqs);
+      kumm_free(ctx->ring);
+    }
+
+  nxsem_destroy(&ctx->exitsem);
+  nxsem_destroy(&ctx->pendsem);
+  nxsem_destroy(&ctx->waitsem);
+  nxmutex_destroy(&ctx->lock);
+  kmm_free(ctx);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ioring_ioctl
+ ****************************************************************************/
+
+static int ioring_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
+{
+  FAR struct ioring_ctx_s *ctx = filep->f_priv;
+  FAR struct ioring_enter_s *enter;
+  int submitted = 0;
+  int ret;
+
+  ret = nxmutex_lock(&ctx->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  switch (cmd)
+    {
+      case IORING_IOC_SETUP:
+        ret = ioring_setup(ctx,
+                           (FAR struct ioring_params_s *)((uintptr_t)arg));
+        break;
+
+      case IORING_IOC_ENTER:
+        enter = (FAR struct ioring_enter_s *)((uintptr_t)arg);
+        if (ctx->ring == NULL || enter == NULL)
+          {
+            ret = -EINVAL;
+            break;
+          }
+
+        if (enter->to_submit > 0)
+          {
+            submitted = ioring_submit(ctx, enter->to_submit);
+            if (submitted < 0)
+              {
+                ret = submitted;
+                break;
+              }
+          }
+
+        nxmutex_unlock(&ctx->lock);
+
+        if ((enter->flags & IORING_ENTER_GETEVENTS) != 0 &&
+            enter->min_complete > 0)
+          {
+            ret = ioring_wait(ctx, enter->min_complete, enter->timeout);
+            if (ret < 0 && submitted == 0)
+              {
+                return ret;
+              }
+          }
+
+        return submitted;
+
+      default:
+        ret = -ENOTTY;
+        break;
+    }
+
+  nxmutex_unlock(&ctx->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ioring_mmap
+ ****************************************************************************/
+
+static int ioring_mmap(FAR struct file *filep,
+                       FAR struct mm_map_entry_s *map)
+{
+  FAR struct ioring_ctx_s *ctx = filep->f_priv;
+
+  if (ctx->ring == NULL || map->offset != 0 || map->length > ctx->size)
+    {
+      return -EINVAL;
+    }
+
+  map->vaddr = ctx->ring;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ioring_poll
+ *
+ * Description:
+ *   The device is readable while completions wait to be consumed, so a
+ *   ring can be watched with poll() or epoll() next to other descriptors.
+ *
+ ****************************************************************************/
+
+static int ioring_poll(FAR struct file *filep, FAR struct pollfd *fds,
+                       bool setup)
+{
+  FAR struct ioring_ctx_s *ctx = filep->f_priv;
+  FAR struct ioring_s *ring;
+  irqstate_t flags;
+  int ret = -EBUSY;
+  int i;
+
+  flags = spin_lock_irqsave(&ctx->cqlock);
+
+  if (setup)
+    {
+      for (i = 0; i < IORING_NPOLLWAITERS; i++)
+        {
+          if (ctx->fds[i] == NULL)
+            {
+              ctx->fds[i] = fds;
+              fds->priv   = &ctx->fds[i];
+              ret         = OK;
+              break;
+            }
+        }
+
+      spin_unlock_irqrestore(&ctx->cqlock, flags);
+
+      ring = ctx->ring;
+      if (ret == OK && ring != NULL &&
+          ctx->cq_tail != (uint32_t)atomic_read(&ring->cq_head))
+        {
+          poll_notify(&fds, 1, POLLIN);
+        }
+    }
+  else
+    {
+      if (fds->priv != NULL)
+        {
+          *(FAR struct pollfd **)fds->priv = NULL;
+          fds->priv = NULL;
+        }
+
+      spin_unlock_irqrestore(&ctx->cqlock, flags);
+      ret = OK;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ioring_initialize
+ *
+ * Description:
+ *   Register the I/O ring device at IORING_DEVPATH.
+ *
+ ****************************************************************************/
+
+int ioring_initialize(void)
+{
+  return register_driver(IORING_DEVPATH, &g_ioring_fops, 0666, NULL);
+}
+
+#endif /* CONFIG_FS_IORING */
@@ -41,6 +41,8 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/list.h>
+#include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 
@@ -66,14 +68,56 @@ struct cromfs_dir_s
   uint32_t cr_curroffset;     /* Current offset into the directory contents */
 };
 
+/* This describes where one data block of a file lies */
+
+struct cromfs_blkinfo_s
+{
+  uint32_t cb_hdroffs;                      /* Offset to the LZF header */
+  uint32_t cb_fpos;                         /* File offset of the block data */
+};
+
+/* This is the block index of a regular file.  It is built the first time
+ * that the file is opened and then kept until the file system is unbound.
+ */
+
+struct cromfs_index_s
+{
+  FAR struct cromfs_index_s *cx_flink;      /* Next index in the list */
+  FAR const struct cromfs_node_s *cx_node;  /* The indexed file node */
+  uint32_t cx_nblocks;                      /* Number of data blocks */
+  struct cromfs_blkinfo_s cx_blocks[1];     /* Blocks, by file offset */
+};
+
+/* One block of decompressed data in the cache */
+
+struct cromfs_cblock_s
+{
+  struct list_node cc_node;                 /* LRU list, most recent first */
+  uint32_t cc_offset;                       /* Offset to the compressed data
+                                             * (zero means none) */
+  uint16_t cc_ulen;                         /* Length of decompressed data */
+  uint8_t cc_data[1];                       /* Decompressed data */
+};
+
+/* This is the state shared by all open files.  Since there is only one
+ * CROMFS image, there is only one instance of this structure.
+ */
+
+struct cromfs_cache_s
+{
+  mutex_t cs_lock;                          /* Protects the rest */
+  uint16_t cs_nbound;                       /* Number of mounts */
+  uint16_t cs_ncblocks;                     /* Cache blocks allocated */
+  FAR struct cromfs_index_s *cs_index;      /* Block indices */
+  struct list_node cs_lru;                  /* Cache blocks, MRU first */
+};
+
 /* This structure represents an open, regular file */
 
 struct cromfs_file_s
 {
   FAR const struct cromfs_node_s *ff_node;  /* The open file node */
-  uint32_t ff_offset;                       /* Cached block offset (zero means none) */
-  uint16_t ff_ulen;                         /* Length of decompressed data in cache */
-  FAR uint8_t *ff_buffer;                   /* Cached, decompressed data */
+  FAR struct cromfs_index_s *ff_index;      /* Block index of the node */
 };
 
 /* This is the form of the callback from cromfs_foreach_node(): */
@@ -137,6 +181,16 @@ static int      cromfs_find_node(FAR const struct cromfs_volume_s *fs,
                                  FAR const char *relpath,
                                  FAR struct cromfs_nodeinfo_s *info,
                                  FAR uint32_t *offset);
+static uint32_t cromfs_block_info(FAR const struct lzf_header_s *hdr,
+                                  FAR uint16_t *ulen, FAR uint16_t *clen);
+static FAR struct cromfs_index_s *
+                cromfs_get_index(FAR const struct cromfs_volume_s *fs,
+                                 FAR const struct cromfs_node_s *node);
+static uint32_t cromfs_find_block(FAR struct cromfs_index_s *index,
+                                  off_t fpos);
+static FAR struct cromfs_cblock_s *
+                cromfs_get_cblock(FAR const struct cromfs_volume_s *fs,
+                                  uint32_t voloffs, bool alloc);
 
 /* Common file system methods */
 
@@ -230,6 +284,21 @@ const struct mountpt_operations g_cromfs_operations =
 
 extern const struct cromfs_volume_s g_cromfs_image;
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Block indices and decompressed blocks shared by all open files */
+
+static struct cromfs_cache_s g_cromfs_cache =
+{
+  NXMUTEX_INITIALIZER,
+  0,
+  0,
+  NULL,
+  LIST_INITIAL_VALUE(g_cromfs_cache.cs_lru)
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -728,6 +797,216 @@ static int cromfs_find_node(FAR const struct cromfs_volume_s *fs,
     }
 }
 
+/****************************************************************************
+ * Name: cromfs_block_info
+ *
+ * Description:
+ *   Return the uncompressed and compressed sizes of the data block with
+ *   the LZF header 'hdr', and the size of the whole block in the image.
+ *   The compressed size is only valid for type 1 blocks.
+ *
+ ****************************************************************************/
+
+static uint32_t cromfs_block_info(FAR const struct lzf_header_s *hdr,
+                                  FAR uint16_t *ulen, FAR uint16_t *clen)
+{
+  if (hdr->lzf_type == LZF_TYPE0_HDR)
+    {
+      FAR const struct lzf_type0_header_s *hdr0 =
+        (FAR const struct lzf_type0_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr0->lzf_len[0] << 8 |
+              (uint16_t)hdr0->lzf_len[1];
+      return (uint32_t)*ulen + LZF_TYPE0_HDR_SIZE;
+    }
+  else
+    {
+      FAR const struct lzf_type1_header_s *hdr1 =
+        (FAR const struct lzf_type1_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr1->lzf_ulen[0] << 8 |
+              (uint16_t)hdr1->lzf_ulen[1];
+      *clen = (uint16_t)hdr1->lzf_clen[0] << 8 |
+              (uint16_t)hdr1->lzf_clen[1];
+      return (uint32_t)*clen + LZF_TYPE1_HDR_SIZE;
+    }
+}
+
+/****************************************************************************
+ * Name: cromfs_get_index
+ *
+ * Description:
+ *   Return the block index of a regular file node, walking the chain of
+ *   LZF headers to build it if this is the first open of the node.  The
+ *   caller must hold the cache lock.
+ *
+ ****************************************************************************/
+
+static FAR struct cromfs_index_s *
+cromfs_get_index(FAR const struct cromfs_volume_s *fs,
+                 FAR const struct cromfs_node_s *node)
+{
+  FAR struct cromfs_index_s *index;
+  FAR const struct lzf_header_s *hdr;
+  FAR const struct lzf_header_s *first;
+  uint32_t nblocks;
+  uint32_t fpos;
+  uint32_t i;
+  uint16_t ulen;
+  uint16_t clen;
+
+  for (index = g_cromfs_cache.cs_index; index != NULL;
+       index = index->cx_flink)
+    {
+      if (index->cx_node == node)
+        {
+          return index;
+        }
+    }
+
+  /* Count the blocks */
+
+  first   = node->cn_size > 0 ? (FAR const struct lzf_header_s *)
+            cromfs_offset2addr(fs, node->u.cn_blocks) : NULL;
+  hdr     = first;
+  nblocks = 0;
+
+  for (fpos = 0; fpos < node->cn_size; fpos += ulen)
+    {
+      hdr = (FAR const struct lzf_header_s *)
+            ((FAR const uint8_t *)hdr +
+             cromfs_block_info(hdr, &ulen, &clen));
+      nblocks++;
+    }
+
+  index = fs_heap_malloc(sizeof(struct cromfs_index_s) +
+                         nblocks * sizeof(struct cromfs_blkinfo_s));
+  if (index == NULL)
+    {
+      return NULL;
+    }
+
+  index->cx_node    = node;
+  index->cx_nblocks = nblocks;
+
+  /* And record where each one starts */
+
+  hdr  = first;
+  fpos = 0;
+
+  for (i = 0; i < nblocks; i++)
+    {
+      index->cx_blocks[i].cb_hdroffs = cromfs_addr2offset(fs, hdr);
+      index->cx_blocks[i].cb_fpos    = fpos;
+
+      hdr   = (FAR const struct lzf_header_s *)
+              ((FAR const uint8_t *)hdr +
+               cromfs_block_info(hdr, &ulen, &clen));
+      fpos += ulen;
+    }
+
+  index->cx_flink          = g_cromfs_cache.cs_index;
+  g_cromfs_cache.cs_index  = index;
+  return index;
+}
+
+/****************************************************************************
+ * Name: cromfs_find_block
+ *
+ * Description:
+ *   Return the index of the block containing file offset 'fpos'.
+ *
+ ****************************************************************************/
+
+static uint32_t cromfs_find_block(FAR struct cromfs_index_s *index,
+                                  off_t fpos)
+{
+  uint32_t low  = 0;
+  uint32_t high = index->cx_nblocks;
+  uint32_t mid;
+
+  while (high - low > 1)
+    {
+      mid = (low + high) / 2;
+      if (index->cx_blocks[mid].cb_fpos <= fpos)
+        {
+          low  = mid;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  return low;
+}
+
+/****************************************************************************
+ * Name: cromfs_get_cblock
+ *
+ * Description:
+ *   Return the cache block holding the decompressed data at 'voloffs' in
+ *   the image, making it the most recently used one.  If it is not cached
+ *   and 'alloc' is true, the least recently used block is reused (or a new
+ *   one allocated while there are fewer than the configured number) and
+ *   its cc_offset is cleared for the caller to fill.  The caller must
+ *   hold the cache lock.
+ *
+ ****************************************************************************/
+
+static FAR struct cromfs_cblock_s *
+cromfs_get_cblock(FAR const struct cromfs_volume_s *fs, uint32_t voloffs,
+                  bool alloc)
+{
+  FAR struct cromfs_cblock_s *cblock;
+
+  list_for_every_entry(&g_cromfs_cache.cs_lru, cblock,
+                       struct cromfs_cblock_s, cc_node)
+    {
+      if (cblock->cc_offset == voloffs)
+        {
+          list_delete(&cblock->cc_node);
+          list_add_head(&g_cromfs_cache.cs_lru, &cblock->cc_node);
+          return cblock;
+        }
+    }
+
+  if (!alloc)
+    {
+      return NULL;
+    }
+
+  cblock = NULL;
+  if (g_cromfs_cache.cs_ncblocks < CONFIG_FS_CROMFS_CACHE_NBLOCKS)
+    {
+      cblock = fs_heap_malloc(sizeof(struct cromfs_cblock_s) +
+                              fs->cv_bsize - 1);
+      if (cblock != NULL)
+        {
+          g_cromfs_cache.cs_ncblocks++;
+          list_add_head(&g_cromfs_cache.cs_lru, &cblock->cc_node);
+        }
+    }
+
+  if (cblock == NULL)
+    {
+      /* Recycle the least recently used block */
+
+      cblock = list_peek_tail_type(&g_cromfs_cache.cs_lru,
+                                   struct cromfs_cblock_s, cc_node);
+      if (cblock == NULL)
+        {
+          return NULL;
+        }
+
+      list_delete(&cblock->cc_node);
+      list_add_head(&g_cromfs_cache.cs_lru, &cblock->cc_node);
+    }
+
+  cblock->cc_offset = 0;
+  return cblock;
+}
+
 /****************************************************************************
  * Name: cromfs_open
  ****************************************************************************/
@@ -796,20 +1075,23 @@ static int cromfs_open(FAR struct file *filep, FAR const char *relpath,
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
+  /* Save the node in the open file instance */
+
+  ff->ff_node = (FAR const struct cromfs_node_s *)
+    cromfs_offset2addr(fs, offset);
+
+  /* Find the block index of the node, building it on the first open */
 
-  ff->ff_buffer = fs_heap_malloc(fs->cv_bsize);
-  if (!ff->ff_buffer)
+  nxmutex_lock(&g_cromfs_cache.cs_lock);
+  ff->ff_index = cromfs_get_index(fs, ff->ff_node);
+  nxmutex_unlock(&g_cromfs_cache.cs_lock);
+
+  if (ff->ff_index == NULL)
     {
       fs_heap_free(ff);
       return -ENOMEM;
     }
 
-  /* Save the node in the open file instance */
-
-  ff->ff_node = (FAR const struct cromfs_node_s *)
-    cromfs_offset2addr(fs, offset);
-
   /* Save the index as the open-specific state in filep->f_priv */
 
   filep->f_priv = (FAR void *)ff;
@@ -830,11 +1112,12 @@ static int cromfs_close(FAR struct file *filep)
   /* Get the open file instance from the file structure */
 
   ff = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL && ff->ff_index != NULL);
 
-  /* Free all resources consumed by the opened file */
+  /* Free all resources consumed by the opened file.  The block index
+   * stays for the next open.
+   */
 
-  fs_heap_free(ff->ff_buffer);
   fs_heap_free(ff);
 
   return OK;
@@ -850,15 +1133,19 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   FAR struct inode *inode;
   FAR const struct cromfs_volume_s *fs;
   FAR struct cromfs_file_s *ff;
+  FAR struct cromfs_blkinfo_s *blkinfo;
+  FAR struct cromfs_cblock_s *cblock;
   FAR struct lzf_header_s *currhdr;
-  FAR struct lzf_header_s *nexthdr;
   FAR uint8_t *dest;
   FAR const uint8_t *src;
   off_t fpos;
   size_t remaining;
+  uint32_t blkndx;
   uint32_t blkoffs;
+  uint32_t voloffs;
   uint16_t ulen;
   uint16_t clen;
+  unsigned int decomplen;
   unsigned int copysize;
   unsigned int copyoffs;
 
@@ -876,14 +1163,14 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   /* Get the open file instance from the file structure */
 
   ff = (FAR struct cromfs_file_s *)filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL && ff->ff_index != NULL);
 
   /* Check for a read past the end of the file */
 
-  if (filep->f_pos > ff->ff_node->cn_size)
+  if (filep->f_pos >= ff->ff_node->cn_size)
     {
-      /* Start read position is past the end of file.  Return the end-of-
-       * file indication.
+      /* Start read position is at or past the end of file.  Return the
+       * end-of-file indication.
        */
 
       return 0;
@@ -897,66 +1184,35 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
       buflen = ff->ff_node->cn_size - filep->f_pos;
     }
 
-  /* Find the compressed block containing the current offset, f_pos */
+  /* Look up the compressed block containing the current offset, f_pos, in
+   * the block index.  The remaining blocks follow it in the index.
+   */
 
   dest      = (FAR uint8_t *)buffer;
   remaining = buflen;
   fpos      = filep->f_pos;
-  blkoffs   = 0;
-  ulen      = 0;
-  nexthdr   = (FAR struct lzf_header_s *)
-               cromfs_offset2addr(fs, ff->ff_node->u.cn_blocks);
-
-  /* Look until we find the compressed block containing the start of the
-   * requested data.
-   */
+  blkndx    = cromfs_find_block(ff->ff_index, fpos);
 
   while (remaining > 0)
     {
-      /* Search for the next block containing the fpos file offset.  This is
-       * real search on the first time through but the remaining blocks
-       * should be contiguous so that the logic should not loop.
-       *
-       */
-
-      do
-        {
-          uint32_t blksize;
+      DEBUGASSERT(blkndx < ff->ff_index->cx_nblocks);
+      blkinfo  = &ff->ff_index->cx_blocks[blkndx++];
+      blkoffs  = blkinfo->cb_fpos;
+      currhdr  = (FAR struct lzf_header_s *)
+                 cromfs_offset2addr(fs, blkinfo->cb_hdroffs);
 
-          /* Go to the next block */
+      cromfs_block_info(currhdr, &ulen, &clen);
 
-          currhdr  = nexthdr;
-          blkoffs += ulen;
+      copyoffs = fpos - blkoffs;
+      DEBUGASSERT(ulen > copyoffs);
+      copysize = ulen - copyoffs;
 
-          if (currhdr->lzf_type == LZF_TYPE0_HDR)
-            {
-              FAR struct lzf_type0_header_s *hdr0 =
-                (FAR struct lzf_type0_header_s *)currhdr;
-
-              ulen    = (uint16_t)hdr0->lzf_len[0] << 8 |
-                        (uint16_t)hdr0->lzf_len[1];
-              blksize = (uint32_t)ulen + LZF_TYPE0_HDR_SIZE;
-            }
-          else
-            {
-              FAR struct lzf_type1_header_s * hdr1 =
-                (FAR struct lzf_type1_header_s *)currhdr;
-
-              ulen    = (uint16_t)hdr1->lzf_ulen[0] << 8 |
-                        (uint16_t)hdr1->lzf_ulen[1];
-              clen    = (uint16_t)hdr1->lzf_clen[0] << 8 |
-                        (uint16_t)hdr1->lzf_clen[1];
-              blksize = (uint32_t)clen + LZF_TYPE1_HDR_SIZE;
-            }
+      if (copysize > remaining)
+        {
+          /* Clip to the size really needed */
 
-          nexthdr  = (FAR struct lzf_header_s *)
-                     ((FAR uint8_t *)currhdr + blksize);
+          copysize = remaining;
         }
-      while (fpos >= (blkoffs + ulen));
-
-      /* Check if we need to decompress the next block into the user
-       * buffer.
-       */
 
       if (currhdr->lzf_type == LZF_TYPE0_HDR)
         {
@@ -964,17 +1220,6 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
            * user buffer.
            */
 
-          copyoffs = (blkoffs >= filep->f_pos) ? 0 : filep->f_pos - blkoffs;
-          DEBUGASSERT(ulen > copyoffs);
-          copysize = ulen - copyoffs;
-
-          if (copysize > remaining)
-            {
-              /* Clip to the size really needed */
-
-              copysize = remaining;
-            }
-
           src = (FAR const uint8_t *)currhdr + LZF_TYPE0_HDR_SIZE;
           memcpy(dest, &src[copyoffs], copysize);
 
@@ -983,86 +1228,62 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
         }
       else
         {
-          /* If the source of the data is at the beginning of the compressed
-           * data buffer and if the uncompressed data would not overrun the
-           * buffer, then we can decompress directly into the user buffer.
+          /* Check if the decompressed block is in the cache.  If not and
+           * the whole block goes to the user buffer, decompress directly
+           * into the user buffer.  Otherwise decompress it into the
+           * least recently used cache block.
            */
 
-          if (filep->f_pos <= blkoffs && ulen <= remaining)
-            {
-              uint32_t voloffs;
-
-              copyoffs = 0;
-              copysize = ulen;
+          src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
+          voloffs = cromfs_addr2offset(fs, src);
 
-              /* Get the address and offset in the CROMFS image to obtain
-               * the data.  Check if we already have this offset in the
-               * cache.
-               */
+          nxmutex_lock(&g_cromfs_cache.cs_lock);
+          cblock = cromfs_get_cblock(fs, voloffs,
+                                     copyoffs != 0 || ulen > remaining);
+          if (cblock == NULL && copyoffs == 0 && ulen <= remaining)
+            {
+              nxmutex_unlock(&g_cromfs_cache.cs_lock);
 
-              src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
+              decomplen = lzf_decompress(src, clen, dest, ulen);
+              if (decomplen < ulen)
                 {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, dest, fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
+                  ferr("ERROR: Bad block at %" PRIu32 "\n", voloffs);
+                  goto errout;
                 }
-
-              finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32
-                    " ulen=%" PRIu16 " ff_offset=%" PRIu32 " copysize=%u\n",
-                    voloffs, blkoffs, ulen, ff->ff_offset, copysize);
-              DEBUGASSERT(ff->ff_ulen >= copysize);
+            }
+          else if (cblock == NULL)
+            {
+              nxmutex_unlock(&g_cromfs_cache.cs_lock);
+              goto errout;
             }
           else
             {
-              uint32_t voloffs;
-
-              /* No, we will need to decompress into the our intermediate
-               * decompression buffer.
-               */
-
-              copyoffs = (blkoffs >= filep->f_pos) ?
-                            0 : filep->f_pos - blkoffs;
-              DEBUGASSERT(ulen > copyoffs);
-              copysize = ulen - copyoffs;
-
-              if (copysize > remaining)
-                {
-                  /* Clip to the size really needed */
-
-                  copysize = remaining;
-                }
-
-              DEBUGASSERT((copyoffs + copysize) <=  fs->cv_bsize);
-
-              src = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
+              if (cblock->cc_offset != voloffs)
                 {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, ff->ff_buffer,
+                  decomplen = lzf_decompress(src, clen, cblock->cc_data,
                                              fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
+                  if (decomplen < ulen)
+                    {
+                      nxmutex_unlock(&g_cromfs_cache.cs_lock);
+                      ferr("ERROR: Bad block at %" PRIu32 "\n", voloffs);
+                      goto errout;
+                    }
+
+                  cblock->cc_offset = voloffs;
+                  cblock->cc_ulen   = decomplen;
                 }
 
-              finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32 " ulen=%" PRIu16
-                    " clen=%" PRIu16 " ff_offset=%" PRIu32
-                    "  copyoffs=%u copysize=%u\n",
-                    voloffs, blkoffs, ulen, clen, ff->ff_offset,
-                    copyoffs, copysize);
-              DEBUGASSERT(ff->ff_ulen >= (copyoffs + copysize));
+              DEBUGASSERT(cblock->cc_ulen >= copyoffs + copysize);
 
               /* Then copy to user buffer */
 
-              memcpy(dest, &ff->ff_buffer[copyoffs], copysize);
+              memcpy(dest, &cblock->cc_data[copyoffs], copysize);
+              nxmutex_unlock(&g_cromfs_cache.cs_lock);
             }
+
+          finfo("voloffs=%" PRIu32 " blkoffs=%" PRIu32 " ulen=%" PRIu16
+                " clen=%" PRIu16 " copyoffs=%u copysize=%u\n",
+                voloffs, blkoffs, ulen, clen, copyoffs, copysize);
         }
 
       /* Adjust pointers counts and offset */
@@ -1076,6 +1297,14 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
 
   filep->f_pos = fpos;
   return buflen;
+
+errout:
+
+  /* Return what was read before the error, if anything */
+
+  buflen      -= remaining;
+  filep->f_pos = fpos;
+  return buflen > 0 ? buflen : -EIO;
 }
 
 /****************************************************************************
@@ -1117,7 +1346,7 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
   /* Get the open file instance from the file structure */
 
   oldff = oldp->f_priv;
-  DEBUGASSERT(oldff->ff_node != NULL && oldff->ff_buffer != NULL);
+  DEBUGASSERT(oldff->ff_node != NULL && oldff->ff_index != NULL);
 
   /* Allocate and initialize an new open file instance referring to the
    * same node.
@@ -1129,18 +1358,10 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
-
-  newff->ff_buffer = fs_heap_malloc(fs->cv_bsize);
-  if (newff->ff_buffer == NULL)
-    {
-      fs_heap_free(newff);
-      return -ENOMEM;
-    }
-
-  /* Save the node in the open file instance */
+  /* Save the node and its block index in the open file instance */
 
-  newff->ff_node = oldff->ff_node;
+  newff->ff_node  = oldff->ff_node;
+  newff->ff_index = oldff->ff_index;
 
   /* Copy the index from the old to the new file structure */
 
@@ -1174,7 +1395,7 @@ static int cromfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
    */
 
   ff              = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL && ff->ff_index != NULL);
 
   inode           = filep->f_inode;
   fs              = inode->i_private;
@@ -1436,6 +1657,10 @@ static int cromfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   DEBUGASSERT(blkdriver == NULL && handle != NULL);
   DEBUGASSERT(g_cromfs_image.cv_magic == CROMFS_MAGIC);
 
+  nxmutex_lock(&g_cromfs_cache.cs_lock);
+  g_cromfs_cache.cs_nbound++;
+  nxmutex_unlock(&g_cromfs_cache.cs_lock);
+
   /* Return the new file system handle */
 
   *handle = (FAR void *)&g_cromfs_image;
@@ -1453,8 +1678,35 @@ static int cromfs_bind(FAR struct inode *blkdriver, FAR const void *data,
 static int cromfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
                          unsigned int flags)
 {
+  FAR struct cromfs_index_s *index;
+  FAR struct cromfs_cblock_s *cblock;
+
   finfo("handle: %p blkdriver: %p flags: %02x\n",
         handle, blkdriver, flags);
+
+  /* Free the block indices and the cache with the last mount */
+
+  nxmutex_lock(&g_cromfs_cache.cs_lock);
+  DEBUGASSERT(g_cromfs_cache.cs_nbound > 0);
+  if (--g_cromfs_cache.cs_nbound == 0)
+    {
+      while ((index = g_cromfs_cache.cs_index) != NULL)
+        {
+          g_cromfs_cache.cs_index = index->cx_flink;
+          fs_heap_free(index);
+        }
+
+      while ((cblock = list_remove_head_type(&g_cromfs_cache.cs_lru,
+                                             struct cromfs_cblock_s,
+                                             cc_node)) != NULL)
+        {
+          fs_heap_free(cblock);
+        }
+
+      g_cromfs_cache.cs_ncblocks = 0;
+    }
+
+  nxmutex_unlock(&g_cromfs_cache.cs_lock);
   return OK;
 }
 
@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <sys/mount.h>
+#include <sys/param.h>
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -270,6 +271,7 @@ static int fat_open(FAR struct file *filep, FAR const char *relpath,
           /* Truncate the file to zero length */
 
           ret = fat_dirtruncate(fs, direntry);
+          fat_extentinvalidate(fs);
           if (ret < 0)
             {
               goto errout_with_lock;
@@ -620,6 +622,26 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
       num_traversed = 1;
     }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+  /* Skip as much of the chain walk as the cached extents allow */
+
+  if (ff->ff_startcluster != 0 && MIN(num_clu, new_num_clu) > num_traversed)
+    {
+      uint32_t findex;
+      uint32_t fcluster;
+
+      fat_extentadd(ff, 0, ff->ff_startcluster);
+
+      if (fat_extentfind(ff, MIN(num_clu, new_num_clu) - 1,
+                         &findex, &fcluster) &&
+          findex >= num_traversed)
+        {
+          cluster       = fcluster;
+          num_traversed = findex + 1;
+        }
+    }
+#endif
+
   /* Traverse the existing chain */
 
   for (i = num_traversed; i < num_clu && i < new_num_clu; i++)
@@ -632,6 +654,10 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
         {
           return -EIO;
         }
+
+#ifdef CONFIG_FAT_EXTENT_CACHE
+      fat_extentadd(ff, i, cluster);
+#endif
     }
 
   if (read)
@@ -684,6 +710,10 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
           return -EIO;
         }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+      fat_extentadd(ff, i, cluster);
+#endif
+
       /* zero area (2) */
 
       ret = fat_zero_cluster(fs, cluster, 0, clu_size);
@@ -707,6 +737,10 @@ static int fat_get_sectors(FAR struct file *filep, bool read)
           return -EIO;
         }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+      fat_extentadd(ff, i, cluster);
+#endif
+
       /* zero area (3) */
 
       zero_end = filep->f_pos & (clu_size -1);
@@ -744,6 +778,124 @@ out:
   return 0;
 }
 
+/****************************************************************************
+ * Name: fat_contiguous
+ *
+ * Description:
+ *   Grow a direct transfer that starts at ->ff_currentsector beyond the end
+ *   of the current cluster for as long as the following clusters of the
+ *   file are physically contiguous on the media.  If 'extend' is true, the
+ *   chain is extended as needed; fat_extendchain() always tries the cluster
+ *   just after the end of the chain first, so a large write normally goes
+ *   out as one request.  The clusters visited are recorded in the extent
+ *   cache.
+ *
+ * Input Parameters:
+ *   fs       - The mountpoint
+ *   ff       - The open file, as set up by fat_get_sectors()
+ *   nsectors - The number of whole sectors the caller wants to transfer
+ *   extend   - True if the cluster chain may be extended (writing)
+ *
+ * Output:
+ *   ->ff_currentcluster - the last cluster touched by the transfer
+ *   ->ff_pos            - the file position of that cluster
+ *
+ * Returned Value:
+ *   The number of sectors that may be transferred from ->ff_currentsector.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_EXTENT_CACHE
+static unsigned int fat_contiguous(FAR struct fat_mountpt_s *fs,
+                                   FAR struct fat_file_s *ff,
+                                   unsigned int nsectors, bool extend)
+{
+  unsigned int clu_size = fs->fs_fatsecperclus * fs->fs_hwsectorsize;
+  unsigned int avail = ff->ff_sectorsincluster;
+  uint32_t index = ff->ff_pos / clu_size;
+  uint32_t cluster = ff->ff_currentcluster;
+  uint32_t findex;
+  uint32_t next;
+  off_t ret;
+
+  while (avail < nsectors)
+    {
+      if (!fat_extentfind(ff, index + 1, &findex, &next) ||
+          findex != index + 1)
+        {
+          /* Not cached, follow the FAT */
+
+          ret = fat_getcluster(fs, cluster);
+          if (ret < 0)
+            {
+              break;
+            }
+
+          if ((ret < 2 || ret >= fs->fs_nclusters + 2) && extend)
+            {
+              /* End of the chain, allocate the next cluster */
+
+              ret = fat_extendchain(fs, cluster);
+            }
+
+          if (ret < 2 || ret >= fs->fs_nclusters + 2)
+            {
+              /* Leave any error to the next fat_get_sectors() */
+
+              break;
+            }
+
+          next = ret;
+          fat_extentadd(ff, index + 1, next);
+        }
+
+      if (next != cluster + 1)
+        {
+          break;
+        }
+
+      cluster = next;
+      index++;
+      avail  += fs->fs_fatsecperclus;
+    }
+
+  ff->ff_currentcluster = cluster;
+  ff->ff_pos            = (off_t)index * clu_size;
+
+  return MIN(avail, nsectors);
+}
+
+/****************************************************************************
+ * Name: fat_skipsectors
+ *
+ * Description:
+ *   Advance ->ff_currentsector and ->ff_sectorsincluster past a direct
+ *   transfer of 'nsectors' sectors sized by fat_contiguous().  The transfer
+ *   may have crossed into later clusters of the same extent.
+ *
+ ****************************************************************************/
+
+static void fat_skipsectors(FAR struct fat_mountpt_s *fs,
+                            FAR struct fat_file_s *ff,
+                            unsigned int nsectors)
+{
+  unsigned int spc = fs->fs_fatsecperclus;
+
+  if (nsectors > ff->ff_sectorsincluster)
+    {
+      nsectors -= ff->ff_sectorsincluster;
+      ff->ff_currentsector   += ff->ff_sectorsincluster;
+      ff->ff_sectorsincluster = (spc - nsectors % spc) % spc;
+    }
+  else
+    {
+      ff->ff_sectorsincluster -= nsectors;
+    }
+
+  ff->ff_currentsector += nsectors;
+}
+#endif
+
 /****************************************************************************
  * Name: fat_read
  ****************************************************************************/
@@ -869,12 +1021,16 @@ fat_read_restart:
            *
            * Limit the number of sectors that we read on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster (or in this extent of the file)
            */
 
           if (nsectors > ff->ff_sectorsincluster)
             {
+#ifdef CONFIG_FAT_EXTENT_CACHE
+              nsectors = fat_contiguous(fs, ff, nsectors, false);
+#else
               nsectors = ff->ff_sectorsincluster;
+#endif
             }
 
           /* We are not sure of the state of the file buffer so
@@ -909,8 +1065,12 @@ fat_read_restart:
               goto errout_with_lock;
             }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+          fat_skipsectors(fs, ff, nsectors);
+#else
           ff->ff_sectorsincluster -= nsectors;
           ff->ff_currentsector    += nsectors;
+#endif
           bytesread                = nsectors * fs->fs_hwsectorsize;
         }
       else
@@ -1067,12 +1227,16 @@ fat_write_restart:
            *
            * Limit the number of sectors that we write on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster (or in this extent of the file)
            */
 
           if (nsectors > ff->ff_sectorsincluster)
             {
+#ifdef CONFIG_FAT_EXTENT_CACHE
+              nsectors = fat_contiguous(fs, ff, nsectors, true);
+#else
               nsectors = ff->ff_sectorsincluster;
+#endif
             }
 
           /* We are not sure of the state of the sector cache so the
@@ -1108,8 +1272,12 @@ fat_write_restart:
               goto errout_with_lock;
             }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+          fat_skipsectors(fs, ff, nsectors);
+#else
           ff->ff_sectorsincluster -= nsectors;
           ff->ff_currentsector    += nsectors;
+#endif
           writesize                = nsectors * fs->fs_hwsectorsize;
           ff->ff_bflags           |= FFBUFF_MODIFIED;
         }
@@ -1492,6 +1660,15 @@ static int fat_sync(FAR struct file *filep)
       ret          = fat_updatefsinfo(fs);
     }
 
+#ifdef CONFIG_FAT_BLKCACHE
+  /* Then push everything out of the block cache to the media */
+
+  if (ret >= 0)
+    {
+      ret = blkcache_flush(&fs->fs_cache);
+    }
+#endif
+
 errout_with_lock:
   nxmutex_unlock(&fs->fs_lock);
   return ret;
@@ -1598,8 +1775,14 @@ static int fat_dup(FAR const struct file *oldp, FAR struct file *newp)
   newff->ff_size             = oldff->ff_size;             /* Size of the file */
   newff->ff_startcluster     = oldff->ff_startcluster;     /* Start cluster of file on media */
   newff->ff_currentsector    = oldff->ff_currentsector;    /* Current sector */
+  newff->ff_pos              = oldff->ff_pos;              /* Position of current cluster */
   newff->ff_cachesector      = 0;                          /* Sector in file buffer */
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+  memcpy(newff->ff_extents, oldff->ff_extents, sizeof(newff->ff_extents));
+  newff->ff_nextextent       = oldff->ff_nextextent;
+#endif
+
   /* Attach the private date to the struct file instance */
 
   newp->f_priv = newff;
@@ -1931,6 +2114,10 @@ static int fat_truncate(FAR struct file *filep, off_t length)
           ret = fat_dirshrink(fs, direntry, length);
         }
 
+      /* Clusters may have been released, forget any cached extents */
+
+      fat_extentinvalidate(fs);
+
       if (ret >= 0)
         {
           /* The truncation has completed without error.  Update the file
@@ -2326,6 +2513,15 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
         }
     }
 
+#ifdef CONFIG_FAT_BLKCACHE
+  /* Write back and release the block cache */
+
+  if (fs->fs_buffer)
+    {
+      blkcache_uninitialize(&fs->fs_cache);
+    }
+#endif
+
   /* Unmount ... close the block driver */
 
   if (fs->fs_blkdriver)
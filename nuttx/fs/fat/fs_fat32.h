@@ -36,6 +36,7 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/mutex.h>
+#include <nuttx/drivers/blkcache.h>
 
 #include "fs_heap.h"
 
@@ -891,8 +892,25 @@ struct fat_mountpt_s
   uint8_t  fs_fatsecperclus;       /* MBR: Sectors per allocation unit: 2**n, n=0..7 */
   uint8_t *fs_buffer;              /* This is an allocated buffer to hold one
                                     * sector from the device */
+#ifdef CONFIG_FAT_BLKCACHE
+  struct blkcache_s fs_cache;      /* Multi-sector cache of the device */
+#endif
 };
 
+/* This structure describes one run of physically contiguous clusters of an
+ * opened file:  file clusters fe_index..fe_index+fe_count-1 are held in the
+ * disk clusters fe_cluster..fe_cluster+fe_count-1.
+ */
+
+#ifdef CONFIG_FAT_EXTENT_CACHE
+struct fat_extent_s
+{
+  uint32_t fe_index;               /* First file cluster of the extent */
+  uint32_t fe_cluster;             /* First disk cluster of the extent */
+  uint32_t fe_count;               /* Number of clusters (0: unused entry) */
+};
+#endif
+
 /* This structure represents on open file under the mountpoint.  An instance
  * of this structure is retained as struct file specific information on each
  * opened file.
@@ -913,6 +931,10 @@ struct fat_file_s
   off_t    ff_cachesector;         /* Current sector in the file buffer */
   off_t    ff_pos;                 /* Current position in the file */
   uint8_t *ff_buffer;              /* File buffer (for partial sector accesses) */
+#ifdef CONFIG_FAT_EXTENT_CACHE
+  uint8_t  ff_nextextent;          /* Next extent entry to be replaced */
+  struct fat_extent_s ff_extents[CONFIG_FAT_EXTENT_CACHE_SIZE];
+#endif
 };
 
 /* This structure holds the sequence of directory entries used by one
@@ -1055,6 +1077,16 @@ EXTERN int32_t fat_extendchain(FAR struct fat_mountpt_s *fs,
 
 #define fat_createchain(fs) fat_extendchain(fs, 0)
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+EXTERN bool   fat_extentfind(FAR struct fat_file_s *ff, uint32_t index,
+                             FAR uint32_t *findex, FAR uint32_t *cluster);
+EXTERN void   fat_extentadd(FAR struct fat_file_s *ff, uint32_t index,
+                            uint32_t cluster);
+EXTERN void   fat_extentinvalidate(FAR struct fat_mountpt_s *fs);
+#else
+#  define fat_extentinvalidate(fs)
+#endif
+
 /* Help for traversing directory trees and accessing directory entries */
 
 EXTERN int    fat_nextdirentry(FAR struct fat_mountpt_s *fs,
@@ -48,6 +48,37 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: fat_cachereload and fat_cacheflush
+ *
+ * Description:
+ *   Block cache callouts to the block driver
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_BLKCACHE
+static ssize_t fat_cachereload(FAR void *dev, FAR uint8_t *buffer,
+                               off_t startblock, size_t nblocks)
+{
+  FAR struct inode *inode = dev;
+
+  return inode->u.i_bops->read(inode, buffer, startblock, nblocks);
+}
+
+static ssize_t fat_cacheflush(FAR void *dev, FAR const uint8_t *buffer,
+                              off_t startblock, size_t nblocks)
+{
+  FAR struct inode *inode = dev;
+
+  if (inode->u.i_bops->write == NULL)
+    {
+      return -EACCES;
+    }
+
+  return inode->u.i_bops->write(inode, buffer, startblock, nblocks);
+}
+#endif
+
 /****************************************************************************
  * Name: fat_checkfsinfo
  *
@@ -520,6 +551,28 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
       goto errout;
     }
 
+#ifdef CONFIG_FAT_BLKCACHE
+  /* Set up the multi-sector cache in front of the block driver */
+
+  fs->fs_cache.blocksize    = fs->fs_hwsectorsize;
+  fs->fs_cache.nblocks      = fs->fs_hwnsectors;
+  fs->fs_cache.nlines       = CONFIG_DRVR_BLKCACHE_NLINES;
+  fs->fs_cache.lineblocks   = CONFIG_DRVR_BLKCACHE_LINEBLOCKS;
+  fs->fs_cache.maxreadahead = CONFIG_DRVR_BLKCACHE_READAHEAD;
+  fs->fs_cache.wrdelay      = CONFIG_DRVR_BLKCACHE_WRDELAY;
+  fs->fs_cache.dev          = inode;
+  fs->fs_cache.reload       = fat_cachereload;
+  fs->fs_cache.flush        = fat_cacheflush;
+
+  ret = blkcache_initialize(&fs->fs_cache);
+  if (ret < 0)
+    {
+      fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
+      fs->fs_buffer = NULL;
+      goto errout;
+    }
+#endif
+
   /* Search FAT boot record on the drive.  First check the MBR at sector
    * zero.  This could be either the boot record or a partition that refers
    * to the boot record.
@@ -658,6 +711,10 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   return OK;
 
 errout_with_buffer:
+#ifdef CONFIG_FAT_BLKCACHE
+  blkcache_invalidate(&fs->fs_cache);
+  blkcache_uninitialize(&fs->fs_cache);
+#endif
   fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
   fs->fs_buffer = NULL;
 
@@ -706,6 +763,12 @@ int fat_checkmount(struct fat_mountpt_s *fs)
       /* If we get here, the mount is NOT healthy */
 
       fs->fs_mounted = false;
+
+#ifdef CONFIG_FAT_BLKCACHE
+      /* Whatever is cached belongs to the old media */
+
+      blkcache_invalidate(&fs->fs_cache);
+#endif
     }
 
   return -ENODEV;
@@ -728,8 +791,13 @@ int fat_hwread(struct fat_mountpt_s *fs, uint8_t *buffer,  off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->read)
         {
+#ifdef CONFIG_FAT_BLKCACHE
+          ssize_t nsectorsread = blkcache_read(&fs->fs_cache, sector,
+                                               nsectors, buffer);
+#else
           ssize_t nsectorsread = inode->u.i_bops->read(inode, buffer,
                                                        sector, nsectors);
+#endif
           if (nsectorsread == nsectors)
             {
               ret = OK;
@@ -761,8 +829,13 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
       struct inode *inode = fs->fs_blkdriver;
       if (inode && inode->u.i_bops && inode->u.i_bops->write)
         {
+#ifdef CONFIG_FAT_BLKCACHE
+          ssize_t nsectorswritten =
+              blkcache_write(&fs->fs_cache, sector, nsectors, buffer);
+#else
           ssize_t nsectorswritten =
               inode->u.i_bops->write(inode, buffer, sector, nsectors);
+#endif
 
           if (nsectorswritten == nsectors)
             {
@@ -1323,6 +1396,135 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
   return newcluster;
 }
 
+/****************************************************************************
+ * Name: fat_extentfind
+ *
+ * Description:
+ *   Find the cached extent of the open file that gets closest to the file
+ *   cluster 'index' without passing it.  On success, the file cluster
+ *   index and the disk cluster of that closest known point are returned
+ *   in 'findex' and 'cluster'.  The chain walk may then resume from there
+ *   rather than from the start of the file.
+ *
+ * Returned Value:
+ *   true if a usable extent was found; false otherwise.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_EXTENT_CACHE
+bool fat_extentfind(FAR struct fat_file_s *ff, uint32_t index,
+                    FAR uint32_t *findex, FAR uint32_t *cluster)
+{
+  FAR struct fat_extent_s *extent;
+  bool found = false;
+  uint32_t known;
+  int i;
+
+  for (i = 0; i < CONFIG_FAT_EXTENT_CACHE_SIZE; i++)
+    {
+      extent = &ff->ff_extents[i];
+      if (extent->fe_count == 0 || extent->fe_index > index)
+        {
+          continue;
+        }
+
+      known = extent->fe_index + extent->fe_count - 1;
+      if (known > index)
+        {
+          known = index;
+        }
+
+      if (!found || known > *findex)
+        {
+          *findex  = known;
+          *cluster = extent->fe_cluster + (known - extent->fe_index);
+          found    = true;
+
+          if (known == index)
+            {
+              break;
+            }
+        }
+    }
+
+  return found;
+}
+
+/****************************************************************************
+ * Name: fat_extentadd
+ *
+ * Description:
+ *   Record that file cluster 'index' of the open file lives in disk
+ *   cluster 'cluster'.  The mapping is merged into an existing extent when
+ *   it is adjacent both in the file and on the media; otherwise it starts
+ *   a new extent, replacing the cached extents round-robin.
+ *
+ ****************************************************************************/
+
+void fat_extentadd(FAR struct fat_file_s *ff, uint32_t index,
+                   uint32_t cluster)
+{
+  FAR struct fat_extent_s *extent;
+  int i;
+
+  for (i = 0; i < CONFIG_FAT_EXTENT_CACHE_SIZE; i++)
+    {
+      extent = &ff->ff_extents[i];
+      if (extent->fe_count == 0 || extent->fe_index > index)
+        {
+          continue;
+        }
+
+      if (index < extent->fe_index + extent->fe_count)
+        {
+          /* Already known */
+
+          return;
+        }
+
+      if (index == extent->fe_index + extent->fe_count &&
+          cluster == extent->fe_cluster + extent->fe_count)
+        {
+          /* Contiguous with the end of this extent; grow it */
+
+          extent->fe_count++;
+          return;
+        }
+    }
+
+  extent = &ff->ff_extents[ff->ff_nextextent];
+  extent->fe_index   = index;
+  extent->fe_cluster = cluster;
+  extent->fe_count   = 1;
+
+  if (++ff->ff_nextextent >= CONFIG_FAT_EXTENT_CACHE_SIZE)
+    {
+      ff->ff_nextextent = 0;
+    }
+}
+
+/****************************************************************************
+ * Name: fat_extentinvalidate
+ *
+ * Description:
+ *   Discard the cached extents of every file open on the volume.  This
+ *   must be called whenever a cluster chain is shortened or released
+ *   since the clusters may then be reused by another file.
+ *
+ ****************************************************************************/
+
+void fat_extentinvalidate(FAR struct fat_mountpt_s *fs)
+{
+  FAR struct fat_file_s *ff;
+
+  for (ff = fs->fs_head; ff != NULL; ff = ff->ff_next)
+    {
+      memset(ff->ff_extents, 0, sizeof(ff->ff_extents));
+      ff->ff_nextextent = 0;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: fat_nextdirentry
  *
@@ -25,6 +25,7 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <nuttx/fs/ioring.h>
 #include <nuttx/reboot_notifier.h>
 #include <nuttx/trace.h>
 
@@ -98,6 +99,12 @@ void fs_initialize(void)
 
 #endif
 
+#ifdef CONFIG_FS_IORING
+  /* Register the I/O ring device */
+
+  ioring_initialize();
+#endif
+
 #ifdef CONFIG_FS_RPMSGFS_SERVER
   rpmsgfs_server_init();
 #endif
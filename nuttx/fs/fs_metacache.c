@@ -0,0 +1,423 @@
+/****************************************************************************
+ * fs/fs_metacache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+
+#include "fs_heap.h"
+#include "fs_metacache.h"
+
+#ifdef CONFIG_FS_METACACHE
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fs_metacache_hash
+ *
+ * Description:
+ *   Return the key of the first 'len' characters of a path.
+ *
+ ****************************************************************************/
+
+static uint32_t fs_metacache_hash(FAR const char *relpath, size_t len)
+{
+  uint32_t hash = 2166136261u;
+
+  while (len-- > 0)
+    {
+      hash = (hash ^ (uint8_t)*relpath++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_valid
+ *
+ * Description:
+ *   Return true if a cached result hasn't expired and no local
+ *   modification of its path was made since it was read.
+ *
+ ****************************************************************************/
+
+static bool fs_metacache_valid(FAR struct fs_metacache_s *cache,
+                               uint32_t key, clock_t expire, int32_t gen)
+{
+  return gen == fs_metacache_gen(cache, key) &&
+         !clock_compare(expire, clock_systime_ticks());
+}
+
+/****************************************************************************
+ * Name: fs_dlist_put
+ ****************************************************************************/
+
+static void fs_dlist_put(FAR struct fs_dlist_s *list)
+{
+  if (list != NULL && --list->refs == 0)
+    {
+      fs_heap_free(list->data);
+      fs_heap_free(list->path);
+      fs_heap_free(list);
+    }
+}
+
+/****************************************************************************
+ * Name: fs_dlist_add
+ *
+ * Description:
+ *   Append an entry to a listing being read.  Listings that grow over the
+ *   size limit of the cache aren't kept.
+ *
+ ****************************************************************************/
+
+static void fs_dlist_add(FAR struct fs_metacache_s *cache,
+                         FAR struct fs_dircache_s *dir,
+                         FAR const struct dirent *entry)
+{
+  FAR struct fs_dlist_s *list = dir->list;
+  size_t size = strlen(entry->d_name) + 2;
+  FAR char *data;
+
+  if (list->len + size > cache->dirmax)
+    {
+      data = NULL;
+    }
+  else
+    {
+      data = fs_heap_realloc(list->data, list->len + size);
+    }
+
+  if (data == NULL)
+    {
+      fs_dlist_put(list);
+      dir->list = NULL;
+      return;
+    }
+
+  data[list->len] = entry->d_type;
+  memcpy(&data[list->len + 1], entry->d_name, size - 1);
+  list->data = data;
+  list->len += size;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fs_metacache_init
+ ****************************************************************************/
+
+void fs_metacache_init(FAR struct fs_metacache_s *cache,
+                       FAR struct fs_attr_s *attr, int nattr,
+                       unsigned int ttl, size_t dirmax)
+{
+  memset(cache, 0, sizeof(*cache));
+  memset(attr, 0, nattr * sizeof(*attr));
+
+  cache->ttl    = MSEC2TICK(ttl);
+  cache->dirmax = dirmax;
+  cache->nattr  = nattr;
+  cache->attr   = attr;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_uninit
+ ****************************************************************************/
+
+void fs_metacache_uninit(FAR struct fs_metacache_s *cache)
+{
+  int i;
+
+  for (i = 0; i < cache->nattr; i++)
+    {
+      fs_heap_free(cache->attr[i].path);
+      cache->attr[i].path = NULL;
+    }
+
+  fs_dlist_put(cache->dlist);
+  cache->dlist = NULL;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_key
+ ****************************************************************************/
+
+uint32_t fs_metacache_key(FAR const char *relpath)
+{
+  return fs_metacache_hash(relpath, strlen(relpath));
+}
+
+/****************************************************************************
+ * Name: fs_metacache_invalidate_path
+ ****************************************************************************/
+
+void fs_metacache_invalidate_path(FAR struct fs_metacache_s *cache,
+                                  FAR const char *relpath)
+{
+  FAR const char *name = strrchr(relpath, '/');
+
+  fs_metacache_touch(cache, fs_metacache_key(relpath));
+  fs_metacache_touch(cache, fs_metacache_hash(relpath, name != NULL ?
+                                              name - relpath : 0));
+}
+
+/****************************************************************************
+ * Name: fs_metacache_getattr
+ ****************************************************************************/
+
+FAR const struct stat *
+fs_metacache_getattr(FAR struct fs_metacache_s *cache,
+                     FAR const char *relpath)
+{
+  int i;
+
+  for (i = 0; i < cache->nattr; i++)
+    {
+      FAR struct fs_attr_s *attr = &cache->attr[i];
+
+      if (attr->path != NULL && strcmp(attr->path, relpath) == 0)
+        {
+          return fs_metacache_valid(cache, attr->key, attr->expire,
+                                    attr->gen) ? &attr->buf : NULL;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_setattr
+ ****************************************************************************/
+
+void fs_metacache_setattr(FAR struct fs_metacache_s *cache,
+                          FAR const char *relpath, int32_t gen,
+                          FAR const struct stat *buf)
+{
+  FAR struct fs_attr_s *attr;
+  int i;
+
+  for (i = 0; i < cache->nattr; i++)
+    {
+      attr = &cache->attr[i];
+      if (attr->path != NULL && strcmp(attr->path, relpath) == 0)
+        {
+          break;
+        }
+    }
+
+  if (i == cache->nattr)
+    {
+      attr = &cache->attr[cache->attrnext];
+      cache->attrnext = (cache->attrnext + 1) % cache->nattr;
+
+      fs_heap_free(attr->path);
+      attr->path = fs_heap_strdup(relpath);
+      if (attr->path == NULL)
+        {
+          return;
+        }
+
+      attr->key = fs_metacache_key(relpath);
+    }
+
+  attr->expire = clock_systime_ticks() + cache->ttl;
+  attr->gen    = gen;
+  attr->buf    = *buf;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_lookup
+ ****************************************************************************/
+
+int fs_metacache_lookup(FAR struct fs_metacache_s *cache,
+                        FAR const char *relpath)
+{
+  FAR struct fs_dlist_s *list = cache->dlist;
+  FAR const char *name;
+  size_t len;
+  size_t pos;
+
+  if (list == NULL ||
+      !fs_metacache_valid(cache, list->key, list->expire, list->gen))
+    {
+      return OK;
+    }
+
+  name = strrchr(relpath, '/');
+  len  = name != NULL ? name - relpath : 0;
+  name = name != NULL ? name + 1 : relpath;
+
+  if (strlen(list->path) != len || strncmp(list->path, relpath, len) != 0 ||
+      *name == '\0' || strlen(name) >= NAME_MAX ||
+      strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+    {
+      return OK;
+    }
+
+  for (pos = 0; pos < list->len; pos += strlen(&list->data[pos + 1]) + 2)
+    {
+      if (strcasecmp(&list->data[pos + 1], name) == 0)
+        {
+          return OK;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_opendir
+ ****************************************************************************/
+
+bool fs_metacache_opendir(FAR struct fs_metacache_s *cache,
+                          FAR struct fs_dircache_s *dir,
+                          FAR const char *relpath)
+{
+  FAR struct fs_dlist_s *list = cache->dlist;
+
+  dir->pos = 0;
+
+  /* Replay the last listing if it is of this directory and recent
+   * enough.
+   */
+
+  if (list != NULL && strcmp(list->path, relpath) == 0 &&
+      fs_metacache_valid(cache, list->key, list->expire, list->gen))
+    {
+      list->refs++;
+      dir->list   = list;
+      dir->replay = true;
+      return true;
+    }
+
+  /* Otherwise record this one as it is read */
+
+  dir->replay = false;
+  dir->list   = fs_heap_zalloc(sizeof(struct fs_dlist_s));
+  if (dir->list != NULL)
+    {
+      dir->list->refs = 1;
+      dir->list->key  = fs_metacache_key(relpath);
+      dir->list->gen  = fs_metacache_gen(cache, dir->list->key);
+      dir->list->path = fs_heap_strdup(relpath);
+      if (dir->list->path == NULL)
+        {
+          fs_dlist_put(dir->list);
+          dir->list = NULL;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_readdir
+ ****************************************************************************/
+
+int fs_metacache_readdir(FAR struct fs_dircache_s *dir,
+                         FAR struct dirent *entry)
+{
+  FAR struct fs_dlist_s *list = dir->list;
+
+  if (dir->pos >= list->len)
+    {
+      return -ENOENT;
+    }
+
+  entry->d_type = list->data[dir->pos];
+  strlcpy(entry->d_name, &list->data[dir->pos + 1], sizeof(entry->d_name));
+  dir->pos += strlen(&list->data[dir->pos + 1]) + 2;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fs_metacache_record
+ ****************************************************************************/
+
+void fs_metacache_record(FAR struct fs_metacache_s *cache,
+                         FAR struct fs_dircache_s *dir,
+                         FAR const struct dirent *entry, int ret)
+{
+  if (dir->list == NULL || dir->list->complete)
+    {
+      return;
+    }
+
+  if (ret >= 0)
+    {
+      fs_dlist_add(cache, dir, entry);
+    }
+  else if (ret == -ENOENT)
+    {
+      dir->list->complete = true;
+    }
+}
+
+/****************************************************************************
+ * Name: fs_metacache_rewinddir
+ ****************************************************************************/
+
+void fs_metacache_rewinddir(FAR struct fs_dircache_s *dir)
+{
+  dir->pos = 0;
+
+  /* Start recording again, unless the listing is already complete */
+
+  if (dir->list != NULL && !dir->list->complete)
+    {
+      dir->list->len = 0;
+    }
+}
+
+/****************************************************************************
+ * Name: fs_metacache_closedir
+ ****************************************************************************/
+
+void fs_metacache_closedir(FAR struct fs_metacache_s *cache,
+                           FAR struct fs_dircache_s *dir)
+{
+  if (dir->list != NULL && dir->list->complete && dir->list != cache->dlist)
+    {
+      dir->list->expire = clock_systime_ticks() + cache->ttl;
+      fs_dlist_put(cache->dlist);
+      cache->dlist = dir->list;
+    }
+  else
+    {
+      fs_dlist_put(dir->list);
+    }
+
+  dir->list = NULL;
+}
+
+#endif /* CONFIG_FS_METACACHE */
@@ -0,0 +1,270 @@
+/****************************************************************************
+ * fs/fs_metacache.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __FS_FS_METACACHE_H
+#define __FS_FS_METACACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <dirent.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/clock.h>
+
+#ifdef CONFIG_FS_METACACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Local modifications made through the mount point invalidate what they
+ * may have changed.  Each path hashes to one of FS_METACACHE_NGENS
+ * generation counters, and a cached result is only used while the sum of
+ * the counter of its path and of the mount-wide one is unchanged.  A
+ * write only bumps the counter of the file, a create or a remove those of
+ * the entry and of its parent directory, and the changes that move whole
+ * subtrees, like a rename, the mount-wide one.
+ */
+
+#define FS_METACACHE_NGENS 32
+
+#define fs_metacache_invalidate(cache) atomic_fetch_add(&(cache)->gen, 1)
+#define fs_metacache_touch(cache, key) \
+  atomic_fetch_add(&(cache)->pathgen[(key) % FS_METACACHE_NGENS], 1)
+#define fs_metacache_gen(cache, key) \
+  (atomic_read(&(cache)->gen) + \
+   atomic_read(&(cache)->pathgen[(key) % FS_METACACHE_NGENS]))
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* A directory listing kept after closedir() for the lifetime of the cache.
+ * The entries are packed in 'data', each one as the d_type byte followed
+ * by the NUL terminated name.
+ */
+
+struct fs_dlist_s
+{
+  int                    refs;     /* Listing users, and the cache */
+  bool                   complete; /* All the entries were read */
+  clock_t                expire;   /* Tick when the listing expires */
+  int32_t                gen;      /* Cache generation when read */
+  uint32_t               key;      /* fs_metacache_key() of 'path' */
+  size_t                 len;      /* Bytes used in 'data' */
+  FAR char               *path;    /* Relative path of the directory */
+  FAR char               *data;    /* The entries */
+};
+
+/* A cached stat() result */
+
+struct fs_attr_s
+{
+  FAR char               *path;    /* Relative path, NULL if unused */
+  clock_t                expire;   /* Tick when the result expires */
+  int32_t                gen;      /* Cache generation when read */
+  uint32_t               key;      /* fs_metacache_key() of 'path' */
+  struct stat            buf;      /* The result */
+};
+
+/* The stat() results and the last complete directory listing of a mount
+ * point.  Except for the generations, it is protected by the lock of the
+ * file system that owns it.
+ */
+
+struct fs_metacache_s
+{
+  atomic_t               gen;      /* Bumped by changes of many paths */
+
+  /* Bumped by the changes of the paths that hash to them */
+
+  atomic_t               pathgen[FS_METACACHE_NGENS];
+
+  clock_t                ttl;      /* Lifetime of a result in ticks */
+  size_t                 dirmax;   /* Largest listing that is kept */
+  int                    nattr;    /* The number of entries in 'attr' */
+  int                    attrnext; /* The entry to replace next */
+  FAR struct fs_attr_s   *attr;    /* The stat() results */
+  FAR struct fs_dlist_s  *dlist;   /* Last complete listing */
+};
+
+/* The cache state of one open directory */
+
+struct fs_dircache_s
+{
+  FAR struct fs_dlist_s  *list;    /* Listing being read or replayed */
+  size_t                 pos;      /* Replay position in the listing */
+  bool                   replay;   /* Entries come from 'list' */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fs_metacache_init
+ *
+ * Description:
+ *   Initialize the cache of a mount point.  'attr' is an array of 'nattr'
+ *   entries owned by the caller; results are kept for 'ttl' milliseconds
+ *   and listings of up to 'dirmax' bytes of names.
+ *
+ ****************************************************************************/
+
+void fs_metacache_init(FAR struct fs_metacache_s *cache,
+                       FAR struct fs_attr_s *attr, int nattr,
+                       unsigned int ttl, size_t dirmax);
+
+/****************************************************************************
+ * Name: fs_metacache_uninit
+ ****************************************************************************/
+
+void fs_metacache_uninit(FAR struct fs_metacache_s *cache);
+
+/****************************************************************************
+ * Name: fs_metacache_key
+ *
+ * Description:
+ *   Return the key of 'relpath', which selects its generation counter.
+ *   File systems keep it in their open files, so that writes through them
+ *   can invalidate the path with fs_metacache_touch().
+ *
+ ****************************************************************************/
+
+uint32_t fs_metacache_key(FAR const char *relpath);
+
+/****************************************************************************
+ * Name: fs_metacache_invalidate_path
+ *
+ * Description:
+ *   Invalidate the cached results of 'relpath' and of its parent
+ *   directory, after an entry was created or removed there.
+ *
+ ****************************************************************************/
+
+void fs_metacache_invalidate_path(FAR struct fs_metacache_s *cache,
+                                  FAR const char *relpath);
+
+/****************************************************************************
+ * Name: fs_metacache_getattr
+ *
+ * Description:
+ *   Return the cached stat() result of 'relpath', or NULL if there is no
+ *   valid one.
+ *
+ ****************************************************************************/
+
+FAR const struct stat *
+fs_metacache_getattr(FAR struct fs_metacache_s *cache,
+                     FAR const char *relpath);
+
+/****************************************************************************
+ * Name: fs_metacache_setattr
+ *
+ * Description:
+ *   Cache a stat() result, replacing the oldest one.  'gen' is the
+ *   generation of 'relpath' from before the request was sent.
+ *
+ ****************************************************************************/
+
+void fs_metacache_setattr(FAR struct fs_metacache_s *cache,
+                          FAR const char *relpath, int32_t gen,
+                          FAR const struct stat *buf);
+
+/****************************************************************************
+ * Name: fs_metacache_lookup
+ *
+ * Description:
+ *   Return -ENOENT if 'relpath' is missing from a valid cached listing of
+ *   its parent directory, OK if that isn't known.  Names are compared
+ *   without regard to case, so that a miss is also a miss on a case
+ *   insensitive backend.
+ *
+ ****************************************************************************/
+
+int fs_metacache_lookup(FAR struct fs_metacache_s *cache,
+                        FAR const char *relpath);
+
+/****************************************************************************
+ * Name: fs_metacache_opendir
+ *
+ * Description:
+ *   Start replaying the cached listing of 'relpath' and return true, or
+ *   start recording a new one and return false, in which case the caller
+ *   has to open the directory on the backend.
+ *
+ ****************************************************************************/
+
+bool fs_metacache_opendir(FAR struct fs_metacache_s *cache,
+                          FAR struct fs_dircache_s *dir,
+                          FAR const char *relpath);
+
+/****************************************************************************
+ * Name: fs_metacache_readdir
+ *
+ * Description:
+ *   Return the next replayed entry, or -ENOENT at the end of the listing.
+ *
+ ****************************************************************************/
+
+int fs_metacache_readdir(FAR struct fs_dircache_s *dir,
+                         FAR struct dirent *entry);
+
+/****************************************************************************
+ * Name: fs_metacache_record
+ *
+ * Description:
+ *   Record the result 'ret' of a readdir() on the backend.
+ *
+ ****************************************************************************/
+
+void fs_metacache_record(FAR struct fs_metacache_s *cache,
+                         FAR struct fs_dircache_s *dir,
+                         FAR const struct dirent *entry, int ret);
+
+/****************************************************************************
+ * Name: fs_metacache_rewinddir
+ ****************************************************************************/
+
+void fs_metacache_rewinddir(FAR struct fs_dircache_s *dir);
+
+/****************************************************************************
+ * Name: fs_metacache_closedir
+ *
+ * Description:
+ *   Keep a complete listing for the next opendir() of the directory, or
+ *   drop it.
+ *
+ ****************************************************************************/
+
+void fs_metacache_closedir(FAR struct fs_metacache_s *cache,
+                           FAR struct fs_dircache_s *dir);
+
+#endif /* CONFIG_FS_METACACHE */
+#endif /* __FS_FS_METACACHE_H */
@@ -38,6 +38,7 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/lib/lib.h>
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
@@ -55,6 +56,12 @@
 
 #define HOSTFS_RETRY_DELAY_MS       10
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+#  define hostfs_invalidate(fs)     fs_metacache_invalidate(&(fs)->fs_cache)
+#else
+#  define hostfs_invalidate(fs)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -63,6 +70,9 @@ struct hostfs_dir_s
 {
   struct fs_dirent_s base;
   FAR void *dir;
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  struct fs_dircache_s cache;          /* Listing being read or replayed */
+#endif
 };
 
 /****************************************************************************
@@ -275,6 +285,28 @@ static int hostfs_open(FAR struct file *filep, FAR const char *relpath,
       return ret;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  /* Don't ask the host for a file known not to exist */
+
+  if ((oflags & O_CREAT) == 0)
+    {
+      ret = fs_metacache_lookup(&fs->fs_cache, relpath);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+    }
+  else
+    {
+      hostfs_invalidate(fs);
+    }
+
+  if (oflags & O_TRUNC)
+    {
+      hostfs_invalidate(fs);
+    }
+#endif
+
   /* Allocate memory for the open file */
 
   len = strlen(relpath);
@@ -528,6 +560,7 @@ static ssize_t hostfs_write(FAR struct file *filep, const char *buffer,
   if (ret > 0)
     {
       filep->f_pos += ret;
+      hostfs_invalidate(fs);
     }
 
 errout_with_lock:
@@ -794,6 +827,7 @@ static int hostfs_fchstat(FAR const struct file *filep,
   /* Call the host to perform the change */
 
   ret = host_fchstat(hf->fd, buf, flags);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -835,6 +869,7 @@ static int hostfs_ftruncate(FAR struct file *filep, off_t length)
   /* Call the host to perform the truncate */
 
   ret = host_ftruncate(hf->fd, length);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -876,6 +911,17 @@ static int hostfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
       goto errout_with_hdir;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  /* Replay the last listing if it is of this directory and recent
+   * enough, otherwise record this one as it is read.
+   */
+
+  if (fs_metacache_opendir(&fs->fs_cache, &hdir->cache, relpath))
+    {
+      goto out;
+    }
+#endif
+
   /* Append to the host's root directory */
 
   hostfs_mkpath(fs, relpath, path, sizeof(path));
@@ -889,11 +935,18 @@ static int hostfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
       goto errout_with_lock;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+out:
+#endif
+
   *dir = (FAR struct fs_dirent_s *)hdir;
   nxmutex_unlock(&g_lock);
   return OK;
 
 errout_with_lock:
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  fs_metacache_closedir(&fs->fs_cache, &hdir->cache);
+#endif
   nxmutex_unlock(&g_lock);
 
 errout_with_hdir:
@@ -911,6 +964,9 @@ errout_with_hdir:
 static int hostfs_closedir(FAR struct inode *mountpt,
                            FAR struct fs_dirent_s *dir)
 {
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  FAR struct hostfs_mountpt_s *fs;
+#endif
   FAR struct hostfs_dir_s *hdir;
   int ret;
 
@@ -920,6 +976,9 @@ static int hostfs_closedir(FAR struct inode *mountpt,
 
   /* Recover our private data from the inode instance */
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  fs = mountpt->i_private;
+#endif
   hdir = (FAR struct hostfs_dir_s *)dir;
 
   /* Take the lock */
@@ -932,7 +991,18 @@ static int hostfs_closedir(FAR struct inode *mountpt,
 
   /* Call the host's closedir function */
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  if (hdir->dir != NULL)
+    {
+      host_closedir(hdir->dir);
+    }
+
+  /* Keep a complete listing for the next opendir() of the directory */
+
+  fs_metacache_closedir(&fs->fs_cache, &hdir->cache);
+#else
   host_closedir(hdir->dir);
+#endif
 
   nxmutex_unlock(&g_lock);
   fs_heap_free(hdir);
@@ -950,6 +1020,9 @@ static int hostfs_readdir(FAR struct inode *mountpt,
                           FAR struct fs_dirent_s *dir,
                           FAR struct dirent *entry)
 {
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  FAR struct hostfs_mountpt_s *fs = mountpt->i_private;
+#endif
   FAR struct hostfs_dir_s *hdir;
   int ret;
 
@@ -969,10 +1042,25 @@ static int hostfs_readdir(FAR struct inode *mountpt,
       return ret;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  if (hdir->cache.replay)
+    {
+      /* Replay the cached listing */
+
+      ret = fs_metacache_readdir(&hdir->cache, entry);
+      nxmutex_unlock(&g_lock);
+      return ret;
+    }
+#endif
+
   /* Call the host OS's readdir function */
 
   ret = host_readdir(hdir->dir, entry);
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  fs_metacache_record(&fs->fs_cache, &hdir->cache, entry, ret);
+#endif
+
   nxmutex_unlock(&g_lock);
   return ret;
 }
@@ -1006,6 +1094,15 @@ static int hostfs_rewinddir(FAR struct inode *mountpt,
       return ret;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  fs_metacache_rewinddir(&hdir->cache);
+  if (hdir->cache.replay)
+    {
+      nxmutex_unlock(&g_lock);
+      return OK;
+    }
+#endif
+
   /* Call the host and let it do all the work */
 
   host_rewinddir(hdir->dir);
@@ -1091,6 +1188,12 @@ static int hostfs_bind(FAR struct inode *blkdriver, FAR const void *data,
    */
 
   fs->fs_head = NULL;
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  fs_metacache_init(&fs->fs_cache, fs->fs_attr,
+                    CONFIG_FS_HOSTFS_CACHE_NENTRIES,
+                    CONFIG_FS_HOSTFS_CACHE_TTL,
+                    CONFIG_FS_HOSTFS_DIRCACHE_SIZE);
+#endif
 
   /* Now perform the mount.  */
 
@@ -1154,6 +1257,12 @@ static int hostfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
       return (flags != 0) ? -ENOSYS : -EBUSY;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  /* Drop the caches */
+
+  fs_metacache_uninit(&fs->fs_cache);
+#endif
+
   nxmutex_unlock(&g_lock);
   fs_heap_free(fs);
   return ret;
@@ -1228,6 +1337,7 @@ static int hostfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host fs to perform the unlink */
 
   ret = host_unlink(path);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -1268,6 +1378,7 @@ static int hostfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the mkdir */
 
   ret = host_mkdir(path, mode);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -1309,6 +1420,7 @@ int hostfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host FS to do the mkdir */
 
   ret = host_rmdir(path);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -1353,6 +1465,7 @@ int hostfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
   /* Call the host FS to do the mkdir */
 
   ret = host_rename(oldpath, newpath);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
@@ -1371,6 +1484,10 @@ static int hostfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   FAR struct hostfs_mountpt_s *fs;
   char path[HOSTFS_MAX_PATH];
   int ret;
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  FAR const struct stat *attr;
+  int32_t gen;
+#endif
 
   /* Sanity checks */
 
@@ -1386,6 +1503,25 @@ static int hostfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  /* Return the cached result if it is recent enough */
+
+  attr = fs_metacache_getattr(&fs->fs_cache, relpath);
+  if (attr != NULL)
+    {
+      *buf = *attr;
+      goto out;
+    }
+
+  ret = fs_metacache_lookup(&fs->fs_cache, relpath);
+  if (ret < 0)
+    {
+      goto out;
+    }
+
+  gen = fs_metacache_gen(&fs->fs_cache, fs_metacache_key(relpath));
+#endif
+
   /* Append to the host's root directory */
 
   hostfs_mkpath(fs, relpath, path, sizeof(path));
@@ -1394,6 +1530,14 @@ static int hostfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
   ret = host_stat(path, buf);
 
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  if (ret >= 0)
+    {
+      fs_metacache_setattr(&fs->fs_cache, relpath, gen, buf);
+    }
+
+out:
+#endif
   nxmutex_unlock(&g_lock);
   return ret;
 }
@@ -1433,6 +1577,7 @@ static int hostfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the chstat operation */
 
   ret = host_chstat(path, buf, flags);
+  hostfs_invalidate(fs);
 
   nxmutex_unlock(&g_lock);
   return ret;
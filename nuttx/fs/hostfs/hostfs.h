@@ -30,8 +30,12 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
+
+#include "fs_metacache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -65,6 +69,10 @@ struct hostfs_mountpt_s
 {
   FAR struct hostfs_ofile_s *fs_head;      /* A singly-linked list of open files */
   char                       fs_root[HOSTFS_MAX_PATH];
+#if CONFIG_FS_HOSTFS_CACHE_TTL > 0
+  struct fs_metacache_s      fs_cache;     /* stat() and listing cache */
+  struct fs_attr_s           fs_attr[CONFIG_FS_HOSTFS_CACHE_NENTRIES];
+#endif
 };
 
 /****************************************************************************
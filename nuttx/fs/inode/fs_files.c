@@ -54,12 +54,105 @@
 #include "inode/inode.h"
 #include "fs_heap.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Assumed size of a cache line, see g_fdlist_readers */
+
+#ifdef CONFIG_SMP
+#  define FDLIST_READER_ALIGN 64
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+struct fdlist_reader_s
+{
+  atomic_t seq;                 /* Odd while a lookup runs on the CPU */
+  uint8_t  pad[FDLIST_READER_ALIGN - sizeof(atomic_t)];
+};
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+/* The lock-free lookups in progress, one counter per CPU.  Only the CPU
+ * itself writes its counter, and each one has its own cache line, so
+ * lookups on different CPUs never write to shared memory.
+ */
+
+static struct fdlist_reader_s g_fdlist_readers[CONFIG_SMP_NCPUS]
+  aligned_data(FDLIST_READER_ALIGN);
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: fdlist_synchronize
+ *
+ * Description:
+ *   Wait until no lock-free reader can still see a file or fl_fds array
+ *   that the caller has just unpublished.  Must be called after the
+ *   update, without fl_lock and with interrupts enabled.
+ *
+ *   A lookup runs with interrupts disabled, so there is at most one per
+ *   CPU, and it makes the counter of its CPU odd for its duration.  Only
+ *   the CPUs whose counter is odd now can run a lookup that started
+ *   before the update, and it is over as soon as that counter changes.
+ *   Lookups starting later see the update and don't hold up the wait.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+static void fdlist_synchronize(void)
+{
+  int seq[CONFIG_SMP_NCPUS];
+  int cpu;
+
+  /* Order the update before the reads of the counters */
+
+  UP_DMB();
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      seq[cpu] = atomic_read_acquire(&g_fdlist_readers[cpu].seq);
+    }
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      if ((seq[cpu] & 1) != 0)
+        {
+          while (atomic_read_acquire(&g_fdlist_readers[cpu].seq) ==
+                 seq[cpu])
+            {
+            }
+        }
+    }
+}
+#else
+/* Readers run with interrupts disabled, so on a single CPU they never
+ * overlap an update.
+ */
+
+#  define fdlist_synchronize()
+#endif
+
 /****************************************************************************
  * Name: fdlist_get_by_index
+ *
+ * Description:
+ *   Look up a file and take a reference to it without taking fl_lock.
+ *   The read side runs with local interrupts disabled so that it cannot
+ *   be preempted, and on SMP is tracked by the counter of its CPU that
+ *   fdlist_synchronize() waits on.
+ *
  ****************************************************************************/
 
 static void fdlist_get_by_index(FAR struct fdlist *list,
@@ -67,18 +160,43 @@ static void fdlist_get_by_index(FAR struct fdlist *list,
                                 FAR struct file **filep,
                                 FAR struct fd **fdp)
 {
-  FAR struct fd *fdp1;
+  FAR struct fd *fdp1 = NULL;
   irqstate_t flags;
+#ifdef CONFIG_SMP
+  FAR struct fdlist_reader_s *reader;
+#endif
 
-  flags = spin_lock_irqsave_notrace(&list->fl_lock);
-  fdp1 = &list->fl_fds[l1][l2];
-  *filep = fdp1->f_file;
-  if (*filep != NULL)
+  *filep = NULL;
+  flags  = up_irq_save();
+
+#ifdef CONFIG_SMP
+  /* Announce the lookup before anything is read */
+
+  reader = &g_fdlist_readers[this_cpu()];
+  atomic_fetch_add(&reader->seq, 1);
+  UP_DMB();
+#endif
+
+  /* fl_rows is published after fl_fds, so any row below it is present in
+   * the array that is read next.
+   */
+
+  if (l1 < list->fl_rows)
     {
-      atomic_fetch_add(&(*filep)->f_refs, 1);
+      UP_DMB();
+      fdp1   = &list->fl_fds[l1][l2];
+      *filep = fdp1->f_file;
+      if (*filep != NULL)
+        {
+          atomic_fetch_add(&(*filep)->f_refs, 1);
+        }
     }
 
-  spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
+#ifdef CONFIG_SMP
+  atomic_fetch_add_release(&reader->seq, 1);
+#endif
+
+  up_irq_restore(flags);
   if (fdp != NULL)
     {
       *fdp = fdp1;
@@ -161,14 +279,20 @@ static int fdlist_extend(FAR struct fdlist *list, size_t row)
       memcpy(fds, list->fl_fds, list->fl_rows * sizeof(FAR struct fd *));
     }
 
+  /* Publish the new array before the new row count, and let the readers
+   * of the old array drain before it is freed.
+   */
+
   tmp = list->fl_fds;
   list->fl_fds = fds;
+  UP_DMB();
   list->fl_rows = row;
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
 
   if (tmp != NULL && tmp != &list->fl_prefd)
     {
+      fdlist_synchronize();
       fs_heap_free(tmp);
     }
 
@@ -199,6 +323,14 @@ static void fdlist_uninstall(FAR struct fdlist *list, FAR struct fd *fdp)
     }
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
+
+  /* A lock-free reader may still be taking a reference */
+
+  if (filep != NULL)
+    {
+      fdlist_synchronize();
+    }
+
   file_put(filep);
 }
 
@@ -224,6 +356,12 @@ static void fdlist_install(FAR struct fdlist *list, int fd,
   FS_ADD_BACKTRACE(fdp);
 
   spin_unlock_irqrestore_notrace(&list->fl_lock, flags);
+
+  if (oldfilep != NULL)
+    {
+      fdlist_synchronize();
+    }
+
   file_put(oldfilep);
 }
 
@@ -0,0 +1,519 @@
+/****************************************************************************
+ * fs/inode/fs_inodecache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#include "inode/inode.h"
+#include "fs_heap.h"
+
+#ifdef CONFIG_FS_INODE_CACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if CONFIG_FS_INODE_CACHE_SIZE & (CONFIG_FS_INODE_CACHE_SIZE - 1)
+#  error CONFIG_FS_INODE_CACHE_SIZE must be a power of two
+#endif
+
+#define INODE_CACHE_MASK    (CONFIG_FS_INODE_CACHE_SIZE - 1)
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_INODECACHE)
+#  define HAVE_INODE_CACHE_PROCFS 1
+#endif
+
+/* Determines the size of an intermediate buffer that must be large enough
+ * to handle the longest line generated by this logic.
+ */
+
+#define INODE_CACHE_LINELEN 80
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One entry of the cache: the result of walking the children of 'parent'
+ * for a name with the hash 'hash'.  'node' is NULL for a name that does not
+ * exist, 'peer' is the child to the "left" of where the name is or would
+ * be.
+ *
+ * Entries are written by concurrent readers of the inode tree without any
+ * lock, so an entry may be torn.  That is harmless: the entries are only
+ * hints that are checked against the inode tree before use, and all of the
+ * inodes that they point to stay allocated because the cache is flushed
+ * before any inode is unlinked.
+ *
+ * Lookups still run under the inode read lock that inode_search() callers
+ * take.  The cache adds no lock of its own, but a hit is not lock-free:
+ * the caller goes on to take a reference on the inode found, and without
+ * the read lock that inode could be unlinked and freed in between, since
+ * nothing like RCU defers the release of inodes.  The read lock is shared
+ * by all readers, so only inode tree changes serialize with lookups.
+ */
+
+struct inode_cache_s
+{
+  FAR struct inode *parent;    /* The inode "above" */
+  FAR struct inode *node;      /* The inode found, NULL if none */
+  FAR struct inode *peer;      /* The inode to the "left" */
+  uint32_t          hash;      /* The hash of the name */
+};
+
+#ifdef HAVE_INODE_CACHE_PROCFS
+
+/* This structure describes one open "file" */
+
+struct inodecache_file_s
+{
+  struct procfs_file_s base;      /* Base open file structure */
+  unsigned int linesize;          /* Number of valid characters in line[] */
+  char line[INODE_CACHE_LINELEN]; /* Pre-allocated buffer for formatted lines */
+};
+#endif
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#ifdef HAVE_INODE_CACHE_PROCFS
+static int     inodecache_open(FAR struct file *filep,
+                               FAR const char *relpath,
+                               int oflags, mode_t mode);
+static int     inodecache_close(FAR struct file *filep);
+static ssize_t inodecache_read(FAR struct file *filep, FAR char *buffer,
+                               size_t buflen);
+static int     inodecache_dup(FAR const struct file *oldp,
+                              FAR struct file *newp);
+static int     inodecache_stat(FAR const char *relpath,
+                               FAR struct stat *buf);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct inode_cache_s g_inode_cache[CONFIG_FS_INODE_CACHE_SIZE];
+
+/* Statistics */
+
+static atomic_t g_inode_cache_hits;    /* Lookups answered by the cache */
+static atomic_t g_inode_cache_neghits; /* ... of which, names not found */
+static atomic_t g_inode_cache_misses;  /* Lookups that walked the peers */
+static atomic_t g_inode_cache_stale;   /* ... of which, outdated entries */
+static atomic_t g_inode_cache_flushes; /* Flushes by inode tree changes */
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef HAVE_INODE_CACHE_PROCFS
+const struct procfs_operations g_inodecache_operations =
+{
+  inodecache_open,   /* open */
+  inodecache_close,  /* close */
+  inodecache_read,   /* read */
+  NULL,              /* write */
+  NULL,              /* poll */
+  inodecache_dup,    /* dup */
+  NULL,              /* opendir */
+  NULL,              /* closedir */
+  NULL,              /* readdir */
+  NULL,              /* rewinddir */
+  inodecache_stat    /* stat */
+};
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cache_hash
+ *
+ * Description:
+ *   Hash the first segment of 'name' together with its parent (FNV-1a).
+ *
+ ****************************************************************************/
+
+static uint32_t inode_cache_hash(FAR struct inode *parent,
+                                 FAR const char *name)
+{
+  uint32_t hash = 2166136261u ^ (uint32_t)((uintptr_t)parent >> 4);
+
+  while (*name != '\0' && *name != '/')
+    {
+      hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: inode_cache_compare
+ *
+ * Description:
+ *   Compare the first segment of 'name' with the name of an inode, in the
+ *   same order as the children of an inode are sorted.
+ *
+ ****************************************************************************/
+
+static int inode_cache_compare(FAR const char *name,
+                               FAR struct inode *inode)
+{
+  FAR const char *nname = inode->i_name;
+
+  for (; ; )
+    {
+      bool end = *name == '\0' || *name == '/';
+
+      if (*nname == '\0')
+        {
+          return end ? 0 : 1;
+        }
+      else if (end || *name < *nname)
+        {
+          return -1;
+        }
+      else if (*name > *nname)
+        {
+          return 1;
+        }
+
+      name++;
+      nname++;
+    }
+}
+
+/****************************************************************************
+ * Name: inode_cache_verify
+ *
+ * Description:
+ *   Check an entry against the inode tree.  The entry holds if 'peer' is
+ *   a child of 'parent' (or NULL) sorting before the name, and the child
+ *   following 'peer' is 'node' with the name or, for a name that does not
+ *   exist, a child sorting after the name (or NULL).
+ *
+ ****************************************************************************/
+
+static bool inode_cache_verify(FAR struct inode *parent,
+                               FAR const char *name,
+                               FAR struct inode *node,
+                               FAR struct inode *peer)
+{
+  FAR struct inode *next;
+
+  if (peer != NULL)
+    {
+      if (peer->i_parent != parent || inode_cache_compare(name, peer) <= 0)
+        {
+          return false;
+        }
+
+      next = peer->i_peer;
+    }
+  else
+    {
+      next = parent->i_child;
+    }
+
+  if (node != NULL)
+    {
+      return next == node && node->i_parent == parent &&
+             inode_cache_compare(name, node) == 0;
+    }
+
+  return next == NULL || inode_cache_compare(name, next) < 0;
+}
+
+#ifdef HAVE_INODE_CACHE_PROCFS
+
+/****************************************************************************
+ * Name: inodecache_open
+ ****************************************************************************/
+
+static int inodecache_open(FAR struct file *filep, FAR const char *relpath,
+                           int oflags, mode_t mode)
+{
+  FAR struct inodecache_file_s *procfile;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* PROCFS is read-only.  Any attempt to open with any kind of write
+   * access is not permitted.
+   */
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      ferr("ERROR: Only O_RDONLY supported\n");
+      return -EACCES;
+    }
+
+  /* Allocate a container to hold the file attributes */
+
+  procfile = fs_heap_zalloc(sizeof(struct inodecache_file_s));
+  if (procfile == NULL)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = procfile;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: inodecache_close
+ ****************************************************************************/
+
+static int inodecache_close(FAR struct file *filep)
+{
+  FAR struct inodecache_file_s *procfile;
+
+  /* Recover our private data from the struct file instance */
+
+  procfile = filep->f_priv;
+  DEBUGASSERT(procfile);
+
+  /* Release the file attributes structure */
+
+  fs_heap_free(procfile);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: inodecache_read
+ ****************************************************************************/
+
+static ssize_t inodecache_read(FAR struct file *filep, FAR char *buffer,
+                               size_t buflen)
+{
+  FAR struct inodecache_file_s *procfile;
+  size_t linesize;
+  size_t copysize;
+  size_t totalsize;
+  off_t offset;
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  DEBUGASSERT(buffer != NULL && buflen > 0);
+  offset = filep->f_pos;
+
+  /* Recover our private data from the struct file instance */
+
+  procfile = filep->f_priv;
+  DEBUGASSERT(procfile);
+
+  /* The first line is the headers */
+
+  linesize  = procfs_snprintf(procfile->line, INODE_CACHE_LINELEN,
+                              "%8s%11s%11s%11s%11s%11s\n",
+                              "size", "hits", "neghits", "misses",
+                              "stale", "flushes");
+
+  copysize  = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                            &offset);
+  totalsize = copysize;
+
+  buffer   += copysize;
+  buflen   -= copysize;
+
+  /* The second line is the usage statistics */
+
+  linesize   = procfs_snprintf(procfile->line, INODE_CACHE_LINELEN,
+                               "%8d%11u%11u%11u%11u%11u\n",
+                               CONFIG_FS_INODE_CACHE_SIZE,
+                               (unsigned int)
+                               atomic_read(&g_inode_cache_hits),
+                               (unsigned int)
+                               atomic_read(&g_inode_cache_neghits),
+                               (unsigned int)
+                               atomic_read(&g_inode_cache_misses),
+                               (unsigned int)
+                               atomic_read(&g_inode_cache_stale),
+                               (unsigned int)
+                               atomic_read(&g_inode_cache_flushes));
+
+  copysize   = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                             &offset);
+  totalsize += copysize;
+
+  /* Update the file offset */
+
+  filep->f_pos += totalsize;
+  return totalsize;
+}
+
+/****************************************************************************
+ * Name: inodecache_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int inodecache_dup(FAR const struct file *oldp,
+                          FAR struct file *newp)
+{
+  FAR struct inodecache_file_s *oldattr;
+  FAR struct inodecache_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = fs_heap_malloc(sizeof(struct inodecache_file_s));
+  if (newattr == NULL)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct inodecache_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: inodecache_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int inodecache_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  /* "fs/inodecache" is the name for a read-only file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+#endif /* HAVE_INODE_CACHE_PROCFS */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cache_lookup
+ ****************************************************************************/
+
+bool inode_cache_lookup(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode **node, FAR struct inode **peer)
+{
+  FAR struct inode_cache_s *entry;
+  FAR struct inode *enode;
+  FAR struct inode *epeer;
+  uint32_t hash;
+
+  hash  = inode_cache_hash(parent, name);
+  entry = &g_inode_cache[hash & INODE_CACHE_MASK];
+
+  if (entry->parent == parent && entry->hash == hash)
+    {
+      enode = entry->node;
+      epeer = entry->peer;
+
+      if (inode_cache_verify(parent, name, enode, epeer))
+        {
+          atomic_fetch_add_relaxed(&g_inode_cache_hits, 1);
+          if (enode == NULL)
+            {
+              atomic_fetch_add_relaxed(&g_inode_cache_neghits, 1);
+            }
+
+          *node = enode;
+          *peer = epeer;
+          return true;
+        }
+
+      atomic_fetch_add_relaxed(&g_inode_cache_stale, 1);
+    }
+
+  atomic_fetch_add_relaxed(&g_inode_cache_misses, 1);
+  return false;
+}
+
+/****************************************************************************
+ * Name: inode_cache_insert
+ ****************************************************************************/
+
+void inode_cache_insert(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode *node, FAR struct inode *peer)
+{
+  FAR struct inode_cache_s *entry;
+  uint32_t hash;
+
+  hash  = inode_cache_hash(parent, name);
+  entry = &g_inode_cache[hash & INODE_CACHE_MASK];
+
+  entry->parent = parent;
+  entry->node   = node;
+  entry->peer   = peer;
+  entry->hash   = hash;
+}
+
+/****************************************************************************
+ * Name: inode_cache_flush
+ ****************************************************************************/
+
+void inode_cache_flush(void)
+{
+  memset(g_inode_cache, 0, sizeof(g_inode_cache));
+  atomic_fetch_add_relaxed(&g_inode_cache_flushes, 1);
+}
+
+#endif /* CONFIG_FS_INODE_CACHE */
@@ -79,6 +79,12 @@ static FAR struct inode *inode_unlink(FAR const char *path)
       inode = desc.node;
       DEBUGASSERT(inode != NULL);
 
+      /* The cache must not keep pointers to an inode that is about to be
+       * freed.
+       */
+
+      inode_cache_flush();
+
       /* If peer is non-null, then remove the node from the right of
        * of that peer node.
        */
@@ -213,6 +213,10 @@ int inode_reserve(FAR const char *path,
   left   = desc.peer;
   parent = desc.parent;
 
+  /* The new nodes outdate the lookup cache */
+
+  inode_cache_flush();
+
   for (; ; )
     {
       FAR struct inode *node;
@@ -221,6 +221,9 @@ static int _inode_search(FAR struct inode_search_s *desc)
   FAR struct inode *left    = NULL;
   FAR struct inode *above   = NULL;
   FAR const char   *relpath = NULL;
+#ifdef CONFIG_FS_INODE_CACHE
+  bool cached = false;
+#endif
   int ret = -ENOENT;
 
   /* Get the search path, skipping over the leading '/'.  The leading '/' is
@@ -235,14 +238,55 @@ static int _inode_search(FAR struct inode_search_s *desc)
       return -EINVAL;
     }
 
+#ifdef CONFIG_FS_INODE_CACHE
+  /* The root inode matches the leading '/' of every path.  Step below it
+   * right away, so that the names at the top level, like "dev" or "proc",
+   * go through the path lookup cache like those of every other level.
+   */
+
+  if (inode != NULL)
+    {
+      name = inode_nextname(name);
+      if (*name == '\0' || INODE_IS_MOUNTPT(inode))
+        {
+          relpath = name;
+          ret = OK;
+        }
+      else
+        {
+          above = inode;
+          inode = inode->i_child;
+        }
+    }
+#endif
+
   /* Traverse the pseudo file system node tree until either (1) all nodes
    * have been examined without finding the matching node, or (2) the
    * matching node is found.
    */
 
-  while (inode != NULL)
+  while (ret < 0 && inode != NULL)
     {
-      int result = _inode_compare(name, inode);
+      int result;
+
+#ifdef CONFIG_FS_INODE_CACHE
+      /* Before walking the list of children of 'above', ask the path
+       * lookup cache where the name is (or would be) in that list.
+       */
+
+      if (left == NULL && !cached)
+        {
+          cached = inode_cache_lookup(above, name, &inode, &left);
+          if (cached && inode == NULL)
+            {
+              /* The name is known not to exist */
+
+              break;
+            }
+        }
+#endif
+
+      result = _inode_compare(name, inode);
 
       /* Case 1:  The name is less than the name of the node.
        * Since the names are ordered, these means that there
@@ -252,6 +296,13 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
       if (result < 0)
         {
+#ifdef CONFIG_FS_INODE_CACHE
+          if (!cached)
+            {
+              inode_cache_insert(above, name, NULL, left);
+            }
+#endif
+
           inode = NULL;
           break;
         }
@@ -267,6 +318,13 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
           left  = inode;
           inode = inode->i_peer;
+
+#ifdef CONFIG_FS_INODE_CACHE
+          if (inode == NULL && !cached)
+            {
+              inode_cache_insert(above, name, NULL, left);
+            }
+#endif
         }
 
       /* The names match */
@@ -280,6 +338,13 @@ static int _inode_search(FAR struct inode_search_s *desc)
            *       below this one
            */
 
+#ifdef CONFIG_FS_INODE_CACHE
+          if (!cached)
+            {
+              inode_cache_insert(above, name, inode, left);
+            }
+#endif
+
           name = inode_nextname(name);
           if (*name == '\0' || INODE_IS_MOUNTPT(inode))
             {
@@ -387,6 +452,9 @@ static int _inode_search(FAR struct inode_search_s *desc)
               above = inode;
               left  = NULL;
               inode = inode->i_child;
+#ifdef CONFIG_FS_INODE_CACHE
+              cached = false;
+#endif
             }
         }
     }
@@ -463,6 +463,59 @@ int pseudofile_create(FAR struct inode **node, FAR const char *path,
 bool inode_is_pseudofile(FAR struct inode *inode);
 #endif
 
+/****************************************************************************
+ * Name: inode_cache_lookup
+ *
+ * Description:
+ *   Look up the peer named by the first segment of 'name' below 'parent' in
+ *   the path lookup cache.  On a hit, the inode (NULL if the name is known
+ *   not to exist) and the peer to the "left" of it are returned exactly as
+ *   walking the list of children of 'parent' would find them.
+ *
+ * Returned Value:
+ *   true on a cache hit, false if the list of children must be walked.
+ *
+ * Assumptions:
+ *   The caller holds the inode semaphore, for reading at least
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODE_CACHE
+bool inode_cache_lookup(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode **node, FAR struct inode **peer);
+
+/****************************************************************************
+ * Name: inode_cache_insert
+ *
+ * Description:
+ *   Remember the result of walking the list of children of 'parent' for
+ *   the first segment of 'name'.
+ *
+ * Assumptions:
+ *   The caller holds the inode semaphore, for reading at least
+ *
+ ****************************************************************************/
+
+void inode_cache_insert(FAR struct inode *parent, FAR const char *name,
+                        FAR struct inode *node, FAR struct inode *peer);
+
+/****************************************************************************
+ * Name: inode_cache_flush
+ *
+ * Description:
+ *   Drop every entry of the path lookup cache.  This must be called
+ *   whenever inodes are linked into or unlinked from the inode tree.
+ *
+ * Assumptions:
+ *   The caller holds the inode semaphore for writing
+ *
+ ****************************************************************************/
+
+void inode_cache_flush(void);
+#else
+#  define inode_cache_flush()
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -26,15 +26,19 @@
 
 #include <nuttx/config.h>
 
+#include <debug.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/list.h>
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/mutex.h>
+#include <nuttx/wqueue.h>
 
 #include <sys/stat.h>
 #include <sys/statfs.h>
@@ -66,6 +70,12 @@ struct littlefs_file_s
 {
   struct lfs_file       file;
   int                   refs;
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  struct list_node      node;    /* Link in the dirty list of the mount */
+  bool                  dirty;   /* Written since the last commit */
+  int                   oflags;  /* LFS open flags without CREAT/EXCL/TRUNC */
+  char                  path[1]; /* Converted relative path */
+#endif
 };
 
 /* This structure represents the overall mountpoint state. An instance of
@@ -81,6 +91,12 @@ struct littlefs_mountpt_s
   struct lfs_config     cfg;
   struct lfs            lfs;
   bool                  readonly;
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  struct list_node      dirty;   /* Files with uncommitted data */
+  struct work_s         work;    /* Deferred commit work */
+  int                   error;   /* First deferred commit failure not
+                                  * reported yet */
+#endif
 };
 
 /* NuttX specific file attributes.
@@ -162,6 +178,9 @@ static int     littlefs_chstat(FAR struct inode *mountpt,
                                FAR const char *relpath,
                                FAR const struct stat *buf, int flags);
 #endif
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+static int     littlefs_syncfs(FAR struct inode *mountpt);
+#endif
 
 /****************************************************************************
  * Public Data
@@ -210,10 +229,15 @@ const struct mountpt_operations g_littlefs_operations =
   littlefs_rename,        /* rename */
   littlefs_stat,          /* stat */
 #ifdef CONFIG_FS_LITTLEFS_ATTR_UPDATE
-  littlefs_chstat         /* chstat */
+  littlefs_chstat,        /* chstat */
 #else
   NULL,
 #endif
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  littlefs_syncfs         /* syncfs */
+#else
+  NULL
+#endif
 };
 
 /****************************************************************************
@@ -335,6 +359,243 @@ static FAR const char *littlefs_convert_path(FAR const char *path)
   return path;
 }
 
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+
+/****************************************************************************
+ * Name: littlefs_commit
+ *
+ * Description:
+ *   Commit a dirty file to flash and drop it from the dirty list. A file
+ *   that has already been closed by all of its users is closed for real
+ *   and released. Nobody is waiting for the result of a deferred commit,
+ *   so a failure is kept on the mount for the next fsync(), syncfs() or
+ *   umount(). The mount lock must be held.
+ *
+ ****************************************************************************/
+
+static int littlefs_commit(FAR struct littlefs_mountpt_s *fs,
+                           FAR struct littlefs_file_s *priv)
+{
+  int ret;
+
+  list_delete(&priv->node);
+  priv->dirty = false;
+
+  if (priv->refs > 0)
+    {
+      ret = littlefs_convert_result(lfs_file_sync(&fs->lfs, &priv->file));
+    }
+  else
+    {
+      ret = littlefs_convert_result(lfs_file_close(&fs->lfs,
+                                                   &priv->file));
+      fs_heap_free(priv);
+    }
+
+  if (ret < 0)
+    {
+      ferr("ERROR: Deferred commit failed: %d\n", ret);
+      if (fs->error == 0)
+        {
+          fs->error = ret;
+        }
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: littlefs_commit_all
+ *
+ * Description:
+ *   Commit every dirty file and return the first deferred commit failure
+ *   not reported yet, if any. The mount lock must be held.
+ *
+ ****************************************************************************/
+
+static int littlefs_commit_all(FAR struct littlefs_mountpt_s *fs)
+{
+  FAR struct littlefs_file_s *priv;
+  int ret;
+
+  while ((priv = list_peek_head_type(&fs->dirty, struct littlefs_file_s,
+                                     node)) != NULL)
+    {
+      littlefs_commit(fs, priv);
+    }
+
+  ret = fs->error;
+  fs->error = 0;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: littlefs_commit_closed
+ *
+ * Description:
+ *   Commit the closed files still waiting for the commit work, so that
+ *   path based operations see their final state. If 'path' is not NULL
+ *   only the files opened with that path are committed. 'except' is
+ *   skipped. The mount lock must be held.
+ *
+ ****************************************************************************/
+
+static void littlefs_commit_closed(FAR struct littlefs_mountpt_s *fs,
+                                   FAR const char *path,
+                                   FAR struct littlefs_file_s *except)
+{
+  FAR struct littlefs_file_s *priv;
+  FAR struct littlefs_file_s *tmp;
+
+  list_for_every_entry_safe(&fs->dirty, priv, tmp,
+                            struct littlefs_file_s, node)
+    {
+      if (priv != except && priv->refs <= 0 &&
+          (path == NULL || strcmp(priv->path, path) == 0))
+        {
+          littlefs_commit(fs, priv);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: littlefs_commit_worker
+ *
+ * Description:
+ *   Commit the files on the dirty list. The mount lock is taken for one
+ *   file at a time so that readers and writers of other files only ever
+ *   wait for a single commit.
+ *
+ ****************************************************************************/
+
+static void littlefs_commit_worker(FAR void *arg)
+{
+  FAR struct littlefs_mountpt_s *fs = arg;
+  FAR struct littlefs_file_s *priv;
+  size_t count;
+  int ret;
+
+  ret = nxmutex_lock(&fs->lock);
+  if (ret < 0)
+    {
+      return;
+    }
+
+  /* Files dirtied while we are running are left for the next round */
+
+  count = list_length(&fs->dirty);
+  while (count-- > 0)
+    {
+      priv = list_peek_head_type(&fs->dirty, struct littlefs_file_s, node);
+      if (priv == NULL)
+        {
+          break;
+        }
+
+      littlefs_commit(fs, priv);
+      nxmutex_unlock(&fs->lock);
+
+      ret = nxmutex_lock(&fs->lock);
+      if (ret < 0)
+        {
+          return;
+        }
+    }
+
+  nxmutex_unlock(&fs->lock);
+}
+
+/****************************************************************************
+ * Name: littlefs_mark_dirty
+ *
+ * Description:
+ *   Put a written file on the dirty list and make sure the commit work is
+ *   scheduled. The mount lock must be held.
+ *
+ ****************************************************************************/
+
+static void littlefs_mark_dirty(FAR struct littlefs_mountpt_s *fs,
+                                FAR struct littlefs_file_s *priv)
+{
+  if (fs->readonly)
+    {
+      return;
+    }
+
+  if (!priv->dirty)
+    {
+      priv->dirty = true;
+      list_add_tail(&fs->dirty, &priv->node);
+    }
+
+  if (work_available(&fs->work))
+    {
+      work_queue(LPWORK, &fs->work, littlefs_commit_worker, fs,
+                 MSEC2TICK(CONFIG_FS_LITTLEFS_WRITEBACK_INTERVAL));
+    }
+}
+
+/****************************************************************************
+ * Name: littlefs_mark_clean
+ *
+ * Description:
+ *   Drop a file from the dirty list after it was committed synchronously.
+ *   The mount lock must be held.
+ *
+ ****************************************************************************/
+
+static void littlefs_mark_clean(FAR struct littlefs_file_s *priv)
+{
+  if (priv->dirty)
+    {
+      list_delete(&priv->node);
+      priv->dirty = false;
+    }
+}
+
+/****************************************************************************
+ * Name: littlefs_reopen
+ *
+ * Description:
+ *   Look for a closed file with uncommitted data and the same path. If it
+ *   was opened with compatible flags, hand it out again instead of
+ *   committing it and opening the file from flash. Otherwise commit it so
+ *   that the new open sees the data written through it. The mount lock
+ *   must be held.
+ *
+ ****************************************************************************/
+
+static FAR struct littlefs_file_s *
+littlefs_reopen(FAR struct littlefs_mountpt_s *fs, FAR const char *relpath,
+                int oflags)
+{
+  FAR struct littlefs_file_s *priv;
+  FAR struct littlefs_file_s *found = NULL;
+
+  if ((oflags & (LFS_O_TRUNC | LFS_O_EXCL)) == 0)
+    {
+      list_for_every_entry(&fs->dirty, priv, struct littlefs_file_s, node)
+        {
+          if (priv->refs <= 0 && strcmp(priv->path, relpath) == 0 &&
+              priv->oflags == (oflags & ~LFS_O_CREAT))
+            {
+              found = priv;
+              break;
+            }
+        }
+    }
+
+  littlefs_commit_closed(fs, relpath, found);
+  if (found != NULL)
+    {
+      found->refs = 1;
+    }
+
+  return found;
+}
+
+#endif /* CONFIG_FS_LITTLEFS_WRITEBACK */
+
 /****************************************************************************
  * Name: littlefs_open
  ****************************************************************************/
@@ -344,6 +605,9 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
 {
   FAR struct littlefs_mountpt_s *fs;
   FAR struct littlefs_file_s *priv;
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  FAR struct littlefs_file_s *reuse;
+#endif
   FAR struct inode *inode;
   int ret;
 
@@ -354,15 +618,27 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
   inode = filep->f_inode;
   fs    = inode->i_private;
 
+  relpath = littlefs_convert_path(relpath);
+  oflags = littlefs_convert_oflags(oflags);
+
   /* Allocate memory for the open file */
 
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  priv = fs_heap_malloc(sizeof(*priv) + strlen(relpath));
+#else
   priv = fs_heap_malloc(sizeof(*priv));
+#endif
   if (priv == NULL)
     {
       return -ENOMEM;
     }
 
   priv->refs = 1;
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  priv->dirty = false;
+  priv->oflags = oflags & ~(LFS_O_CREAT | LFS_O_EXCL | LFS_O_TRUNC);
+  strcpy(priv->path, relpath);
+#endif
 
   /* Lock */
 
@@ -374,8 +650,6 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
 
   /* Try to open the file */
 
-  relpath = littlefs_convert_path(relpath);
-  oflags = littlefs_convert_oflags(oflags);
   if (fs->readonly)
     {
       if (oflags != LFS_O_RDONLY)
@@ -385,6 +659,34 @@ static int littlefs_open(FAR struct file *filep, FAR const char *relpath,
         }
     }
 
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  reuse = littlefs_reopen(fs, relpath, oflags);
+  if (reuse != NULL)
+    {
+      fs_heap_free(priv);
+      priv = reuse;
+
+      if (oflags & LFS_O_APPEND)
+        {
+          ret = littlefs_convert_result(lfs_file_seek(&fs->lfs,
+                                                      &priv->file, 0,
+                                                      LFS_SEEK_END));
+          if (ret < 0)
+            {
+              priv->refs = 0;
+              nxmutex_unlock(&fs->lock);
+              return ret;
+            }
+
+          filep->f_pos = ret;
+        }
+
+      nxmutex_unlock(&fs->lock);
+      filep->f_priv = priv;
+      return OK;
+    }
+#endif
+
   ret = littlefs_convert_result(lfs_file_open(&fs->lfs, &priv->file,
                                               relpath, oflags));
   if (ret < 0)
@@ -495,16 +797,27 @@ static int littlefs_close(FAR struct file *filep)
       return ret;
     }
 
-  if (--priv->refs <= 0)
+  if (--priv->refs > 0)
     {
-      ret = littlefs_convert_result(lfs_file_close(&fs->lfs, &priv->file));
+      nxmutex_unlock(&fs->lock);
+      return ret;
     }
 
-  nxmutex_unlock(&fs->lock);
-  if (priv->refs <= 0)
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  /* Leave a file with uncommitted data to the commit work, which closes
+   * it later unless the same path is opened again first.
+   */
+
+  if (priv->dirty)
     {
-      fs_heap_free(priv);
+      nxmutex_unlock(&fs->lock);
+      return ret;
     }
+#endif
+
+  ret = littlefs_convert_result(lfs_file_close(&fs->lfs, &priv->file));
+  nxmutex_unlock(&fs->lock);
+  fs_heap_free(priv);
 
   return ret;
 }
@@ -600,6 +913,9 @@ static ssize_t littlefs_write(FAR struct file *filep, const char *buffer,
   if (ret > 0)
     {
       filep->f_pos += ret;
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+      littlefs_mark_dirty(fs, priv);
+#endif
     }
 
 out:
@@ -748,6 +1064,18 @@ static int littlefs_sync(FAR struct file *filep)
     }
 
   ret = littlefs_convert_result(lfs_file_sync(&fs->lfs, &priv->file));
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  if (ret >= 0)
+    {
+      littlefs_mark_clean(priv);
+
+      /* Report a deferred commit that failed since the last report */
+
+      ret = fs->error;
+      fs->error = 0;
+    }
+#endif
+
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -974,6 +1302,13 @@ static int littlefs_truncate(FAR struct file *filep, off_t length)
 
   ret = littlefs_convert_result(lfs_file_truncate(&fs->lfs, &priv->file,
                                                   length));
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  if (ret >= 0)
+    {
+      littlefs_mark_dirty(fs, priv);
+    }
+#endif
+
   nxmutex_unlock(&fs->lock);
 
   return ret;
@@ -1320,6 +1655,9 @@ static int littlefs_bind(FAR struct inode *driver, FAR const void *data,
 
   fs->drv = driver;        /* Save the driver reference */
   nxmutex_init(&fs->lock); /* Initialize the access control mutex */
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  list_initialize(&fs->dirty);
+#endif
 
   if (INODE_IS_MTD(driver))
     {
@@ -1470,6 +1808,10 @@ static int littlefs_unbind(FAR void *handle, FAR struct inode **driver,
   FAR struct inode *drv = fs->drv;
   int ret;
 
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  work_cancel_sync(LPWORK, &fs->work);
+#endif
+
   /* Unmount */
 
   ret = nxmutex_lock(&fs->lock);
@@ -1478,6 +1820,20 @@ static int littlefs_unbind(FAR void *handle, FAR struct inode **driver,
       return ret;
     }
 
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  /* Commit everything the commit work did not get to.  If a deferred
+   * commit failed, fail this umount with that error and stay mounted; the
+   * error is reported once, so a second umount goes through.
+   */
+
+  ret = littlefs_commit_all(fs);
+  if (ret < 0)
+    {
+      nxmutex_unlock(&fs->lock);
+      return ret;
+    }
+#endif
+
   ret = littlefs_convert_result(lfs_unmount(&fs->lfs));
   nxmutex_unlock(&fs->lock);
 
@@ -1580,6 +1936,10 @@ static int littlefs_unlink(FAR struct inode *mountpt,
     }
 
   relpath = littlefs_convert_path(relpath);
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  littlefs_commit_closed(fs, relpath, NULL);
+#endif
+
   ret = littlefs_convert_result(lfs_remove(&fs->lfs, relpath));
   nxmutex_unlock(&fs->lock);
 
@@ -1723,6 +2083,10 @@ static int littlefs_rename(FAR struct inode *mountpt,
 
   oldrelpath = littlefs_convert_path(oldrelpath);
   newrelpath = littlefs_convert_path(newrelpath);
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  littlefs_commit_closed(fs, NULL, NULL);
+#endif
+
   ret = littlefs_convert_result(lfs_rename(&fs->lfs, oldrelpath,
                                            newrelpath));
   nxmutex_unlock(&fs->lock);
@@ -1760,6 +2124,10 @@ static int littlefs_stat(FAR struct inode *mountpt, FAR const char *relpath,
     }
 
   relpath = littlefs_convert_path(relpath);
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+  littlefs_commit_closed(fs, relpath, NULL);
+#endif
+
   ret = lfs_stat(&fs->lfs, relpath, &info);
   if (ret < 0)
     {
@@ -1885,3 +2253,31 @@ errout:
   return ret;
 }
 #endif
+
+#ifdef CONFIG_FS_LITTLEFS_WRITEBACK
+/****************************************************************************
+ * Name: littlefs_syncfs
+ *
+ * Description: Commit all the files with uncommitted data and return the
+ *   first deferred commit failure not reported yet.
+ *
+ ****************************************************************************/
+
+static int littlefs_syncfs(FAR struct inode *mountpt)
+{
+  FAR struct littlefs_mountpt_s *fs;
+  int ret;
+
+  fs = mountpt->i_private;
+
+  ret = nxmutex_lock(&fs->lock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = littlefs_commit_all(fs);
+  nxmutex_unlock(&fs->lock);
+  return ret;
+}
+#endif
@@ -66,6 +66,8 @@ extern const struct procfs_operations g_irq_operations;
 extern const struct procfs_operations g_meminfo_operations;
 extern const struct procfs_operations g_memdump_operations;
 extern const struct procfs_operations g_mempool_operations;
+extern const struct procfs_operations g_mempool_histogram_operations;
+extern const struct procfs_operations g_memprof_operations;
 extern const struct procfs_operations g_module_operations;
 extern const struct procfs_operations g_pm_operations;
 extern const struct procfs_operations g_proc_operations;
@@ -81,6 +83,7 @@ extern const struct procfs_operations g_pressure_operations;
  * configuration.
  */
 
+extern const struct procfs_operations g_inodecache_operations;
 extern const struct procfs_operations g_mount_operations;
 extern const struct procfs_operations g_net_operations;
 extern const struct procfs_operations g_netroute_operations;
@@ -129,6 +132,10 @@ static const struct procfs_entry_s g_procfs_entries[] =
   { "fs/blocks",    &g_mount_operations,    PROCFS_FILE_TYPE   },
 #endif
 
+#if defined(CONFIG_FS_INODE_CACHE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_INODECACHE)
+  { "fs/inodecache", &g_inodecache_operations, PROCFS_FILE_TYPE },
+#endif
+
 #ifndef CONFIG_FS_PROCFS_EXCLUDE_MOUNT
   { "fs/mount",     &g_mount_operations,    PROCFS_FILE_TYPE   },
 #endif
@@ -158,6 +165,13 @@ static const struct procfs_entry_s g_procfs_entries[] =
 
 #if defined(CONFIG_MM_HEAP_MEMPOOL) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL)
   { "mempool",      &g_mempool_operations,  PROCFS_FILE_TYPE   },
+#  ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+  { "mempoolhist",  &g_mempool_histogram_operations, PROCFS_FILE_TYPE },
+#  endif
+#endif
+
+#if defined(CONFIG_MM_MEMPROF) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPROF)
+  { "memprof",      &g_memprof_operations,  PROCFS_FILE_TYPE   },
 #endif
 
 #if defined(CONFIG_MODULE) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MODULE)
@@ -38,6 +38,8 @@
 #include <debug.h>
 #include <limits.h>
 
+#include <nuttx/atomic.h>
+#include <nuttx/clock.h>
 #include <nuttx/lib/lib.h>
 #include <nuttx/mutex.h>
 #include <nuttx/fs/fs.h>
@@ -46,6 +48,7 @@
 
 #include "rpmsgfs.h"
 #include "fs_heap.h"
+#include "fs_metacache.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -53,6 +56,30 @@
 
 #define RPMSGFS_RETRY_DELAY_MS       10
 
+#define RPMSGFS_RABUF(hf, i) \
+  ((hf)->rabuf + (i) * CONFIG_FS_RPMSGFS_READAHEAD)
+
+/* Every modification made through the mount point bumps the generation
+ * of the paths it may have changed (see fs_metacache.h).  Cached
+ * attributes and listings, and the read-ahead data of the open files, are
+ * only used while the generation of their path is unchanged.
+ */
+
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0 || CONFIG_FS_RPMSGFS_READAHEAD > 0
+#  define RPMSGFS_METACACHE 1
+#  define rpmsgfs_invalidate(fs)     fs_metacache_invalidate(&(fs)->fs_cache)
+#  define rpmsgfs_invalidate_path(fs, relpath) \
+     fs_metacache_invalidate_path(&(fs)->fs_cache, relpath)
+#  define rpmsgfs_touch(fs, hf)      fs_metacache_touch(&(fs)->fs_cache, \
+                                                        (hf)->key)
+#  define rpmsgfs_gen(fs, hf)        fs_metacache_gen(&(fs)->fs_cache, \
+                                                      (hf)->key)
+#else
+#  define rpmsgfs_invalidate(fs)
+#  define rpmsgfs_invalidate_path(fs, relpath)
+#  define rpmsgfs_touch(fs, hf)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -61,10 +88,14 @@ struct rpmsgfs_dir_s
 {
   struct fs_dirent_s base;
   FAR void *dir;
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  struct fs_dircache_s cache;          /* Listing being read or replayed */
+#endif
 };
 
-/* This structure describes the state of one open file.  This structure
- * is protected by the volume semaphore.
+/* This structure describes the state of one open file.  The list link
+ * and reference count are protected by the volume lock, the rest by the
+ * file lock so that requests on different files proceed in parallel.
  */
 
 struct rpmsgfs_ofile_s
@@ -73,6 +104,23 @@ struct rpmsgfs_ofile_s
   int16_t                    crefs;    /* Reference count */
   mode_t                     oflags;   /* Open mode */
   int                        fd;
+  mutex_t                    lock;     /* Serializes requests on the file */
+  off_t                      rpos;     /* Remote file position, -1 if
+                                        * unknown */
+#ifdef RPMSGFS_METACACHE
+  uint32_t                   key;      /* fs_metacache_key() of the path */
+#endif
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  off_t                      lastpos;  /* End of the previous read */
+  off_t                      rapos;    /* File position of the current
+                                        * read-ahead buffer */
+  size_t                     ralen;    /* Valid bytes in it */
+  int                        racur;    /* Current buffer, 0 or 1 */
+  FAR char                   *rabuf;   /* Two read-ahead buffers */
+  FAR void                   *rareq;   /* Request in flight for the other
+                                        * buffer, at rapos + ralen */
+  int32_t                    ragen;    /* Generation of the data */
+#endif
 };
 
 /* This structure represents the overall mountpoint state.  An instance of
@@ -87,6 +135,12 @@ struct rpmsgfs_mountpt_s
   char                       fs_root[PATH_MAX];
   void                       *handle;
   int                        timeout;  /* Connect timeout */
+#ifdef RPMSGFS_METACACHE
+  struct fs_metacache_s      fs_cache; /* stat() and listing cache */
+#endif
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  struct fs_attr_s           fs_attr[CONFIG_FS_RPMSGFS_ATTR_NENTRIES];
+#endif
 };
 
 /****************************************************************************
@@ -272,6 +326,74 @@ static void rpmsgfs_mkpath(FAR struct rpmsgfs_mountpt_s *fs,
     }
 }
 
+/****************************************************************************
+ * Name: rpmsgfs_seekto
+ *
+ * Description: Move the remote file position to 'pos' if it isn't there.
+ *   Reads and writes go to the remote position, so this is done lazily
+ *   just before them.
+ *
+ ****************************************************************************/
+
+static int rpmsgfs_seekto(FAR struct rpmsgfs_mountpt_s *fs,
+                          FAR struct rpmsgfs_ofile_s *hf, off_t pos)
+{
+  off_t ret;
+
+  if (hf->rpos == pos)
+    {
+      return OK;
+    }
+
+  ret = rpmsgfs_client_lseek(fs->handle, hf->fd, pos, SEEK_SET);
+  hf->rpos = ret < 0 ? -1 : ret;
+  return ret < 0 ? ret : OK;
+}
+
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+/****************************************************************************
+ * Name: rpmsgfs_ra_wait
+ *
+ * Description: Wait for the read-ahead request in flight, if any, and make
+ *   its buffer the current one.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_ra_wait(FAR struct rpmsgfs_mountpt_s *fs,
+                            FAR struct rpmsgfs_ofile_s *hf)
+{
+  ssize_t ret;
+
+  if (hf->rareq != NULL)
+    {
+      ret = rpmsgfs_client_read_wait(fs->handle, hf->rareq);
+      hf->rareq  = NULL;
+      hf->racur ^= 1;
+      hf->rapos += hf->ralen;
+      hf->ralen  = ret > 0 ? ret : 0;
+      hf->rpos   = ret < 0 ? -1 : hf->rapos + hf->ralen;
+    }
+}
+
+/****************************************************************************
+ * Name: rpmsgfs_ra_drop
+ *
+ * Description: Discard the read-ahead data, before a write for example.
+ *   Modifications made through other open files are caught by the mount
+ *   generation when reading.
+ *
+ ****************************************************************************/
+
+static void rpmsgfs_ra_drop(FAR struct rpmsgfs_mountpt_s *fs,
+                            FAR struct rpmsgfs_ofile_s *hf)
+{
+  rpmsgfs_ra_wait(fs, hf);
+  hf->ralen = 0;
+}
+#else
+#  define rpmsgfs_ra_drop(fs, hf)
+#endif
+
 /****************************************************************************
  * Name: rpmsgfs_open
  ****************************************************************************/
@@ -315,7 +437,7 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
 
   /* Allocate memory for the open file */
 
-  hf = fs_heap_malloc(sizeof *hf);
+  hf = fs_heap_zalloc(sizeof *hf);
   if (hf == NULL)
     {
       ret = -ENOMEM;
@@ -354,6 +476,17 @@ static int rpmsgfs_open(FAR struct file *filep, FAR const char *relpath,
         }
     }
 
+  hf->rpos = filep->f_pos;
+  nxmutex_init(&hf->lock);
+#ifdef RPMSGFS_METACACHE
+  hf->key = fs_metacache_key(relpath);
+#endif
+
+  if ((oflags & (O_CREAT | O_TRUNC)) != 0)
+    {
+      rpmsgfs_invalidate_path(fs, relpath);
+    }
+
   /* Attach the private date to the struct file instance */
 
   filep->f_priv = hf;
@@ -463,11 +596,20 @@ static int rpmsgfs_close(FAR struct file *filep)
 
   /* Close the host file */
 
+  rpmsgfs_ra_drop(fs, hf);
   rpmsgfs_client_close(fs->handle, hf->fd);
+  if ((hf->oflags & O_WROK) != 0)
+    {
+      rpmsgfs_touch(fs, hf);
+    }
 
   /* Now free the pointer */
 
   filep->f_priv = NULL;
+  nxmutex_destroy(&hf->lock);
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  fs_heap_free(hf->rabuf);
+#endif
   fs_heap_free(hf);
 
 okout:
@@ -485,7 +627,14 @@ static ssize_t rpmsgfs_read(FAR struct file *filep, FAR char *buffer,
   FAR struct inode *inode;
   FAR struct rpmsgfs_mountpt_s *fs;
   FAR struct rpmsgfs_ofile_s *hf;
+  size_t nread = 0;
+  off_t pos;
   ssize_t ret;
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  bool sequential;
+  int32_t gen;
+  size_t n;
+#endif
 
   /* Sanity checks */
 
@@ -501,22 +650,134 @@ static ssize_t rpmsgfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
     }
 
-  /* Call the host to perform the read */
+  pos = filep->f_pos;
 
-  ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer, buflen);
-  if (ret > 0)
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  /* Take what we can from the read-ahead buffers, waiting for the one in
+   * flight when the current one runs out.
+   */
+
+  sequential = pos == hf->lastpos;
+
+  /* The data is stale if the file was modified since it was fetched,
+   * through this open file or any other one of the same path.
+   */
+
+  gen = rpmsgfs_gen(fs, hf);
+  if (hf->ragen != gen)
     {
-      filep->f_pos += ret;
+      rpmsgfs_ra_drop(fs, hf);
+      hf->ragen = gen;
     }
 
-  nxmutex_unlock(&fs->fs_lock);
-  return ret;
+  for (; ; )
+    {
+      if (pos >= hf->rapos && pos < hf->rapos + hf->ralen)
+        {
+          n = MIN(buflen - nread, hf->rapos + hf->ralen - pos);
+          memcpy(buffer + nread,
+                 RPMSGFS_RABUF(hf, hf->racur) + (pos - hf->rapos), n);
+          nread += n;
+          pos   += n;
+          if (nread == buflen)
+            {
+              break;
+            }
+        }
+      else if (hf->rareq != NULL)
+        {
+          rpmsgfs_ra_wait(fs, hf);
+          if (hf->ralen == 0)
+            {
+              break;
+            }
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  /* Small sequential reads fetch a whole read-ahead buffer */
+
+  if (nread < buflen && sequential &&
+      buflen - nread < CONFIG_FS_RPMSGFS_READAHEAD && hf->rabuf == NULL)
+    {
+      hf->rabuf = fs_heap_malloc(2 * CONFIG_FS_RPMSGFS_READAHEAD);
+    }
+
+  if (nread < buflen && sequential &&
+      buflen - nread < CONFIG_FS_RPMSGFS_READAHEAD && hf->rabuf != NULL)
+    {
+      ret = rpmsgfs_seekto(fs, hf, pos);
+      if (ret < 0)
+        {
+          goto out;
+        }
+
+      ret = rpmsgfs_client_read(fs->handle, hf->fd,
+                                RPMSGFS_RABUF(hf, hf->racur),
+                                CONFIG_FS_RPMSGFS_READAHEAD);
+      hf->rapos = pos;
+      hf->ralen = ret > 0 ? ret : 0;
+      hf->rpos  = ret < 0 ? -1 : pos + hf->ralen;
+
+      n = MIN(buflen - nread, hf->ralen);
+      memcpy(buffer + nread, RPMSGFS_RABUF(hf, hf->racur), n);
+      nread += n;
+      pos   += n;
+    }
+  else
+#endif
+  if (nread < buflen)
+    {
+      ret = rpmsgfs_seekto(fs, hf, pos);
+      if (ret < 0)
+        {
+          goto out;
+        }
+
+      /* Call the host to perform the read */
+
+      ret = rpmsgfs_client_read(fs->handle, hf->fd, buffer + nread,
+                                buflen - nread);
+      hf->rpos = ret < 0 ? -1 : hf->rpos + ret;
+      if (ret > 0)
+        {
+          nread += ret;
+          pos   += ret;
+        }
+    }
+
+#if CONFIG_FS_RPMSGFS_READAHEAD > 0
+  /* Keep the next buffer of a sequential reader in flight while the
+   * caller is busy with this data.  A short buffer means the end of the
+   * file.
+   */
+
+  if (sequential && hf->rabuf != NULL && hf->rareq == NULL &&
+      hf->ralen == CONFIG_FS_RPMSGFS_READAHEAD &&
+      hf->rpos == hf->rapos + hf->ralen &&
+      pos >= hf->rapos && pos <= hf->rapos + hf->ralen)
+    {
+      hf->rareq = rpmsgfs_client_read_async(fs->handle, hf->fd,
+                                            RPMSGFS_RABUF(hf, hf->racur ^ 1),
+                                            CONFIG_FS_RPMSGFS_READAHEAD);
+    }
+
+  hf->lastpos = pos;
+#endif
+
+out:
+  filep->f_pos = pos;
+  nxmutex_unlock(&hf->lock);
+  return nread > 0 ? nread : ret;
 }
 
 /****************************************************************************
@@ -543,7 +804,7 @@ static ssize_t rpmsgfs_write(FAR struct file *filep, const char *buffer,
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -559,6 +820,20 @@ static ssize_t rpmsgfs_write(FAR struct file *filep, const char *buffer,
       goto errout_with_lock;
     }
 
+  /* Drop the read-ahead data and bring the remote position to f_pos.
+   * Appending writes go to the end of the file wherever it is.
+   */
+
+  rpmsgfs_ra_drop(fs, hf);
+  if ((hf->oflags & O_APPEND) == 0)
+    {
+      ret = rpmsgfs_seekto(fs, hf, filep->f_pos);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+    }
+
   /* Call the host to perform the write */
 
   ret = rpmsgfs_client_write(fs->handle, hf->fd, buffer, buflen);
@@ -567,8 +842,11 @@ static ssize_t rpmsgfs_write(FAR struct file *filep, const char *buffer,
       filep->f_pos += ret;
     }
 
+  hf->rpos = ret < 0 || (hf->oflags & O_APPEND) != 0 ? -1 : filep->f_pos;
+  rpmsgfs_touch(fs, hf);
+
 errout_with_lock:
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -597,21 +875,48 @@ static off_t rpmsgfs_seek(FAR struct file *filep, off_t offset, int whence)
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
     }
 
-  /* Call our internal routine to perform the seek */
+  /* Positions relative to the start or the current position are only
+   * recorded here.  The remote position follows before the next read or
+   * write.
+   */
 
-  ret = rpmsgfs_client_lseek(fs->handle, hf->fd, offset, whence);
-  if (ret >= 0)
+  switch (whence)
     {
-      filep->f_pos = ret;
+      case SEEK_CUR:
+        offset += filep->f_pos;
+
+        /* Fall through */
+
+      case SEEK_SET:
+        if (offset >= 0)
+          {
+            filep->f_pos = offset;
+            ret = offset;
+          }
+        else
+          {
+            ret = -EINVAL;
+          }
+        break;
+
+      default:
+        rpmsgfs_ra_drop(fs, hf);
+        ret = rpmsgfs_client_lseek(fs->handle, hf->fd, offset, whence);
+        hf->rpos = ret < 0 ? -1 : ret;
+        if (ret >= 0)
+          {
+            filep->f_pos = ret;
+          }
+        break;
     }
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -640,12 +945,16 @@ static int rpmsgfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
     }
 
+  /* The ioctl may change the file behind the read-ahead data */
+
+  rpmsgfs_ra_drop(fs, hf);
+
   /* Call our internal routine to perform the ioctl */
 
   ret = rpmsgfs_client_ioctl(fs->handle, hf->fd, cmd, arg);
@@ -654,7 +963,7 @@ static int rpmsgfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       ret = -ENOTTY;
     }
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -687,7 +996,7 @@ static int rpmsgfs_sync(FAR struct file *filep)
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -695,7 +1004,7 @@ static int rpmsgfs_sync(FAR struct file *filep)
 
   rpmsgfs_client_sync(fs->handle, hf->fd);
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return OK;
 }
 
@@ -761,7 +1070,7 @@ static int rpmsgfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -771,7 +1080,7 @@ static int rpmsgfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
 
   ret = rpmsgfs_client_fstat(fs->handle, hf->fd, buf);
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -807,7 +1116,7 @@ static int rpmsgfs_fchstat(FAR const struct file *filep,
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -816,8 +1125,9 @@ static int rpmsgfs_fchstat(FAR const struct file *filep,
   /* Call the host to perform the change */
 
   ret = rpmsgfs_client_fchstat(fs->handle, hf->fd, buf, flags);
+  rpmsgfs_touch(fs, hf);
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -848,7 +1158,7 @@ static int rpmsgfs_truncate(FAR struct file *filep, off_t length)
 
   /* Take the lock */
 
-  ret = nxmutex_lock(&fs->fs_lock);
+  ret = nxmutex_lock(&hf->lock);
   if (ret < 0)
     {
       return ret;
@@ -856,9 +1166,11 @@ static int rpmsgfs_truncate(FAR struct file *filep, off_t length)
 
   /* Call the host to perform the truncate */
 
+  rpmsgfs_ra_drop(fs, hf);
   ret = rpmsgfs_client_ftruncate(fs->handle, hf->fd, length);
+  rpmsgfs_touch(fs, hf);
 
-  nxmutex_unlock(&fs->fs_lock);
+  nxmutex_unlock(&hf->lock);
   return ret;
 }
 
@@ -906,6 +1218,17 @@ static int rpmsgfs_opendir(FAR struct inode *mountpt,
       goto errout_with_rdir;
     }
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  /* Replay the last listing if it is of this directory and recent
+   * enough, otherwise record this one as it is read.
+   */
+
+  if (fs_metacache_opendir(&fs->fs_cache, &rdir->cache, relpath))
+    {
+      goto out;
+    }
+#endif
+
   /* Append to the host's root directory */
 
   rpmsgfs_mkpath(fs, relpath, path, PATH_MAX);
@@ -919,12 +1242,19 @@ static int rpmsgfs_opendir(FAR struct inode *mountpt,
       goto errout_with_lock;
     }
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+out:
+#endif
+
   *dir = (FAR struct fs_dirent_s *)rdir;
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
   return OK;
 
 errout_with_lock:
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  fs_metacache_closedir(&fs->fs_cache, &rdir->cache);
+#endif
   nxmutex_unlock(&fs->fs_lock);
 
 errout_with_rdir:
@@ -966,7 +1296,18 @@ static int rpmsgfs_closedir(FAR struct inode *mountpt,
 
   /* Call the host's closedir function */
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  if (rdir->dir != NULL)
+    {
+      rpmsgfs_client_closedir(fs->handle, rdir->dir);
+    }
+
+  /* Keep a complete listing for the next opendir() of the directory */
+
+  fs_metacache_closedir(&fs->fs_cache, &rdir->cache);
+#else
   rpmsgfs_client_closedir(fs->handle, rdir->dir);
+#endif
 
   nxmutex_unlock(&fs->fs_lock);
   fs_heap_free(rdir);
@@ -1005,10 +1346,25 @@ static int rpmsgfs_readdir(FAR struct inode *mountpt,
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  if (rdir->cache.replay)
+    {
+      /* Replay the cached listing */
+
+      ret = fs_metacache_readdir(&rdir->cache, entry);
+      nxmutex_unlock(&fs->fs_lock);
+      return ret;
+    }
+#endif
+
   /* Call the host OS's readdir function */
 
   ret = rpmsgfs_client_readdir(fs->handle, rdir->dir, entry);
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  fs_metacache_record(&fs->fs_cache, &rdir->cache, entry, ret);
+#endif
+
   nxmutex_unlock(&fs->fs_lock);
   return ret;
 }
@@ -1044,6 +1400,15 @@ static int rpmsgfs_rewinddir(FAR struct inode *mountpt,
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  fs_metacache_rewinddir(&rdir->cache);
+  if (rdir->cache.replay)
+    {
+      nxmutex_unlock(&fs->fs_lock);
+      return OK;
+    }
+#endif
+
   /* Call the host and let it do all the work */
 
   rpmsgfs_client_rewinddir(fs->handle, rdir->dir);
@@ -1144,6 +1509,14 @@ static int rpmsgfs_bind(FAR struct inode *blkdriver, FAR const void *data,
    */
 
   fs->fs_head = NULL;
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  fs_metacache_init(&fs->fs_cache, fs->fs_attr,
+                    CONFIG_FS_RPMSGFS_ATTR_NENTRIES,
+                    CONFIG_FS_RPMSGFS_ATTR_TTL,
+                    CONFIG_FS_RPMSGFS_DIRCACHE_SIZE);
+#elif CONFIG_FS_RPMSGFS_READAHEAD > 0
+  fs_metacache_init(&fs->fs_cache, NULL, 0, 0, 0);
+#endif
 
   /* Now perform the mount.  */
 
@@ -1213,6 +1586,10 @@ static int rpmsgfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
       return ret;
     }
 
+#ifdef RPMSGFS_METACACHE
+  fs_metacache_uninit(&fs->fs_cache);
+#endif
+
   nxmutex_destroy(&fs->fs_lock);
   fs_heap_free(fs);
   return 0;
@@ -1292,6 +1669,7 @@ static int rpmsgfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host fs to perform the unlink */
 
   ret = rpmsgfs_client_unlink(fs->handle, path);
+  rpmsgfs_invalidate_path(fs, relpath);
 
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
@@ -1340,6 +1718,7 @@ static int rpmsgfs_mkdir(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the mkdir */
 
   ret = rpmsgfs_client_mkdir(fs->handle, path, mode);
+  rpmsgfs_invalidate_path(fs, relpath);
 
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
@@ -1389,6 +1768,7 @@ int rpmsgfs_rmdir(FAR struct inode *mountpt, FAR const char *relpath)
   /* Call the host FS to do the mkdir */
 
   ret = rpmsgfs_client_rmdir(fs->handle, path);
+  rpmsgfs_invalidate_path(fs, relpath);
 
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
@@ -1406,6 +1786,10 @@ int rpmsgfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
                    FAR const char *newrelpath)
 {
   FAR struct rpmsgfs_mountpt_s *fs;
+#ifdef RPMSGFS_METACACHE
+  FAR struct rpmsgfs_ofile_s *hf;
+  uint32_t oldkey;
+#endif
   FAR char *oldpath;
   FAR char *newpath;
   int ret;
@@ -1448,7 +1832,25 @@ int rpmsgfs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
 
   /* Call the host FS to do the mkdir */
 
+  /* Everything below a renamed directory moves, so all the cached results
+   * are dropped.  The open files of the renamed path follow it.
+   */
+
   ret = rpmsgfs_client_rename(fs->handle, oldpath, newpath);
+  rpmsgfs_invalidate(fs);
+#ifdef RPMSGFS_METACACHE
+  if (ret >= 0)
+    {
+      oldkey = fs_metacache_key(oldrelpath);
+      for (hf = fs->fs_head; hf != NULL; hf = hf->fnext)
+        {
+          if (hf->key == oldkey)
+            {
+              hf->key = fs_metacache_key(newrelpath);
+            }
+        }
+    }
+#endif
 
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(oldpath);
@@ -1469,6 +1871,10 @@ static int rpmsgfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   FAR struct rpmsgfs_mountpt_s *fs;
   FAR char *path;
   int ret;
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  FAR const struct stat *attr;
+  int32_t gen;
+#endif
 
   /* Sanity checks */
 
@@ -1491,6 +1897,19 @@ static int rpmsgfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
       return ret;
     }
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  /* Return the cached result if it is recent enough */
+
+  attr = fs_metacache_getattr(&fs->fs_cache, relpath);
+  if (attr != NULL)
+    {
+      *buf = *attr;
+      goto out;
+    }
+
+  gen = fs_metacache_gen(&fs->fs_cache, fs_metacache_key(relpath));
+#endif
+
   /* Append to the host's root directory */
 
   rpmsgfs_mkpath(fs, relpath, path, PATH_MAX);
@@ -1499,6 +1918,14 @@ static int rpmsgfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
   ret = rpmsgfs_client_stat(fs->handle, path, buf);
 
+#if CONFIG_FS_RPMSGFS_ATTR_TTL > 0
+  if (ret >= 0)
+    {
+      fs_metacache_setattr(&fs->fs_cache, relpath, gen, buf);
+    }
+
+out:
+#endif
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
   return ret;
@@ -1546,6 +1973,7 @@ static int rpmsgfs_chstat(FAR struct inode *mountpt, FAR const char *relpath,
   /* Call the host FS to do the chstat operation */
 
   ret = rpmsgfs_client_chstat(fs->handle, path, buf, flags);
+  rpmsgfs_invalidate_path(fs, relpath);
 
   nxmutex_unlock(&fs->fs_lock);
   lib_put_pathbuffer(path);
@@ -225,6 +225,9 @@ int       rpmsgfs_client_open(FAR void *handle,
 int       rpmsgfs_client_close(FAR void *handle, int fd);
 ssize_t   rpmsgfs_client_read(FAR void *handle, int fd,
                               FAR void *buf, size_t count);
+FAR void *rpmsgfs_client_read_async(FAR void *handle, int fd,
+                                    FAR void *buf, size_t count);
+ssize_t   rpmsgfs_client_read_wait(FAR void *handle, FAR void *req);
 ssize_t   rpmsgfs_client_write(FAR void *handle, int fd,
                                FAR const void *buf, size_t count);
 off_t     rpmsgfs_client_lseek(FAR void *handle, int fd,
@@ -58,6 +58,14 @@ struct rpmsgfs_cookie_s
   FAR void *data;
 };
 
+/* A read request that is left in flight, see rpmsgfs_client_read_async() */
+
+struct rpmsgfs_aread_s
+{
+  struct rpmsgfs_cookie_s cookie;
+  struct iovec            read;
+};
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -509,6 +517,66 @@ out:
   return read.iov_len > 0 ? read.iov_len : ret;
 }
 
+FAR void *rpmsgfs_client_read_async(FAR void *handle, int fd,
+                                    FAR void *buf, size_t count)
+{
+  FAR struct rpmsgfs_s *priv = handle;
+  FAR struct rpmsgfs_aread_s *req;
+  struct rpmsgfs_read_s msg;
+
+  if (!buf || count <= 0)
+    {
+      return NULL;
+    }
+
+  req = fs_heap_zalloc(sizeof(*req));
+  if (req == NULL)
+    {
+      return NULL;
+    }
+
+  nxsem_init(&req->cookie.sem, 0, 0);
+  req->read.iov_base = buf;
+  req->cookie.data   = &req->read;
+
+  msg.header.command = RPMSGFS_READ;
+  msg.header.result  = -ENXIO;
+  msg.header.cookie  = (uintptr_t)&req->cookie;
+  msg.fd             = fd;
+  msg.count          = count;
+
+  if (rpmsg_send(&priv->ept, &msg, sizeof(msg)) < 0)
+    {
+      nxsem_destroy(&req->cookie.sem);
+      fs_heap_free(req);
+      return NULL;
+    }
+
+  return req;
+}
+
+ssize_t rpmsgfs_client_read_wait(FAR void *handle, FAR void *req_)
+{
+  FAR struct rpmsgfs_s *priv = handle;
+  FAR struct rpmsgfs_aread_s *req = req_;
+  ssize_t ret;
+
+  ret = rpmsg_wait(&priv->ept, &req->cookie.sem);
+  if (ret >= 0)
+    {
+      ret = req->cookie.result;
+    }
+
+  if (req->read.iov_len > 0)
+    {
+      ret = req->read.iov_len;
+    }
+
+  nxsem_destroy(&req->cookie.sem);
+  fs_heap_free(req);
+  return ret;
+}
+
 ssize_t rpmsgfs_client_write(FAR void *handle, int fd,
                              FAR const void *buf, size_t count)
 {
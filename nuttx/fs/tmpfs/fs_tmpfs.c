@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <stdint.h>
@@ -54,8 +55,8 @@
 #  warning CONFIG_FS_TMPFS_DIRECTORY_FREEGUARD needs to be > ALLOCGUARD
 #endif
 
-#if CONFIG_FS_TMPFS_FILE_FREEGUARD <= CONFIG_FS_TMPFS_FILE_ALLOCGUARD
-#  warning CONFIG_FS_TMPFS_FILE_FREEGUARD needs to be > ALLOCGUARD
+#if (CONFIG_FS_TMPFS_PAGESIZE & (CONFIG_FS_TMPFS_PAGESIZE - 1)) != 0
+#  error CONFIG_FS_TMPFS_PAGESIZE must be a power of two
 #endif
 
 #define tmpfs_lock(fs) \
@@ -94,8 +95,22 @@ struct tmpfs_dir_s
 
 static int  tmpfs_realloc_directory(FAR struct tmpfs_directory_s *tdo,
               unsigned int nentries);
+static FAR struct tmpfs_block_s *
+tmpfs_find_block(FAR struct tmpfs_file_s *tfo, FAR const uint8_t *addr);
+static void tmpfs_put_block(FAR struct tmpfs_file_s *tfo,
+              FAR struct tmpfs_block_s *tb);
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+              size_t index);
+static void tmpfs_free_page(FAR struct tmpfs_file_s *tfo, size_t index);
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo);
 static int  tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
               size_t newsize);
+static size_t tmpfs_read_pages(FAR struct tmpfs_file_s *tfo,
+              FAR uint8_t *buffer, size_t offset, size_t len);
+static ssize_t tmpfs_write_pages(FAR struct tmpfs_file_s *tfo,
+              FAR const uint8_t *buffer, size_t offset, size_t len);
+static int  tmpfs_map_block(FAR struct tmpfs_file_s *tfo, size_t first,
+              size_t npages, FAR struct tmpfs_block_s **block);
 static void tmpfs_release_lockedobject(FAR struct tmpfs_object_s *to);
 static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo);
 static int  tmpfs_release_file(FAR struct tmpfs_file_s *tfo);
@@ -268,81 +283,431 @@ static int tmpfs_realloc_directory(FAR struct tmpfs_directory_s *tdo,
   return ret;
 }
 
+/****************************************************************************
+ * Name: tmpfs_find_block
+ *
+ * Description:
+ *   Return the contiguous page block that contains the address, or NULL if
+ *   the address belongs to an individually allocated page.
+ *
+ ****************************************************************************/
+
+static FAR struct tmpfs_block_s *
+tmpfs_find_block(FAR struct tmpfs_file_s *tfo, FAR const uint8_t *addr)
+{
+  FAR struct tmpfs_block_s *tb;
+  FAR uint8_t *data;
+
+  for (tb = tfo->tfo_blocks; tb != NULL; tb = tb->tb_flink)
+    {
+      data = TMPFS_BLOCK_DATA(tb);
+      if (addr >= data && addr < data + tb->tb_npages * TMPFS_PAGESIZE)
+        {
+          return tb;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: tmpfs_put_block
+ *
+ * Description:
+ *   Free the page block if neither the page table nor any mapping refers
+ *   to it any longer.
+ *
+ ****************************************************************************/
+
+static void tmpfs_put_block(FAR struct tmpfs_file_s *tfo,
+                            FAR struct tmpfs_block_s *tb)
+{
+  FAR struct tmpfs_block_s **pprev;
+
+  if (tb->tb_used > 0 || tb->tb_maps > 0)
+    {
+      return;
+    }
+
+  pprev = &tfo->tfo_blocks;
+  while (*pprev != tb)
+    {
+      pprev = &(*pprev)->tb_flink;
+    }
+
+  *pprev          = tb->tb_flink;
+  tfo->tfo_alloc -= tb->tb_npages * TMPFS_PAGESIZE;
+  fs_heap_free(tb);
+}
+
+/****************************************************************************
+ * Name: tmpfs_get_page
+ *
+ * Description:
+ *   Return the page at the index of the page table, allocating a zeroed
+ *   page if the index is still a hole.
+ *
+ ****************************************************************************/
+
+static FAR uint8_t *tmpfs_get_page(FAR struct tmpfs_file_s *tfo,
+                                   size_t index)
+{
+  FAR uint8_t *page;
+
+  DEBUGASSERT(index < tfo->tfo_npages);
+
+  page = tfo->tfo_pages[index];
+  if (page == NULL)
+    {
+      page = fs_heap_zalloc(TMPFS_PAGESIZE);
+      if (page != NULL)
+        {
+          tfo->tfo_pages[index] = page;
+          tfo->tfo_alloc       += TMPFS_PAGESIZE;
+        }
+    }
+
+  return page;
+}
+
+/****************************************************************************
+ * Name: tmpfs_free_page
+ *
+ * Description:
+ *   Remove the page at the index from the page table, turning it into a
+ *   hole.  Pages that are part of a block are released with the block.
+ *
+ ****************************************************************************/
+
+static void tmpfs_free_page(FAR struct tmpfs_file_s *tfo, size_t index)
+{
+  FAR struct tmpfs_block_s *tb;
+  FAR uint8_t *page;
+
+  page = tfo->tfo_pages[index];
+  if (page == NULL)
+    {
+      return;
+    }
+
+  tfo->tfo_pages[index] = NULL;
+
+  tb = tmpfs_find_block(tfo, page);
+  if (tb != NULL)
+    {
+      tb->tb_used--;
+      tmpfs_put_block(tfo, tb);
+    }
+  else
+    {
+      tfo->tfo_alloc -= TMPFS_PAGESIZE;
+      fs_heap_free(page);
+    }
+}
+
+/****************************************************************************
+ * Name: tmpfs_free_data
+ *
+ * Description:
+ *   Free all the data of a file object that is being destroyed.
+ *
+ ****************************************************************************/
+
+static void tmpfs_free_data(FAR struct tmpfs_file_s *tfo)
+{
+  FAR struct tmpfs_block_s *tb;
+  FAR uint8_t *page;
+  size_t i;
+
+  for (i = 0; i < tfo->tfo_npages; i++)
+    {
+      page = tfo->tfo_pages[i];
+      if (page != NULL && tmpfs_find_block(tfo, page) == NULL)
+        {
+          fs_heap_free(page);
+        }
+    }
+
+  while ((tb = tfo->tfo_blocks) != NULL)
+    {
+      tfo->tfo_blocks = tb->tb_flink;
+      fs_heap_free(tb);
+    }
+
+  fs_heap_free(tfo->tfo_pages);
+  tfo->tfo_pages  = NULL;
+  tfo->tfo_xip    = NULL;
+  tfo->tfo_npages = 0;
+  tfo->tfo_alloc  = 0;
+  tfo->tfo_size   = 0;
+}
+
 /****************************************************************************
  * Name: tmpfs_realloc_file
+ *
+ * Description:
+ *   Change the size of the file.  Growing the file only extends the page
+ *   table with holes, pages are allocated when they are first written.
+ *   Shrinking frees the pages past the new end of the file.  The existing
+ *   data is never moved.
+ *
  ****************************************************************************/
 
 static int tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
                               size_t newsize)
 {
-  FAR uint8_t *newdata;
-  size_t allocsize;
-  size_t delta;
-
-  /* Are we growing or shrinking the object? */
+  FAR uint8_t **newpages;
+  size_t npages;
+  size_t count;
+  size_t tail;
+  size_t i;
 
-  if (newsize <= tfo->tfo_alloc)
+  npages = TMPFS_NPAGES(newsize);
+  if (npages > tfo->tfo_npages)
     {
-      /* Shrinking ... Shrink unconditionally if the size is shrinking to
-       * zero.
+      /* Double the page table so that appending to a file only costs an
+       * amortized constant time.  The new entries are holes.
        */
 
-      if (newsize == 0)
+      count = MAX(npages, tfo->tfo_npages * 2);
+      if (count > SIZE_MAX / sizeof(FAR uint8_t *))
         {
-          /* Free the file object */
+          return -ENOMEM;
+        }
 
-          fs_heap_free(tfo->tfo_data);
-          tfo->tfo_data = NULL;
-          tfo->tfo_alloc = 0;
-          tfo->tfo_size = 0;
-          return OK;
+      newpages = fs_heap_realloc(tfo->tfo_pages,
+                                 count * sizeof(FAR uint8_t *));
+      if (newpages == NULL)
+        {
+          return -ENOMEM;
         }
-      else if (newsize > 0)
+
+      memset(&newpages[tfo->tfo_npages], 0,
+             (count - tfo->tfo_npages) * sizeof(FAR uint8_t *));
+
+      tfo->tfo_pages  = newpages;
+      tfo->tfo_npages = count;
+    }
+  else if (newsize < tfo->tfo_size)
+    {
+      /* Free the pages past the new end of the file */
+
+      for (i = npages; i < TMPFS_NPAGES(tfo->tfo_size); i++)
         {
-          /* Otherwise, don't realloc unless the object has shrunk by a
-           * lot.
-           */
+          tmpfs_free_page(tfo, i);
+        }
+
+      /* We should make sure the remainder of the last page is zero, it
+       * becomes visible again if the file is extended.
+       */
 
-          delta = tfo->tfo_alloc - newsize;
+      tail = newsize % TMPFS_PAGESIZE;
+      if (tail > 0 && tfo->tfo_pages[npages - 1] != NULL)
+        {
+          memset(tfo->tfo_pages[npages - 1] + tail, 0,
+                 TMPFS_PAGESIZE - tail);
+        }
 
-          /* We should make sure the shrunked memory be zero */
+      /* Don't realloc the page table unless it has shrunk by a lot */
 
-          memset(tfo->tfo_data + newsize, 0, delta);
-          if (delta <= CONFIG_FS_TMPFS_FILE_FREEGUARD)
+      if (npages == 0)
+        {
+          fs_heap_free(tfo->tfo_pages);
+          tfo->tfo_pages  = NULL;
+          tfo->tfo_npages = 0;
+        }
+      else if (npages < tfo->tfo_npages / 4)
+        {
+          newpages = fs_heap_realloc(tfo->tfo_pages,
+                                     npages * sizeof(FAR uint8_t *));
+          if (newpages != NULL)
             {
-              /* Hasn't shrunk enough.. Return doing nothing for now */
+              tfo->tfo_pages  = newpages;
+              tfo->tfo_npages = npages;
+            }
+        }
+    }
+
+  tfo->tfo_size = newsize;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tmpfs_read_pages
+ *
+ * Description:
+ *   Copy file data to the buffer.  The range must lie within the file.
+ *
+ ****************************************************************************/
+
+static size_t tmpfs_read_pages(FAR struct tmpfs_file_s *tfo,
+                               FAR uint8_t *buffer, size_t offset,
+                               size_t len)
+{
+  FAR const uint8_t *page;
+  size_t pgoff;
+  size_t nbytes;
+  size_t ncopied = 0;
+
+  while (ncopied < len)
+    {
+      page   = tfo->tfo_pages[offset / TMPFS_PAGESIZE];
+      pgoff  = offset % TMPFS_PAGESIZE;
+      nbytes = MIN(len - ncopied, TMPFS_PAGESIZE - pgoff);
+
+      if (page != NULL)
+        {
+          memcpy(buffer + ncopied, page + pgoff, nbytes);
+        }
+      else
+        {
+          memset(buffer + ncopied, 0, nbytes);
+        }
 
-              tfo->tfo_size = newsize;
-              return OK;
+      offset  += nbytes;
+      ncopied += nbytes;
+    }
+
+  return ncopied;
+}
+
+/****************************************************************************
+ * Name: tmpfs_write_pages
+ *
+ * Description:
+ *   Copy the buffer to the file data, allocating pages for the holes.  The
+ *   page table must already cover the range.  Returns the number of bytes
+ *   copied, or -ENOMEM if not even the first page could be allocated.
+ *
+ ****************************************************************************/
+
+static ssize_t tmpfs_write_pages(FAR struct tmpfs_file_s *tfo,
+                                 FAR const uint8_t *buffer, size_t offset,
+                                 size_t len)
+{
+  FAR uint8_t *page;
+  size_t pgoff;
+  size_t nbytes;
+  size_t ncopied = 0;
+
+  while (ncopied < len)
+    {
+      page = tmpfs_get_page(tfo, offset / TMPFS_PAGESIZE);
+      if (page == NULL)
+        {
+          return ncopied > 0 ? (ssize_t)ncopied : -ENOMEM;
+        }
+
+      pgoff  = offset % TMPFS_PAGESIZE;
+      nbytes = MIN(len - ncopied, TMPFS_PAGESIZE - pgoff);
+      memcpy(page + pgoff, buffer + ncopied, nbytes);
+
+      offset  += nbytes;
+      ncopied += nbytes;
+    }
+
+  return ncopied;
+}
+
+/****************************************************************************
+ * Name: tmpfs_map_block
+ *
+ * Description:
+ *   Return a block holding the pages [first, first + npages) contiguously,
+ *   as needed to map them.  If the pages are already adjacent in a block
+ *   that block is shared, otherwise they are gathered into a new block and
+ *   the page table is pointed at it, so that file I/O and all mappings of
+ *   the range keep seeing the same memory.
+ *
+ *   Pages of a block that is mapped (or pinned by FIOC_XIPBASE) are never
+ *   moved, as the existing users would no longer see the file data;
+ *   -EBUSY is returned if the range could only be mapped that way.
+ *
+ ****************************************************************************/
+
+static int tmpfs_map_block(FAR struct tmpfs_file_s *tfo, size_t first,
+                           size_t npages, FAR struct tmpfs_block_s **block)
+{
+  FAR struct tmpfs_block_s *tb;
+  FAR uint8_t *page;
+  FAR uint8_t *data;
+  size_t i;
+
+  DEBUGASSERT(npages > 0 && first + npages <= tfo->tfo_npages);
+
+  /* Are the pages already contiguous? */
+
+  page = tfo->tfo_pages[first];
+  if (page != NULL && (tb = tmpfs_find_block(tfo, page)) != NULL)
+    {
+      data = TMPFS_BLOCK_DATA(tb) + tb->tb_npages * TMPFS_PAGESIZE;
+      for (i = 1; i < npages; i++)
+        {
+          if (page + i * TMPFS_PAGESIZE >= data ||
+              tfo->tfo_pages[first + i] != page + i * TMPFS_PAGESIZE)
+            {
+              break;
             }
         }
+
+      if (i == npages)
+        {
+          *block = tb;
+          return OK;
+        }
     }
 
-  /* Added some additional amount to the new size to account frequent
-   * reallocations.
+  /* No.. gather them into a new block, unless that would pull pages out
+   * from under a mapping.
    */
 
-  allocsize = newsize + CONFIG_FS_TMPFS_FILE_ALLOCGUARD;
-  if (allocsize < newsize)
+  for (i = 0; i < npages; i++)
     {
-      /* There must have been an integer overflow */
+      page = tfo->tfo_pages[first + i];
+      if (page != NULL && (tb = tmpfs_find_block(tfo, page)) != NULL &&
+          tb->tb_maps > 0)
+        {
+          return -EBUSY;
+        }
+    }
 
+  if (npages > (SIZE_MAX - sizeof(struct tmpfs_block_s)) / TMPFS_PAGESIZE)
+    {
       return -ENOMEM;
     }
 
-  /* Realloc the file object */
-
-  newdata = fs_heap_realloc(tfo->tfo_data, allocsize);
-  if (newdata == NULL)
+  tb = fs_heap_malloc(sizeof(struct tmpfs_block_s) +
+                      npages * TMPFS_PAGESIZE);
+  if (tb == NULL)
     {
       return -ENOMEM;
     }
 
-  /* Return the new address of the reallocated file object */
+  tb->tb_npages = npages;
+  tb->tb_used   = npages;
+  tb->tb_maps   = 0;
+
+  data = TMPFS_BLOCK_DATA(tb);
+  for (i = 0; i < npages; i++, data += TMPFS_PAGESIZE)
+    {
+      page = tfo->tfo_pages[first + i];
+      if (page != NULL)
+        {
+          memcpy(data, page, TMPFS_PAGESIZE);
+          tmpfs_free_page(tfo, first + i);
+        }
+      else
+        {
+          memset(data, 0, TMPFS_PAGESIZE);
+        }
+
+      tfo->tfo_pages[first + i] = data;
+    }
 
-  tfo->tfo_alloc = allocsize;
-  tfo->tfo_size  = newsize;
-  tfo->tfo_data  = newdata;
+  tb->tb_flink     = tfo->tfo_blocks;
+  tfo->tfo_blocks  = tb;
+  tfo->tfo_alloc  += npages * TMPFS_PAGESIZE;
+  *block           = tb;
   return OK;
 }
 
@@ -383,7 +748,7 @@ static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo)
     {
       tmpfs_unlock_file(tfo);
       nxrmutex_destroy(&tfo->tfo_lock);
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       fs_heap_free(tfo);
     }
 
@@ -582,7 +947,10 @@ tmpfs_alloc_file(FAR struct tmpfs_directory_s *parent)
   tfo->tfo_parent = parent;
   tfo->tfo_flags  = 0;
   tfo->tfo_size   = 0;
-  tfo->tfo_data   = NULL;
+  tfo->tfo_npages = 0;
+  tfo->tfo_pages  = NULL;
+  tfo->tfo_blocks = NULL;
+  tfo->tfo_xip    = NULL;
 
   nxrmutex_init(&tfo->tfo_lock);
   tmpfs_lock_file(tfo);
@@ -1189,7 +1557,11 @@ static int tmpfs_statfs_callout(FAR struct tmpfs_directory_s *tdo,
 
       tmptfo             = (FAR struct tmpfs_file_s *)to;
       tmpbuf->tsf_alloc += sizeof(struct tmpfs_file_s);
-      tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+      if (to->to_alloc > tmptfo->tfo_size)
+        {
+          tmpbuf->tsf_avail += to->to_alloc - tmptfo->tfo_size;
+        }
+
       tmpbuf->tsf_files++;
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
@@ -1265,7 +1637,7 @@ static int tmpfs_free_callout(FAR struct tmpfs_directory_s *tdo,
           return TMPFS_UNLINKED;
         }
 
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
     }
   else /* if (to->to_type == TMPFS_DIRECTORY) */
     {
@@ -1586,15 +1958,8 @@ static ssize_t tmpfs_read(FAR struct file *filep, FAR char *buffer,
 
   /* Copy data from the memory object to the user buffer */
 
-  if (tfo->tfo_data != NULL)
-    {
-      memcpy(buffer, &tfo->tfo_data[startpos], nread);
-      filep->f_pos += nread;
-    }
-  else
-    {
-      DEBUGASSERT(tfo->tfo_size == 0 && nread == 0);
-    }
+  tmpfs_read_pages(tfo, (FAR uint8_t *)buffer, startpos, nread);
+  filep->f_pos += nread;
 
   /* Release the lock on the file */
 
@@ -1611,6 +1976,7 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
 {
   FAR struct tmpfs_file_s *tfo;
   ssize_t nwritten;
+  size_t oldsize;
   off_t startpos;
   off_t endpos;
   int ret;
@@ -1642,12 +2008,12 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
       startpos = filep->f_pos;
     }
 
-  nwritten = buflen;
-  endpos   = startpos + buflen;
+  oldsize = tfo->tfo_size;
+  endpos  = startpos + buflen;
 
-  if (endpos > tfo->tfo_size)
+  if (endpos > oldsize)
     {
-      /* Reallocate the file to handle the write past the end of the file. */
+      /* Extend the file to handle the write past the end of the file. */
 
       ret = tmpfs_realloc_file(tfo, (size_t)endpos);
       if (ret < 0)
@@ -1656,15 +2022,23 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
         }
     }
 
-  /* Copy data from the memory object to the user buffer */
+  /* Copy data from the user buffer to the memory object */
 
-  if (tfo->tfo_data != NULL)
+  nwritten = tmpfs_write_pages(tfo, (FAR const uint8_t *)buffer,
+                               startpos, buflen);
+  if (nwritten < 0)
     {
-      memcpy(&tfo->tfo_data[startpos], buffer, nwritten);
+      ret = nwritten;
+      tmpfs_realloc_file(tfo, oldsize);
+      goto errout_with_lock;
     }
-  else
+
+  /* Trim the file again if we ran out of memory part way through */
+
+  endpos = startpos + nwritten;
+  if (endpos < tfo->tfo_size)
     {
-      DEBUGASSERT(tfo->tfo_size == 0 && nwritten == 0);
+      tmpfs_realloc_file(tfo, MAX(oldsize, (size_t)endpos));
     }
 
   filep->f_pos = endpos;
@@ -1728,6 +2102,7 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
                        FAR void *start, size_t length)
 {
   FAR struct tmpfs_file_s *tfo = entry->priv.p;
+  FAR struct tmpfs_block_s *tb;
   off_t offset;
   int ret;
 
@@ -1753,20 +2128,31 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
       ret = mm_map_remove(get_group_mm(group), entry);
       if (ret >= 0)
         {
-          ret = tmpfs_release_file(tfo);
+          ret = tmpfs_lock_file(tfo);
+        }
+
+      if (ret >= 0)
+        {
+          /* Drop the mapping's reference on its page block */
+
+          tb = tmpfs_find_block(tfo, entry->vaddr);
+          DEBUGASSERT(tb != NULL && tb->tb_maps > 0);
+
+          tb->tb_maps--;
+          tmpfs_put_block(tfo, tb);
+          tmpfs_release_lockedfile(tfo);
         }
     }
 
   /* No.. We have been asked to "unmap' only a portion of the memory
-   * (offset > 0).
+   * (offset > 0).  The file data is not affected, the pages stay in the
+   * block until the whole mapping goes away.
    */
 
   else
     {
       entry->length = offset;
-      tmpfs_lock_file(tfo);
-      ret = tmpfs_realloc_file(tfo, offset);
-      tmpfs_unlock_file(tfo);
+      ret = OK;
     }
 
   return ret;
@@ -1775,7 +2161,9 @@ static int tmpfs_unmap(FAR struct task_group_s *group,
 static int tmpfs_mmap(FAR struct file *filep, FAR struct mm_map_entry_s *map)
 {
   FAR struct tmpfs_file_s *tfo;
-  int ret = -EINVAL;
+  FAR struct tmpfs_block_s *tb;
+  size_t first;
+  int ret;
 
   DEBUGASSERT(filep->f_priv != NULL);
 
@@ -1785,20 +2173,54 @@ static int tmpfs_mmap(FAR struct file *filep, FAR struct mm_map_entry_s *map)
 
   DEBUGASSERT(tfo != NULL);
 
-  if (map->offset >= 0 && map->offset < tfo->tfo_size &&
-      map->length && map->offset + map->length <= tfo->tfo_size)
+  ret = tmpfs_lock_file(tfo);
+  if (ret < 0)
     {
-      map->vaddr = tfo->tfo_data + map->offset;
-      map->priv.p = tfo;
-      map->munmap = tmpfs_unmap;
-      ret = mm_map_add(get_current_mm(), map);
+      return ret;
+    }
 
-      if (ret >= 0)
-        {
-          tmpfs_lock_file(tfo);
-          tfo->tfo_refs++;
-          tmpfs_unlock_file(tfo);
-        }
+  if (map->offset < 0 || map->offset >= tfo->tfo_size ||
+      map->length == 0 || map->offset + map->length > tfo->tfo_size)
+    {
+      tmpfs_unlock_file(tfo);
+      return -EINVAL;
+    }
+
+  /* Map the file pages in place.  The pages covering the range are
+   * gathered into one contiguous block (unless they already are), which
+   * is then shared by the file and every mapping of the range.
+   */
+
+  first = map->offset / TMPFS_PAGESIZE;
+  ret   = tmpfs_map_block(tfo, first,
+                          TMPFS_NPAGES(map->offset + map->length) - first,
+                          &tb);
+  if (ret < 0)
+    {
+      tmpfs_unlock_file(tfo);
+      return ret;
+    }
+
+  map->vaddr  = tfo->tfo_pages[first] + map->offset % TMPFS_PAGESIZE;
+  map->priv.p = tfo;
+  map->munmap = tmpfs_unmap;
+
+  /* Hold the block and the file while the mapping exists.  The file lock
+   * is dropped before calling into the mapping list, munmap() takes the
+   * locks in the opposite order.
+   */
+
+  tb->tb_maps++;
+  tfo->tfo_refs++;
+  tmpfs_unlock_file(tfo);
+
+  ret = mm_map_add(get_current_mm(), map);
+  if (ret < 0)
+    {
+      tmpfs_lock_file(tfo);
+      tb->tb_maps--;
+      tmpfs_put_block(tfo, tb);
+      tmpfs_release_lockedfile(tfo);
     }
 
   return ret;
@@ -1841,9 +2263,38 @@ static int tmpfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
   else if (cmd == FIOC_XIPBASE)
     {
       FAR uintptr_t *ptr = (FAR uintptr_t *)arg;
+      FAR struct tmpfs_block_s *tb;
+
+      /* XIP needs the whole file in one piece */
+
+      ret = tmpfs_lock_file(tfo);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      *ptr = 0;
+      if (tfo->tfo_size > 0)
+        {
+          ret = tmpfs_map_block(tfo, 0, TMPFS_NPAGES(tfo->tfo_size), &tb);
+          if (ret >= 0)
+            {
+              /* There is no way to tell when the XIP user is done with
+               * the address, so the block stays pinned for the lifetime
+               * of the file.
+               */
+
+              if (tb != tfo->tfo_xip)
+                {
+                  tb->tb_maps++;
+                  tfo->tfo_xip = tb;
+                }
+
+              *ptr = (uintptr_t)tfo->tfo_pages[0];
+            }
+        }
 
-      *ptr = (uintptr_t)tfo->tfo_data;
-      return OK;
+      tmpfs_unlock_file(tfo);
     }
 
   return ret;
@@ -1976,15 +2427,10 @@ static int tmpfs_truncate(FAR struct file *filep, off_t length)
           goto errout_with_lock;
         }
 
-      /* If the size has increased, then we need to zero the newly added
-       * memory.
+      /* If the size has increased, the newly added pages are holes and
+       * read as zero.
        */
 
-      if (length > oldsize)
-        {
-          memset(&tfo->tfo_data[oldsize], 0, length - oldsize);
-        }
-
       ret = OK;
     }
 
@@ -2426,7 +2872,7 @@ static int tmpfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
   else
     {
       nxrmutex_destroy(&tfo->tfo_lock);
-      fs_heap_free(tfo->tfo_data);
+      tmpfs_free_data(tfo);
       fs_heap_free(tfo);
     }
 
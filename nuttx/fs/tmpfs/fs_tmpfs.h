@@ -42,6 +42,11 @@
 
 #define TFO_FLAG_UNLINKED (1 << 0)  /* Bit 0: File is unlinked */
 
+/* File data is kept in fixed size pages */
+
+#define TMPFS_PAGESIZE    CONFIG_FS_TMPFS_PAGESIZE
+#define TMPFS_NPAGES(n)   (((n) + TMPFS_PAGESIZE - 1) / TMPFS_PAGESIZE)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -105,6 +110,23 @@ struct tmpfs_directory_s
 
 #define SIZEOF_TMPFS_DIRECTORY(n) ((n) * sizeof(struct tmpfs_dirent_s))
 
+/* A run of physically contiguous file pages.  Pages are normally
+ * allocated one at a time;  blocks are only created when a contiguous view
+ * of the file data is needed (mmap() or FIOC_XIPBASE).  The page data
+ * immediately follows this header.  A block is freed when no page table
+ * entry and no mapping refers to it any longer.
+ */
+
+struct tmpfs_block_s
+{
+  FAR struct tmpfs_block_s *tb_flink;   /* Next block of the file */
+  size_t   tb_npages;                   /* Number of pages in the block */
+  size_t   tb_used;                     /* Pages still in the page table */
+  size_t   tb_maps;                     /* Active mappings of the block */
+};
+
+#define TMPFS_BLOCK_DATA(tb) ((FAR uint8_t *)((tb) + 1))
+
 /* The form of a regular file memory object
  *
  * NOTE that in this very simplified implementation, there is no per-open
@@ -119,16 +141,22 @@ struct tmpfs_file_s
 
   rmutex_t tfo_lock;
 
-  size_t   tfo_alloc;    /* Allocated size of the file object */
+  size_t   tfo_alloc;    /* Allocated data size of the file object */
   uint8_t  tfo_type;     /* See enum tmpfs_objtype_e */
   uint8_t  tfo_refs;     /* Reference count */
   FAR struct tmpfs_directory_s *tfo_parent;
 
   /* Remaining fields are unique to a directory object */
 
-  uint8_t       tfo_flags; /* See TFO_FLAG_* definitions */
-  size_t        tfo_size;  /* Valid file size */
-  FAR uint8_t  *tfo_data;  /* File data starts here */
+  uint8_t       tfo_flags;  /* See TFO_FLAG_* definitions */
+  size_t        tfo_size;   /* Valid file size */
+  size_t        tfo_npages; /* Number of entries in the page table */
+  FAR uint8_t **tfo_pages;  /* Page table, NULL entries read as zero */
+
+  /* Contiguous page blocks created for mmap() and FIOC_XIPBASE */
+
+  FAR struct tmpfs_block_s *tfo_blocks;
+  FAR struct tmpfs_block_s *tfo_xip;    /* Block pinned by FIOC_XIPBASE */
 };
 
 /* This structure represents one instance of a TMPFS file system */
@@ -27,6 +27,7 @@
 #include <sys/param.h>
 #include <fcntl.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/semaphore.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
@@ -374,6 +375,17 @@ struct v9fs_fid_s
   char relpath[1];
 };
 
+/* One Tread/Twrite transaction of a pipelined transfer */
+
+struct v9fs_io_s
+{
+  struct v9fs_write_s   request;
+  struct v9fs_rwrite_s  response;
+  struct iovec          wiov[2];
+  struct iovec          riov[2];
+  struct v9fs_payload_s payload;
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -570,6 +582,349 @@ static int v9fs_client_rpc(FAR struct v9fs_transport_s *transport,
   return payload.ret;
 }
 
+/****************************************************************************
+ * v9fs_client_io
+ *
+ * Description:
+ *   Transfer buflen bytes with Tread or Twrite, split into iounit sized
+ *   requests.  Up to CONFIG_V9FS_MAX_INFLIGHT reads are outstanding at any
+ *   time, but writes are sent one at a time: the server may apply
+ *   pipelined writes in any order, so after a short or failed one the
+ *   later chunks could already be in the file, and with O_APPEND they
+ *   could even land before it.  Replies are consumed in order, and the
+ *   transfer stops at the first error or short reply, so the returned
+ *   count always covers a contiguous range starting at offset.
+ *
+ ****************************************************************************/
+
+static ssize_t v9fs_client_io(FAR struct v9fs_client_s *client,
+                              uint32_t fid, uint8_t type, FAR void *buffer,
+                              off_t offset, size_t buflen)
+{
+  struct v9fs_io_s io[CONFIG_V9FS_MAX_INFLIGHT];
+  FAR struct v9fs_fid_s *fidp;
+  FAR struct v9fs_io_s *cur;
+  FAR uint8_t *ptr = buffer;
+  bool stop = false;
+  size_t nio = 0;
+  int inflight = 0;
+  int depth;
+  int head = 0;
+  int ret = 0;
+
+  fidp = idr_find(client->fids, fid);
+  if (fidp == NULL)
+    {
+      return -ENOENT;
+    }
+
+  depth = type == V9FS_TWRITE ? 1 : CONFIG_V9FS_MAX_INFLIGHT;
+  for (; ; )
+    {
+      /* Keep the pipeline full */
+
+      while (!stop && buflen > 0 && inflight < depth)
+        {
+          cur = &io[(head + inflight) % CONFIG_V9FS_MAX_INFLIGHT];
+
+          cur->request.count = MIN(buflen, fidp->iounit);
+          cur->request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ +
+                                     V9FS_BIT64SZ + V9FS_BIT32SZ;
+          cur->request.header.type = type;
+          cur->request.header.tag = v9fs_get_tagid(client);
+          cur->request.fid = fid;
+          cur->request.offset = offset;
+
+          cur->wiov[0].iov_base = &cur->request;
+          cur->wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
+                                 V9FS_BIT32SZ;
+          cur->riov[0].iov_base = &cur->response;
+          cur->riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
+
+          nxsem_init(&cur->payload.resp, 0, 0);
+          cur->payload.wiov = cur->wiov;
+          cur->payload.riov = cur->riov;
+          cur->payload.tag = cur->request.header.tag;
+          cur->payload.ret = -EIO;
+
+          if (type == V9FS_TWRITE)
+            {
+              cur->request.header.size += cur->request.count;
+              cur->wiov[1].iov_base = ptr;
+              cur->wiov[1].iov_len = cur->request.count;
+              cur->payload.wcount = 2;
+              cur->payload.rcount = 1;
+            }
+          else
+            {
+              cur->riov[1].iov_base = ptr;
+              cur->riov[1].iov_len = cur->request.count;
+              cur->payload.wcount = 1;
+              cur->payload.rcount = 2;
+            }
+
+          ret = v9fs_transport_request(client->transport, &cur->payload);
+          if (ret < 0)
+            {
+              nxsem_destroy(&cur->payload.resp);
+              stop = true;
+              break;
+            }
+
+          inflight++;
+          ptr += cur->request.count;
+          offset += cur->request.count;
+          buflen -= cur->request.count;
+        }
+
+      if (inflight == 0)
+        {
+          break;
+        }
+
+      /* Wait for the oldest request.  Everything submitted must complete
+       * before returning, since the requests live on this stack.
+       */
+
+      cur = &io[head];
+      nxsem_wait_uninterruptible(&cur->payload.resp);
+      nxsem_destroy(&cur->payload.resp);
+      head = (head + 1) % CONFIG_V9FS_MAX_INFLIGHT;
+      inflight--;
+
+      if (stop)
+        {
+          continue;
+        }
+
+      if (cur->payload.ret < 0)
+        {
+          ret = cur->payload.ret;
+          stop = true;
+          continue;
+        }
+
+      nio += cur->response.count;
+      if (cur->response.count < cur->request.count)
+        {
+          stop = true;
+        }
+    }
+
+  return nio ? nio : ret;
+}
+
+#if CONFIG_V9FS_CACHE_TTL > 0
+
+/****************************************************************************
+ * v9fs_cache_touch
+ *
+ * Description:
+ *   Forget the cached attributes of the file fid refers to, after its
+ *   contents or attributes were changed through it.
+ *
+ ****************************************************************************/
+
+static void v9fs_cache_touch(FAR struct v9fs_client_s *client,
+                             uint32_t fid)
+{
+  FAR struct v9fs_fid_s *fidp;
+
+  nxmutex_lock(&client->lock);
+  fidp = idr_find(client->fids, fid);
+  if (fidp != NULL)
+    {
+      fs_metacache_touch(&client->meta, fs_metacache_key(fidp->relpath));
+    }
+
+  nxmutex_unlock(&client->lock);
+}
+
+/****************************************************************************
+ * v9fs_cache_invalidate
+ *
+ * Description:
+ *   Forget the cached attributes of an entry and of its directory, after
+ *   the entry was created or removed.  A fid walked to a directory for a
+ *   child (an empty path or one ending with a '/') is combined with name,
+ *   any other fid already refers to the entry itself.
+ *
+ ****************************************************************************/
+
+static void v9fs_cache_invalidate(FAR struct v9fs_client_s *client,
+                                  uint32_t fid, FAR const char *name)
+{
+  FAR struct v9fs_fid_s *fidp;
+  FAR char *path;
+  size_t len;
+
+  path = lib_get_pathbuffer();
+  if (path == NULL)
+    {
+      fs_metacache_invalidate(&client->meta);
+      return;
+    }
+
+  nxmutex_lock(&client->lock);
+  fidp = idr_find(client->fids, fid);
+  if (fidp == NULL)
+    {
+      fs_metacache_invalidate(&client->meta);
+    }
+  else
+    {
+      strlcpy(path, fidp->relpath, PATH_MAX);
+      len = strlen(path);
+      if (name != NULL && (len == 0 || path[len - 1] == '/'))
+        {
+          strlcat(path, name, PATH_MAX);
+        }
+
+      fs_metacache_invalidate_path(&client->meta, path);
+    }
+
+  nxmutex_unlock(&client->lock);
+  lib_put_pathbuffer(path);
+}
+
+/****************************************************************************
+ * v9fs_cache_drop
+ *
+ * Description:
+ *   Release all cached fids, after anything that may have changed which
+ *   file a path refers to.
+ *
+ ****************************************************************************/
+
+static void v9fs_cache_drop(FAR struct v9fs_client_s *client)
+{
+  FAR struct v9fs_cache_s *entry;
+  FAR char *path;
+  uint32_t fid;
+  int i;
+
+  for (i = 0; i < CONFIG_V9FS_CACHE_NENTRIES; i++)
+    {
+      entry = &client->cache[i];
+
+      nxmutex_lock(&client->lock);
+      path = entry->path;
+      fid = entry->fid;
+      entry->path = NULL;
+      nxmutex_unlock(&client->lock);
+
+      if (path != NULL)
+        {
+          fs_heap_free(path);
+          v9fs_fid_put(client, fid);
+        }
+    }
+}
+
+/****************************************************************************
+ * v9fs_cache_insert
+ *
+ * Description:
+ *   Remember that path was walked to fid.  The cache takes its own
+ *   reference on the fid and the ownership of path.
+ *
+ ****************************************************************************/
+
+static void v9fs_cache_insert(FAR struct v9fs_client_s *client,
+                              FAR char *path, uint32_t fid)
+{
+  FAR struct v9fs_cache_s *victim = NULL;
+  FAR struct v9fs_cache_s *entry;
+  FAR struct v9fs_fid_s *fidp;
+  FAR char *oldpath;
+  uint32_t oldfid;
+  int i;
+
+  nxmutex_lock(&client->lock);
+  for (i = 0; i < CONFIG_V9FS_CACHE_NENTRIES; i++)
+    {
+      entry = &client->cache[i];
+      if (entry->path == NULL)
+        {
+          if (victim == NULL || victim->path != NULL)
+            {
+              victim = entry;
+            }
+        }
+      else if (strcmp(entry->path, path) == 0)
+        {
+          /* Another thread walked the same path meanwhile */
+
+          nxmutex_unlock(&client->lock);
+          fs_heap_free(path);
+          return;
+        }
+      else if (victim == NULL ||
+               (victim->path != NULL &&
+                clock_compare(entry->expire, victim->expire)))
+        {
+          victim = entry;
+        }
+    }
+
+  fidp = idr_find(client->fids, fid);
+  if (fidp == NULL)
+    {
+      nxmutex_unlock(&client->lock);
+      fs_heap_free(path);
+      return;
+    }
+
+  fidp->refcount++;
+  oldpath = victim->path;
+  oldfid = victim->fid;
+  victim->path = path;
+  victim->fid = fid;
+  victim->expire = clock_systime_ticks() +
+                   MSEC2TICK(CONFIG_V9FS_CACHE_TTL);
+  nxmutex_unlock(&client->lock);
+
+  if (oldpath != NULL)
+    {
+      fs_heap_free(oldpath);
+      v9fs_fid_put(client, oldfid);
+    }
+}
+
+/****************************************************************************
+ * v9fs_cache_find
+ *
+ * Description:
+ *   Return the live cache entry holding fid, or NULL.  The client lock
+ *   must be held.
+ *
+ ****************************************************************************/
+
+static FAR struct v9fs_cache_s *
+v9fs_cache_find(FAR struct v9fs_client_s *client, uint32_t fid)
+{
+  FAR struct v9fs_cache_s *entry;
+  int i;
+
+  for (i = 0; i < CONFIG_V9FS_CACHE_NENTRIES; i++)
+    {
+      entry = &client->cache[i];
+      if (entry->path != NULL && entry->fid == fid &&
+          !clock_compare(entry->expire, clock_systime_ticks()))
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+#else
+#  define v9fs_cache_touch(client, fid)
+#  define v9fs_cache_invalidate(client, fid, name)
+#  define v9fs_cache_drop(client)
+#endif
+
 /****************************************************************************
  * v9fs_client_clunk
  ****************************************************************************/
@@ -786,8 +1141,39 @@ int v9fs_client_stat(FAR struct v9fs_client_s *client, uint32_t fid,
   struct v9fs_rstat_s response;
   struct iovec wiov[1];
   struct iovec riov[1];
+#if CONFIG_V9FS_CACHE_TTL > 0
+  FAR const struct stat *attr;
+  FAR struct v9fs_cache_s *entry;
+  bool keep = false;
+  int32_t gen = 0;
+#endif
   int ret;
 
+#if CONFIG_V9FS_CACHE_TTL > 0
+  /* Only fids of the lookup cache have a path that is known to still
+   * name the same file, the attributes are kept under that path.
+   */
+
+  nxmutex_lock(&client->lock);
+  entry = v9fs_cache_find(client, fid);
+  if (entry != NULL)
+    {
+      attr = fs_metacache_getattr(&client->meta, entry->path);
+      if (attr != NULL)
+        {
+          memcpy(buf, attr, sizeof(struct stat));
+          nxmutex_unlock(&client->lock);
+          return 0;
+        }
+
+      gen = fs_metacache_gen(&client->meta,
+                             fs_metacache_key(entry->path));
+      keep = true;
+    }
+
+  nxmutex_unlock(&client->lock);
+#endif
+
   /* size[4] Tgetattr tag[2] fid[4] request_mask[8]
    * size[4] Rgetattr tag[2] valid[8] qid[13] mode[4] uid[4] gid[4] nlink[8]
    *         rdev[8] size[8] blksize[8] blocks[8]
@@ -829,6 +1215,17 @@ int v9fs_client_stat(FAR struct v9fs_client_s *client, uint32_t fid,
   buf->st_ctim.tv_sec = response.ctime_sec;
   buf->st_ctim.tv_nsec = response.ctime_nsec;
 
+#if CONFIG_V9FS_CACHE_TTL > 0
+  nxmutex_lock(&client->lock);
+  entry = v9fs_cache_find(client, fid);
+  if (keep && entry != NULL)
+    {
+      fs_metacache_setattr(&client->meta, entry->path, gen, buf);
+    }
+
+  nxmutex_unlock(&client->lock);
+#endif
+
   return 0;
 }
 
@@ -861,6 +1258,7 @@ int v9fs_client_chstat(FAR struct v9fs_client_s *client, uint32_t fid,
   struct v9fs_lerror_s response;
   struct iovec wiov[1];
   struct iovec riov[1];
+  int ret;
 
   /* size[4] Tsetattr tag[2] fid[4] valid[4] mode[4] uid[4] gid[4] size[8]
    *                  atime_sec[8] atime_nsec[8] mtime_sec[8] mtime_nsec[8]
@@ -891,8 +1289,10 @@ int v9fs_client_chstat(FAR struct v9fs_client_s *client, uint32_t fid,
   riov[0].iov_base = &response;
   riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
 
-  return v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
-                         request.header.tag);
+  ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
+                        request.header.tag);
+  v9fs_cache_touch(client, fid);
+  return ret;
 }
 
 /****************************************************************************
@@ -902,61 +1302,11 @@ int v9fs_client_chstat(FAR struct v9fs_client_s *client, uint32_t fid,
 ssize_t v9fs_client_read(FAR struct v9fs_client_s *client, uint32_t fid,
                          FAR void *buffer, off_t offset, size_t buflen)
 {
-  FAR struct v9fs_fid_s *fidp;
-  struct v9fs_read_s request;
-  struct v9fs_rread_s response;
-  struct iovec wiov[1];
-  struct iovec riov[2];
-  size_t nread = 0;
-  int ret = 0;
-
   /* size[4] Tread tag[2] fid[4] offset[8] count[4]
    * size[4] Rread tag[2] count[4] data[count]
    */
 
-  fidp = idr_find(client->fids, fid);
-  if (fidp == NULL)
-    {
-      return -ENOENT;
-    }
-
-  while (buflen > 0)
-    {
-      request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                            V9FS_BIT32SZ;
-      request.header.type = V9FS_TREAD;
-      request.header.tag = v9fs_get_tagid(client);
-      request.fid = fid;
-      request.offset = offset;
-      request.count = buflen > fidp->iounit ? fidp->iounit : buflen;
-
-      wiov[0].iov_base = &request;
-      wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                        V9FS_BIT32SZ;
-      riov[0].iov_base = &response;
-      riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
-      riov[1].iov_base = (FAR void *)buffer;
-      riov[1].iov_len = request.count;
-
-      ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 2,
-                            request.header.tag);
-      if (ret < 0)
-        {
-          break;
-        }
-
-      if (response.count == 0)
-        {
-          break;
-        }
-
-      nread += response.count;
-      offset += response.count;
-      buffer += response.count;
-      buflen -= response.count;
-    }
-
-  return nread ? nread : ret;
+  return v9fs_client_io(client, fid, V9FS_TREAD, buffer, offset, buflen);
 }
 
 /****************************************************************************
@@ -1078,56 +1428,16 @@ ssize_t v9fs_client_write(FAR struct v9fs_client_s *client, uint32_t fid,
                           FAR const void *buffer, off_t offset,
                           size_t buflen)
 {
-  FAR struct v9fs_fid_s *fidp;
-  struct v9fs_write_s request;
-  struct v9fs_rwrite_s response;
-  struct iovec wiov[2];
-  struct iovec riov[1];
-  size_t nwrite = 0;
-  int ret = 0;
+  ssize_t ret;
 
   /* size[4] Twrite tag[2] fid[4] offset[8] count[4] data[count]
    * size[4] Rwrite tag[2] count[4]
    */
 
-  fidp = idr_find(client->fids, fid);
-  if (fidp == NULL)
-    {
-      return -ENOENT;
-    }
-
-  while (buflen > 0)
-    {
-      request.count = buflen > fidp->iounit ? fidp->iounit : buflen;
-      request.header.size = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                            V9FS_BIT32SZ + request.count;
-      request.header.type = V9FS_TWRITE;
-      request.header.tag = v9fs_get_tagid(client);
-      request.fid = fid;
-      request.offset = offset;
-
-      wiov[0].iov_base = &request;
-      wiov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ + V9FS_BIT64SZ +
-                        V9FS_BIT32SZ;
-      wiov[1].iov_base = (FAR void *)buffer;
-      wiov[1].iov_len = request.count;
-      riov[0].iov_base = &response;
-      riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
-
-      ret = v9fs_client_rpc(client->transport, wiov, 2, riov, 1,
-                            request.header.tag);
-      if (ret < 0)
-        {
-          break;
-        }
-
-      nwrite += response.count;
-      offset += response.count;
-      buffer += response.count;
-      buflen -= response.count;
-    }
-
-  return nwrite ? nwrite : ret;
+  ret = v9fs_client_io(client, fid, V9FS_TWRITE, (FAR void *)buffer,
+                       offset, buflen);
+  v9fs_cache_touch(client, fid);
+  return ret;
 }
 
 /****************************************************************************
@@ -1173,6 +1483,7 @@ int v9fs_client_rename(FAR struct v9fs_client_s *client, uint32_t fid,
   struct v9fs_lerror_s response;
   struct iovec wiov[1];
   struct iovec riov[1];
+  int ret;
 
   /* size[4] Trename tag[2] fid[4] dfid[4] name[s]
    * size[4] Rrename tag[2]
@@ -1193,8 +1504,13 @@ int v9fs_client_rename(FAR struct v9fs_client_s *client, uint32_t fid,
   riov[0].iov_base = &response;
   riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
 
-  return v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
-                         request.header.tag);
+  ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
+                        request.header.tag);
+  v9fs_cache_drop(client);
+#if CONFIG_V9FS_CACHE_TTL > 0
+  fs_metacache_invalidate(&client->meta);
+#endif
+  return ret;
 }
 
 /****************************************************************************
@@ -1207,6 +1523,7 @@ int v9fs_client_remove(FAR struct v9fs_client_s *client, uint32_t fid)
   struct v9fs_lerror_s response;
   struct iovec wiov[1];
   struct iovec riov[1];
+  int ret;
 
   /* size[4] Tremove tag[2] fid[4]
    * size[4] Rremove tag[2]
@@ -1226,8 +1543,11 @@ int v9fs_client_remove(FAR struct v9fs_client_s *client, uint32_t fid)
   riov[0].iov_base = &response;
   riov[0].iov_len = V9FS_HDRSZ + V9FS_BIT32SZ;
 
-  return v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
-                         request.header.tag);
+  ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
+                        request.header.tag);
+  v9fs_cache_invalidate(client, fid, NULL);
+  v9fs_cache_drop(client);
+  return ret;
 }
 
 /****************************************************************************
@@ -1265,12 +1585,9 @@ int v9fs_client_unlink(FAR struct v9fs_client_s *client, uint32_t fid,
 
   ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
                         request.header.tag);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  return v9fs_client_clunk(client, fid);
+  v9fs_cache_invalidate(client, fid, name);
+  v9fs_cache_drop(client);
+  return ret;
 }
 
 /****************************************************************************
@@ -1286,6 +1603,7 @@ int v9fs_client_mkdir(FAR struct v9fs_client_s *client, uint32_t fid,
   struct iovec riov[1];
   uint32_t gid = getgid();
   off_t offset = 0;
+  int ret;
 
   /* size[4] Tmkdir tag[2] dfid[4] name[s] mode[4] gid[4]
    * size[4] Rmkdir tag[2] qid[13]
@@ -1309,8 +1627,10 @@ int v9fs_client_mkdir(FAR struct v9fs_client_s *client, uint32_t fid,
   riov[0].iov_base = &response;
   riov[0].iov_len = V9FS_HDRSZ + V9FS_QIDSZ;
 
-  return v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
-                         request.header.tag);
+  ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
+                        request.header.tag);
+  v9fs_cache_invalidate(client, fid, name);
+  return ret;
 }
 
 /****************************************************************************
@@ -1362,6 +1682,7 @@ int v9fs_client_create(FAR struct v9fs_client_s *client, uint32_t fid,
 
   ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
                         request.header.tag);
+  v9fs_cache_invalidate(client, fid, name);
   if (ret < 0)
     {
       return ret;
@@ -1413,6 +1734,11 @@ int v9fs_client_open(FAR struct v9fs_client_s *client,
 
   ret = v9fs_client_rpc(client->transport, wiov, 1, riov, 1,
                         request.header.tag);
+  if (oflags & O_TRUNC)
+    {
+      v9fs_cache_touch(client, fid);
+    }
+
   if (ret < 0)
     {
       return ret;
@@ -1606,6 +1932,99 @@ err:
   return ret == 0 ? newfid : ret;
 }
 
+/****************************************************************************
+ * v9fs_client_lookup
+ *
+ * Description:
+ *   Like v9fs_client_walk, but the returned fid may be shared with the
+ *   lookup cache.  It must only be used for operations that leave the fid
+ *   itself untouched (no Tlopen or Tlcreate) and released with
+ *   v9fs_fid_put.
+ *
+ ****************************************************************************/
+
+int v9fs_client_lookup(FAR struct v9fs_client_s *client,
+                       FAR const char *path, FAR const char **childname)
+{
+#if CONFIG_V9FS_CACHE_TTL > 0
+  FAR struct v9fs_cache_s *entry;
+  FAR struct v9fs_fid_s *fidp;
+  FAR const char *name;
+  FAR char *oldpath = NULL;
+  FAR char *key;
+  uint32_t oldfid = 0;
+  size_t len;
+  int ret;
+  int i;
+
+  /* The cache key is the part of the path that is actually walked */
+
+  len = strlen(path);
+  if (childname != NULL)
+    {
+      name = strrchr(path, '/');
+      name = name != NULL ? name + 1 : path;
+      len = name - path;
+      *childname = name;
+    }
+
+  nxmutex_lock(&client->lock);
+  for (i = 0; i < CONFIG_V9FS_CACHE_NENTRIES; i++)
+    {
+      entry = &client->cache[i];
+      if (entry->path == NULL || strncmp(entry->path, path, len) != 0 ||
+          entry->path[len] != '\0')
+        {
+          continue;
+        }
+
+      if (!clock_compare(entry->expire, clock_systime_ticks()))
+        {
+          fidp = idr_find(client->fids, entry->fid);
+          if (fidp != NULL)
+            {
+              fidp->refcount++;
+              ret = entry->fid;
+              nxmutex_unlock(&client->lock);
+              return ret;
+            }
+        }
+
+      /* Expired, drop it and walk again */
+
+      oldpath = entry->path;
+      oldfid = entry->fid;
+      entry->path = NULL;
+      break;
+    }
+
+  nxmutex_unlock(&client->lock);
+  if (oldpath != NULL)
+    {
+      fs_heap_free(oldpath);
+      v9fs_fid_put(client, oldfid);
+    }
+
+  key = fs_heap_strndup(path, len);
+  if (key == NULL)
+    {
+      return v9fs_client_walk(client, path, childname);
+    }
+
+  ret = v9fs_client_walk(client, key, NULL);
+  if (ret < 0)
+    {
+      fs_heap_free(key);
+      return ret;
+    }
+
+  v9fs_cache_insert(client, key, ret);
+  return ret;
+#else
+  return v9fs_client_walk(client, path, childname);
+#endif
+}
+
 /****************************************************************************
  * v9fs_client_init
  ****************************************************************************/
@@ -1685,6 +2104,10 @@ int v9fs_client_init(FAR struct v9fs_client_s *client,
     }
 
   nxmutex_init(&client->lock);
+#if CONFIG_V9FS_CACHE_TTL > 0
+  fs_metacache_init(&client->meta, client->attr,
+                    CONFIG_V9FS_CACHE_NENTRIES, CONFIG_V9FS_CACHE_TTL, 0);
+#endif
 
   /* Do Version */
 
@@ -1708,6 +2131,9 @@ int v9fs_client_init(FAR struct v9fs_client_s *client,
   return 0;
 
 out:
+#if CONFIG_V9FS_CACHE_TTL > 0
+  fs_metacache_uninit(&client->meta);
+#endif
   v9fs_transport_destroy(client->transport);
   nxmutex_destroy(&client->lock);
   idr_destroy(client->fids);
@@ -1723,12 +2149,16 @@ int v9fs_client_uninit(FAR struct v9fs_client_s *client)
 {
   int ret;
 
+  v9fs_cache_drop(client);
   ret = v9fs_client_clunk(client, client->root_fid);
   if (ret < 0)
     {
       return ret;
     }
 
+#if CONFIG_V9FS_CACHE_TTL > 0
+  fs_metacache_uninit(&client->meta);
+#endif
   v9fs_transport_destroy(client->transport);
   nxmutex_destroy(&client->lock);
   idr_destroy(client->fids);
@@ -36,6 +36,8 @@
 #include <sys/statfs.h>
 #include <sys/uio.h>
 
+#include "fs_metacache.h"
+
 /****************************************************************************
  * Type Definitions
  ****************************************************************************/
@@ -70,6 +72,20 @@ struct v9fs_transport_ops_s
   CODE void (*destroy)(FAR struct v9fs_transport_s *transport);
 };
 
+#if CONFIG_V9FS_CACHE_TTL > 0
+/* A walked fid kept for later path lookups.  The cache holds one reference
+ * on the fid.  The attributes of the file it refers to are kept in the
+ * metadata cache of the client, under the same path.
+ */
+
+struct v9fs_cache_s
+{
+  FAR char                    *path;     /* Walked path, NULL if unused */
+  uint32_t                     fid;      /* The walked fid */
+  clock_t                      expire;   /* Expiration time */
+};
+#endif
+
 struct v9fs_client_s
 {
   FAR struct v9fs_transport_s *transport;
@@ -78,6 +94,11 @@ struct v9fs_client_s
   uint32_t                     root_fid;
   uint32_t                     tag_id;
   mutex_t                      lock;
+#if CONFIG_V9FS_CACHE_TTL > 0
+  struct v9fs_cache_s          cache[CONFIG_V9FS_CACHE_NENTRIES];
+  struct fs_metacache_s        meta;     /* Attributes of cached paths */
+  struct fs_attr_s             attr[CONFIG_V9FS_CACHE_NENTRIES];
+#endif
 };
 
 /****************************************************************************
@@ -117,6 +138,8 @@ int v9fs_client_getname(FAR struct v9fs_client_s *client, uint32_t fid,
                         FAR char *path);
 int v9fs_client_walk(FAR struct v9fs_client_s *client, FAR const char *path,
                      FAR const char **childname);
+int v9fs_client_lookup(FAR struct v9fs_client_s *client,
+                       FAR const char *path, FAR const char **childname);
 int v9fs_client_init(FAR struct v9fs_client_s *client, FAR const char *data);
 int v9fs_client_uninit(FAR struct v9fs_client_s *client);
 int v9fs_transport_create(FAR struct v9fs_transport_s **transport,
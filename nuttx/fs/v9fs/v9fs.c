@@ -715,7 +715,7 @@ static int v9fs_vfs_unlink(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, relpath, &filename);
+  ret = v9fs_client_lookup(client, relpath, &filename);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the parent fid of relpath: %d\n", ret);
@@ -765,7 +765,7 @@ static int v9fs_vfs_mkdir(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, relpath, &relpath);
+  ret = v9fs_client_lookup(client, relpath, &relpath);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the parent fid of relpath: %d\n", ret);
@@ -798,7 +798,7 @@ static int v9fs_vfs_rmdir(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, relpath, &dirname);
+  ret = v9fs_client_lookup(client, relpath, &dirname);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the parent fid of relpath: %d\n", ret);
@@ -850,7 +850,7 @@ static int v9fs_vfs_rename(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, oldrelpath, NULL);
+  ret = v9fs_client_lookup(client, oldrelpath, NULL);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the fid of the oldrelpath: %d\n", ret);
@@ -858,7 +858,7 @@ static int v9fs_vfs_rename(FAR struct inode *mountpt,
     }
 
   oldfid = ret;
-  ret = v9fs_client_walk(client, newrelpath, &newrelpath);
+  ret = v9fs_client_lookup(client, newrelpath, &newrelpath);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the new parent fid of the newrelpath: %d\n",
@@ -894,7 +894,7 @@ static int v9fs_vfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
   client = mountpt->i_private;
   memset(buf, 0, sizeof(struct stat));
 
-  ret = v9fs_client_walk(client, relpath, NULL);
+  ret = v9fs_client_lookup(client, relpath, NULL);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the fid of the relpath: %d\n", ret);
@@ -927,7 +927,7 @@ static int v9fs_vfs_chstat(FAR struct inode *mountpt,
 
   client = mountpt->i_private;
 
-  ret = v9fs_client_walk(client, relpath, NULL);
+  ret = v9fs_client_lookup(client, relpath, NULL);
   if (ret < 0)
     {
       ferr("ERROR: Can't find the fid of the relpath %d\n", ret);
@@ -36,12 +36,14 @@
 #include <debug.h>
 
 #include <nuttx/nuttx.h>
+#include <nuttx/atomic.h>
 #include <nuttx/clock.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/list.h>
 #include <nuttx/mutex.h>
 #include <nuttx/signal.h>
+#include <nuttx/spinlock.h>
 
 #include "inode/inode.h"
 #include "fs_heap.h"
@@ -52,9 +54,10 @@
 
 struct epoll_node_s
 {
-  struct list_node         node;
+  struct list_node         node;     /* Link in the setup/oneshot/free list */
+  struct list_node         rdnode;   /* Link in the ready list */
+  struct list_node         exnode;   /* Link in g_epoll_exclusive */
   epoll_data_t             data;
-  bool                     notified;
   struct pollfd            pfd;
   FAR struct file         *filep;
   FAR struct epoll_head_s *eph;
@@ -66,15 +69,20 @@ struct epoll_head_s
 {
   int                   size;
   int                   crefs;
+  atomic_t              waiters;  /* Number of threads in epoll_wait() */
   mutex_t               lock;
   sem_t                 sem;
-  struct list_node      setup;    /* The setup list, store all the setuped
-                                   * epoll node.
+  spinlock_t            rdlock;   /* Protects the ready list, it is appended
+                                   * from poll_notify() which may run in
+                                   * interrupt context.
                                    */
-  struct list_node      teardown; /* The teardown list, store all the epoll
-                                   * node notified after epoll_wait finish,
-                                   * these epoll node should be setup again
-                                   * to check the pending poll notification.
+  struct list_node      setup;    /* The setup list, store all the epoll
+                                   * nodes that stay armed in their driver.
+                                   */
+  struct list_node      ready;    /* The ready list, store all the epoll
+                                   * nodes notified by their driver and not
+                                   * yet reported by epoll_wait().  Only
+                                   * these are examined by epoll_wait().
                                    */
   struct list_node      oneshot;  /* The oneshot list, store all the epoll
                                    * node notified after epoll_wait and with
@@ -101,9 +109,9 @@ static int epoll_do_open(FAR struct file *filep);
 static int epoll_do_close(FAR struct file *filep);
 static int epoll_do_poll(FAR struct file *filep,
                          FAR struct pollfd *fds, bool setup);
-static int epoll_setup(FAR epoll_head_t *eph);
-static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
-                          int maxevents);
+static void epoll_default_cb(FAR struct pollfd *fds);
+static int epoll_harvest(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
+                         int maxevents);
 
 /****************************************************************************
  * Private Data
@@ -134,6 +142,14 @@ static struct inode g_epoll_inode =
   }
 };
 
+/* All the EPOLLEXCLUSIVE epoll nodes of all the epoll instances, used to
+ * wake only one of the instances waiting on the same file.
+ */
+
+static struct list_node g_epoll_exclusive =
+  LIST_INITIAL_VALUE(g_epoll_exclusive);
+static spinlock_t g_epoll_exlock;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -163,6 +179,209 @@ static FAR epoll_head_t *epoll_head_from_fd(int fd, FAR struct file **filep)
   return (*filep)->f_priv;
 }
 
+/****************************************************************************
+ * Name: epoll_exclusive_remove
+ *
+ * Description:
+ *   Remove an epoll node from the EPOLLEXCLUSIVE list if it is there.
+ *
+ ****************************************************************************/
+
+static void epoll_exclusive_remove(FAR epoll_node_t *epn)
+{
+  irqstate_t flags;
+
+  if (list_in_list(&epn->exnode))
+    {
+      flags = spin_lock_irqsave(&g_epoll_exlock);
+      list_delete(&epn->exnode);
+      spin_unlock_irqrestore(&g_epoll_exlock, flags);
+    }
+}
+
+/****************************************************************************
+ * Name: epoll_exclusive_claimed
+ *
+ * Description:
+ *   Check whether the wakeup for an event on an EPOLLEXCLUSIVE epoll node
+ *   is already taken care of by another epoll instance watching the same
+ *   file: i.e. another EPOLLEXCLUSIVE node of that file is queued on its
+ *   ready list and some thread waits on its instance.  The file is matched
+ *   by its inode, since every open() of it, e.g. by different tasks, has
+ *   its own struct file.
+ *
+ ****************************************************************************/
+
+static bool epoll_exclusive_claimed(FAR epoll_node_t *epn)
+{
+  FAR epoll_node_t *other;
+  irqstate_t flags;
+  bool claimed = false;
+
+  flags = spin_lock_irqsave(&g_epoll_exlock);
+  list_for_every_entry(&g_epoll_exclusive, other, epoll_node_t, exnode)
+    {
+      if (other != epn && other->filep->f_inode == epn->filep->f_inode &&
+          list_in_list(&other->rdnode) &&
+          atomic_read(&other->eph->waiters) > 0)
+        {
+          claimed = true;
+          break;
+        }
+    }
+
+  spin_unlock_irqrestore(&g_epoll_exlock, flags);
+  return claimed;
+}
+
+/****************************************************************************
+ * Name: epoll_splice
+ *
+ * Description:
+ *   Move all the nodes of the list 'from' to the head of the list 'to',
+ *   keeping their order.  The ready list lock must be held.
+ *
+ ****************************************************************************/
+
+static void epoll_splice(FAR struct list_node *to,
+                         FAR struct list_node *from)
+{
+  if (!list_is_empty(from))
+    {
+      from->prev->next = to->next;
+      to->next->prev   = from->prev;
+      from->next->prev = to;
+      to->next         = from->next;
+      list_initialize(from);
+    }
+}
+
+/****************************************************************************
+ * Name: epoll_unqueue
+ *
+ * Description:
+ *   Remove an epoll node from the ready list if it is there.
+ *
+ ****************************************************************************/
+
+static void epoll_unqueue(FAR epoll_node_t *epn)
+{
+  irqstate_t flags;
+
+  flags = spin_lock_irqsave(&epn->eph->rdlock);
+  if (list_in_list(&epn->rdnode))
+    {
+      list_delete(&epn->rdnode);
+    }
+
+  epn->pfd.revents = 0;
+  spin_unlock_irqrestore(&epn->eph->rdlock, flags);
+}
+
+/****************************************************************************
+ * Name: epoll_arm
+ *
+ * Description:
+ *   Setup the poll of an epoll node in its driver.  The node stays armed
+ *   until it is deleted (or fires with EPOLLONESHOT); the driver appends
+ *   it to the ready list through poll_notify() whenever an event occurs,
+ *   including from the setup itself if the file is ready already.
+ *
+ ****************************************************************************/
+
+static int epoll_arm(FAR epoll_node_t *epn)
+{
+  epoll_unqueue(epn);
+  return file_poll(epn->filep, &epn->pfd, true);
+}
+
+/****************************************************************************
+ * Name: epoll_disarm
+ *
+ * Description:
+ *   Teardown the poll of an epoll node in its driver and forget any
+ *   pending notification.
+ *
+ ****************************************************************************/
+
+static void epoll_disarm(FAR epoll_node_t *epn)
+{
+  file_poll(epn->filep, &epn->pfd, false);
+  epoll_unqueue(epn);
+}
+
+/****************************************************************************
+ * Name: epoll_recheck
+ *
+ * Description:
+ *   Ask the driver for the current state of a level-triggered epoll node:
+ *   the notification that queued it may be stale by now.  The node is
+ *   re-armed with the callback detached so that the state reported by the
+ *   setup is returned here instead of queuing the node again.
+ *
+ ****************************************************************************/
+
+static pollevent_t epoll_recheck(FAR epoll_node_t *epn)
+{
+  FAR epoll_head_t *eph = epn->eph;
+  pollevent_t revents;
+  irqstate_t flags;
+  int ret;
+
+  file_poll(epn->filep, &epn->pfd, false);
+
+  epn->pfd.cb      = NULL;
+  epn->pfd.revents = 0;
+  ret = file_poll(epn->filep, &epn->pfd, true);
+  epn->pfd.cb      = epoll_default_cb;
+
+  if (ret < 0)
+    {
+      ferr("epoll setup failed, filep=%p, events=%08" PRIx32 ", "
+           "ret=%d\n", epn->filep, epn->pfd.events, ret);
+      return POLLERR;
+    }
+
+  flags = spin_lock_irqsave(&eph->rdlock);
+  revents = epn->pfd.revents;
+  epn->pfd.revents = 0;
+  spin_unlock_irqrestore(&eph->rdlock, flags);
+
+  return revents;
+}
+
+/****************************************************************************
+ * Name: epoll_find
+ *
+ * Description:
+ *   Find the epoll node of a file descriptor, either armed or a fired
+ *   oneshot node.
+ *
+ ****************************************************************************/
+
+static FAR epoll_node_t *epoll_find(FAR epoll_head_t *eph, int fd)
+{
+  FAR epoll_node_t *epn;
+
+  list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
+    {
+      if (epn->pfd.fd == fd)
+        {
+          return epn;
+        }
+    }
+
+  list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+    {
+      if (epn->pfd.fd == fd)
+        {
+          return epn;
+        }
+    }
+
+  return NULL;
+}
+
 static int epoll_do_open(FAR struct file *filep)
 {
   FAR epoll_head_t *eph = filep->f_priv;
@@ -200,6 +419,12 @@ static int epoll_do_close(FAR struct file *filep)
       list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
         {
           file_poll(epn->filep, &epn->pfd, false);
+          epoll_exclusive_remove(epn);
+          file_put(epn->filep);
+        }
+
+      list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+        {
           file_put(epn->filep);
         }
 
@@ -209,6 +434,7 @@ static int epoll_do_close(FAR struct file *filep)
           fs_heap_free(epn);
         }
 
+      nxsem_destroy(&eph->sem);
       fs_heap_free(eph);
     }
 
@@ -239,13 +465,14 @@ static int epoll_do_create(int size, int flags)
   eph->size = size;
   nxmutex_init(&eph->lock);
   nxsem_init(&eph->sem, 0, 0);
+  spin_lock_init(&eph->rdlock);
 
   /* List initialize */
 
   epn = (FAR epoll_node_t *)(eph + 1);
 
   list_initialize(&eph->setup);
-  list_initialize(&eph->teardown);
+  list_initialize(&eph->ready);
   list_initialize(&eph->oneshot);
   list_initialize(&eph->extend);
   list_initialize(&eph->free);
@@ -262,6 +489,7 @@ static int epoll_do_create(int size, int flags)
   if (fd < 0)
     {
       nxmutex_destroy(&eph->lock);
+      nxsem_destroy(&eph->sem);
       fs_heap_free(eph);
       set_errno(-fd);
       return ERROR;
@@ -271,23 +499,39 @@ static int epoll_do_create(int size, int flags)
 }
 
 /****************************************************************************
- * Name: epoll_setup
+ * Name: epoll_harvest
  *
  * Description:
- *   Setup all the fd.
+ *   Report the events of the epoll nodes on the ready list.  Only the ready
+ *   list is visited, so the cost does not depend on the number of watched
+ *   file descriptors.  The ready list is first moved aside, so that a node
+ *   that is notified again while the others are reported is queued for
+ *   the next call instead of being reported twice by this one.
+ *
+ *   Edge-triggered (EPOLLET) nodes report the events accumulated since they
+ *   were last reported and stay armed.  Level-triggered nodes are checked
+ *   again with the driver and, if still ready, are put back on the ready
+ *   list so that the next epoll_wait() checks them once more.  EPOLLONESHOT
+ *   nodes are disarmed until they are re-enabled with EPOLL_CTL_MOD.
  *
  * Input Parameters:
  *   eph       - The epoll head pointer
+ *   evs       - The epoll events array
+ *   maxevents - The epoll events array size
  *
  * Returned Value:
- *   Positive on success, negative on fail
+ *   Return the number of events stored in evs, or a negated errno value.
  *
  ****************************************************************************/
 
-static int epoll_setup(FAR epoll_head_t *eph)
+static int epoll_harvest(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
+                         int maxevents)
 {
-  FAR epoll_node_t *tepn;
+  struct list_node harvest;
   FAR epoll_node_t *epn;
+  pollevent_t revents;
+  irqstate_t flags;
+  int i = 0;
   int ret;
 
   ret = nxmutex_lock(&eph->lock);
@@ -296,90 +540,67 @@ static int epoll_setup(FAR epoll_head_t *eph)
       return ret;
     }
 
-  list_for_every_entry_safe(&eph->teardown, epn, tepn, epoll_node_t, node)
-    {
-      /* Setup again to check the notified pollfd last epoll_wait() to
-       * cover the situation several poll event pending on one fd.
-       */
+  list_initialize(&harvest);
 
-      epn->notified    = false;
-      epn->pfd.revents = 0;
-      ret = file_poll(epn->filep, &epn->pfd, true);
-      if (ret < 0)
+  flags = spin_lock_irqsave(&eph->rdlock);
+  epoll_splice(&harvest, &eph->ready);
+  spin_unlock_irqrestore(&eph->rdlock, flags);
+
+  while (i < maxevents)
+    {
+      flags = spin_lock_irqsave(&eph->rdlock);
+      epn = list_remove_head_type(&harvest, epoll_node_t, rdnode);
+      if (epn == NULL)
         {
-          ferr("epoll setup failed, filep=%p, events=%08" PRIx32 ", "
-               "ret=%d\n", epn->filep, epn->pfd.events, ret);
+          spin_unlock_irqrestore(&eph->rdlock, flags);
           break;
         }
 
-      list_delete(&epn->node);
-      list_add_tail(&eph->setup, &epn->node);
-    }
-
-  nxmutex_unlock(&eph->lock);
-  return ret;
-}
-
-/****************************************************************************
- * Name: epoll_teardown
- *
- * Description:
- *   Teardown all the notified fd and check the notified fd's event with user
- *   expected event.
- *
- * Input Parameters:
- *   eph       - The epoll head pointer
- *   evs       - The epoll events array
- *   maxevents - The epoll events array size
- *
- * Returned Value:
- *   Return the number of fd that notified and the events is also user
- *   expected.
- *
- ****************************************************************************/
-
-static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
-                          int maxevents)
-{
-  FAR epoll_node_t *tepn;
-  FAR epoll_node_t *epn;
-  int i = 0;
-
-  nxmutex_lock(&eph->lock);
+      revents = epn->pfd.revents;
+      epn->pfd.revents = 0;
+      spin_unlock_irqrestore(&eph->rdlock, flags);
 
-  list_for_every_entry_safe(&eph->setup, epn, tepn, epoll_node_t, node)
-    {
-      /* Only check the notified fd */
+      if ((epn->pfd.events & EPOLLET) == 0)
+        {
+          revents = epoll_recheck(epn);
+        }
 
-      if (!epn->notified)
+      revents &= epn->pfd.events | POLLERR | POLLHUP;
+      revents &= ~(POLLALWAYS | EPOLLET | EPOLLONESHOT | EPOLLEXCLUSIVE);
+      if (revents == 0)
         {
           continue;
         }
 
-      /* Teradown all the notified fd */
-
-      file_poll(epn->filep, &epn->pfd, false);
-      list_delete(&epn->node);
+      evs[i].data     = epn->data;
+      evs[i++].events = revents;
 
-      if (epn->pfd.revents != 0 && i < maxevents)
+      if ((epn->pfd.events & EPOLLONESHOT) != 0)
         {
-          evs[i].data     = epn->data;
-          evs[i++].events = epn->pfd.revents;
-          if ((epn->pfd.events & EPOLLONESHOT) != 0)
-            {
-              list_add_tail(&eph->oneshot, &epn->node);
-            }
-          else
-            {
-              list_add_tail(&eph->teardown, &epn->node);
-            }
+          epoll_disarm(epn);
+          list_delete(&epn->node);
+          list_add_tail(&eph->oneshot, &epn->node);
         }
-      else
+      else if ((epn->pfd.events & EPOLLET) == 0)
         {
-          list_add_tail(&eph->teardown, &epn->node);
+          /* Still ready, check it again on the next call */
+
+          flags = spin_lock_irqsave(&eph->rdlock);
+          if (!list_in_list(&epn->rdnode))
+            {
+              list_add_tail(&eph->ready, &epn->rdnode);
+            }
+
+          spin_unlock_irqrestore(&eph->rdlock, flags);
         }
     }
 
+  /* The nodes that did not fit in evs go back in front of the ready list */
+
+  flags = spin_lock_irqsave(&eph->rdlock);
+  epoll_splice(&eph->ready, &harvest);
+  spin_unlock_irqrestore(&eph->rdlock, flags);
+
   nxmutex_unlock(&eph->lock);
   return i;
 }
@@ -389,7 +610,8 @@ static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
  *
  * Description:
  *   The default epoll callback function, this function do the final step of
- *   poll notification.
+ *   poll notification: queue the epoll node on the ready list of its epoll
+ *   instance and wake up the waiter.
  *
  * Input Parameters:
  *   fds - The fds
@@ -402,16 +624,34 @@ static int epoll_teardown(FAR epoll_head_t *eph, FAR struct epoll_event *evs,
 static void epoll_default_cb(FAR struct pollfd *fds)
 {
   FAR epoll_node_t *epn = fds->arg;
+  FAR epoll_head_t *eph = epn->eph;
+  irqstate_t flags;
   int semcount = 0;
 
-  epn->notified = true;
-  if (fds->revents != 0)
+  if ((fds->revents & ~POLLALWAYS) == 0)
     {
-      nxsem_get_value(&epn->eph->sem, &semcount);
-      if (semcount < 1)
-        {
-          nxsem_post(&epn->eph->sem);
-        }
+      return;
+    }
+
+  flags = spin_lock_irqsave(&eph->rdlock);
+  if (!list_in_list(&epn->rdnode))
+    {
+      list_add_tail(&eph->ready, &epn->rdnode);
+    }
+
+  spin_unlock_irqrestore(&eph->rdlock, flags);
+
+  if ((fds->events & EPOLLEXCLUSIVE) != 0 && epoll_exclusive_claimed(epn))
+    {
+      /* Another instance is woken for this file already */
+
+      return;
+    }
+
+  nxsem_get_value(&eph->sem, &semcount);
+  if (semcount < 1)
+    {
+      nxsem_post(&eph->sem);
     }
 }
 
@@ -484,6 +724,7 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
   FAR struct file *filep;
   FAR epoll_head_t *eph;
   FAR epoll_node_t *epn;
+  irqstate_t flags;
   int ret;
   int i;
 
@@ -505,33 +746,21 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
       case EPOLL_CTL_ADD:
         finfo("%p CTL ADD: fd=%d ev=%08" PRIx32 "\n", eph, fd, ev->events);
 
-        /* Check repetition */
+        /* EPOLLEXCLUSIVE cannot be combined with EPOLLONESHOT */
 
-        list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
+        if ((ev->events & (EPOLLEXCLUSIVE | EPOLLONESHOT)) ==
+            (EPOLLEXCLUSIVE | EPOLLONESHOT))
           {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
+            ret = -EINVAL;
+            goto err;
           }
 
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
-          }
+        /* Check repetition */
 
-        list_for_every_entry(&eph->oneshot, epn, epoll_node_t, node)
+        if (epoll_find(eph, fd) != NULL)
           {
-            if (epn->pfd.fd == fd)
-              {
-                ret = -EEXIST;
-                goto err;
-              }
+            ret = -EEXIST;
+            goto err;
           }
 
         if (list_is_empty(&eph->free))
@@ -561,12 +790,13 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
         epn = container_of(list_remove_head(&eph->free), epoll_node_t, node);
         epn->eph         = eph;
         epn->data        = ev->data;
-        epn->notified    = false;
         epn->pfd.events  = ev->events | POLLALWAYS;
         epn->pfd.fd      = fd;
         epn->pfd.arg     = epn;
         epn->pfd.cb      = epoll_default_cb;
         epn->pfd.revents = 0;
+        list_clear_node(&epn->rdnode);
+        list_clear_node(&epn->exnode);
 
         ret = file_get(fd, &epn->filep);
         if (ret < 0)
@@ -575,9 +805,17 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
             goto err;
           }
 
-        ret = file_poll(epn->filep, &epn->pfd, true);
+        if ((ev->events & EPOLLEXCLUSIVE) != 0)
+          {
+            flags = spin_lock_irqsave(&g_epoll_exlock);
+            list_add_tail(&g_epoll_exclusive, &epn->exnode);
+            spin_unlock_irqrestore(&g_epoll_exlock, flags);
+          }
+
+        ret = epoll_arm(epn);
         if (ret < 0)
           {
+            epoll_exclusive_remove(epn);
             file_put(epn->filep);
             list_add_tail(&eph->free, &epn->node);
             goto err;
@@ -592,18 +830,8 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
           {
             if (epn->pfd.fd == fd)
               {
-                file_poll(epn->filep, &epn->pfd, false);
-                file_put(epn->filep);
-                list_delete(&epn->node);
-                list_add_tail(&eph->free, &epn->node);
-                goto out;
-              }
-          }
-
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
+                epoll_disarm(epn);
+                epoll_exclusive_remove(epn);
                 file_put(epn->filep);
                 list_delete(&epn->node);
                 list_add_tail(&eph->free, &epn->node);
@@ -626,49 +854,43 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
 
       case EPOLL_CTL_MOD:
         finfo("%p CTL MOD: fd=%d ev=%08" PRIx32 "\n", eph, fd, ev->events);
+
+        /* EPOLLEXCLUSIVE may only be given to EPOLL_CTL_ADD */
+
+        if ((ev->events & EPOLLEXCLUSIVE) != 0)
+          {
+            ret = -EINVAL;
+            goto err;
+          }
+
         list_for_every_entry(&eph->setup, epn, epoll_node_t, node)
           {
             if (epn->pfd.fd == fd)
               {
-                if (epn->pfd.events != (ev->events | POLLALWAYS))
+                if ((epn->pfd.events & EPOLLEXCLUSIVE) != 0)
                   {
-                    file_poll(epn->filep, &epn->pfd, false);
-
-                    epn->notified    = false;
-                    epn->data        = ev->data;
-                    epn->pfd.events  = ev->events | POLLALWAYS;
-                    epn->pfd.revents = 0;
-
-                    ret = file_poll(epn->filep, &epn->pfd, true);
-                    if (ret < 0)
-                      {
-                        goto err;
-                      }
+                    ret = -EINVAL;
+                    goto err;
                   }
 
-                goto out;
-              }
-          }
+                /* Unchanged level-triggered events need no new setup, the
+                 * node is checked again whenever it is reported.  Any
+                 * other MOD re-arms the node, so that a pending EPOLLET
+                 * or EPOLLONESHOT event is reported once more.
+                 */
 
-        list_for_every_entry(&eph->teardown, epn, epoll_node_t, node)
-          {
-            if (epn->pfd.fd == fd)
-              {
-                if (epn->pfd.events != (ev->events | POLLALWAYS))
+                epn->data = ev->data;
+                if (epn->pfd.events != (ev->events | POLLALWAYS) ||
+                    (ev->events & (EPOLLET | EPOLLONESHOT)) != 0)
                   {
-                    epn->notified    = false;
-                    epn->data        = ev->data;
-                    epn->pfd.events  = ev->events | POLLALWAYS;
-                    epn->pfd.revents = 0;
+                    epoll_disarm(epn);
+                    epn->pfd.events = ev->events | POLLALWAYS;
 
-                    ret = file_poll(epn->filep, &epn->pfd, true);
+                    ret = epoll_arm(epn);
                     if (ret < 0)
                       {
                         goto err;
                       }
-
-                    list_delete(&epn->node);
-                    list_add_tail(&eph->setup, &epn->node);
                   }
 
                 goto out;
@@ -679,12 +901,10 @@ int epoll_ctl(int epfd, int op, int fd, FAR struct epoll_event *ev)
           {
             if (epn->pfd.fd == fd)
               {
-                epn->notified    = false;
-                epn->data        = ev->data;
-                epn->pfd.events  = ev->events | POLLALWAYS;
-                epn->pfd.revents = 0;
+                epn->data       = ev->data;
+                epn->pfd.events = ev->events | POLLALWAYS;
 
-                ret = file_poll(epn->filep, &epn->pfd, true);
+                ret = epoll_arm(epn);
                 if (ret < 0)
                   {
                     goto err;
@@ -734,21 +954,18 @@ int epoll_pwait(int epfd, FAR struct epoll_event *evs,
     }
 
 retry:
-  ret = epoll_setup(eph);
-  if (ret < 0)
+  ret = epoll_harvest(eph, evs, maxevents);
+  if (ret != 0 || timeout == 0)
     {
-      goto err;
+      goto done;
     }
 
   /* Wait the poll ready */
 
   nxsig_procmask(SIG_SETMASK, sigmask, &oldsigmask);
+  atomic_fetch_add(&eph->waiters, 1);
 
-  if (timeout == 0)
-    {
-      ret = -ETIMEDOUT;
-    }
-  else if (timeout > 0)
+  if (timeout > 0)
     {
       ret = nxsem_tickwait(&eph->sem, MSEC2TICK(timeout));
     }
@@ -757,20 +974,21 @@ retry:
       ret = nxsem_wait(&eph->sem);
     }
 
+  atomic_fetch_sub(&eph->waiters, 1);
   nxsig_procmask(SIG_SETMASK, &oldsigmask, NULL);
-  if (ret < 0 && ret != -ETIMEDOUT)
+  if (ret >= 0)
     {
-      goto err;
+      goto retry;
     }
-  else /* ret >= 0 or ret == -ETIMEDOUT */
+  else if (ret == -ETIMEDOUT)
     {
-      int num = epoll_teardown(eph, evs, maxevents);
-      if (num == 0 && ret >= 0)
-        {
-          goto retry;
-        }
+      ret = epoll_harvest(eph, evs, maxevents);
+    }
 
-      ret = num;
+done:
+  if (ret < 0)
+    {
+      goto err;
     }
 
   file_put(filep);
@@ -809,19 +1027,17 @@ int epoll_wait(int epfd, FAR struct epoll_event *evs,
     }
 
 retry:
-  ret = epoll_setup(eph);
-  if (ret < 0)
+  ret = epoll_harvest(eph, evs, maxevents);
+  if (ret != 0 || timeout == 0)
     {
-      goto err;
+      goto done;
     }
 
   /* Wait the poll ready */
 
-  if (timeout == 0)
-    {
-      ret = -ETIMEDOUT;
-    }
-  else if (timeout > 0)
+  atomic_fetch_add(&eph->waiters, 1);
+
+  if (timeout > 0)
     {
       ret = nxsem_tickwait(&eph->sem, MSEC2TICK(timeout));
     }
@@ -830,19 +1046,20 @@ retry:
       ret = nxsem_wait(&eph->sem);
     }
 
-  if (ret < 0 && ret != -ETIMEDOUT)
+  atomic_fetch_sub(&eph->waiters, 1);
+  if (ret >= 0)
     {
-      goto err;
+      goto retry;
     }
-  else /* ret >= 0 or ret == -ETIMEDOUT */
+  else if (ret == -ETIMEDOUT)
     {
-      int num = epoll_teardown(eph, evs, maxevents);
-      if (num == 0 && ret >= 0)
-        {
-          goto retry;
-        }
+      ret = epoll_harvest(eph, evs, maxevents);
+    }
 
-      ret = num;
+done:
+  if (ret < 0)
+    {
+      goto err;
     }
 
   file_put(filep);
@@ -70,6 +70,7 @@ static int pseudorename(FAR const char *oldpath, FAR struct inode *oldinode,
 {
   struct inode_search_s newdesc;
   FAR struct inode *newinode;
+  FAR struct inode *child;
   FAR char *subdir = NULL;
 #ifdef CONFIG_FS_NOTIFY
   bool isdir = INODE_IS_PSEUDODIR(oldinode);
@@ -221,6 +222,11 @@ static int pseudorename(FAR const char *oldpath, FAR struct inode *oldinode,
 
   /* Remove all of the children from the unlinked inode */
 
+  for (child = oldinode->i_child; child != NULL; child = child->i_peer)
+    {
+      child->i_parent = newinode;
+    }
+
   oldinode->i_child  = NULL;
   oldinode->i_parent = NULL;
   ret = OK;
@@ -0,0 +1,373 @@
+/****************************************************************************
+ * fs/vfs/fs_splice.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/uio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: file_is_pipe
+ ****************************************************************************/
+
+static bool file_is_pipe(FAR struct file *filep)
+{
+  return filep->f_inode != NULL && INODE_IS_PIPE(filep->f_inode);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: file_splice
+ *
+ * Description:
+ *   Equivalent to the standard splice() function except that is accepts
+ *   struct file instances instead of file descriptors.
+ *
+ ****************************************************************************/
+
+ssize_t file_splice(FAR struct file *infile, FAR off_t *inoff,
+                    FAR struct file *outfile, FAR off_t *outoff,
+                    size_t len, unsigned int flags)
+{
+  struct pipe_splice_s splice;
+
+  if ((infile->f_oflags & O_RDOK) == 0 ||
+      (outfile->f_oflags & O_WROK) == 0)
+    {
+      return -EBADF;
+    }
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  splice.ps_iov      = NULL;
+  splice.ps_niov     = 0;
+  splice.ps_len      = len;
+  splice.ps_nonblock = (flags & SPLICE_F_NONBLOCK) != 0;
+
+  /* The pipe does the transfer to or from its own buffer.  When both
+   * ends are pipes the data goes straight from one buffer to the other.
+   */
+
+  if (file_is_pipe(infile))
+    {
+      if (inoff != NULL)
+        {
+          return -ESPIPE;
+        }
+
+      splice.ps_file   = outfile;
+      splice.ps_offset = outoff;
+      splice.ps_mode   = PIPE_SPLICE_OUT;
+      return file_ioctl(infile, PIPEIOC_SPLICE, &splice);
+    }
+  else if (file_is_pipe(outfile))
+    {
+      if (outoff != NULL)
+        {
+          return -ESPIPE;
+        }
+
+      splice.ps_file   = infile;
+      splice.ps_offset = inoff;
+      splice.ps_mode   = PIPE_SPLICE_IN;
+      return file_ioctl(outfile, PIPEIOC_SPLICE, &splice);
+    }
+
+  /* One of the two must be a pipe */
+
+  return -EINVAL;
+}
+
+/****************************************************************************
+ * Name: file_tee
+ *
+ * Description:
+ *   Equivalent to the standard tee() function except that is accepts
+ *   struct file instances instead of file descriptors.
+ *
+ ****************************************************************************/
+
+ssize_t file_tee(FAR struct file *infile, FAR struct file *outfile,
+                 size_t len, unsigned int flags)
+{
+  struct pipe_splice_s splice;
+
+  if (!file_is_pipe(infile) || !file_is_pipe(outfile))
+    {
+      return -EINVAL;
+    }
+
+  if ((infile->f_oflags & O_RDOK) == 0 ||
+      (outfile->f_oflags & O_WROK) == 0)
+    {
+      return -EBADF;
+    }
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  splice.ps_file     = outfile;
+  splice.ps_offset   = NULL;
+  splice.ps_iov      = NULL;
+  splice.ps_niov     = 0;
+  splice.ps_len      = len;
+  splice.ps_mode     = PIPE_SPLICE_TEE;
+  splice.ps_nonblock = (flags & SPLICE_F_NONBLOCK) != 0;
+  return file_ioctl(infile, PIPEIOC_SPLICE, &splice);
+}
+
+/****************************************************************************
+ * Name: file_vmsplice
+ *
+ * Description:
+ *   Equivalent to the standard vmsplice() function except that is accepts
+ *   a struct file instance instead of a file descriptor.
+ *
+ *   There is no virtual memory to remap, so the user pages are copied into
+ *   (or out of) the pipe buffer with a single copy.  SPLICE_F_GIFT is
+ *   accepted and ignored.
+ *
+ ****************************************************************************/
+
+ssize_t file_vmsplice(FAR struct file *filep, FAR const struct iovec *iov,
+                      size_t nr_segs, unsigned int flags)
+{
+  struct pipe_splice_s splice;
+
+  if (!file_is_pipe(filep))
+    {
+      return -EBADF;
+    }
+
+  if (nr_segs > IOV_MAX)
+    {
+      return -EINVAL;
+    }
+
+  /* Fill the pipe if this is its write end, otherwise drain it.  The pipe
+   * is told not to wait, rather than changing the flags of the descriptor
+   * that other threads may share.
+   */
+
+  splice.ps_file     = NULL;
+  splice.ps_offset   = NULL;
+  splice.ps_iov      = iov;
+  splice.ps_niov     = nr_segs;
+  splice.ps_len      = 0;
+  splice.ps_mode     = (filep->f_oflags & O_WROK) != 0 ?
+                       PIPE_SPLICE_VMIN : PIPE_SPLICE_VMOUT;
+  splice.ps_nonblock = (flags & SPLICE_F_NONBLOCK) != 0 ||
+                       (filep->f_oflags & O_NONBLOCK) != 0;
+  return file_ioctl(filep, PIPEIOC_SPLICE, &splice);
+}
+
+/****************************************************************************
+ * Name: splice
+ *
+ * Description:
+ *   splice() moves data between two file descriptors where one of them is
+ *   a pipe, without copying it through a user space buffer.  Data leaving
+ *   or entering a pipe is written from or read into the pipe buffer in
+ *   place.  The pipe stays unlocked while the other file (or socket)
+ *   blocks, only its other readers (or writers) wait.  Between two pipes
+ *   the data is copied from one buffer to the other once.
+ *
+ * Input Parameters:
+ *   fd_in   - The descriptor to read from
+ *   off_in  - Offset in fd_in to read from, NULL to use (and update) the
+ *             file position.  Must be NULL for a pipe.
+ *   fd_out  - The descriptor to write to
+ *   off_out - Offset in fd_out to write to, as off_in.
+ *   len     - The maximum number of bytes to move
+ *   flags   - SPLICE_F_* flags.  SPLICE_F_NONBLOCK makes the operation
+ *             non-blocking on the pipe(s).
+ *
+ * Returned Value:
+ *   The number of bytes moved, 0 at end of input.  On error, -1 is returned
+ *   and errno is set appropriately:
+ *
+ *   EBADF  - A descriptor is not valid or not open in the right mode.
+ *   EINVAL - Neither descriptor refers to a pipe.
+ *   ESPIPE - An offset was given for a pipe.
+ *   EAGAIN - SPLICE_F_NONBLOCK was given and the operation would block.
+ *
+ ****************************************************************************/
+
+ssize_t splice(int fd_in, FAR off_t *off_in, int fd_out,
+               FAR off_t *off_out, size_t len, unsigned int flags)
+{
+  FAR struct file *infile;
+  FAR struct file *outfile;
+  ssize_t ret;
+
+  ret = file_get(fd_in, &infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = file_get(fd_out, &outfile);
+  if (ret < 0)
+    {
+      file_put(infile);
+      goto errout;
+    }
+
+  ret = file_splice(infile, off_in, outfile, off_out, len, flags);
+  file_put(outfile);
+  file_put(infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: tee
+ *
+ * Description:
+ *   tee() duplicates up to len bytes from the pipe fd_in into the pipe
+ *   fd_out without consuming them, so that they can still be read or
+ *   spliced from fd_in afterwards.
+ *
+ * Input Parameters:
+ *   fd_in  - The pipe to copy from
+ *   fd_out - The pipe to copy to
+ *   len    - The maximum number of bytes to copy
+ *   flags  - SPLICE_F_* flags
+ *
+ * Returned Value:
+ *   The number of bytes duplicated, 0 if fd_in is empty and has no
+ *   writers.  On error, -1 is returned and errno is set appropriately.
+ *
+ ****************************************************************************/
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags)
+{
+  FAR struct file *infile;
+  FAR struct file *outfile;
+  ssize_t ret;
+
+  ret = file_get(fd_in, &infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = file_get(fd_out, &outfile);
+  if (ret < 0)
+    {
+      file_put(infile);
+      goto errout;
+    }
+
+  ret = file_tee(infile, outfile, len, flags);
+  file_put(outfile);
+  file_put(infile);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: vmsplice
+ *
+ * Description:
+ *   vmsplice() moves the user memory described by iov into the pipe fd if
+ *   it is the write end of a pipe, or moves data from the pipe into the
+ *   memory if it is the read end.
+ *
+ * Input Parameters:
+ *   fd      - The pipe
+ *   iov     - The user memory segments
+ *   nr_segs - The number of segments in iov
+ *   flags   - SPLICE_F_* flags.  SPLICE_F_NONBLOCK makes the operation
+ *             non-blocking on the pipe.
+ *
+ * Returned Value:
+ *   The number of bytes transferred.  On error, -1 is returned and errno is
+ *   set appropriately (EAGAIN if SPLICE_F_NONBLOCK was given and the pipe
+ *   is full or empty).
+ *
+ ****************************************************************************/
+
+ssize_t vmsplice(int fd, FAR const struct iovec *iov, size_t nr_segs,
+                 unsigned int flags)
+{
+  FAR struct file *filep;
+  ssize_t ret;
+
+  ret = file_get(fd, &filep);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = file_vmsplice(filep, iov, nr_segs, flags);
+  file_put(filep);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return ret;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
@@ -28,8 +28,11 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
+#include <debug.h>
+#include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
+#include <nuttx/list.h>
 #include <nuttx/mutex.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/fs.h>
@@ -39,10 +42,68 @@
 
 #include "fs_heap.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Size of the deflate window saved at each access point */
+
+#define ZIPFS_WINSIZE   32768
+
+/* Output distance between access points, 0 without the index */
+
+#ifdef CONFIG_ZIPFS_INDEX
+#  define ZIPFS_INDEX_SPAN CONFIG_ZIPFS_INDEX_SPAN
+#else
+#  define ZIPFS_INDEX_SPAN 0
+#endif
+
+/* Compression methods that are read without going through minizip */
+
+#define ZIPFS_STORED    0
+#define ZIPFS_DEFLATED  Z_DEFLATED
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+/* A point in a deflate stream where inflation can be restarted: the
+ * position in both streams, the bits of the last input byte that belong
+ * to the point, and the window of output that precedes it.
+ */
+
+struct zipfs_point_s
+{
+  off_t out;                      /* Offset in the uncompressed data */
+  off_t in;                       /* Offset in the compressed data */
+  int bits;                       /* Unused bits of the byte before 'in' */
+  uint8_t window[ZIPFS_WINSIZE];  /* Preceding uncompressed data */
+};
+
+/* One archive member, found by name in the mount's hash table */
+
+struct zipfs_entry_s
+{
+  FAR struct zipfs_entry_s *next;    /* Next entry in the hash chain */
+  uint32_t hash;                     /* Hash of the name */
+  unz64_file_pos pos;                /* Position in the central directory */
+  bool indexed;                      /* The access points have been built */
+  size_t npoints;                    /* Number of access points */
+  FAR struct zipfs_point_s **points; /* Access points, by offset */
+  char name[1];
+};
+
+/* One cached block of uncompressed data */
+
+struct zipfs_block_s
+{
+  struct list_node node;             /* LRU list, most recent first */
+  FAR struct zipfs_entry_s *entry;   /* Owner, NULL if the block is free */
+  off_t blockno;                     /* Block number within the entry */
+  size_t len;                        /* Valid bytes, short at end of file */
+  uint8_t data[1];
+};
+
 struct zipfs_dir_s
 {
   struct fs_dirent_s base;
@@ -53,6 +114,10 @@ struct zipfs_dir_s
 
 struct zipfs_mountpt_s
 {
+  mutex_t lock;                      /* Protects the index and the cache */
+  uint32_t hashmask;                 /* Size of the hash table - 1 */
+  FAR struct zipfs_entry_s **hash;   /* Archive members by name */
+  struct list_node lru;              /* Block cache, most recent first */
   char abspath[1];
 };
 
@@ -61,6 +126,23 @@ struct zipfs_file_s
   unzFile uf;
   mutex_t lock;
   FAR char *seekbuf;
+  FAR struct zipfs_entry_s *entry;
+
+  /* Stored and deflated members are read directly from the archive so
+   * that they can be positioned without inflating from the start.
+   */
+
+  bool direct;                       /* Read through 'raw' below */
+  int method;                        /* ZIPFS_STORED or ZIPFS_DEFLATED */
+  struct file raw;                   /* The archive */
+  off_t dataoff;                     /* Offset of the member data */
+  off_t csize;                       /* Compressed size */
+  off_t size;                        /* Uncompressed size */
+  z_stream strm;                     /* Inflate state */
+  FAR uint8_t *inbuf;                /* Compressed input buffer */
+  off_t inpos;                       /* Compressed bytes fed to strm */
+  off_t outpos;                      /* Uncompressed position of strm, -1
+                                      * if strm must be restarted */
   char relpath[1];
 };
 
@@ -243,6 +325,725 @@ static int zipfs_convert_result(int ziperr)
     }
 }
 
+static uint32_t zipfs_hash(FAR const char *name)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*name != '\0')
+    {
+      hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+
+  return hash;
+}
+
+static FAR struct zipfs_entry_s *
+zipfs_find_entry(FAR struct zipfs_mountpt_s *fs, FAR const char *name)
+{
+  FAR struct zipfs_entry_s *entry;
+  uint32_t hash = zipfs_hash(name);
+
+  for (entry = fs->hash[hash & fs->hashmask]; entry != NULL;
+       entry = entry->next)
+    {
+      if (entry->hash == hash && strcmp(entry->name, name) == 0)
+        {
+          return entry;
+        }
+    }
+
+  return NULL;
+}
+
+static int zipfs_locate(FAR struct zipfs_mountpt_s *fs, unzFile uf,
+                        FAR const char *relpath,
+                        FAR struct zipfs_entry_s **entryp)
+{
+  FAR struct zipfs_entry_s *entry;
+
+  entry = zipfs_find_entry(fs, relpath);
+  if (entry == NULL)
+    {
+      return -ENOENT;
+    }
+
+  if (entryp != NULL)
+    {
+      *entryp = entry;
+    }
+
+  return zipfs_convert_result(unzGoToFilePos64(uf, &entry->pos));
+}
+
+/* Hash the central directory once at mount time, so that opening a file
+ * doesn't search it linearly.
+ */
+
+static int zipfs_build_map(FAR struct zipfs_mountpt_s *fs, unzFile uf)
+{
+  FAR struct zipfs_entry_s *entry;
+  unz_global_info64 global_info;
+  unz_file_info64 file_info;
+  FAR char *name;
+  uint32_t nhash = 16;
+  int ret;
+
+  ret = zipfs_convert_result(unzGetGlobalInfo64(uf, &global_info));
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  while (nhash < global_info.number_entry && nhash < (1u << 16))
+    {
+      nhash <<= 1;
+    }
+
+  fs->hash = fs_heap_zalloc(nhash * sizeof(FAR struct zipfs_entry_s *));
+  if (fs->hash == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  fs->hashmask = nhash - 1;
+
+  name = fs_heap_malloc(PATH_MAX);
+  if (name == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ret = zipfs_convert_result(unzGoToFirstFile(uf));
+  while (ret >= 0)
+    {
+      ret = unzGetCurrentFileInfo64(uf, &file_info, name, PATH_MAX,
+                                    NULL, 0, NULL, 0);
+      ret = zipfs_convert_result(ret);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      entry = fs_heap_zalloc(sizeof(*entry) + strlen(name));
+      if (entry == NULL)
+        {
+          ret = -ENOMEM;
+          break;
+        }
+
+      ret = zipfs_convert_result(unzGetFilePos64(uf, &entry->pos));
+      if (ret < 0)
+        {
+          fs_heap_free(entry);
+          break;
+        }
+
+      strcpy(entry->name, name);
+      entry->hash = zipfs_hash(name);
+      entry->next = fs->hash[entry->hash & fs->hashmask];
+      fs->hash[entry->hash & fs->hashmask] = entry;
+
+      ret = zipfs_convert_result(unzGoToNextFile(uf));
+    }
+
+  fs_heap_free(name);
+  return ret == -ENOENT ? OK : ret;
+}
+
+static void zipfs_free_mount(FAR struct zipfs_mountpt_s *fs)
+{
+  FAR struct zipfs_entry_s *entry;
+  FAR struct zipfs_block_s *blk;
+  uint32_t i;
+  size_t j;
+
+  while ((blk = list_remove_head_type(&fs->lru, struct zipfs_block_s,
+                                      node)) != NULL)
+    {
+      fs_heap_free(blk);
+    }
+
+  if (fs->hash != NULL)
+    {
+      for (i = 0; i <= fs->hashmask; i++)
+        {
+          while ((entry = fs->hash[i]) != NULL)
+            {
+              fs->hash[i] = entry->next;
+              for (j = 0; j < entry->npoints; j++)
+                {
+                  fs_heap_free(entry->points[j]);
+                }
+
+              fs_heap_free(entry->points);
+              fs_heap_free(entry);
+            }
+        }
+
+      fs_heap_free(fs->hash);
+    }
+
+  nxmutex_destroy(&fs->lock);
+  fs_heap_free(fs);
+}
+
+/* Feed the next chunk of compressed data to the inflate state.  Returns
+ * the number of bytes fed, 0 at the end of the member.
+ */
+
+static ssize_t zipfs_fill(FAR struct zipfs_file_s *fp)
+{
+  ssize_t nread;
+  size_t size;
+
+  size = MIN(CONFIG_ZIPFS_SEEK_BUFSIZE, fp->csize - fp->inpos);
+  if (size == 0)
+    {
+      return 0;
+    }
+
+  nread = file_pread(&fp->raw, fp->inbuf, size, fp->dataoff + fp->inpos);
+  if (nread <= 0)
+    {
+      return nread < 0 ? nread : -EIO;
+    }
+
+  fp->strm.next_in  = fp->inbuf;
+  fp->strm.avail_in = nread;
+  fp->inpos        += nread;
+  return nread;
+}
+
+/* Restart inflation at an access point, or at the start of the member if
+ * 'point' is NULL.
+ */
+
+static int zipfs_restart(FAR struct zipfs_file_s *fp,
+                         FAR struct zipfs_point_s *point)
+{
+  uint8_t byte;
+  ssize_t ret;
+
+  fp->outpos = -1;
+  if (inflateReset(&fp->strm) != Z_OK)
+    {
+      return -EIO;
+    }
+
+  fp->strm.avail_in = 0;
+  fp->inpos         = 0;
+
+  if (point != NULL)
+    {
+      if (point->bits != 0)
+        {
+          ret = file_pread(&fp->raw, &byte, 1,
+                           fp->dataoff + point->in - 1);
+          if (ret != 1)
+            {
+              return ret < 0 ? ret : -EIO;
+            }
+
+          inflatePrime(&fp->strm, point->bits, byte >> (8 - point->bits));
+        }
+
+      inflateSetDictionary(&fp->strm, point->window, ZIPFS_WINSIZE);
+      fp->inpos  = point->in;
+      fp->outpos = point->out;
+    }
+  else
+    {
+      fp->outpos = 0;
+    }
+
+  return OK;
+}
+
+/* Inflate up to 'len' bytes at the current position */
+
+static ssize_t zipfs_inflate(FAR struct zipfs_file_s *fp,
+                             FAR uint8_t *buf, size_t len)
+{
+  ssize_t ret;
+  size_t nout;
+
+  fp->strm.next_out  = buf;
+  fp->strm.avail_out = len;
+
+  while (fp->strm.avail_out > 0)
+    {
+      if (fp->strm.avail_in == 0)
+        {
+          ret = zipfs_fill(fp);
+          if (ret <= 0)
+            {
+              if (ret < 0)
+                {
+                  fp->outpos = -1;
+                  return ret;
+                }
+
+              break;
+            }
+        }
+
+      ret = inflate(&fp->strm, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END)
+        {
+          break;
+        }
+      else if (ret != Z_OK)
+        {
+          fp->outpos = -1;
+          return ret == Z_MEM_ERROR ? -ENOMEM : -EIO;
+        }
+    }
+
+  nout        = len - fp->strm.avail_out;
+  fp->outpos += nout;
+  return nout;
+}
+
+#ifdef CONFIG_ZIPFS_INDEX
+/* Free an array of access points */
+
+static void zipfs_free_points(FAR struct zipfs_point_s **points,
+                              size_t npoints)
+{
+  while (npoints > 0)
+    {
+      fs_heap_free(points[--npoints]);
+    }
+
+  fs_heap_free(points);
+}
+
+/* Inflate the whole member once and save an access point about every
+ * CONFIG_ZIPFS_INDEX_SPAN bytes of output, at deflate block boundaries,
+ * like zlib's zran example.  The index is built without the mount lock,
+ * so that other files of the mount aren't held off while the member is
+ * inflated, and is then published under the lock in one go.  If another
+ * file of the same member won the race, its index is kept.  A failed
+ * build still publishes the points saved before the error, which are
+ * valid, so that later seeks don't inflate the member all over again.
+ */
+
+static int zipfs_build_index(FAR struct zipfs_mountpt_s *fs,
+                             FAR struct zipfs_file_s *fp)
+{
+  FAR struct zipfs_entry_s *entry = fp->entry;
+  FAR struct zipfs_point_s **points = NULL;
+  FAR struct zipfs_point_s **newpoints;
+  FAR struct zipfs_point_s *point;
+  FAR uint8_t *window;
+  size_t npoints = 0;
+  off_t last = 0;
+  size_t left;
+  ssize_t ret;
+
+  window = fs_heap_malloc(ZIPFS_WINSIZE);
+  if (window == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ret = zipfs_restart(fp, NULL);
+  fp->strm.avail_out = 0;
+
+  while (ret >= 0)
+    {
+      if (fp->strm.avail_in == 0)
+        {
+          ret = zipfs_fill(fp);
+          if (ret <= 0)
+            {
+              ret = ret < 0 ? ret : -EIO;
+              break;
+            }
+        }
+
+      if (fp->strm.avail_out == 0)
+        {
+          fp->strm.next_out  = window;
+          fp->strm.avail_out = ZIPFS_WINSIZE;
+        }
+
+      ret = inflate(&fp->strm, Z_BLOCK);
+      if (ret == Z_STREAM_END)
+        {
+          ret = OK;
+          break;
+        }
+      else if (ret != Z_OK)
+        {
+          ret = ret == Z_MEM_ERROR ? -ENOMEM : -EIO;
+          break;
+        }
+
+      /* At the end of a block (but not the last one)? */
+
+      if ((fp->strm.data_type & 128) == 0 ||
+          (fp->strm.data_type & 64) != 0 ||
+          fp->strm.total_out - last <= CONFIG_ZIPFS_INDEX_SPAN)
+        {
+          continue;
+        }
+
+      point = fs_heap_malloc(sizeof(*point));
+      newpoints = fs_heap_realloc(points, (npoints + 1) *
+                                  sizeof(FAR struct zipfs_point_s *));
+      if (point == NULL || newpoints == NULL)
+        {
+          fs_heap_free(point);
+          if (newpoints != NULL)
+            {
+              points = newpoints;
+            }
+
+          ret = -ENOMEM;
+          break;
+        }
+
+      point->out  = fp->strm.total_out;
+      point->in   = fp->inpos - fp->strm.avail_in;
+      point->bits = fp->strm.data_type & 7;
+
+      left = fp->strm.avail_out;
+      if (left > 0)
+        {
+          memcpy(point->window, window + ZIPFS_WINSIZE - left, left);
+        }
+
+      memcpy(point->window + left, window, ZIPFS_WINSIZE - left);
+
+      points = newpoints;
+      points[npoints++] = point;
+      last = point->out;
+    }
+
+  fs_heap_free(window);
+
+  /* The stream is at the end of the member now */
+
+  fp->outpos = -1;
+  if (ret < 0)
+    {
+      ferr("ERROR: zipfs index of %s failed: %zd\n", entry->name, ret);
+    }
+
+  nxmutex_lock(&fs->lock);
+  if (entry->indexed)
+    {
+      nxmutex_unlock(&fs->lock);
+      zipfs_free_points(points, npoints);
+      return ret < 0 ? ret : OK;
+    }
+
+  entry->points  = points;
+  entry->npoints = npoints;
+  entry->indexed = true;
+  nxmutex_unlock(&fs->lock);
+  return ret < 0 ? ret : OK;
+}
+#endif
+
+/* Return the last access point at or before 'target', building the index
+ * on the first request.  NULL means to start from the beginning.  The
+ * points of a published index are never changed until the unmount, so
+ * the one returned stays valid.
+ */
+
+static FAR struct zipfs_point_s *
+zipfs_find_point(FAR struct zipfs_mountpt_s *fs,
+                 FAR struct zipfs_file_s *fp, off_t target)
+{
+  FAR struct zipfs_point_s *point = NULL;
+#ifdef CONFIG_ZIPFS_INDEX
+  FAR struct zipfs_entry_s *entry = fp->entry;
+  size_t low;
+  size_t high;
+  size_t mid;
+
+  if (fp->size <= CONFIG_ZIPFS_INDEX_SPAN)
+    {
+      return NULL;
+    }
+
+  nxmutex_lock(&fs->lock);
+  if (!entry->indexed)
+    {
+      nxmutex_unlock(&fs->lock);
+
+      /* Even a failed build leaves the points saved before the error */
+
+      zipfs_build_index(fs, fp);
+      nxmutex_lock(&fs->lock);
+    }
+
+  low  = 0;
+  high = entry->npoints;
+  while (low < high)
+    {
+      mid = (low + high) / 2;
+      if (entry->points[mid]->out <= target)
+        {
+          point = entry->points[mid];
+          low   = mid + 1;
+        }
+      else
+        {
+          high  = mid;
+        }
+    }
+
+  nxmutex_unlock(&fs->lock);
+#endif
+
+  return point;
+}
+
+/* Bring the inflate state to 'target', restarting from the closest access
+ * point if that is shorter than inflating forward.  'scratch' receives the
+ * data that is skipped.
+ */
+
+static int zipfs_position(FAR struct zipfs_mountpt_s *fs,
+                          FAR struct zipfs_file_s *fp, off_t target,
+                          FAR uint8_t *scratch, size_t len)
+{
+  FAR struct zipfs_point_s *point;
+  ssize_t ret;
+
+  if (fp->outpos < 0 || target < fp->outpos ||
+      target - fp->outpos > ZIPFS_INDEX_SPAN)
+    {
+      point = zipfs_find_point(fs, fp, target);
+      if (fp->outpos < 0 || target < fp->outpos ||
+          (point != NULL && point->out > fp->outpos))
+        {
+          ret = zipfs_restart(fp, point);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  while (fp->outpos < target)
+    {
+      ret = zipfs_inflate(fp, scratch, MIN(len, target - fp->outpos));
+      if (ret <= 0)
+        {
+          return ret < 0 ? ret : -EIO;
+        }
+    }
+
+  return OK;
+}
+
+static ssize_t zipfs_read_direct(FAR struct zipfs_mountpt_s *fs,
+                                 FAR struct zipfs_file_s *fp,
+                                 FAR char *buffer, size_t buflen,
+                                 off_t pos)
+{
+  ssize_t ret;
+
+  if (pos >= fp->size)
+    {
+      return 0;
+    }
+
+  buflen = MIN(buflen, fp->size - pos);
+  if (fp->method == ZIPFS_STORED)
+    {
+      return file_pread(&fp->raw, buffer, buflen, fp->dataoff + pos);
+    }
+
+  ret = zipfs_position(fs, fp, pos, (FAR uint8_t *)fp->seekbuf,
+                       CONFIG_ZIPFS_SEEK_BUFSIZE);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return zipfs_inflate(fp, (FAR uint8_t *)buffer, buflen);
+}
+
+#if CONFIG_ZIPFS_CACHE_NBLOCKS > 0
+static int zipfs_cache_init(FAR struct zipfs_mountpt_s *fs)
+{
+  FAR struct zipfs_block_s *blk;
+  int i;
+
+  for (i = 0; i < CONFIG_ZIPFS_CACHE_NBLOCKS; i++)
+    {
+      blk = fs_heap_zalloc(sizeof(*blk) + CONFIG_ZIPFS_CACHE_BLOCKSIZE - 1);
+      if (blk == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      list_add_tail(&fs->lru, &blk->node);
+    }
+
+  return OK;
+}
+
+/* Read deflated data through the mount's cache of uncompressed blocks.
+ * A missing block is inflated into the least recently used one, which is
+ * taken off the list meanwhile so that the mount lock is not held while
+ * inflating.
+ */
+
+static ssize_t zipfs_read_cached(FAR struct zipfs_mountpt_s *fs,
+                                 FAR struct zipfs_file_s *fp,
+                                 FAR char *buffer, size_t buflen,
+                                 off_t pos)
+{
+  FAR struct zipfs_block_s *blk;
+  size_t nread = 0;
+  off_t blockno;
+  size_t offset;
+  size_t nbytes;
+  ssize_t ret;
+
+  while (nread < buflen && pos < fp->size)
+    {
+      blockno = pos / CONFIG_ZIPFS_CACHE_BLOCKSIZE;
+      offset  = pos % CONFIG_ZIPFS_CACHE_BLOCKSIZE;
+
+      nxmutex_lock(&fs->lock);
+      list_for_every_entry(&fs->lru, blk, struct zipfs_block_s, node)
+        {
+          if (blk->entry == fp->entry && blk->blockno == blockno)
+            {
+              break;
+            }
+        }
+
+      if (&blk->node == &fs->lru)
+        {
+          blk = list_remove_tail_type(&fs->lru, struct zipfs_block_s,
+                                      node);
+          nxmutex_unlock(&fs->lock);
+
+          if (blk == NULL)
+            {
+              /* Every block is being filled, bypass the cache */
+
+              ret = zipfs_read_direct(fs, fp, buffer + nread,
+                                      buflen - nread, pos);
+              return ret < 0 && nread > 0 ? nread : nread + ret;
+            }
+
+          blk->entry = NULL;
+          ret = zipfs_position(fs, fp, blockno *
+                               CONFIG_ZIPFS_CACHE_BLOCKSIZE,
+                               blk->data, CONFIG_ZIPFS_CACHE_BLOCKSIZE);
+          if (ret >= 0)
+            {
+              ret = zipfs_inflate(fp, blk->data,
+                                  CONFIG_ZIPFS_CACHE_BLOCKSIZE);
+            }
+
+          nxmutex_lock(&fs->lock);
+          if (ret <= 0)
+            {
+              list_add_tail(&fs->lru, &blk->node);
+              nxmutex_unlock(&fs->lock);
+              return nread > 0 ? nread : ret;
+            }
+
+          blk->entry   = fp->entry;
+          blk->blockno = blockno;
+          blk->len     = ret;
+        }
+      else
+        {
+          list_delete(&blk->node);
+        }
+
+      list_add_head(&fs->lru, &blk->node);
+
+      if (offset >= blk->len)
+        {
+          nxmutex_unlock(&fs->lock);
+          break;
+        }
+
+      nbytes = MIN(blk->len - offset, buflen - nread);
+      memcpy(buffer + nread, blk->data + offset, nbytes);
+      nxmutex_unlock(&fs->lock);
+
+      nread += nbytes;
+      pos   += nbytes;
+    }
+
+  return nread;
+}
+#endif
+
+/* Set up direct reading of the current member of fp->uf if it is stored
+ * or deflated without encryption.  Other members are read via minizip.
+ */
+
+static int zipfs_open_direct(FAR struct zipfs_mountpt_s *fs,
+                             FAR struct zipfs_file_s *fp)
+{
+  unz_file_info64 file_info;
+  int ret;
+
+  ret = unzGetCurrentFileInfo64(fp->uf, &file_info,
+                                NULL, 0, NULL, 0, NULL, 0);
+  ret = zipfs_convert_result(ret);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if ((file_info.flag & 1) != 0 ||
+      (file_info.compression_method != ZIPFS_STORED &&
+       file_info.compression_method != ZIPFS_DEFLATED))
+    {
+      return OK;
+    }
+
+  fp->method  = file_info.compression_method;
+  fp->csize   = file_info.compressed_size;
+  fp->size    = file_info.uncompressed_size;
+  fp->dataoff = unzGetCurrentFileZStreamPos64(fp->uf);
+  fp->outpos  = -1;
+
+  if (fp->method == ZIPFS_DEFLATED)
+    {
+      fp->seekbuf = fs_heap_malloc(CONFIG_ZIPFS_SEEK_BUFSIZE);
+      fp->inbuf   = fs_heap_malloc(CONFIG_ZIPFS_SEEK_BUFSIZE);
+      if (fp->seekbuf == NULL || fp->inbuf == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      if (inflateInit2(&fp->strm, -MAX_WBITS) != Z_OK)
+        {
+          return -ENOMEM;
+        }
+    }
+
+  ret = file_open(&fp->raw, fs->abspath, O_RDONLY);
+  if (ret < 0)
+    {
+      if (fp->method == ZIPFS_DEFLATED)
+        {
+          inflateEnd(&fp->strm);
+        }
+
+      return ret;
+    }
+
+  fp->direct = true;
+  return OK;
+}
+
 static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
                       int oflags, mode_t mode)
 {
@@ -252,7 +1053,7 @@ static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
 
   DEBUGASSERT(fs != NULL);
 
-  fp = fs_heap_malloc(sizeof(*fp) + strlen(relpath));
+  fp = fs_heap_zalloc(sizeof(*fp) + strlen(relpath));
   if (fp == NULL)
     {
       return -ENOMEM;
@@ -271,7 +1072,7 @@ static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
       goto err_with_mutex;
     }
 
-  ret = zipfs_convert_result(unzLocateFile(fp->uf, relpath, 0));
+  ret = zipfs_locate(fs, fp->uf, relpath, &fp->entry);
   if (ret < 0)
     {
       goto err_with_zip;
@@ -283,15 +1084,17 @@ static int zipfs_open(FAR struct file *filep, FAR const char *relpath,
       goto err_with_zip;
     }
 
+  ret = zipfs_open_direct(fs, fp);
   if (ret == OK)
     {
-      fp->seekbuf = NULL;
       strcpy(fp->relpath, relpath);
       filep->f_priv = fp;
     }
   else
     {
 err_with_zip:
+      fs_heap_free(fp->inbuf);
+      fs_heap_free(fp->seekbuf);
       unzClose(fp->uf);
 err_with_mutex:
       nxmutex_destroy(&fp->lock);
@@ -307,8 +1110,19 @@ static int zipfs_close(FAR struct file *filep)
   FAR struct zipfs_file_s *fp = filep->f_priv;
   int ret;
 
+  if (fp->direct)
+    {
+      if (fp->method == ZIPFS_DEFLATED)
+        {
+          inflateEnd(&fp->strm);
+        }
+
+      file_close(&fp->raw);
+    }
+
   ret = zipfs_convert_result(unzClose(fp->uf));
   nxmutex_destroy(&fp->lock);
+  fs_heap_free(fp->inbuf);
   fs_heap_free(fp->seekbuf);
   fs_heap_free(fp);
   return ret;
@@ -317,11 +1131,27 @@ static int zipfs_close(FAR struct file *filep)
 static ssize_t zipfs_read(FAR struct file *filep, FAR char *buffer,
                           size_t buflen)
 {
+  FAR struct zipfs_mountpt_s *fs = filep->f_inode->i_private;
   FAR struct zipfs_file_s *fp = filep->f_priv;
   ssize_t ret;
 
   nxmutex_lock(&fp->lock);
-  ret = zipfs_convert_result(unzReadCurrentFile(fp->uf, buffer, buflen));
+  if (!fp->direct)
+    {
+      ret = unzReadCurrentFile(fp->uf, buffer, buflen);
+      ret = zipfs_convert_result(ret);
+    }
+#if CONFIG_ZIPFS_CACHE_NBLOCKS > 0
+  else if (fp->method == ZIPFS_DEFLATED)
+    {
+      ret = zipfs_read_cached(fs, fp, buffer, buflen, filep->f_pos);
+    }
+#endif
+  else
+    {
+      ret = zipfs_read_direct(fs, fp, buffer, buflen, filep->f_pos);
+    }
+
   if (ret > 0)
     {
       filep->f_pos += ret;
@@ -398,6 +1228,22 @@ static off_t zipfs_seek(FAR struct file *filep, off_t offset,
         goto err_with_lock;
     }
 
+  /* Directly read members are positioned by the next read */
+
+  if (fp->direct)
+    {
+      if (offset < 0)
+        {
+          ret = -EINVAL;
+        }
+      else
+        {
+          filep->f_pos = offset;
+        }
+
+      goto err_with_lock;
+    }
+
   if (filep->f_pos == offset)
     {
       goto err_with_lock;
@@ -417,7 +1263,7 @@ static off_t zipfs_seek(FAR struct file *filep, off_t offset,
           goto err_with_lock;
         }
 
-      ret = zipfs_convert_result(unzLocateFile(fp->uf, fp->relpath, 0));
+      ret = zipfs_locate(fs, fp->uf, fp->relpath, NULL);
       if (ret < 0)
         {
           goto err_with_lock;
@@ -584,6 +1430,7 @@ static int zipfs_bind(FAR struct inode *driver, FAR const void *data,
 {
   FAR struct zipfs_mountpt_s *fs;
   unzFile uf;
+  int ret;
 
   if (data == NULL)
     {
@@ -603,17 +1450,33 @@ static int zipfs_bind(FAR struct inode *driver, FAR const void *data,
       return -EINVAL;
     }
 
-  unzClose(uf);
+  nxmutex_init(&fs->lock);
+  list_initialize(&fs->lru);
   strcpy(fs->abspath, data);
-  *handle = fs;
 
+  ret = zipfs_build_map(fs, uf);
+  unzClose(uf);
+#if CONFIG_ZIPFS_CACHE_NBLOCKS > 0
+  if (ret >= 0)
+    {
+      ret = zipfs_cache_init(fs);
+    }
+#endif
+
+  if (ret < 0)
+    {
+      zipfs_free_mount(fs);
+      return ret;
+    }
+
+  *handle = fs;
   return OK;
 }
 
 static int zipfs_unbind(FAR void *handle, FAR struct inode **driver,
                         unsigned int flags)
 {
-  fs_heap_free(handle);
+  zipfs_free_mount(handle);
   return OK;
 }
 
@@ -648,7 +1511,7 @@ static int zipfs_stat(FAR struct inode *mountpt,
       return -EINVAL;
     }
 
-  ret = zipfs_convert_result(unzLocateFile(uf, relpath, 0));
+  ret = zipfs_locate(fs, uf, relpath, NULL);
   if (ret < 0)
     {
       unzClose(uf);
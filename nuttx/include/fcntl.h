@@ -114,6 +114,13 @@
 #define F_SETPIPE_SZ    19 /* Modify the capacity of the pipe to arg bytes, but not larger than CONFIG_DEV_PIPE_MAXSIZE */
 #define F_GETPIPE_SZ    20 /* Return the capacity of the pipe */
 
+/* Flags for splice(), tee() and vmsplice() */
+
+#define SPLICE_F_MOVE     (1 << 0) /* Move pages instead of copying (hint) */
+#define SPLICE_F_NONBLOCK (1 << 1) /* Don't block on the pipe */
+#define SPLICE_F_MORE     (1 << 2) /* More data will be coming (hint) */
+#define SPLICE_F_GIFT     (1 << 3) /* User pages are a gift (vmsplice) */
+
 /* For posix fcntl() and lockf() */
 
 #define F_RDLCK     0  /* Take out a read lease */
@@ -221,6 +228,14 @@ int fcntl(int fd, int cmd, ...);
 
 int posix_fallocate(int fd, off_t offset, off_t len);
 
+struct iovec;
+
+ssize_t splice(int fd_in, FAR off_t *off_in, int fd_out,
+               FAR off_t *off_out, size_t len, unsigned int flags);
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+ssize_t vmsplice(int fd, FAR const struct iovec *iov, size_t nr_segs,
+                 unsigned int flags);
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -38,6 +38,13 @@
 
 #define MQ_NONBLOCK O_NONBLOCK
 
+/* Non-standard mq_attr.mq_flags bit: when set at creation time (O_CREAT),
+ * the queue is a lockless single-producer/single-consumer ring.  Requires
+ * CONFIG_MQ_SPSC; ignored otherwise.
+ */
+
+#define MQ_SPSC     (1 << 30)
+
 /****************************************************************************
  * Public Type Declarations
  ****************************************************************************/
@@ -0,0 +1,191 @@
+/****************************************************************************
+ * include/nuttx/drivers/blkcache.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_DRIVERS_BLKCACHE_H
+#define __INCLUDE_NUTTX_DRIVERS_BLKCACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include <nuttx/list.h>
+#include <nuttx/mutex.h>
+#include <nuttx/wqueue.h>
+
+#ifdef CONFIG_DRVR_BLKCACHE
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Data transfer callouts to the underlying block device.  They return the
+ * number of blocks transferred or a negated errno value.
+ */
+
+typedef CODE ssize_t (*blkcache_reload_t)(FAR void *dev,
+                                          FAR uint8_t *buffer,
+                                          off_t startblock, size_t nblocks);
+typedef CODE ssize_t (*blkcache_flush_t)(FAR void *dev,
+                                         FAR const uint8_t *buffer,
+                                         off_t startblock, size_t nblocks);
+
+/* One cache line: 'lineblocks' consecutive blocks starting at a multiple of
+ * 'lineblocks'.
+ */
+
+struct blkcache_line_s
+{
+  struct list_node              node;  /* In the LRU list, most recent first */
+  FAR struct blkcache_line_s   *hnext; /* Next line in the same hash bucket */
+  off_t                         line;  /* The line number, -1 if unused */
+  uint32_t                      dirty; /* One bit per modified block */
+  uint8_t                       nfail; /* Failed write backs in a row */
+  FAR uint8_t                  *data;  /* The blocks of the line */
+};
+
+/* This structure holds the state of a block cache.  Like struct rwbuffer_s,
+ * an instance is embedded in the state of each user, e.g.
+ *
+ *  struct foo_dev_s
+ *  {
+ *    ...
+ *    struct blkcache_s cache;
+ *    ...
+ *  };
+ *
+ * The user sets up the geometry, the cache size and the callouts and then
+ * calls blkcache_initialize().  All transfers to the device should then go
+ * through blkcache_read() and blkcache_write().
+ *
+ * The cache holds 'nlines' lines of 'lineblocks' blocks each, replaced in
+ * LRU order.  Reads that continue where the previous one ended are
+ * detected as sequential and the lines following them are loaded ahead of
+ * time, in a single device transfer together with the missing line; the
+ * read-ahead window doubles on each sequential read up to 'maxreadahead'
+ * lines and collapses on a random one.  Writes are kept in the cache and
+ * written back by the low priority work queue after 'wrdelay' ms without
+ * writes, when the line is evicted or on blkcache_flush().  A line that
+ * fails to be written back stays dirty until a write back succeeds: the
+ * timer retries it a few times, blkcache_flush() and the eviction of the
+ * line every time.  blkcache_flush() returns the error for as long as a
+ * line can't be written back.
+ */
+
+struct blkcache_s
+{
+  /**************************************************************************/
+
+  /* These values must be provided by the user prior to calling
+   * blkcache_initialize()
+   */
+
+  /* Supported geometry */
+
+  uint16_t          blocksize;     /* The size of one block */
+  size_t            nblocks;       /* The total number blocks supported */
+
+  /* Cache size.  Caching is disabled (all transfers go straight to the
+   * device) if nlines is zero.
+   */
+
+  uint16_t          nlines;        /* The number of cache lines */
+  uint8_t           lineblocks;    /* Blocks per line, 1..32 */
+  uint8_t           maxreadahead;  /* Max. lines to read ahead, 0: none */
+  uint16_t          wrdelay;       /* Write back delay in ms, 0: write through */
+
+  /* Callback functions */
+
+  FAR void         *dev;           /* Device state passed to the callouts */
+  blkcache_flush_t  flush;         /* Callout to write blocks to the device */
+  blkcache_reload_t reload;        /* Callout to read blocks from the device */
+
+  /**************************************************************************/
+
+  /* The user should never modify any of the remaining fields */
+
+  mutex_t           lock;          /* Enforces exclusive access to the cache */
+  struct work_s     work;          /* Delayed write back */
+  struct list_node  lru;           /* The lines, most recently used first */
+
+  /* All of the lines, and the lines hashed by their line number */
+
+  FAR struct blkcache_line_s  *lines;
+  FAR struct blkcache_line_s **hash;
+
+  FAR uint8_t      *buffer;        /* The data of all lines */
+  FAR uint8_t      *rabuffer;      /* Staging buffer for multi-line loads */
+  uint16_t          hmask;         /* The number of hash buckets - 1 */
+  uint16_t          ndirty;        /* The number of dirty lines */
+  uint8_t           readahead;     /* The current read-ahead window */
+  off_t             seqblock;      /* The block after the last read */
+  int               error;         /* Write back error not reported yet */
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Cache initialization */
+
+int blkcache_initialize(FAR struct blkcache_s *cache);
+void blkcache_uninitialize(FAR struct blkcache_s *cache);
+
+/* Block oriented transfers */
+
+ssize_t blkcache_read(FAR struct blkcache_s *cache, off_t startblock,
+                      size_t nblocks, FAR uint8_t *rdbuffer);
+ssize_t blkcache_write(FAR struct blkcache_s *cache, off_t startblock,
+                       size_t nblocks, FAR const uint8_t *wrbuffer);
+
+/* Write back all dirty blocks */
+
+int blkcache_flush(FAR struct blkcache_s *cache);
+
+/* Drop all cached blocks, dirty ones included (e.g. on media change) */
+
+int blkcache_invalidate(FAR struct blkcache_s *cache);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_DRVR_BLKCACHE */
+#endif /* __INCLUDE_NUTTX_DRIVERS_BLKCACHE_H */
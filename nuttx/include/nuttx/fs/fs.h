@@ -492,7 +492,7 @@ struct fd
 
 struct fdlist
 {
-  spinlock_t        fl_lock;    /* Manage access to the file descriptor list */
+  spinlock_t        fl_lock;    /* Serialize updates of the file descriptor list */
   uint8_t           fl_rows;    /* The number of rows of fl_fds array */
   FAR struct fd   **fl_fds;     /* The pointer of two layer file descriptors array */
 
@@ -1642,6 +1642,26 @@ ssize_t file_pwrite(FAR struct file *filep, FAR const void *buf,
 ssize_t file_sendfile(FAR struct file *outfile, FAR struct file *infile,
                       FAR off_t *offset, size_t count);
 
+/****************************************************************************
+ * Name: file_splice, file_tee and file_vmsplice
+ *
+ * Description:
+ *   Equivalent to the standard splice(), tee() and vmsplice() functions
+ *   except that they accept struct file instances instead of file
+ *   descriptors.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_PIPES
+ssize_t file_splice(FAR struct file *infile, FAR off_t *inoff,
+                    FAR struct file *outfile, FAR off_t *outoff,
+                    size_t len, unsigned int flags);
+ssize_t file_tee(FAR struct file *infile, FAR struct file *outfile,
+                 size_t len, unsigned int flags);
+ssize_t file_vmsplice(FAR struct file *filep, FAR const struct iovec *iov,
+                      size_t nr_segs, unsigned int flags);
+#endif
+
 /****************************************************************************
  * Name: file_seek
  *
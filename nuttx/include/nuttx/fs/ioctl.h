@@ -111,6 +111,7 @@
 #define _MSIOCBASE      (0x4300) /* Mouse ioctl commands */
 #define _I2SOCBASE      (0x4400) /* I2S driver ioctl commands */
 #define _1WIREBASE      (0x4500) /* 1WIRE ioctl commands */
+#define _IORINGBASE     (0x4600) /* I/O ring ioctl commands */
 #define _WLIOCBASE      (0x8b00) /* Wireless modules ioctl network commands */
 
 /* boardctl() commands share the same number space */
@@ -524,6 +525,12 @@
                                                * IN: None
                                                * OUT: int */
 
+#define PIPEIOC_SPLICE      _PIPEIOC(0x0007)  /* Move data between the pipe
+                                               * buffer and another file.
+                                               * No user space buffer.
+                                               * IN: pipe_splice_s
+                                               * OUT: Length of data */
+
 /* RTC driver ioctl definitions *********************************************/
 
 /* (see nuttx/include/rtc.h */
@@ -791,6 +798,13 @@
 #define _1WIREIOCVALID(c) (_IOC_TYPE(c)==_1WIREBASE)
 #define _1WIREIOC(nr)     _IOC(_1WIREBASE,nr)
 
+/* I/O ring ioctl definitions ***********************************************/
+
+/* see nuttx/fs/ioring.h */
+
+#define _IORINGIOCVALID(c) (_IOC_TYPE(c)==_IORINGBASE)
+#define _IORINGIOC(nr)     _IOC(_IORINGBASE,nr)
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
@@ -829,6 +843,28 @@ struct pipe_peek_s
   size_t size;
 };
 
+/* PIPEIOC_SPLICE directions */
+
+#define PIPE_SPLICE_OUT   0  /* Drain the pipe into ps_file */
+#define PIPE_SPLICE_IN    1  /* Fill the pipe from ps_file */
+#define PIPE_SPLICE_TEE   2  /* Copy the pipe into pipe ps_file, no drain */
+#define PIPE_SPLICE_VMIN  3  /* Copy the memory in ps_iov into the pipe */
+#define PIPE_SPLICE_VMOUT 4  /* Drain the pipe into the memory in ps_iov */
+
+struct file;
+struct iovec;
+
+struct pipe_splice_s
+{
+  FAR struct file *ps_file;       /* The other end of the transfer */
+  FAR off_t *ps_offset;           /* Position in ps_file, NULL: position */
+  FAR const struct iovec *ps_iov; /* The memory of PIPE_SPLICE_VM* */
+  size_t ps_niov;                 /* Number of segments in ps_iov */
+  size_t ps_len;                  /* Maximum number of bytes to transfer */
+  uint8_t ps_mode;                /* See PIPE_SPLICE_* definitions */
+  bool ps_nonblock;               /* Don't wait on the pipe(s) */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
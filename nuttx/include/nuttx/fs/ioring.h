@@ -0,0 +1,278 @@
+/****************************************************************************
+ * include/nuttx/fs/ioring.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_FS_IORING_H
+#define __INCLUDE_NUTTX_FS_IORING_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/fs/ioctl.h>
+
+#ifdef CONFIG_FS_IORING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define IORING_DEVPATH         "/dev/ioring"
+
+/* IOCTL commands of the I/O ring device.
+ *
+ * IORING_IOC_SETUP - Allocate the rings of this open instance.
+ *                    Argument: struct ioring_params_s *
+ * IORING_IOC_ENTER - Submit the queued SQEs and/or wait for completions.
+ *                    Argument: struct ioring_enter_s *
+ *                    Returns the number of SQEs consumed.
+ */
+
+#define IORING_IOC_SETUP       _IORINGIOC(0x0001)
+#define IORING_IOC_ENTER       _IORINGIOC(0x0002)
+
+/* Submission queue entry operation codes */
+
+#define IORING_OP_NOP          0  /* Complete immediately */
+#define IORING_OP_READ         1  /* read() or pread() */
+#define IORING_OP_WRITE        2  /* write() or pwrite() */
+#define IORING_OP_FSYNC        3  /* fsync() */
+#define IORING_OP_SEND         4  /* send() on a socket */
+#define IORING_OP_RECV         5  /* recv() on a socket */
+
+/* ioring_enter_s flags */
+
+#define IORING_ENTER_GETEVENTS (1 << 0) /* Wait for min_complete CQEs */
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One submission queue entry, filled in place by the submitter */
+
+struct ioring_sqe_s
+{
+  uint8_t   opcode;                /* IORING_OP_* */
+  uint8_t   flags;                 /* Reserved, must be zero */
+  uint16_t  reserved;
+  int32_t   fd;                    /* File descriptor of the submitter */
+  off_t     off;                   /* File offset, -1: current position */
+  FAR void *addr;                  /* Data buffer */
+  uint32_t  len;                   /* Size of the data buffer */
+  uint32_t  msgflags;              /* send()/recv() flags */
+  uint64_t  user_data;             /* Copied unchanged to the CQE */
+};
+
+/* One completion queue entry, posted by the I/O ring workers */
+
+struct ioring_cqe_s
+{
+  uint64_t  user_data;             /* user_data of the SQE */
+  int32_t   res;                   /* Result: bytes or a negated errno */
+  uint32_t  flags;                 /* Reserved */
+};
+
+/* The shared ring memory.  The submitter owns sq_tail and cq_head, the
+ * kernel owns sq_head and cq_tail.  The indexes run freely and are masked
+ * with (entries - 1) to address the arrays, so completions can be polled
+ * without entering the kernel.
+ */
+
+struct ioring_s
+{
+  atomic_t  sq_head;               /* Next SQE to be consumed */
+  atomic_t  sq_tail;               /* Next SQE to be filled */
+  atomic_t  cq_head;               /* Next CQE to be consumed */
+  atomic_t  cq_tail;               /* Next CQE to be posted */
+  uint32_t  sq_entries;            /* Power of two */
+  uint32_t  cq_entries;            /* Power of two */
+  FAR struct ioring_sqe_s *sqes;   /* The submission queue entries */
+  FAR struct ioring_cqe_s *cqes;   /* The completion queue entries */
+};
+
+/* Argument of IORING_IOC_SETUP */
+
+struct ioring_params_s
+{
+  uint32_t  sq_entries;            /* In: Submission queue size */
+  uint32_t  cq_entries;            /* In: Completion queue size, 0 for twice
+                                    * sq_entries.  Also the maximum number
+                                    * of requests in flight. */
+  FAR struct ioring_s *ring;       /* Out: The shared ring */
+  size_t    size;                  /* Out: Size of the shared memory, the
+                                    * same ring is returned by mmap() */
+};
+
+/* Argument of IORING_IOC_ENTER */
+
+struct ioring_enter_s
+{
+  uint32_t  to_submit;             /* Maximum number of SQEs to consume */
+  uint32_t  min_complete;          /* CQEs to wait for with GETEVENTS */
+  uint32_t  flags;                 /* IORING_ENTER_* */
+  int       timeout;               /* Wait timeout in ms, <0 forever */
+};
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ioring_get_sqe
+ *
+ * Description:
+ *   Return the next free submission queue entry, or NULL if the submission
+ *   queue is full.  The entry is not visible to the kernel until
+ *   ioring_queue_sqe() is called.  Only one thread may submit to a ring.
+ *
+ ****************************************************************************/
+
+static inline FAR struct ioring_sqe_s *
+ioring_get_sqe(FAR struct ioring_s *ring)
+{
+  uint32_t head = atomic_read_acquire(&ring->sq_head);
+  uint32_t tail = atomic_read(&ring->sq_tail);
+
+  if (tail - head >= ring->sq_entries)
+    {
+      return NULL;
+    }
+
+  return &ring->sqes[tail & (ring->sq_entries - 1)];
+}
+
+/****************************************************************************
+ * Name: ioring_queue_sqe
+ *
+ * Description:
+ *   Publish the entry returned by the last ioring_get_sqe().
+ *
+ ****************************************************************************/
+
+static inline void ioring_queue_sqe(FAR struct ioring_s *ring)
+{
+  atomic_set_release(&ring->sq_tail, atomic_read(&ring->sq_tail) + 1);
+}
+
+/****************************************************************************
+ * Name: ioring_peek_cqe
+ *
+ * Description:
+ *   Return the oldest completion queue entry not consumed yet, or NULL if
+ *   there is none.  Release it with ioring_cqe_seen().
+ *
+ ****************************************************************************/
+
+static inline FAR struct ioring_cqe_s *
+ioring_peek_cqe(FAR struct ioring_s *ring)
+{
+  uint32_t tail = atomic_read_acquire(&ring->cq_tail);
+  uint32_t head = atomic_read(&ring->cq_head);
+
+  if (head == tail)
+    {
+      return NULL;
+    }
+
+  return &ring->cqes[head & (ring->cq_entries - 1)];
+}
+
+/****************************************************************************
+ * Name: ioring_cqe_seen
+ *
+ * Description:
+ *   Release the entry returned by the last ioring_peek_cqe().
+ *
+ ****************************************************************************/
+
+static inline void ioring_cqe_seen(FAR struct ioring_s *ring)
+{
+  atomic_set_release(&ring->cq_head, atomic_read(&ring->cq_head) + 1);
+}
+
+/****************************************************************************
+ * Name: ioring_enter
+ *
+ * Description:
+ *   Submit up to 'to_submit' queued entries in one call and, if
+ *   'min_complete' is not zero, wait until that many completions are
+ *   available.
+ *
+ * Returned Value:
+ *   The number of entries submitted, or -1 with errno set.
+ *
+ ****************************************************************************/
+
+static inline int ioring_enter(int fd, uint32_t to_submit,
+                               uint32_t min_complete, int timeout)
+{
+  struct ioring_enter_s enter;
+
+  enter.to_submit    = to_submit;
+  enter.min_complete = min_complete;
+  enter.flags        = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  enter.timeout      = timeout;
+
+  return ioctl(fd, IORING_IOC_ENTER, (unsigned long)((uintptr_t)&enter));
+}
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: ioring_initialize
+ *
+ * Description:
+ *   Register the I/O ring device at IORING_DEVPATH.  Each open of the
+ *   device is an independent pair of submission and completion rings.
+ *   Called once by fs_initialize().
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int ioring_initialize(void);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_FS_IORING */
+#endif /* __INCLUDE_NUTTX_FS_IORING_H */
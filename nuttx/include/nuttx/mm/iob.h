@@ -221,6 +221,30 @@ FAR struct iob_s *iob_alloc(bool throttled);
 
 FAR struct iob_s *iob_tryalloc(bool throttled);
 
+/****************************************************************************
+ * Name: iob_alloc_chain
+ *
+ * Description:
+ *   Allocate a chain of 'n' I/O buffers linked through io_flink, in a
+ *   single operation if they are available, otherwise buffer by buffer,
+ *   waiting as necessary.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_alloc_chain(bool throttled, unsigned int n);
+
+/****************************************************************************
+ * Name: iob_tryalloc_chain
+ *
+ * Description:
+ *   Try to allocate a chain of 'n' I/O buffers linked through io_flink in a
+ *   single operation, without waiting.  Either the whole chain is
+ *   allocated or NULL is returned.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_tryalloc_chain(bool throttled, unsigned int n);
+
 #ifdef CONFIG_IOB_ALLOC
 /****************************************************************************
  * Name: iob_alloc_dynamic
@@ -347,7 +371,7 @@ void iob_notifier_teardown(int key);
  *
  * Description:
  *   Free an entire buffer chain, starting at the beginning of the I/O
- *   buffer chain
+ *   buffer chain, in a single operation
  *
  ****************************************************************************/
 
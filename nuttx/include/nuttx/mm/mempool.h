@@ -49,6 +49,12 @@
 #  define MEMPOOL_REALBLOCKSIZE(pool) ((pool)->blocksize)
 #endif
 
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+#  define MEMPOOL_HISTOGRAM_GRAIN (2 * sizeof(uintptr_t))
+#  define MEMPOOL_HISTOGRAM_NBINS (CONFIG_MM_MEMPOOL_HISTOGRAM_MAX / \
+                                   MEMPOOL_HISTOGRAM_GRAIN)
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -87,6 +93,22 @@ struct mempool_procfs_entry_s
 };
 #endif
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+/* This structure describes the per-CPU cache of free blocks that sits in
+ * front of the shared free queue of a memory pool.  It is only accessed
+ * by its own CPU with local interrupts disabled; blocks are moved to and
+ * from the shared queue CONFIG_MM_MEMPOOL_MAGAZINE_SIZE at a time.
+ */
+
+struct mempool_magazine_s
+{
+  FAR sq_entry_t *head;   /* The list of cached free blocks */
+  size_t          count;  /* The number of cached free blocks */
+  unsigned long   nhit;   /* The number of allocations served by the cache */
+  unsigned long   nmiss;  /* The number of allocations that missed the cache */
+};
+#endif
+
 /* This structure describes memory buffer pool */
 
 struct mempool_s
@@ -110,6 +132,9 @@ struct mempool_s
   size_t     nalloc;  /* The number of used block in mempool */
   spinlock_t lock;    /* The protect lock to mempool */
   sem_t      waitsem; /* The semaphore of waiter get free block */
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  struct mempool_magazine_s magazine[CONFIG_SMP_NCPUS]; /* Per-CPU caches */
+#endif
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL)
   struct mempool_procfs_entry_s procfs; /* The entry of procfs */
 #endif
@@ -137,8 +162,41 @@ struct mempoolinfo_s
   unsigned long aordblks; /* This is the number of used blocks */
   unsigned long sizeblks; /* This is the size of a mempool blocks */
   unsigned long nwaiter;  /* This is the number of waiter for mempool */
+  unsigned long cordblks; /* This is the number of free blocks in per-CPU caches */
+  unsigned long nhit;     /* This is the number of per-CPU cache hits */
+  unsigned long nmiss;    /* This is the number of per-CPU cache misses */
+};
+
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+/* This structure records the request sizes seen by a multiple memory pool.
+ * bins[i] counts the requests of (i * MEMPOOL_HISTOGRAM_GRAIN,
+ * (i + 1) * MEMPOOL_HISTOGRAM_GRAIN] bytes and the last bin counts all
+ * larger requests.  The counters are statistics only and are updated
+ * without any lock.
+ */
+
+struct mempool_histogram_s
+{
+  FAR struct mempool_multiple_s *mpool;     /* The owner multiple mempool */
+  FAR const char *name;                     /* The name of the owner */
+  FAR struct mempool_histogram_s *next;     /* The next registered histogram */
+  size_t npools;                            /* The number of size classes */
+  unsigned long nalloc;                     /* The number of requests */
+  unsigned long nupgrade;                   /* Served by a larger class */
+  unsigned long nfallback;                  /* Left to the general heap */
+  unsigned long bins[MEMPOOL_HISTOGRAM_NBINS + 1];
 };
 
+/* This structure describes one size class of a multiple memory pool */
+
+struct mempool_classinfo_s
+{
+  size_t        blocksize; /* The block size of the current class */
+  unsigned long nreq;      /* The requests that map to the current class */
+  size_t        recommend; /* The recommended block size of the class */
+};
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -303,6 +361,40 @@ void mempool_procfs_register(FAR struct mempool_procfs_entry_s *entry,
 void mempool_procfs_unregister(FAR struct mempool_procfs_entry_s *entry);
 #endif
 
+/****************************************************************************
+ * Name: mempool_histogram_register
+ *
+ * Description:
+ *   Add the request size histogram of a multiple mempool to the procfs
+ *   file system.
+ *
+ * Input Parameters:
+ *   hist - Describes the histogram to be registered.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL) && \
+    defined(CONFIG_MM_MEMPOOL_HISTOGRAM)
+void mempool_histogram_register(FAR struct mempool_histogram_s *hist);
+#endif
+
+/****************************************************************************
+ * Name: mempool_histogram_unregister
+ *
+ * Description:
+ *   Remove the request size histogram of a multiple mempool from the procfs
+ *   file system.
+ *
+ * Input Parameters:
+ *   hist - Describes the histogram to be unregistered.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL) && \
+    defined(CONFIG_MM_MEMPOOL_HISTOGRAM)
+void mempool_histogram_unregister(FAR struct mempool_histogram_s *hist);
+#endif
+
 /****************************************************************************
  * Name: mempool_multiple_init
  *
@@ -521,6 +613,33 @@ struct mallinfo_task
 mempool_multiple_info_task(FAR struct mempool_multiple_s *mpool,
                            FAR const struct malltask *task);
 
+/****************************************************************************
+ * Name: mempool_multiple_classinfo
+ *
+ * Description:
+ *   Report how the requests recorded by the histogram map to the current
+ *   size classes, and recommend the same number of classes with the same
+ *   coverage that minimize the internal fragmentation of those requests.
+ *   The recommended classes can be fed back as the poolsize array of
+ *   mempool_multiple_init on the next boot.
+ *
+ * Input Parameters:
+ *   mpool  - The handle of multiple memory pool to be used.
+ *   info   - The array of mpool's npools entries to fill.
+ *   waste  - Return the estimated wasted bytes with the current classes.
+ *   rwaste - Return the estimated wasted bytes with the recommendation.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+int mempool_multiple_classinfo(FAR struct mempool_multiple_s *mpool,
+                               FAR struct mempool_classinfo_s *info,
+                               FAR uint64_t *waste, FAR uint64_t *rwaste);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -0,0 +1,105 @@
+/****************************************************************************
+ * include/nuttx/mm/memprof.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_MM_MEMPROF_H
+#define __INCLUDE_NUTTX_MM_MEMPROF_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The profiler lives in the kernel copy of the memory manager only */
+
+#if defined(CONFIG_MM_MEMPROF) && \
+    (defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__))
+#  define MM_MEMPROF 1
+#endif
+
+#ifndef MM_MEMPROF
+#  define mm_memprof_alloc(heap, mem, size)
+#  define mm_memprof_free(heap, mem)
+#else
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+struct mm_heap_s;
+
+/****************************************************************************
+ * Name: mm_memprof_alloc
+ *
+ * Description:
+ *   Account an allocation to the sampling heap profiler.  On average one
+ *   allocation is sampled every CONFIG_MM_MEMPROF_RATE bytes; the call
+ *   stack of a sampled allocation is recorded and the allocation is
+ *   tracked until it is freed.
+ *
+ * Input Parameters:
+ *   heap - The heap the memory was allocated from
+ *   mem  - The allocated memory
+ *   size - The size of the allocation
+ *
+ ****************************************************************************/
+
+void mm_memprof_alloc(FAR struct mm_heap_s *heap, FAR void *mem,
+                      size_t size);
+
+/****************************************************************************
+ * Name: mm_memprof_free
+ *
+ * Description:
+ *   Tell the sampling heap profiler that memory is being freed.  Nothing
+ *   is done unless the memory was sampled when it was allocated.
+ *
+ * Input Parameters:
+ *   heap - The heap the memory is released to
+ *   mem  - The memory being freed
+ *
+ ****************************************************************************/
+
+void mm_memprof_free(FAR struct mm_heap_s *heap, FAR void *mem);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MM_MEMPROF */
+
+#endif /* __INCLUDE_NUTTX_MM_MEMPROF_H */
@@ -28,6 +28,7 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <nuttx/atomic.h>
 #include <nuttx/compiler.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/signal.h>
@@ -94,6 +95,21 @@
 #  define MQ_WNELIST(cmn)             (&((cmn).waitfornotempty))
 #  define MQ_WNFLIST(cmn)             (&((cmn).waitfornotfull))
 
+/* Number of messages currently held by a queue.  MQ_SPSC queues do not
+ * maintain nmsgs; their depth is the distance between the free-running
+ * producer and consumer indices.
+ */
+
+#ifdef CONFIG_MQ_SPSC
+#  define nxmq_nmsgs(msgq) \
+   ((msgq)->ring != NULL ? \
+    (int16_t)((uint32_t)atomic_read(&(msgq)->head) - \
+              (uint32_t)atomic_read(&(msgq)->tail)) : \
+    (msgq)->nmsgs)
+#else
+#  define nxmq_nmsgs(msgq)            ((msgq)->nmsgs)
+#endif
+
 /****************************************************************************
  * Public Type Declarations
  ****************************************************************************/
@@ -126,6 +142,12 @@ struct mqueue_inode_s
   pid_t ntpid;                /* Notification: Receiving Task's PID */
   struct sigevent ntevent;    /* Notification description */
   struct sigwork_s ntwork;    /* Notification work */
+#endif
+#ifdef CONFIG_MQ_SPSC
+  FAR uint8_t *ring;          /* Slot storage of MQ_SPSC queues, else NULL */
+  uint16_t slotsize;          /* Size of one ring slot in bytes */
+  atomic_t head;              /* Producer index (free-running) */
+  atomic_t tail;              /* Consumer index (free-running) */
 #endif
   FAR struct pollfd *fds[CONFIG_FS_MQUEUE_NPOLLWAITERS];
 };
@@ -793,6 +815,139 @@ int file_mq_setattr(FAR struct file *mq, FAR const struct mq_attr *mq_stat,
 
 int file_mq_getattr(FAR struct file *mq, FAR struct mq_attr *mq_stat);
 
+#ifdef CONFIG_MQ_SPSC
+
+/****************************************************************************
+ * Name: file_mq_send_acquire
+ *
+ * Description:
+ *   Reserve the next free slot of an MQ_SPSC message queue so that the
+ *   producer can build the message in place.  The slot is published to the
+ *   consumer by file_mq_send_commit().  Calling file_mq_send_acquire()
+ *   again before the commit returns the same slot.
+ *
+ *   If the ring is full and O_NONBLOCK is not set, the caller blocks until
+ *   the consumer releases a slot or until abstime expires.
+ *
+ * Input Parameters:
+ *   mq      - Message queue descriptor
+ *   buf     - Location to return the slot payload address.  The payload
+ *             can hold up to mq_msgsize bytes.
+ *   abstime - The absolute time to wait until a timeout is declared or
+ *             NULL to wait forever.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure:
+ *
+ *   EAGAIN    The ring was full and the O_NONBLOCK flag was set (or the
+ *             caller is an interrupt handler).
+ *   EBADF     Message queue not opened for writing.
+ *   EINVAL    The queue is not an MQ_SPSC queue or an argument is invalid.
+ *   EINTR     The call was interrupted by a signal handler.
+ *   ETIMEDOUT The ring stayed full until abstime.
+ *
+ ****************************************************************************/
+
+int file_mq_send_acquire(FAR struct file *mq, FAR void **buf,
+                         FAR const struct timespec *abstime);
+
+/****************************************************************************
+ * Name: file_mq_send_commit
+ *
+ * Description:
+ *   Publish the slot obtained with file_mq_send_acquire() as a message of
+ *   msglen bytes and wake the consumer if it is waiting.
+ *
+ * Input Parameters:
+ *   mq      - Message queue descriptor
+ *   msglen  - The length of the message that was written in place
+ *   prio    - The priority recorded with the message
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure:
+ *
+ *   EINVAL   The queue is not an MQ_SPSC queue, prio is invalid or no slot
+ *            was acquired.
+ *   EMSGSIZE 'msglen' was greater than the maxmsgsize attribute of the
+ *            message queue.
+ *
+ ****************************************************************************/
+
+int file_mq_send_commit(FAR struct file *mq, size_t msglen,
+                        unsigned int prio);
+
+/****************************************************************************
+ * Name: file_mq_receive_acquire
+ *
+ * Description:
+ *   Return the oldest message of an MQ_SPSC message queue without copying
+ *   it out of its ring slot.  The slot stays owned by the consumer until
+ *   file_mq_receive_commit() releases it to the producer.
+ *
+ *   If the ring is empty and O_NONBLOCK is not set, the caller blocks until
+ *   a message is committed or until abstime expires.
+ *
+ * Input Parameters:
+ *   mq      - Message queue descriptor
+ *   buf     - Location to return the message address
+ *   prio    - If not NULL, the location to store message priority.
+ *   abstime - The absolute time to wait until a timeout is declared or
+ *             NULL to wait forever.
+ *
+ * Returned Value:
+ *   On success, the length of the message in bytes is returned.  A negated
+ *   errno value is returned on failure (see file_mq_send_acquire()).
+ *
+ ****************************************************************************/
+
+ssize_t file_mq_receive_acquire(FAR struct file *mq, FAR void **buf,
+                                FAR unsigned int *prio,
+                                FAR const struct timespec *abstime);
+
+/****************************************************************************
+ * Name: file_mq_receive_commit
+ *
+ * Description:
+ *   Release the slot returned by file_mq_receive_acquire() back to the
+ *   producer and wake the producer if it is waiting for a free slot.
+ *
+ * Input Parameters:
+ *   mq      - Message queue descriptor
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure:
+ *
+ *   EINVAL   The queue is not an MQ_SPSC queue or it holds no message.
+ *
+ ****************************************************************************/
+
+int file_mq_receive_commit(FAR struct file *mq);
+
+/****************************************************************************
+ * Name: nxmq_send_acquire, nxmq_send_commit, nxmq_receive_acquire and
+ *       nxmq_receive_commit
+ *
+ * Description:
+ *   Equivalents of the file_mq_*_acquire()/file_mq_*_commit() interfaces
+ *   that take a message queue descriptor.  The returned slot addresses
+ *   remain valid until the matching commit as long as the descriptor is
+ *   open.
+ *
+ ****************************************************************************/
+
+int nxmq_send_acquire(mqd_t mqdes, FAR void **buf,
+                      FAR const struct timespec *abstime);
+int nxmq_send_commit(mqd_t mqdes, size_t msglen, unsigned int prio);
+ssize_t nxmq_receive_acquire(mqd_t mqdes, FAR void **buf,
+                             FAR unsigned int *prio,
+                             FAR const struct timespec *abstime);
+int nxmq_receive_commit(mqd_t mqdes);
+
+#endif /* CONFIG_MQ_SPSC */
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -0,0 +1,217 @@
+/****************************************************************************
+ * include/nuttx/nxring.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_NXRING_H
+#define __INCLUDE_NUTTX_NXRING_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#ifdef CONFIG_LIBC_NXRING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Flags for nxring_create() */
+
+#define NXRING_MPSC  0x01  /* The ring may have more than one producer */
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* An nxring is a fixed-size ring of fixed-size slots in a POSIX shared
+ * memory object, so it is mapped by every process that opens it by name.
+ * Producers fill a reserved slot in place and the consumer reads it in
+ * place, so frames are never copied through the kernel.  The kernel is
+ * only entered to ring a doorbell when the other side has announced that
+ * it is going to sleep.
+ */
+
+struct nxring_s;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: nxring_create
+ *
+ * Description:
+ *   Create a new named ring and map it into the caller's address space.
+ *
+ * Input Parameters:
+ *   ring     - Location to return the handle of the ring.
+ *   name     - The name of the ring, shared by all its users.
+ *   slotsize - The largest frame that fits into one slot.
+ *   nslots   - The number of slots, rounded up to a power of two.
+ *   flags    - NXRING_MPSC if more than one producer may use the ring.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int nxring_create(FAR struct nxring_s **ring, FAR const char *name,
+                  size_t slotsize, size_t nslots, int flags);
+
+/****************************************************************************
+ * Name: nxring_open
+ *
+ * Description:
+ *   Map an existing named ring into the caller's address space.
+ *
+ * Input Parameters:
+ *   ring - Location to return the handle of the ring.
+ *   name - The name the ring was created with.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int nxring_open(FAR struct nxring_s **ring, FAR const char *name);
+
+/****************************************************************************
+ * Name: nxring_close
+ *
+ * Description:
+ *   Unmap a ring and free its handle.  The ring lives on until it is
+ *   unlinked and closed by all of its users.
+ *
+ ****************************************************************************/
+
+void nxring_close(FAR struct nxring_s *ring);
+
+/****************************************************************************
+ * Name: nxring_unlink
+ *
+ * Description:
+ *   Remove the name of a ring.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int nxring_unlink(FAR const char *name);
+
+/****************************************************************************
+ * Name: nxring_slotsize
+ *
+ * Description:
+ *   Return the largest frame that fits into one slot of the ring.
+ *
+ ****************************************************************************/
+
+size_t nxring_slotsize(FAR struct nxring_s *ring);
+
+/****************************************************************************
+ * Name: nxring_reserve
+ *
+ * Description:
+ *   Reserve the next free slot of the ring for the calling producer.  The
+ *   frame is written in place and published with nxring_commit().
+ *
+ * Input Parameters:
+ *   ring    - The ring to produce into.
+ *   buf     - Location to return the slot's buffer.
+ *   timeout - Milliseconds to wait for a free slot, -1 to wait forever.
+ *
+ * Returned Value:
+ *   Zero on success; -EAGAIN or -ETIMEDOUT if the ring stayed full, or
+ *   another negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int nxring_reserve(FAR struct nxring_s *ring, FAR void **buf, int timeout);
+
+/****************************************************************************
+ * Name: nxring_commit
+ *
+ * Description:
+ *   Publish a slot reserved by nxring_reserve() holding len bytes, and
+ *   wake the consumer if it sleeps.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int nxring_commit(FAR struct nxring_s *ring, FAR void *buf, size_t len);
+
+/****************************************************************************
+ * Name: nxring_acquire
+ *
+ * Description:
+ *   Get the oldest published frame of the ring.  The frame stays in place
+ *   until it is given back with nxring_release().  There must be only one
+ *   consumer.
+ *
+ * Input Parameters:
+ *   ring    - The ring to consume from.
+ *   buf     - Location to return the frame.
+ *   timeout - Milliseconds to wait for a frame, -1 to wait forever.
+ *
+ * Returned Value:
+ *   The length of the frame on success; -EAGAIN or -ETIMEDOUT if the ring
+ *   stayed empty, or another negated errno value on failure.
+ *
+ ****************************************************************************/
+
+ssize_t nxring_acquire(FAR struct nxring_s *ring, FAR void **buf,
+                       int timeout);
+
+/****************************************************************************
+ * Name: nxring_release
+ *
+ * Description:
+ *   Give the frame returned by nxring_acquire() back to the producers, and
+ *   wake them if they sleep on a full ring.
+ *
+ ****************************************************************************/
+
+void nxring_release(FAR struct nxring_s *ring);
+
+#undef EXTERN
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CONFIG_LIBC_NXRING */
+#endif /* __INCLUDE_NUTTX_NXRING_H */
@@ -611,6 +611,7 @@ struct tcb_s
   uint8_t  boost_priority;               /* Boosted priority of the thread  */
   uint8_t  base_priority;                /* Normal priority of the thread   */
   FAR struct semholder_s *holdsem;       /* List of held semaphores         */
+  FAR struct semholder_s *donors;        /* Heap of donated priorities      */
 #endif
 
 #ifdef CONFIG_SMP
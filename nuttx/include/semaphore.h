@@ -73,27 +73,41 @@ struct semholder_s
   FAR struct semholder_s *tlink;  /* List of task held semaphores          */
   FAR struct sem_s *sem;          /* The corresponding semaphore           */
   FAR struct tcb_s *htcb;         /* The corresponding TCB                 */
+  FAR struct semholder_s *pchild; /* Donation heap: first child            */
+  FAR struct semholder_s *pnext;  /* Donation heap: next sibling           */
+  FAR struct semholder_s *pprev;  /* Donation heap: parent or prev sibling */
   int32_t counts;                 /* Number of counts owned by this holder */
+  uint8_t dprio;                  /* Priority donated by waiters, 0 = none */
 };
 
 #if CONFIG_SEM_PREALLOCHOLDERS > 0
-#  define SEMHOLDER_INITIALIZER   {NULL, NULL, NULL, NULL, 0}
+#  define SEMHOLDER_INITIALIZER \
+    {NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0}
 #  define INITIALIZE_SEMHOLDER(h) \
     do { \
       (h)->flink  = NULL; \
       (h)->tlink  = NULL; \
       (h)->sem    = NULL; \
       (h)->htcb   = NULL; \
+      (h)->pchild = NULL; \
+      (h)->pnext  = NULL; \
+      (h)->pprev  = NULL; \
       (h)->counts = 0; \
+      (h)->dprio  = 0; \
     } while (0)
 #else
-#  define SEMHOLDER_INITIALIZER   {NULL, NULL, NULL, 0}
+#  define SEMHOLDER_INITIALIZER \
+    {NULL, NULL, NULL, NULL, NULL, NULL, 0, 0}
 #  define INITIALIZE_SEMHOLDER(h) \
     do { \
       (h)->tlink  = NULL; \
       (h)->sem    = NULL; \
       (h)->htcb   = NULL; \
+      (h)->pchild = NULL; \
+      (h)->pnext  = NULL; \
+      (h)->pprev  = NULL; \
       (h)->counts = 0; \
+      (h)->dprio  = 0; \
     } while (0)
 #endif
 #endif /* CONFIG_PRIORITY_INHERITANCE */
@@ -272,6 +272,12 @@ SYSCALL_LOOKUP(munmap,                     2)
   SYSCALL_LOOKUP(pipe2,                    2)
 #endif
 
+#ifdef CONFIG_PIPES
+  SYSCALL_LOOKUP(splice,                   6)
+  SYSCALL_LOOKUP(tee,                      4)
+  SYSCALL_LOOKUP(vmsplice,                 4)
+#endif
+
 #if defined(CONFIG_PIPES) && CONFIG_DEV_FIFO_SIZE > 0
   SYSCALL_LOOKUP(nx_mkfifo,                3)
 #endif
@@ -0,0 +1,664 @@
+/****************************************************************************
+ * libs/libc/misc/lib_nxring.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/nuttx.h>
+#include <nuttx/nxring.h>
+#include <nuttx/lib/lib.h>
+
+#ifdef CONFIG_LIBC_NXRING
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NXRING_MAGIC       0x4e58524e /* "NXRN" */
+#define NXRING_ALIGN       64         /* Keep hot fields on their own lines */
+#define NXRING_MAXSLOTS    (1 << 30)
+
+#define NXRING_HDRSIZE     ALIGN_UP(sizeof(struct nxring_hdr_s), NXRING_ALIGN)
+#define NXRING_SLOTHDR     ALIGN_UP(sizeof(struct nxring_slot_s), 16)
+
+#define NXRING_SLOT(hdr, pos) \
+  ((FAR struct nxring_slot_s *)((FAR char *)(hdr) + NXRING_HDRSIZE + \
+                                ((pos) & ((hdr)->nslots - 1)) * \
+                                (hdr)->stride))
+
+#define NXRING_PAYLOAD(slot) ((FAR char *)(slot) + NXRING_SLOTHDR)
+#define NXRING_SLOTOF(buf) \
+  ((FAR struct nxring_slot_s *)((FAR char *)(buf) - NXRING_SLOTHDR))
+
+#define NXRING_DOORBELL_FMT CONFIG_LIBC_NXRING_VFS_PATH "/%s.%s"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The head of the shared memory object, the slots follow it.  Every slot
+ * carries a sequence number: a slot at ring position pos is free for the
+ * producer that reserves pos while its sequence is pos, published to the
+ * consumer when it is pos + 1, and free again for the next lap when the
+ * consumer sets it to pos + nslots.  So producers and the consumer never
+ * share a lock, and with NXRING_MPSC the producers only race for the head
+ * with a compare and swap.
+ */
+
+struct nxring_hdr_s
+{
+  atomic_t magic;                          /* Set last by nxring_create */
+  uint32_t flags;                          /* NXRING_* flags */
+  uint32_t nslots;                         /* The number of slots */
+  uint32_t slotsize;                       /* The payload of one slot */
+  uint32_t stride;                         /* The distance of two slots */
+
+  /* The next position to reserve, and the producers asleep on full */
+
+  aligned_data(NXRING_ALIGN) atomic_t head;
+  atomic_t pwait;
+
+  /* The next position to consume, and the consumer asleep on empty */
+
+  aligned_data(NXRING_ALIGN) atomic_t tail;
+  atomic_t cwait;
+};
+
+struct nxring_slot_s
+{
+  atomic_t seq;                            /* See struct nxring_hdr_s */
+  uint32_t len;                            /* The length of the frame */
+};
+
+/* The per-process handle of a ring */
+
+struct nxring_s
+{
+  FAR struct nxring_hdr_s *hdr;            /* The mapping of the ring */
+  size_t                   mapsize;        /* The size of the mapping */
+  int                      datafd;         /* Rung when a frame arrives */
+  int                      spacefd;        /* Rung when a slot frees up */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxring_doorbell
+ *
+ * Description:
+ *   Open, and create if asked to, one of the two doorbells of a ring.  A
+ *   doorbell is a named FIFO because, unlike an eventfd, it can be opened
+ *   by name from another process in every build mode.  It is opened for
+ *   both reading and writing so that opening never blocks, and without
+ *   blocking so that ringing a doorbell that already rings is a no-op.
+ *
+ ****************************************************************************/
+
+static int nxring_doorbell(FAR const char *name, FAR const char *suffix,
+                           bool create)
+{
+  FAR char *path;
+  int ret;
+
+  path = lib_get_pathbuffer();
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  while (*name == '/')
+    {
+      name++;
+    }
+
+  snprintf(path, PATH_MAX, NXRING_DOORBELL_FMT, name, suffix);
+  if (create && mkfifo(path, 0666) < 0 && get_errno() != EEXIST)
+    {
+      ret = -get_errno();
+      goto out;
+    }
+
+  ret = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (ret < 0)
+    {
+      ret = -get_errno();
+    }
+
+out:
+  lib_put_pathbuffer(path);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxring_unlink_doorbell
+ ****************************************************************************/
+
+static int nxring_unlink_doorbell(FAR const char *name,
+                                  FAR const char *suffix)
+{
+  FAR char *path;
+  int ret;
+
+  path = lib_get_pathbuffer();
+  if (path == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  while (*name == '/')
+    {
+      name++;
+    }
+
+  snprintf(path, PATH_MAX, NXRING_DOORBELL_FMT, name, suffix);
+  ret = unlink(path) < 0 ? -get_errno() : 0;
+  lib_put_pathbuffer(path);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxring_ring
+ ****************************************************************************/
+
+static void nxring_ring(int fd)
+{
+  char token = 0;
+
+  write(fd, &token, 1);
+}
+
+/****************************************************************************
+ * Name: nxring_wait
+ *
+ * Description:
+ *   Sleep until a doorbell rings or the timeout expires.  The caller has
+ *   announced its sleep in the ring and then checked the ring once more,
+ *   so a doorbell rung in between is not lost: its token stays in the
+ *   FIFO.  Stale tokens only cause a spurious wakeup.
+ *
+ ****************************************************************************/
+
+static int nxring_wait(int fd, int timeout)
+{
+  struct pollfd pfd;
+  char token;
+  int ret;
+
+  pfd.fd     = fd;
+  pfd.events = POLLIN;
+
+  ret = poll(&pfd, 1, timeout);
+  if (ret < 0)
+    {
+      return -get_errno();
+    }
+  else if (ret == 0)
+    {
+      return -ETIMEDOUT;
+    }
+
+  read(fd, &token, 1);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: nxring_attach
+ *
+ * Description:
+ *   Map the shared memory object fd and open the doorbells of the ring.
+ *
+ ****************************************************************************/
+
+static int nxring_attach(FAR struct nxring_s **ring, FAR const char *name,
+                         int fd, size_t mapsize, bool create)
+{
+  FAR struct nxring_s *handle;
+  int ret;
+
+  handle = lib_malloc(sizeof(struct nxring_s));
+  if (handle == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  handle->mapsize = mapsize;
+  handle->hdr     = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+  if (handle->hdr == MAP_FAILED)
+    {
+      ret = -get_errno();
+      goto err_with_handle;
+    }
+
+  handle->datafd = nxring_doorbell(name, "data", create);
+  if (handle->datafd < 0)
+    {
+      ret = handle->datafd;
+      goto err_with_map;
+    }
+
+  handle->spacefd = nxring_doorbell(name, "space", create);
+  if (handle->spacefd < 0)
+    {
+      ret = handle->spacefd;
+      goto err_with_data;
+    }
+
+  *ring = handle;
+  return 0;
+
+err_with_data:
+  close(handle->datafd);
+err_with_map:
+  munmap(handle->hdr, mapsize);
+err_with_handle:
+  lib_free(handle);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxring_create
+ ****************************************************************************/
+
+int nxring_create(FAR struct nxring_s **ring, FAR const char *name,
+                  size_t slotsize, size_t nslots, int flags)
+{
+  FAR struct nxring_hdr_s *hdr;
+  size_t mapsize;
+  size_t stride;
+  size_t n;
+  int ret;
+  int fd;
+
+  if (ring == NULL || name == NULL || slotsize == 0 ||
+      slotsize > UINT16_MAX * NXRING_ALIGN || nslots == 0 ||
+      nslots > NXRING_MAXSLOTS)
+    {
+      return -EINVAL;
+    }
+
+  for (n = 1; n < nslots; n <<= 1);
+
+  stride  = ALIGN_UP(NXRING_SLOTHDR + slotsize, NXRING_ALIGN);
+  mapsize = NXRING_HDRSIZE + n * stride;
+  if ((mapsize - NXRING_HDRSIZE) / stride != n)
+    {
+      return -EINVAL;
+    }
+
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+    {
+      return -get_errno();
+    }
+
+  if (ftruncate(fd, mapsize) < 0)
+    {
+      ret = -get_errno();
+      goto err_with_fd;
+    }
+
+  ret = nxring_attach(ring, name, fd, mapsize, true);
+  if (ret < 0)
+    {
+      goto err_with_fd;
+    }
+
+  close(fd);
+
+  hdr           = (*ring)->hdr;
+  hdr->flags    = flags;
+  hdr->nslots   = n;
+  hdr->slotsize = slotsize;
+  hdr->stride   = stride;
+  atomic_set(&hdr->head, 0);
+  atomic_set(&hdr->pwait, 0);
+  atomic_set(&hdr->tail, 0);
+  atomic_set(&hdr->cwait, 0);
+
+  while (n-- > 0)
+    {
+      atomic_set(&NXRING_SLOT(hdr, n)->seq, n);
+    }
+
+  atomic_set_release(&hdr->magic, NXRING_MAGIC);
+  return 0;
+
+err_with_fd:
+  close(fd);
+  shm_unlink(name);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxring_open
+ ****************************************************************************/
+
+int nxring_open(FAR struct nxring_s **ring, FAR const char *name)
+{
+  FAR struct nxring_hdr_s *hdr;
+  struct stat st;
+  int ret;
+  int fd;
+
+  if (ring == NULL || name == NULL)
+    {
+      return -EINVAL;
+    }
+
+  fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0)
+    {
+      return -get_errno();
+    }
+
+  /* The creator may not have sized the object yet */
+
+  if (fstat(fd, &st) < 0)
+    {
+      ret = -get_errno();
+      close(fd);
+      return ret;
+    }
+  else if (st.st_size < NXRING_HDRSIZE)
+    {
+      close(fd);
+      return -EAGAIN;
+    }
+
+  ret = nxring_attach(ring, name, fd, st.st_size, false);
+  close(fd);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Nor initialized it */
+
+  hdr = (*ring)->hdr;
+  if (atomic_read_acquire(&hdr->magic) != NXRING_MAGIC)
+    {
+      nxring_close(*ring);
+      return -EAGAIN;
+    }
+
+  /* Every slot access trusts the geometry in the header, so make sure
+   * that it describes slots that all lie within the mapping.
+   */
+
+  if (hdr->nslots == 0 || hdr->nslots > NXRING_MAXSLOTS ||
+      (hdr->nslots & (hdr->nslots - 1)) != 0 || hdr->slotsize == 0 ||
+      hdr->stride < NXRING_SLOTHDR + (size_t)hdr->slotsize ||
+      hdr->stride % NXRING_ALIGN != 0 ||
+      hdr->stride > ((*ring)->mapsize - NXRING_HDRSIZE) / hdr->nslots)
+    {
+      nxring_close(*ring);
+      return -EINVAL;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: nxring_close
+ ****************************************************************************/
+
+void nxring_close(FAR struct nxring_s *ring)
+{
+  close(ring->spacefd);
+  close(ring->datafd);
+  munmap(ring->hdr, ring->mapsize);
+  lib_free(ring);
+}
+
+/****************************************************************************
+ * Name: nxring_unlink
+ ****************************************************************************/
+
+int nxring_unlink(FAR const char *name)
+{
+  int ret;
+
+  ret = shm_unlink(name) < 0 ? -get_errno() : 0;
+  nxring_unlink_doorbell(name, "data");
+  nxring_unlink_doorbell(name, "space");
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxring_slotsize
+ ****************************************************************************/
+
+size_t nxring_slotsize(FAR struct nxring_s *ring)
+{
+  return ring->hdr->slotsize;
+}
+
+/****************************************************************************
+ * Name: nxring_reserve
+ ****************************************************************************/
+
+int nxring_reserve(FAR struct nxring_s *ring, FAR void **buf, int timeout)
+{
+  FAR struct nxring_hdr_s *hdr = ring->hdr;
+  FAR struct nxring_slot_s *slot;
+  bool waiting = false;
+  uint32_t pos;
+  int32_t diff;
+  int ret = 0;
+
+  pos = atomic_read(&hdr->head);
+  for (; ; )
+    {
+      slot = NXRING_SLOT(hdr, pos);
+      diff = (int32_t)((uint32_t)atomic_read_acquire(&slot->seq) - pos);
+      if (diff == 0)
+        {
+          int32_t expect = pos;
+
+          if ((hdr->flags & NXRING_MPSC) == 0)
+            {
+              atomic_set(&hdr->head, pos + 1);
+              break;
+            }
+          else if (atomic_try_cmpxchg_relaxed(&hdr->head, &expect,
+                                              pos + 1))
+            {
+              break;
+            }
+
+          pos = expect;
+          continue;
+        }
+      else if (diff > 0)
+        {
+          /* Another producer took this position */
+
+          pos = atomic_read(&hdr->head);
+          continue;
+        }
+
+      /* The ring is full.  Announce the sleep before checking once more,
+       * the consumer rings the doorbell if it sees the announcement after
+       * freeing a slot.
+       */
+
+      if (timeout == 0)
+        {
+          ret = -EAGAIN;
+          break;
+        }
+      else if (!waiting)
+        {
+          atomic_fetch_add(&hdr->pwait, 1);
+          waiting = true;
+          continue;
+        }
+
+      ret = nxring_wait(ring->spacefd, timeout);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      pos = atomic_read(&hdr->head);
+    }
+
+  if (waiting)
+    {
+      atomic_fetch_sub(&hdr->pwait, 1);
+    }
+
+  if (ret >= 0)
+    {
+      *buf = NXRING_PAYLOAD(slot);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxring_commit
+ ****************************************************************************/
+
+int nxring_commit(FAR struct nxring_s *ring, FAR void *buf, size_t len)
+{
+  FAR struct nxring_hdr_s *hdr = ring->hdr;
+  FAR struct nxring_slot_s *slot = NXRING_SLOTOF(buf);
+
+  if (len > hdr->slotsize)
+    {
+      return -EMSGSIZE;
+    }
+
+  slot->len = len;
+  atomic_set_release(&slot->seq, atomic_read(&slot->seq) + 1);
+
+  /* This must be a read-modify-write to be ordered after the publication
+   * above, see nxring_acquire().
+   */
+
+  if (atomic_xchg(&hdr->cwait, 0) != 0)
+    {
+      nxring_ring(ring->datafd);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: nxring_acquire
+ ****************************************************************************/
+
+ssize_t nxring_acquire(FAR struct nxring_s *ring, FAR void **buf,
+                       int timeout)
+{
+  FAR struct nxring_hdr_s *hdr = ring->hdr;
+  FAR struct nxring_slot_s *slot;
+  bool waiting = false;
+  uint32_t pos;
+  int ret;
+
+  pos  = atomic_read(&hdr->tail);
+  slot = NXRING_SLOT(hdr, pos);
+
+  for (; ; )
+    {
+      if ((uint32_t)atomic_read_acquire(&slot->seq) == pos + 1)
+        {
+          if (waiting)
+            {
+              atomic_set(&hdr->cwait, 0);
+            }
+
+          *buf = NXRING_PAYLOAD(slot);
+          return slot->len;
+        }
+
+      /* The ring is empty.  Announce the sleep before checking once more,
+       * producers ring the doorbell if they see the announcement after
+       * publishing a frame.
+       */
+
+      if (timeout == 0)
+        {
+          return -EAGAIN;
+        }
+      else if (!waiting)
+        {
+          atomic_xchg(&hdr->cwait, 1);
+          waiting = true;
+          continue;
+        }
+
+      ret = nxring_wait(ring->datafd, timeout);
+      if (ret < 0)
+        {
+          atomic_set(&hdr->cwait, 0);
+          return ret;
+        }
+
+      waiting = false;
+    }
+}
+
+/****************************************************************************
+ * Name: nxring_release
+ ****************************************************************************/
+
+void nxring_release(FAR struct nxring_s *ring)
+{
+  FAR struct nxring_hdr_s *hdr = ring->hdr;
+  uint32_t pos = atomic_read(&hdr->tail);
+
+  atomic_set_release(&NXRING_SLOT(hdr, pos)->seq, pos + hdr->nslots);
+  atomic_set(&hdr->tail, pos + 1);
+
+  /* A read-modify-write for the same reason as in nxring_commit() */
+
+  if (atomic_fetch_add(&hdr->pwait, 0) > 0)
+    {
+      nxring_ring(ring->spacefd);
+    }
+}
+
+#endif /* CONFIG_LIBC_NXRING */
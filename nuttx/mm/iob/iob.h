@@ -51,6 +51,23 @@
 #  define iobinfo                _none
 #endif /* CONFIG_DEBUG_FEATURES && CONFIG_IOB_DEBUG */
 
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#if CONFIG_IOB_PERCPU_CACHE > 0
+/* A per-CPU cache of free I/O buffers.  The lock is only contended when
+ * the caches are flushed for a waiter.
+ */
+
+struct iob_cache_s
+{
+  spinlock_t        lock;  /* Protects the cache */
+  FAR struct iob_s *head;  /* The cached I/O buffers */
+  int16_t           count; /* The number of cached I/O buffers */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -98,6 +115,12 @@ extern int16_t g_qentry_wait;
 
 extern volatile spinlock_t g_iob_lock;
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+/* The per-CPU caches of free I/O buffers */
+
+extern struct iob_cache_s g_iob_cache[CONFIG_SMP_NCPUS];
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -137,6 +160,78 @@ FAR struct iob_qentry_s *iob_tryalloc_qentry(void);
 
 FAR struct iob_qentry_s *iob_free_qentry(FAR struct iob_qentry_s *iobq);
 
+/****************************************************************************
+ * Name: iob_free_list
+ *
+ * Description:
+ *   Return a list of I/O buffers linked through io_flink to the global
+ *   pool in a single locked operation, handing them to the waiting tasks
+ *   first.  This function is intended only for internal use by the IOB
+ *   module.
+ *
+ ****************************************************************************/
+
+void iob_free_list(FAR struct iob_s *iob);
+
+#if CONFIG_IOB_PERCPU_CACHE > 0
+
+/****************************************************************************
+ * Name: iob_cache_alloc
+ *
+ * Description:
+ *   Take up to '*n' I/O buffers from the cache of this CPU.  On return
+ *   '*n' holds the number of buffers in the returned list.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_cache_alloc(bool throttled, FAR unsigned int *n);
+
+/****************************************************************************
+ * Name: iob_cache_refill
+ *
+ * Description:
+ *   Move a batch of I/O buffers from the global free list to the cache of
+ *   this CPU.  The caller holds g_iob_lock with the interrupts disabled.
+ *
+ ****************************************************************************/
+
+void iob_cache_refill(void);
+
+/****************************************************************************
+ * Name: iob_cache_free
+ *
+ * Description:
+ *   Put a list of free I/O buffers into the cache of this CPU and return
+ *   those that must go back to the global pool.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_cache_free(FAR struct iob_s *iob);
+
+/****************************************************************************
+ * Name: iob_cache_flush
+ *
+ * Description:
+ *   Return the I/O buffers of all the CPU caches to the global pool.
+ *
+ ****************************************************************************/
+
+void iob_cache_flush(void);
+
+/****************************************************************************
+ * Name: iob_cache_navail
+ *
+ * Description:
+ *   Return the number of I/O buffers held by the CPU caches.
+ *
+ ****************************************************************************/
+
+int iob_cache_navail(void);
+
+#else
+#  define iob_cache_navail() 0
+#endif
+
 /****************************************************************************
  * Name: iob_notifier_signal
  *
@@ -129,6 +129,12 @@ static FAR struct iob_s *iob_tryalloc_internal(bool throttled)
           g_iob_count--;
           DEBUGASSERT(g_iob_count >= 0);
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+          /* Take the next buffers of this CPU in the same go */
+
+          iob_cache_refill();
+#endif
+
           /* Put the I/O buffer in a known state */
 
           iob->io_flink  = NULL; /* Not in a chain */
@@ -142,6 +148,35 @@ static FAR struct iob_s *iob_tryalloc_internal(bool throttled)
   return NULL;
 }
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+/****************************************************************************
+ * Name: iob_tryalloc_cached
+ *
+ * Description:
+ *   Try to allocate an I/O buffer from the cache of this CPU.
+ *
+ ****************************************************************************/
+
+static FAR struct iob_s *iob_tryalloc_cached(bool throttled)
+{
+  FAR struct iob_s *iob;
+  unsigned int n = 1;
+
+  iob = iob_cache_alloc(throttled, &n);
+  if (iob != NULL)
+    {
+      /* Put the I/O buffer in a known state */
+
+      iob->io_flink  = NULL; /* Not in a chain */
+      iob->io_len    = 0;    /* Length of the data in the entry */
+      iob->io_offset = 0;    /* Offset to the beginning of data */
+      iob->io_pktlen = 0;    /* Total length of the packet */
+    }
+
+  return iob;
+}
+#endif
+
 /****************************************************************************
  * Name: iob_allocwait
  *
@@ -167,6 +202,14 @@ static FAR struct iob_s *iob_allocwait(bool throttled, unsigned int timeout)
   sem = &g_iob_sem;
 #endif
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+  iob = iob_tryalloc_cached(throttled);
+  if (iob != NULL)
+    {
+      return iob;
+    }
+#endif
+
   /* The following must be atomic; interrupt must be disabled so that there
    * is no conflict with interrupt level I/O buffer allocations.  This is
    * not as bad as it sounds because interrupts will be re-enabled while
@@ -193,6 +236,12 @@ static FAR struct iob_s *iob_allocwait(bool throttled, unsigned int timeout)
 
       spin_unlock_irqrestore(&g_iob_lock, flags);
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+      /* Don't sleep while I/O buffers are parked in the CPU caches */
+
+      iob_cache_flush();
+#endif
+
       if (timeout == UINT_MAX)
         {
           ret = nxsem_wait_uninterruptible(sem);
@@ -300,6 +349,14 @@ FAR struct iob_s *iob_tryalloc(bool throttled)
   FAR struct iob_s *iob;
   irqstate_t flags;
 
+#if CONFIG_IOB_PERCPU_CACHE > 0
+  iob = iob_tryalloc_cached(throttled);
+  if (iob != NULL)
+    {
+      return iob;
+    }
+#endif
+
   /* We don't know what context we are called from so we use extreme measures
    * to protect the free list:  We disable interrupts very briefly.
    */
@@ -310,6 +367,121 @@ FAR struct iob_s *iob_tryalloc(bool throttled)
   return iob;
 }
 
+/****************************************************************************
+ * Name: iob_tryalloc_chain
+ *
+ * Description:
+ *   Try to allocate a chain of 'n' I/O buffers without waiting.  The
+ *   buffers are taken from the cache of this CPU and the rest from the
+ *   global free list in a single locked operation.  Either the whole chain
+ *   is allocated or nothing.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_tryalloc_chain(bool throttled, unsigned int n)
+{
+  FAR struct iob_s *head = NULL;
+  FAR struct iob_s *iob;
+  unsigned int ncached = 0;
+  irqstate_t flags;
+  int16_t count;
+
+  if (n == 0)
+    {
+      return NULL;
+    }
+
+#if CONFIG_IOB_PERCPU_CACHE > 0
+  ncached = n;
+  head    = iob_cache_alloc(throttled, &ncached);
+#endif
+
+  if (ncached < n)
+    {
+      flags = spin_lock_irqsave(&g_iob_lock);
+
+#if CONFIG_IOB_THROTTLE > 0
+      count = throttled ? g_iob_count - CONFIG_IOB_THROTTLE : g_iob_count;
+#else
+      count = g_iob_count;
+#endif
+
+      if (count < (int)(n - ncached))
+        {
+          spin_unlock_irqrestore(&g_iob_lock, flags);
+
+          /* Not enough for the whole chain, give back what was taken */
+
+          if (head != NULL)
+            {
+              iob_free_list(head);
+            }
+
+          return NULL;
+        }
+
+      for (; ncached < n; ncached++)
+        {
+          iob            = g_iob_freelist;
+          g_iob_freelist = iob->io_flink;
+          g_iob_count--;
+
+          iob->io_flink  = head;
+          head           = iob;
+        }
+
+      DEBUGASSERT(g_iob_count >= 0);
+      spin_unlock_irqrestore(&g_iob_lock, flags);
+    }
+
+  /* Put the I/O buffers in a known state */
+
+  for (iob = head; iob != NULL; iob = iob->io_flink)
+    {
+      iob->io_len    = 0;    /* Length of the data in the entry */
+      iob->io_offset = 0;    /* Offset to the beginning of data */
+      iob->io_pktlen = 0;    /* Total length of the packet */
+    }
+
+  return head;
+}
+
+/****************************************************************************
+ * Name: iob_alloc_chain
+ *
+ * Description:
+ *   Allocate a chain of 'n' I/O buffers, in a single operation if they are
+ *   available, otherwise buffer by buffer, waiting as necessary.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_alloc_chain(bool throttled, unsigned int n)
+{
+  FAR struct iob_s *head;
+  FAR struct iob_s *iob;
+
+  head = iob_tryalloc_chain(throttled, n);
+  if (head != NULL || up_interrupt_context() || sched_idletask())
+    {
+      return head;
+    }
+
+  for (; n > 0; n--)
+    {
+      iob = iob_alloc(throttled);
+      if (iob == NULL)
+        {
+          iob_free_chain(head);
+          return NULL;
+        }
+
+      iob->io_flink = head;
+      head          = iob;
+    }
+
+  return head;
+}
+
 #ifdef CONFIG_IOB_ALLOC
 
 /****************************************************************************
@@ -0,0 +1,297 @@
+/****************************************************************************
+ * mm/iob/iob_cache.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <assert.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/sched.h>
+#include <nuttx/mm/iob.h>
+
+#include "iob.h"
+
+#if CONFIG_IOB_PERCPU_CACHE > 0
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* A cache growing past CONFIG_IOB_PERCPU_CACHE is trimmed back to this
+ * low watermark, and an empty cache is refilled with this many buffers, so
+ * that the global pool is touched once every IOB_CACHE_BATCH buffers.
+ */
+
+#define IOB_CACHE_BATCH ((CONFIG_IOB_PERCPU_CACHE + 1) / 2)
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* The per-CPU caches of free I/O buffers */
+
+struct iob_cache_s g_iob_cache[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_cache_waiters
+ *
+ * Description:
+ *   Return true if a task is blocked waiting for an I/O buffer.  Such an
+ *   I/O buffer must go to the global pool where the waiter gets it.
+ *
+ ****************************************************************************/
+
+static inline bool iob_cache_waiters(void)
+{
+#if CONFIG_IOB_THROTTLE > 0
+  return g_iob_count < 0 || g_throttle_wait > 0;
+#else
+  return g_iob_count < 0;
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_cache_alloc
+ *
+ * Description:
+ *   Take up to '*n' I/O buffers from the cache of this CPU, without
+ *   touching the global pool.  On return '*n' holds the number of buffers
+ *   in the returned list.
+ *
+ *   A throttled allocation is only served while the throttle reserve is
+ *   still intact in the global pool.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_cache_alloc(bool throttled, FAR unsigned int *n)
+{
+  FAR struct iob_cache_s *cache;
+  FAR struct iob_s *head = NULL;
+  FAR struct iob_s *iob;
+  unsigned int want = *n;
+  irqstate_t flags;
+
+  *n = 0;
+
+#if CONFIG_IOB_THROTTLE > 0
+  if (throttled && g_iob_count < CONFIG_IOB_THROTTLE)
+    {
+      return NULL;
+    }
+#endif
+
+  flags = up_irq_save();
+  cache = &g_iob_cache[this_cpu()];
+  spin_lock(&cache->lock);
+
+  while (*n < want && cache->head != NULL)
+    {
+      iob           = cache->head;
+      cache->head   = iob->io_flink;
+      cache->count--;
+
+      iob->io_flink = head;
+      head          = iob;
+      (*n)++;
+    }
+
+  spin_unlock(&cache->lock);
+  up_irq_restore(flags);
+  return head;
+}
+
+/****************************************************************************
+ * Name: iob_cache_refill
+ *
+ * Description:
+ *   Move a batch of I/O buffers from the global free list to the cache of
+ *   this CPU, if the global pool can spare it.  The caller holds
+ *   g_iob_lock with the interrupts disabled.
+ *
+ ****************************************************************************/
+
+void iob_cache_refill(void)
+{
+  FAR struct iob_cache_s *cache = &g_iob_cache[this_cpu()];
+  FAR struct iob_s *iob;
+  int i;
+
+  /* Leave the throttle reserve and a batch for the other CPUs behind */
+
+  if (cache->count > 0 ||
+      g_iob_count < CONFIG_IOB_THROTTLE + 2 * IOB_CACHE_BATCH)
+    {
+      return;
+    }
+
+  spin_lock(&cache->lock);
+  for (i = 0; i < IOB_CACHE_BATCH && g_iob_freelist != NULL; i++)
+    {
+      iob            = g_iob_freelist;
+      g_iob_freelist = iob->io_flink;
+      g_iob_count--;
+
+      iob->io_flink  = cache->head;
+      cache->head    = iob;
+      cache->count++;
+    }
+
+  spin_unlock(&cache->lock);
+}
+
+/****************************************************************************
+ * Name: iob_cache_free
+ *
+ * Description:
+ *   Put a list of free I/O buffers into the cache of this CPU.  The
+ *   buffers that must go back to the global pool instead are returned:
+ *   all of them while a task is waiting for an I/O buffer, otherwise the
+ *   excess over the high watermark down to the low watermark.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_cache_free(FAR struct iob_s *iob)
+{
+  FAR struct iob_cache_s *cache;
+  FAR struct iob_s *spill = NULL;
+  FAR struct iob_s *next;
+  irqstate_t flags;
+  int keep;
+
+  if (iob_cache_waiters())
+    {
+      return iob;
+    }
+
+  flags = up_irq_save();
+  cache = &g_iob_cache[this_cpu()];
+  spin_lock(&cache->lock);
+
+  for (; iob != NULL; iob = next)
+    {
+      next          = iob->io_flink;
+      iob->io_flink = cache->head;
+      cache->head   = iob;
+      cache->count++;
+    }
+
+  /* Check for waiters again now that the buffers are visible in the
+   * cache: a waiter that registered meanwhile may already have flushed it.
+   */
+
+  if (iob_cache_waiters())
+    {
+      keep = 0;
+    }
+  else if (cache->count > CONFIG_IOB_PERCPU_CACHE)
+    {
+      keep = IOB_CACHE_BATCH;
+    }
+  else
+    {
+      keep = cache->count;
+    }
+
+  while (cache->count > keep)
+    {
+      iob           = cache->head;
+      cache->head   = iob->io_flink;
+      cache->count--;
+
+      iob->io_flink = spill;
+      spill         = iob;
+    }
+
+  spin_unlock(&cache->lock);
+  up_irq_restore(flags);
+  return spill;
+}
+
+/****************************************************************************
+ * Name: iob_cache_flush
+ *
+ * Description:
+ *   Return the I/O buffers of all the CPU caches to the global pool.  This
+ *   is done by a task about to wait for an I/O buffer, so that no buffer
+ *   stays parked in the cache of an idle CPU meanwhile.
+ *
+ ****************************************************************************/
+
+void iob_cache_flush(void)
+{
+  FAR struct iob_cache_s *cache;
+  FAR struct iob_s *iob;
+  irqstate_t flags;
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      cache = &g_iob_cache[cpu];
+
+      flags = spin_lock_irqsave(&cache->lock);
+      iob          = cache->head;
+      cache->head  = NULL;
+      cache->count = 0;
+      spin_unlock_irqrestore(&cache->lock, flags);
+
+      if (iob != NULL)
+        {
+          iob_free_list(iob);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: iob_cache_navail
+ *
+ * Description:
+ *   Return the number of I/O buffers held by the CPU caches.
+ *
+ ****************************************************************************/
+
+int iob_cache_navail(void)
+{
+  int navail = 0;
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      navail += g_iob_cache[cpu].count;
+    }
+
+  return navail;
+}
+
+#endif /* CONFIG_IOB_PERCPU_CACHE > 0 */
@@ -57,6 +57,7 @@ static int iob_copyin_internal(FAR struct iob_s *iob, FAR const uint8_t *src,
                                bool throttled, bool can_block)
 {
   FAR struct iob_s *head = iob;
+  FAR struct iob_s *spare = NULL;
   FAR struct iob_s *next;
   FAR uint8_t *dest;
   unsigned int ncopy;
@@ -178,12 +179,26 @@ static int iob_copyin_internal(FAR struct iob_s *iob, FAR const uint8_t *src,
 
       if (len > 0 && !next)
         {
-          /* Yes.. allocate a new buffer.
+          /* Yes.. allocate a new buffer.  The first time, try to take the
+           * buffers for all of the remaining data at once.
            *
            * Copy as many bytes as possible. Block if we're allowed.
            */
 
-          if (can_block)
+          if (spare == NULL && len > CONFIG_IOB_BUFSIZE)
+            {
+              spare = iob_tryalloc_chain(throttled,
+                                         (len + CONFIG_IOB_BUFSIZE - 1) /
+                                         CONFIG_IOB_BUFSIZE);
+            }
+
+          if (spare != NULL)
+            {
+              next           = spare;
+              spare          = next->io_flink;
+              next->io_flink = NULL;
+            }
+          else if (can_block)
             {
               next = iob_alloc(throttled);
             }
@@ -208,6 +223,13 @@ static int iob_copyin_internal(FAR struct iob_s *iob, FAR const uint8_t *src,
       offset = 0;
     }
 
+  /* Give back the buffers that were not needed after all */
+
+  if (spare != NULL)
+    {
+      iob_free_chain(spare);
+    }
+
   return total;
 }
 
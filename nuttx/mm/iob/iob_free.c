@@ -67,6 +67,86 @@
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: iob_free_list
+ *
+ * Description:
+ *   Return a list of I/O buffers linked through io_flink to the global
+ *   pool in a single locked operation.
+ *
+ ****************************************************************************/
+
+void iob_free_list(FAR struct iob_s *iob)
+{
+  FAR struct iob_s *next;
+  irqstate_t flags;
+  int nposts = 0;
+#if CONFIG_IOB_THROTTLE > 0
+  int nthrottle = 0;
+#endif
+
+  /* Free the I/O buffers by adding them to the head of the free or the
+   * committed list. We don't know what context we are called from so
+   * we use extreme measures to protect the free list:  We disable
+   * interrupts very briefly.
+   */
+
+  flags = spin_lock_irqsave(&g_iob_lock);
+
+  for (; iob != NULL; iob = next)
+    {
+      next = iob->io_flink;
+
+      /* Which list?  If there is a task waiting for an IOB, then put
+       * the IOB on either the free list or on the committed list where
+       * it is reserved for that allocation (and not available to
+       * iob_tryalloc()). This is true for both throttled and non-throttled
+       * cases.
+       */
+
+      if (g_iob_count < 0)
+        {
+          g_iob_count++;
+          iob->io_flink   = g_iob_committed;
+          g_iob_committed = iob;
+          nposts++;
+        }
+#if CONFIG_IOB_THROTTLE > 0
+      else if (g_throttle_wait > 0 && g_iob_count >= CONFIG_IOB_THROTTLE)
+        {
+          iob->io_flink   = g_iob_committed;
+          g_iob_committed = iob;
+          g_throttle_wait--;
+          nthrottle++;
+        }
+#endif
+      else
+        {
+          g_iob_count++;
+          iob->io_flink   = g_iob_freelist;
+          g_iob_freelist  = iob;
+        }
+    }
+
+  spin_unlock_irqrestore(&g_iob_lock, flags);
+
+  /* Wake up the waiters the I/O buffers were committed to */
+
+  while (nposts-- > 0)
+    {
+      nxsem_post(&g_iob_sem);
+    }
+
+#if CONFIG_IOB_THROTTLE > 0
+  while (nthrottle-- > 0)
+    {
+      nxsem_post(&g_throttle_sem);
+    }
+#endif
+
+  DEBUGASSERT(g_iob_count <= CONFIG_IOB_NBUFFERS);
+}
+
 /****************************************************************************
  * Name: iob_free
  *
@@ -79,7 +159,6 @@
 FAR struct iob_s *iob_free(FAR struct iob_s *iob)
 {
   FAR struct iob_s *next = iob->io_flink;
-  irqstate_t flags;
 #ifdef CONFIG_IOB_NOTIFIER
   int16_t navail;
 #endif
@@ -126,49 +205,19 @@ FAR struct iob_s *iob_free(FAR struct iob_s *iob)
     }
 #endif
 
-  /* Free the I/O buffer by adding it to the head of the free or the
-   * committed list. We don't know what context we are called from so
-   * we use extreme measures to protect the free list:  We disable
-   * interrupts very briefly.
-   */
-
-  flags = spin_lock_irqsave(&g_iob_lock);
-
-  /* Which list?  If there is a task waiting for an IOB, then put
-   * the IOB on either the free list or on the committed list where
-   * it is reserved for that allocation (and not available to
-   * iob_tryalloc()). This is true for both throttled and non-throttled
-   * cases.
+  /* Free the I/O buffer into the cache of this CPU, or to the global
+   * free or committed list.
    */
 
-  if (g_iob_count < 0)
-    {
-      g_iob_count++;
-      iob->io_flink   = g_iob_committed;
-      g_iob_committed = iob;
-      spin_unlock_irqrestore(&g_iob_lock, flags);
-      nxsem_post(&g_iob_sem);
-    }
-#if CONFIG_IOB_THROTTLE > 0
-  else if (g_throttle_wait > 0 && g_iob_count >= CONFIG_IOB_THROTTLE)
-    {
-      iob->io_flink   = g_iob_committed;
-      g_iob_committed = iob;
-      g_throttle_wait--;
-      spin_unlock_irqrestore(&g_iob_lock, flags);
-      nxsem_post(&g_throttle_sem);
-    }
+  iob->io_flink = NULL;
+#if CONFIG_IOB_PERCPU_CACHE > 0
+  iob = iob_cache_free(iob);
+  if (iob != NULL)
 #endif
-  else
     {
-      g_iob_count++;
-      iob->io_flink   = g_iob_freelist;
-      g_iob_freelist  = iob;
-      spin_unlock_irqrestore(&g_iob_lock, flags);
+      iob_free_list(iob);
     }
 
-  DEBUGASSERT(g_iob_count <= CONFIG_IOB_NBUFFERS);
-
 #ifdef CONFIG_IOB_NOTIFIER
   /* Check if the IOB was claimed by a thread that is blocked waiting
    * for an IOB.
@@ -27,6 +27,9 @@
 #include <nuttx/config.h>
 
 #include <nuttx/arch.h>
+#ifdef CONFIG_IOB_ALLOC
+#  include <nuttx/kmalloc.h>
+#endif
 #include <nuttx/mm/iob.h>
 
 #include "iob.h"
@@ -46,12 +49,57 @@
 
 void iob_free_chain(FAR struct iob_s *iob)
 {
+  FAR struct iob_s *head = NULL;
   FAR struct iob_s *next;
 
-  /* Free each IOB in the chain -- one at a time to keep the count straight */
+  iobinfo("iob=%p io_pktlen=%u\n", iob, iob ? iob->io_pktlen : 0);
+
+  /* Gather the pre-allocated I/O buffers of the chain into a list, the
+   * packet length does not matter as the whole chain goes away.
+   */
 
   for (; iob; iob = next)
     {
-      next = iob_free(iob);
+      next = iob->io_flink;
+
+#ifdef CONFIG_IOB_ALLOC
+      if (iob->io_free != NULL)
+        {
+          iob->io_free(iob->io_data);
+          kmm_free(iob);
+          continue;
+        }
+#endif
+
+      iob->io_flink = head;
+      head          = iob;
+    }
+
+  if (head == NULL)
+    {
+      return;
+    }
+
+  /* And free them all at once into the cache of this CPU, or to the
+   * global pool in a single locked operation.
+   */
+
+#if CONFIG_IOB_PERCPU_CACHE > 0
+  head = iob_cache_free(head);
+  if (head != NULL)
+#endif
+    {
+      iob_free_list(head);
+    }
+
+#ifdef CONFIG_IOB_NOTIFIER
+  /* Signal any threads that have requested a signal notification when an
+   * IOB becomes available.
+   */
+
+  if (iob_navail(false) > 0)
+    {
+      iob_notifier_signal();
     }
+#endif
 }
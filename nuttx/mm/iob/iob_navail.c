@@ -50,6 +50,12 @@ int iob_navail(bool throttled)
 
 #if CONFIG_IOB_NBUFFERS > 0
   ret = g_iob_count;
+  if (ret > 0)
+    {
+      /* Add the free I/O buffers held by the CPU caches */
+
+      ret += iob_cache_navail();
+    }
 
 #if CONFIG_IOB_THROTTLE > 0
   /* Subtract the throttle value is so requested */
@@ -65,10 +65,11 @@ void iob_getstats(FAR struct iob_stats_s *stats)
   else
     {
       stats->nwait = 0;
+      stats->nfree += iob_cache_navail();
     }
 
 #if CONFIG_IOB_THROTTLE > 0
-  stats->nthrottle = (g_iob_count - CONFIG_IOB_THROTTLE);
+  stats->nthrottle = (stats->nfree - CONFIG_IOB_THROTTLE);
   if (stats->nthrottle < 0)
 #endif
     {
@@ -28,8 +28,10 @@
 #include <execinfo.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <syslog.h>
 
+#include <nuttx/irq.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/mm/kasan.h>
 #include <nuttx/mm/mempool.h>
@@ -100,6 +102,147 @@ static inline void mempool_add_queue(FAR struct mempool_s *pool,
     }
 }
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+static inline bool mempool_magazine_enabled(FAR struct mempool_s *pool)
+{
+  /* Blocks hidden in a per-CPU cache would never wake up a waiter */
+
+  return !(pool->wait && pool->expandsize == 0);
+}
+
+/* Move up to CONFIG_MM_MEMPOOL_MAGAZINE_SIZE blocks from the shared queue
+ * into the magazine.  Local interrupts must be disabled.
+ */
+
+static void mempool_magazine_refill(FAR struct mempool_s *pool,
+                                    FAR struct mempool_magazine_s *mag)
+{
+  FAR sq_entry_t *blk;
+  size_t n;
+
+  spin_lock(&pool->lock);
+  for (n = 0; n < CONFIG_MM_MEMPOOL_MAGAZINE_SIZE; n++)
+    {
+      blk = mempool_remove_queue(pool, &pool->queue);
+      if (blk == NULL)
+        {
+          break;
+        }
+
+      blk->flink = mag->head;
+      mag->head  = blk;
+    }
+
+  /* Cached blocks are accounted as allocated by the shared pool */
+
+  pool->nalloc += n;
+  spin_unlock(&pool->lock);
+  mag->count += n;
+}
+
+/* Move n blocks from the magazine back to the shared queue.  Local
+ * interrupts must be disabled.
+ */
+
+static void mempool_magazine_flush(FAR struct mempool_s *pool,
+                                   FAR struct mempool_magazine_s *mag,
+                                   size_t n)
+{
+  FAR sq_entry_t *blk;
+
+  spin_lock(&pool->lock);
+  mag->count   -= n;
+  pool->nalloc -= n;
+  while (n-- > 0)
+    {
+      blk       = mag->head;
+      mag->head = blk->flink;
+      sq_addlast(blk, &pool->queue);
+    }
+
+  spin_unlock(&pool->lock);
+}
+
+static FAR sq_entry_t *mempool_magazine_alloc(FAR struct mempool_s *pool)
+{
+  FAR struct mempool_magazine_s *mag;
+  FAR sq_entry_t *blk;
+  irqstate_t flags;
+
+  if (!mempool_magazine_enabled(pool))
+    {
+      return NULL;
+    }
+
+  flags = up_irq_save();
+  mag = &pool->magazine[this_cpu()];
+  if (mag->head != NULL)
+    {
+      mag->nhit++;
+    }
+  else
+    {
+      mag->nmiss++;
+      mempool_magazine_refill(pool, mag);
+    }
+
+  blk = mag->head;
+  if (blk != NULL)
+    {
+      mag->head = blk->flink;
+      mag->count--;
+      blk->flink = NULL;
+    }
+
+  up_irq_restore(flags);
+  return blk;
+}
+
+static bool mempool_magazine_release(FAR struct mempool_s *pool,
+                                     FAR void *blk)
+{
+  FAR struct mempool_magazine_s *mag;
+  irqstate_t flags;
+
+  /* Blocks of the interrupt reserve always go back to the shared pool */
+
+  if (!mempool_magazine_enabled(pool) ||
+      (pool->ibase != NULL && (FAR char *)blk >= pool->ibase &&
+       (FAR char *)blk < pool->ibase + pool->interruptsize))
+    {
+      return false;
+    }
+
+  flags = up_irq_save();
+  mag = &pool->magazine[this_cpu()];
+  ((FAR sq_entry_t *)blk)->flink = mag->head;
+  mag->head = blk;
+  kasan_poison(blk, pool->blocksize);
+  if (++mag->count >= 2 * CONFIG_MM_MEMPOOL_MAGAZINE_SIZE)
+    {
+      mempool_magazine_flush(pool, mag, CONFIG_MM_MEMPOOL_MAGAZINE_SIZE);
+    }
+
+  up_irq_restore(flags);
+  return true;
+}
+
+static size_t mempool_magazine_count(FAR struct mempool_s *pool)
+{
+  size_t count = 0;
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      count += pool->magazine[cpu].count;
+    }
+
+  return count;
+}
+#else
+#  define mempool_magazine_count(pool) 0
+#endif
+
 #if CONFIG_MM_BACKTRACE >= 0
 static inline void mempool_add_backtrace(FAR struct mempool_s *pool,
                                          FAR struct mempool_backtrace_s *buf)
@@ -313,6 +456,10 @@ int mempool_init(FAR struct mempool_s *pool, FAR const char *name)
       nxsem_init(&pool->waitsem, 0, 0);
     }
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  memset(pool->magazine, 0, sizeof(pool->magazine));
+#endif
+
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL)
   mempool_procfs_register(&pool->procfs, name);
 #  ifdef CONFIG_MM_BACKTRACE_DEFAULT
@@ -347,6 +494,14 @@ FAR void *mempool_allocate(FAR struct mempool_s *pool)
   FAR sq_entry_t *blk;
   irqstate_t flags;
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  blk = mempool_magazine_alloc(pool);
+  if (blk != NULL)
+    {
+      goto found;
+    }
+#endif
+
 retry:
   flags = spin_lock_irqsave(&pool->lock);
   blk = mempool_remove_queue(pool, &pool->queue);
@@ -401,6 +556,9 @@ retry:
   pool->nalloc++;
   spin_unlock_irqrestore(&pool->lock, flags);
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+found:
+#endif
 #if CONFIG_MM_BACKTRACE >= 0
   mempool_add_backtrace(pool, (FAR struct mempool_backtrace_s *)
                               ((FAR char *)blk + pool->blocksize));
@@ -427,8 +585,8 @@ retry:
 
 void mempool_release(FAR struct mempool_s *pool, FAR void *blk)
 {
-  irqstate_t flags = spin_lock_irqsave(&pool->lock);
   size_t blocksize = MEMPOOL_REALBLOCKSIZE(pool);
+  irqstate_t flags;
 #if CONFIG_MM_BACKTRACE >= 0
   FAR struct mempool_backtrace_s *buf =
     (FAR struct mempool_backtrace_s *)((FAR char *)blk + pool->blocksize);
@@ -440,12 +598,20 @@ void mempool_release(FAR struct mempool_s *pool, FAR void *blk)
 
 #endif
 
-  pool->nalloc--;
-
 #ifdef CONFIG_MM_FILL_ALLOCATIONS
   memset(blk, MM_FREE_MAGIC, pool->blocksize);
 #endif
 
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  if (mempool_magazine_release(pool, blk))
+    {
+      return;
+    }
+
+#endif
+  flags = spin_lock_irqsave(&pool->lock);
+  pool->nalloc--;
+
   if (pool->interruptsize > blocksize)
     {
       if ((FAR char *)blk >= pool->ibase &&
@@ -495,6 +661,9 @@ int mempool_info(FAR struct mempool_s *pool, FAR struct mempoolinfo_s *info)
 {
   size_t blocksize = MEMPOOL_REALBLOCKSIZE(pool);
   irqstate_t flags;
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  int cpu;
+#endif
 
   DEBUGASSERT(pool != NULL && info != NULL);
 
@@ -506,6 +675,23 @@ int mempool_info(FAR struct mempool_s *pool, FAR struct mempoolinfo_s *info)
     (info->aordblks + info->ordblks + info->iordblks) * blocksize;
   spin_unlock_irqrestore(&pool->lock, flags);
   info->sizeblks = blocksize;
+
+  /* Blocks in the per-CPU caches are free, although the shared pool
+   * accounts them as allocated.
+   */
+
+  info->cordblks = mempool_magazine_count(pool);
+  info->aordblks -= info->cordblks;
+  info->nhit = 0;
+  info->nmiss = 0;
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      info->nhit += pool->magazine[cpu].nhit;
+      info->nmiss += pool->magazine[cpu].nmiss;
+    }
+#endif
+
   if (pool->wait && pool->expandsize == 0)
     {
       int semcount;
@@ -542,13 +728,16 @@ mempool_info_task(FAR struct mempool_s *pool,
                      sq_count(&pool->iqueue);
 
       spin_unlock_irqrestore(&pool->lock, flags);
+      count += mempool_magazine_count(pool);
       info.aordblks += count;
       info.uordblks += count * blocksize;
     }
   else if (task->pid == PID_MM_ALLOC)
     {
-      info.aordblks += pool->nalloc;
-      info.uordblks += pool->nalloc * blocksize;
+      size_t count = pool->nalloc - mempool_magazine_count(pool);
+
+      info.aordblks += count;
+      info.uordblks += count * blocksize;
     }
 #if CONFIG_MM_BACKTRACE >= 0
   else
@@ -617,6 +806,22 @@ int mempool_deinit(FAR struct mempool_s *pool)
   size_t blocksize = MEMPOOL_REALBLOCKSIZE(pool);
   FAR sq_entry_t *blk;
   size_t count = 0;
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  irqstate_t flags;
+  int cpu;
+
+  /* Give the blocks cached by every CPU back to the shared queue */
+
+  flags = up_irq_save();
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      FAR struct mempool_magazine_s *mag = &pool->magazine[cpu];
+
+      mempool_magazine_flush(pool, mag, mag->count);
+    }
+
+  up_irq_restore(flags);
+#endif
 
   if (pool->nalloc != 0)
     {
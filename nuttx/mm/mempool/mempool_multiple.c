@@ -25,6 +25,7 @@
  ****************************************************************************/
 
 #include <assert.h>
+#include <stdint.h>
 #include <strings.h>
 #include <syslog.h>
 #include <sys/param.h>
@@ -35,6 +36,14 @@
 #include <nuttx/mm/mempool.h>
 #include <nuttx/mm/kasan.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_MM_MEMPOOL_HISTOGRAM
+#  define mempool_multiple_record(mpool, size, pool)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -93,6 +102,9 @@ struct mempool_multiple_s
   size_t                        dict_col_num_log2;
   size_t                        dict_row_num;
   FAR struct mpool_dict_s     **dict;
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+  struct mempool_histogram_s    hist;        /* The request size histogram */
+#endif
 };
 
 /****************************************************************************
@@ -145,6 +157,42 @@ mempool_multiple_find(FAR struct mempool_multiple_s *mpool, size_t size)
   return &mpool->pools[left];
 }
 
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+/****************************************************************************
+ * Name: mempool_multiple_record
+ *
+ * Description:
+ *   Account a request of size bytes in the histogram.  pool is the mempool
+ *   that served the request, or NULL if it was left to the caller.
+ *
+ ****************************************************************************/
+
+static void mempool_multiple_record(FAR struct mempool_multiple_s *mpool,
+                                    size_t size,
+                                    FAR struct mempool_s *pool)
+{
+  size_t bin;
+
+  if (mpool == NULL)
+    {
+      return;
+    }
+
+  bin = size != 0 ? (size - 1) / MEMPOOL_HISTOGRAM_GRAIN : 0;
+  mpool->hist.bins[MIN(bin, MEMPOOL_HISTOGRAM_NBINS)]++;
+  mpool->hist.nalloc++;
+
+  if (pool == NULL)
+    {
+      mpool->hist.nfallback++;
+    }
+  else if (pool != mempool_multiple_find(mpool, size))
+    {
+      mpool->hist.nupgrade++;
+    }
+}
+#endif
+
 static FAR void *
 mempool_multiple_alloc_chunk(FAR struct mempool_multiple_s *mpool,
                              size_t align, size_t size)
@@ -502,6 +550,16 @@ mempool_multiple_init(FAR const char *name,
          mpool->dict_row_num * sizeof(FAR struct mpool_dict_s *));
   nxrmutex_init(&mpool->lock);
 
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+  memset(&mpool->hist, 0, sizeof(mpool->hist));
+  mpool->hist.mpool = mpool;
+  mpool->hist.npools = npools;
+#  if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL)
+  mpool->hist.name = name;
+  mempool_histogram_register(&mpool->hist);
+#  endif
+#endif
+
   return mpool;
 
 err_with_pools:
@@ -541,6 +599,7 @@ FAR void *mempool_multiple_alloc(FAR struct mempool_multiple_s *mpool,
   pool = mempool_multiple_find(mpool, size);
   if (pool == NULL)
     {
+      mempool_multiple_record(mpool, size, NULL);
       return NULL;
     }
 
@@ -551,11 +610,13 @@ FAR void *mempool_multiple_alloc(FAR struct mempool_multiple_s *mpool,
 
       if (blk)
         {
+          mempool_multiple_record(mpool, size, pool);
           return blk;
         }
     }
   while (++pool < end);
 
+  mempool_multiple_record(mpool, size, NULL);
   return NULL;
 }
 
@@ -707,6 +768,7 @@ FAR void *mempool_multiple_memalign(FAR struct mempool_multiple_s *mpool,
   pool = mempool_multiple_find(mpool, size + alignment);
   if (pool == NULL)
     {
+      mempool_multiple_record(mpool, size + alignment, NULL);
       return NULL;
     }
 
@@ -716,11 +778,13 @@ FAR void *mempool_multiple_memalign(FAR struct mempool_multiple_s *mpool,
       FAR char *blk = mempool_allocate(pool);
       if (blk != NULL)
         {
+          mempool_multiple_record(mpool, size + alignment, pool);
           return (FAR void *)ALIGN_UP((uintptr_t)blk, alignment);
         }
     }
   while (++pool < end);
 
+  mempool_multiple_record(mpool, size + alignment, NULL);
   return NULL;
 }
 
@@ -817,6 +881,152 @@ mempool_multiple_info_task(FAR struct mempool_multiple_s *mpool,
   return ret;
 }
 
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+/****************************************************************************
+ * Name: mempool_multiple_classinfo
+ *
+ * Description:
+ *   Report how the recorded requests map to the current size classes and
+ *   recommend classes for them.  Every histogram bin is accounted at its
+ *   upper bound, and the recommendation is the set of mpool->npools bin
+ *   bounds, the largest pinned to the current largest class, that
+ *   minimizes the total rounding waste.  It is found by dynamic
+ *   programming over the bins in O(npools * nbins^2) time.
+ *
+ ****************************************************************************/
+
+int mempool_multiple_classinfo(FAR struct mempool_multiple_s *mpool,
+                               FAR struct mempool_classinfo_s *info,
+                               FAR uint64_t *waste, FAR uint64_t *rwaste)
+{
+  FAR uint64_t *count;
+  FAR uint64_t *bytes;
+  FAR uint64_t *prev;
+  FAR uint64_t *cur;
+  FAR uint64_t *tmp;
+  FAR uint16_t *split;
+  size_t maxsize;
+  size_t nbins;
+  size_t nclass;
+  size_t size;
+  size_t i;
+  size_t j;
+  size_t m;
+
+  if (mpool == NULL || info == NULL)
+    {
+      return -EINVAL;
+    }
+
+  maxsize = mpool->pools[mpool->npools - 1].blocksize;
+  nbins   = (maxsize + MEMPOOL_HISTOGRAM_GRAIN - 1) /
+            MEMPOOL_HISTOGRAM_GRAIN;
+  nbins   = MIN(nbins, MEMPOOL_HISTOGRAM_NBINS);
+  nclass  = MIN(mpool->npools, nbins);
+
+  count = kmm_malloc(4 * (nbins + 1) * sizeof(uint64_t) +
+                     nclass * nbins * sizeof(uint16_t));
+  if (count == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  bytes = count + nbins + 1;
+  prev  = bytes + nbins + 1;
+  cur   = prev + nbins + 1;
+  split = (FAR uint16_t *)(cur + nbins + 1);
+
+  /* Take a snapshot of the histogram as prefix sums of the requests and
+   * of their (upper bound) sizes, and map it to the current classes.
+   */
+
+  memset(info, 0, mpool->npools * sizeof(struct mempool_classinfo_s));
+  for (i = 0; i < mpool->npools; i++)
+    {
+      info[i].blocksize = mpool->pools[i].blocksize;
+    }
+
+  *waste = 0;
+  count[0] = 0;
+  bytes[0] = 0;
+  for (i = 0; i < nbins; i++)
+    {
+      unsigned long nreq = mpool->hist.bins[i];
+      FAR struct mempool_s *pool;
+
+      size = i + 1 < nbins ? (i + 1) * MEMPOOL_HISTOGRAM_GRAIN : maxsize;
+      pool = mempool_multiple_find(mpool, size);
+      if (pool != NULL)
+        {
+          info[pool - mpool->pools].nreq += nreq;
+          *waste += (uint64_t)nreq * (pool->blocksize - size);
+        }
+
+      count[i + 1] = count[i] + nreq;
+      bytes[i + 1] = bytes[i] + (uint64_t)nreq * size;
+    }
+
+  /* prev[j] is the least waste of the bins 0..j served by m + 1 classes,
+   * the largest of which is the bound of bin j.
+   */
+
+  for (j = 0; j < nbins; j++)
+    {
+      size = j + 1 < nbins ? (j + 1) * MEMPOOL_HISTOGRAM_GRAIN : maxsize;
+      prev[j] = size * count[j + 1] - bytes[j + 1];
+    }
+
+  for (m = 1; m < nclass; m++)
+    {
+      for (j = 0; j < nbins; j++)
+        {
+          cur[j] = UINT64_MAX;
+          if (j < m)
+            {
+              continue;
+            }
+
+          size = j + 1 < nbins ? (j + 1) * MEMPOOL_HISTOGRAM_GRAIN :
+                                 maxsize;
+          for (i = m; i <= j; i++)
+            {
+              uint64_t cost = prev[i - 1] +
+                              size * (count[j + 1] - count[i]) -
+                              (bytes[j + 1] - bytes[i]);
+
+              if (cost < cur[j])
+                {
+                  cur[j] = cost;
+                  split[m * nbins + j] = i;
+                }
+            }
+        }
+
+      tmp  = prev;
+      prev = cur;
+      cur  = tmp;
+    }
+
+  /* Walk the splits back from the last bin to recover the classes */
+
+  *rwaste = prev[nbins - 1];
+  j = nbins - 1;
+  m = nclass;
+  while (m-- > 0)
+    {
+      info[m].recommend = j + 1 < nbins ?
+                          (j + 1) * MEMPOOL_HISTOGRAM_GRAIN : maxsize;
+      if (m > 0)
+        {
+          j = split[m * nbins + j] - 1;
+        }
+    }
+
+  kmm_free(count);
+  return 0;
+}
+#endif
+
 /****************************************************************************
  * Name: mempool_multiple_memdump
  *
@@ -870,6 +1080,11 @@ void mempool_multiple_deinit(FAR struct mempool_multiple_s *mpool)
       return;
     }
 
+#if defined(CONFIG_MM_MEMPOOL_HISTOGRAM) && defined(CONFIG_FS_PROCFS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPOOL)
+  mempool_histogram_unregister(&mpool->hist);
+#endif
+
   for (i = 0; i < mpool->npools; i++)
     {
       DEBUGVERIFY(mempool_deinit(mpool->pools + i));
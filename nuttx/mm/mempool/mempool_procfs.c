@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <inttypes.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -42,7 +43,11 @@
  * to handle the longest line generated by this logic.
  */
 
-#define MEMPOOLINFO_LINELEN 80
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+#  define MEMPOOLINFO_LINELEN 100
+#else
+#  define MEMPOOLINFO_LINELEN 80
+#endif
 
 /****************************************************************************
  * Private Types
@@ -69,6 +74,10 @@ static int     mempool_dup(FAR const struct file *oldp,
 static int     mempool_stat(FAR const char *relpath, FAR struct stat *buf);
 static ssize_t mempool_read(FAR struct file *filep, FAR char *buffer,
                             size_t buflen);
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+static ssize_t mempool_histogram_read(FAR struct file *filep,
+                                      FAR char *buffer, size_t buflen);
+#endif
 
 /****************************************************************************
  * Public Data
@@ -89,7 +98,27 @@ const struct procfs_operations g_mempool_operations =
   mempool_stat    /* stat */
 };
 
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+const struct procfs_operations g_mempool_histogram_operations =
+{
+  mempool_open,           /* open */
+  mempool_close,          /* close */
+  mempool_histogram_read, /* read */
+  NULL,                   /* write */
+  NULL,                   /* poll */
+  mempool_dup,            /* dup */
+  NULL,                   /* opendir */
+  NULL,                   /* closedir */
+  NULL,                   /* readdir */
+  NULL,                   /* rewinddir */
+  mempool_stat            /* stat */
+};
+#endif
+
 static FAR struct mempool_procfs_entry_s *g_mempool_procfs = NULL;
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+static FAR struct mempool_histogram_s *g_mempool_histogram = NULL;
+#endif
 
 /****************************************************************************
  * Private Functions
@@ -141,10 +170,17 @@ static ssize_t mempool_read(FAR struct file *filep, FAR char *buffer,
 
   offset    = filep->f_pos;
   procfile  = filep->f_priv;
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+  linesize  = procfs_snprintf(procfile->line, MEMPOOLINFO_LINELEN,
+                              "%13s%11s%9s%9s%9s%9s%9s%9s%8s\n", "",
+                              "total", "bsize", "nused", "nfree",
+                              "nifree", "nwaiter", "ncached", "hit%");
+#else
   linesize  = procfs_snprintf(procfile->line, MEMPOOLINFO_LINELEN,
                               "%13s%11s%9s%9s%9s%9s%9s\n", "", "total",
                               "bsize", "nused", "nfree", "nifree",
                               "nwaiter");
+#endif
 
   copysize  = procfs_memcpy(procfile->line, linesize, buffer, buflen,
                             &offset);
@@ -162,12 +198,25 @@ static ssize_t mempool_read(FAR struct file *filep, FAR char *buffer,
           buflen    -= copysize;
 
           mempool_info(pool, &minfo);
+#if CONFIG_MM_MEMPOOL_MAGAZINE_SIZE > 0
+          linesize   = procfs_snprintf(procfile->line, MEMPOOLINFO_LINELEN,
+                                       "%12s:%11lu%9lu%9lu%9lu%9lu%9lu"
+                                       "%9lu%8lu\n",
+                                       entry->name, minfo.arena,
+                                       minfo.sizeblks, minfo.aordblks,
+                                       minfo.ordblks, minfo.iordblks,
+                                       minfo.nwaiter, minfo.cordblks,
+                                       minfo.nhit + minfo.nmiss == 0 ? 0 :
+                                       minfo.nhit * 100 /
+                                       (minfo.nhit + minfo.nmiss));
+#else
           linesize   = procfs_snprintf(procfile->line, MEMPOOLINFO_LINELEN,
                                        "%12s:%11lu%9lu%9lu%9lu%9lu%9lu\n",
                                        entry->name, minfo.arena,
                                        minfo.sizeblks, minfo.aordblks,
                                        minfo.ordblks, minfo.iordblks,
                                        minfo.nwaiter);
+#endif
           copysize   = procfs_memcpy(procfile->line, linesize, buffer,
                                      buflen, &offset);
           totalsize += copysize;
@@ -178,6 +227,140 @@ static ssize_t mempool_read(FAR struct file *filep, FAR char *buffer,
   return totalsize;
 }
 
+/****************************************************************************
+ * Name: mempool_histogram_read
+ *
+ * Description:
+ *   For every multiple mempool, print the request counters, the current
+ *   and the recommended size classes with their estimated waste, and the
+ *   non-empty bins of the request size histogram.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+static ssize_t mempool_histogram_read(FAR struct file *filep,
+                                      FAR char *buffer, size_t buflen)
+{
+  FAR const struct mempool_histogram_s *hist;
+  FAR struct mempool_classinfo_s *info;
+  FAR struct mempool_file_s *procfile;
+  size_t linesize;
+  size_t copysize = 0;
+  size_t totalsize = 0;
+  uint64_t rwaste;
+  uint64_t waste;
+  off_t offset;
+  size_t i;
+
+  offset    = filep->f_pos;
+  procfile  = filep->f_priv;
+
+  for (hist = g_mempool_histogram; hist != NULL && totalsize < buflen;
+       hist = hist->next)
+    {
+      info = kmm_malloc(hist->npools * sizeof(struct mempool_classinfo_s));
+      if (info == NULL)
+        {
+          if (totalsize == 0)
+            {
+              return -ENOMEM;
+            }
+
+          break;
+        }
+
+      if (mempool_multiple_classinfo(hist->mpool, info,
+                                     &waste, &rwaste) < 0)
+        {
+          kmm_free(info);
+          continue;
+        }
+
+      for (i = 0; i < hist->npools + 3 && totalsize < buflen; i++)
+        {
+          buffer += copysize;
+          buflen -= copysize;
+
+          if (i == 0)
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%s: nalloc %lu nupgrade %lu "
+                                         "nfallback %lu\n", hist->name,
+                                         hist->nalloc, hist->nupgrade,
+                                         hist->nfallback);
+            }
+          else if (i == 1)
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%s: waste %" PRIu64
+                                         " recommended %" PRIu64 "\n",
+                                         hist->name, waste, rwaste);
+            }
+          else if (i == 2)
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%11s%11s%11s\n", "class",
+                                         "nreq", "recommend");
+            }
+          else
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%11zu%11lu%11zu\n",
+                                         info[i - 3].blocksize,
+                                         info[i - 3].nreq,
+                                         info[i - 3].recommend);
+            }
+
+          copysize   = procfs_memcpy(procfile->line, linesize, buffer,
+                                     buflen, &offset);
+          totalsize += copysize;
+        }
+
+      kmm_free(info);
+
+      for (i = 0; i <= MEMPOOL_HISTOGRAM_NBINS && totalsize < buflen; i++)
+        {
+          if (hist->bins[i] == 0)
+            {
+              continue;
+            }
+
+          buffer += copysize;
+          buflen -= copysize;
+
+          if (i < MEMPOOL_HISTOGRAM_NBINS)
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%10s%-11zu%11lu\n", "<=",
+                                         (i + 1) *
+                                         MEMPOOL_HISTOGRAM_GRAIN,
+                                         hist->bins[i]);
+            }
+          else
+            {
+              linesize = procfs_snprintf(procfile->line,
+                                         MEMPOOLINFO_LINELEN,
+                                         "%10s%-11zu%11lu\n", ">",
+                                         i * MEMPOOL_HISTOGRAM_GRAIN,
+                                         hist->bins[i]);
+            }
+
+          copysize   = procfs_memcpy(procfile->line, linesize, buffer,
+                                     buflen, &offset);
+          totalsize += copysize;
+        }
+    }
+
+  filep->f_pos += totalsize;
+  return totalsize;
+}
+#endif
+
 /****************************************************************************
  * Name: mempool_dup
  *
@@ -264,3 +447,49 @@ void mempool_procfs_unregister(FAR struct mempool_procfs_entry_s *entry)
         }
     }
 }
+
+/****************************************************************************
+ * Name: mempool_histogram_register
+ *
+ * Description:
+ *   Add the request size histogram of a multiple mempool to the procfs
+ *   file system.
+ *
+ * Input Parameters:
+ *   hist - Describes the histogram to be registered.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MM_MEMPOOL_HISTOGRAM
+void mempool_histogram_register(FAR struct mempool_histogram_s *hist)
+{
+  hist->next = g_mempool_histogram;
+  g_mempool_histogram = hist;
+}
+
+/****************************************************************************
+ * Name: mempool_histogram_unregister
+ *
+ * Description:
+ *   Remove the request size histogram of a multiple mempool from the procfs
+ *   file system.
+ *
+ * Input Parameters:
+ *   hist - Describes the histogram to be unregistered.
+ *
+ ****************************************************************************/
+
+void mempool_histogram_unregister(FAR struct mempool_histogram_s *hist)
+{
+  FAR struct mempool_histogram_s **cur;
+
+  for (cur = &g_mempool_histogram; *cur != NULL; cur = &(*cur)->next)
+    {
+      if (*cur == hist)
+        {
+          *cur = hist->next;
+          break;
+        }
+    }
+}
+#endif
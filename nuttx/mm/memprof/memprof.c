@@ -0,0 +1,606 @@
+/****************************************************************************
+ * mm/memprof/memprof.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/nuttx.h>
+#include <nuttx/sched.h>
+#include <nuttx/spinlock.h>
+#include <nuttx/fs/procfs.h>
+#include <nuttx/mm/memprof.h>
+
+#ifdef MM_MEMPROF
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Open addressing tables are kept at most half full */
+
+#define MEMPROF_NSLOTS     (2 * CONFIG_MM_MEMPROF_NSAMPLES)
+#define MEMPROF_NSITESLOTS (2 * CONFIG_MM_MEMPROF_NSITES)
+
+/* Counting filter of the sampled addresses, so that freeing memory that
+ * was not sampled costs a single unlocked load.
+ */
+
+#define MEMPROF_NFILTER    (4 * CONFIG_MM_MEMPROF_NSAMPLES)
+
+/* Site 0 collects the samples whose call stack did not fit in the table */
+
+#define MEMPROF_OVERFLOW   0
+
+/* Room for the counters plus one " 0x%p" per frame */
+
+#define MEMPROF_LINELEN    (64 + (3 + 2 * sizeof(uintptr_t)) * \
+                            CONFIG_MM_MEMPROF_DEPTH)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes one allocation site (call stack) */
+
+struct memprof_site_s
+{
+  uint32_t  hash;                            /* Hash of the call stack */
+  uint8_t   depth;                           /* Number of frames in stack */
+  FAR void *stack[CONFIG_MM_MEMPROF_DEPTH];  /* The call stack */
+  size_t    inuse_objs;                      /* Live sampled allocations */
+  size_t    inuse_bytes;                     /* Live sampled bytes */
+  size_t    alloc_objs;                      /* All sampled allocations */
+  size_t    alloc_bytes;                     /* All sampled bytes */
+};
+
+/* This structure describes one live sampled allocation */
+
+struct memprof_sample_s
+{
+  FAR void *mem;                             /* The sampled memory */
+  size_t    size;                            /* The size of the allocation */
+  uint16_t  site;                            /* Index of the allocation site */
+};
+
+/* This structure describes one open "file" */
+
+#if !defined(CONFIG_FS_PROCFS) || defined(CONFIG_FS_PROCFS_EXCLUDE_MEMPROF)
+#  define MEMPROF_PROCFS 0
+#else
+#  define MEMPROF_PROCFS 1
+
+struct memprof_file_s
+{
+  struct procfs_file_s base;                 /* Base open file structure */
+  char line[MEMPROF_LINELEN];                /* Pre-allocated line buffer */
+};
+#endif
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#if MEMPROF_PROCFS
+static int     memprof_open(FAR struct file *filep, FAR const char *relpath,
+                            int oflags, mode_t mode);
+static int     memprof_close(FAR struct file *filep);
+static ssize_t memprof_read(FAR struct file *filep, FAR char *buffer,
+                            size_t buflen);
+static int     memprof_dup(FAR const struct file *oldp,
+                           FAR struct file *newp);
+static int     memprof_stat(FAR const char *relpath, FAR struct stat *buf);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static spinlock_t g_memprof_lock = SP_UNLOCKED;
+
+static struct memprof_site_s g_memprof_sites[CONFIG_MM_MEMPROF_NSITES];
+static uint16_t g_memprof_sitehash[MEMPROF_NSITESLOTS];
+static size_t g_memprof_nsites = 1;
+
+static struct memprof_sample_s g_memprof_samples[MEMPROF_NSLOTS];
+static uint8_t g_memprof_filter[MEMPROF_NFILTER];
+static size_t g_memprof_nsamples;
+
+/* Per-CPU sampling state.  These are updated without any lock: a race
+ * with a migrating thread only perturbs the sampling interval.
+ */
+
+static ssize_t g_memprof_countdown[CONFIG_SMP_NCPUS];
+static uint32_t g_memprof_seed[CONFIG_SMP_NCPUS];
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#if MEMPROF_PROCFS
+const struct procfs_operations g_memprof_operations =
+{
+  memprof_open,   /* open */
+  memprof_close,  /* close */
+  memprof_read,   /* read */
+  NULL,           /* write */
+  NULL,           /* poll */
+  memprof_dup,    /* dup */
+  NULL,           /* opendir */
+  NULL,           /* closedir */
+  NULL,           /* readdir */
+  NULL,           /* rewinddir */
+  memprof_stat    /* stat */
+};
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: memprof_interval
+ *
+ * Description:
+ *   Return the number of bytes to allocate on this CPU before the next
+ *   sample is taken: uniformly distributed in [0, 2 * RATE), so that the
+ *   sampling does not alias with periodic allocation patterns.
+ *
+ ****************************************************************************/
+
+static ssize_t memprof_interval(int cpu)
+{
+  uint32_t x = g_memprof_seed[cpu];
+
+  if (x == 0)
+    {
+      x = 0x9e3779b9u + cpu;
+    }
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  g_memprof_seed[cpu] = x;
+
+  return (ssize_t)(((uint64_t)x * (2ull * CONFIG_MM_MEMPROF_RATE)) >> 32);
+}
+
+static inline uint32_t memprof_ptrhash(FAR void *mem)
+{
+  uintptr_t x = (uintptr_t)mem;
+
+  x ^= x >> 16;
+  x *= 0x45d9f3bu;
+  x ^= x >> 16;
+  return (uint32_t)x;
+}
+
+/****************************************************************************
+ * Name: memprof_find_site
+ *
+ * Description:
+ *   Find or create the site of a call stack.  The caller holds the lock.
+ *
+ ****************************************************************************/
+
+static FAR struct memprof_site_s *
+memprof_find_site(FAR void **stack, int depth)
+{
+  FAR struct memprof_site_s *site;
+  uint32_t hash = 2166136261u;
+  size_t slot;
+  int i;
+
+  for (i = 0; i < depth; i++)
+    {
+      hash = (hash ^ (uint32_t)(uintptr_t)stack[i]) * 16777619u;
+    }
+
+  for (slot = hash % MEMPROF_NSITESLOTS; g_memprof_sitehash[slot] != 0;
+       slot = (slot + 1) % MEMPROF_NSITESLOTS)
+    {
+      site = &g_memprof_sites[g_memprof_sitehash[slot]];
+      if (site->hash == hash && site->depth == depth &&
+          memcmp(site->stack, stack, depth * sizeof(FAR void *)) == 0)
+        {
+          return site;
+        }
+    }
+
+  if (g_memprof_nsites >= CONFIG_MM_MEMPROF_NSITES)
+    {
+      return &g_memprof_sites[MEMPROF_OVERFLOW];
+    }
+
+  g_memprof_sitehash[slot] = g_memprof_nsites;
+  site        = &g_memprof_sites[g_memprof_nsites++];
+  site->hash  = hash;
+  site->depth = depth;
+  memcpy(site->stack, stack, depth * sizeof(FAR void *));
+  return site;
+}
+
+/****************************************************************************
+ * Name: memprof_find_sample
+ *
+ * Description:
+ *   Return the slot of a live sample, or the empty slot where it would be
+ *   inserted.  The caller holds the lock.
+ *
+ ****************************************************************************/
+
+static size_t memprof_find_sample(FAR void *mem)
+{
+  size_t slot;
+
+  for (slot = memprof_ptrhash(mem) % MEMPROF_NSLOTS;
+       g_memprof_samples[slot].mem != NULL &&
+       g_memprof_samples[slot].mem != mem;
+       slot = (slot + 1) % MEMPROF_NSLOTS);
+
+  return slot;
+}
+
+/****************************************************************************
+ * Name: memprof_remove_sample
+ *
+ * Description:
+ *   Remove a live sample, shifting back the entries of its probe sequence
+ *   so that no tombstone is needed.  The caller holds the lock.
+ *
+ ****************************************************************************/
+
+static void memprof_remove_sample(size_t slot)
+{
+  FAR struct memprof_site_s *site;
+  FAR uint8_t *filter;
+  size_t home;
+  size_t next;
+
+  site = &g_memprof_sites[g_memprof_samples[slot].site];
+  g_memprof_nsamples--;
+  site->inuse_objs--;
+  site->inuse_bytes -= g_memprof_samples[slot].size;
+
+  filter = &g_memprof_filter[memprof_ptrhash(g_memprof_samples[slot].mem) %
+                             MEMPROF_NFILTER];
+  if (*filter != UINT8_MAX)
+    {
+      (*filter)--;
+    }
+
+  for (next = slot; ; )
+    {
+      g_memprof_samples[slot].mem = NULL;
+
+      do
+        {
+          next = (next + 1) % MEMPROF_NSLOTS;
+          if (g_memprof_samples[next].mem == NULL)
+            {
+              return;
+            }
+
+          home = memprof_ptrhash(g_memprof_samples[next].mem) %
+                 MEMPROF_NSLOTS;
+        }
+      while (slot <= next ? slot < home && home <= next :
+                            slot < home || home <= next);
+
+      g_memprof_samples[slot] = g_memprof_samples[next];
+      slot = next;
+    }
+}
+
+#if MEMPROF_PROCFS
+
+/****************************************************************************
+ * Name: memprof_open
+ ****************************************************************************/
+
+static int memprof_open(FAR struct file *filep, FAR const char *relpath,
+                        int oflags, mode_t mode)
+{
+  FAR struct memprof_file_s *procfile;
+
+  procfile = kmm_zalloc(sizeof(struct memprof_file_s));
+  if (procfile == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  filep->f_priv = procfile;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memprof_close
+ ****************************************************************************/
+
+static int memprof_close(FAR struct file *filep)
+{
+  kmm_free(filep->f_priv);
+  filep->f_priv = NULL;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memprof_read
+ *
+ * Description:
+ *   Produce the profile in the text heap profile format understood by
+ *   pprof ("heap_v2"): one line per allocation site with the live and the
+ *   cumulative sampled objects and bytes, followed by the call stack.
+ *
+ ****************************************************************************/
+
+static ssize_t memprof_read(FAR struct file *filep, FAR char *buffer,
+                            size_t buflen)
+{
+  FAR struct memprof_file_s *procfile = filep->f_priv;
+  struct memprof_site_s site;
+  struct memprof_site_s total;
+  irqstate_t flags;
+  size_t bufsize = buflen;
+  size_t totalsize = 0;
+  size_t linesize;
+  size_t copysize;
+  off_t offset = filep->f_pos;
+  size_t i;
+  int j;
+
+  memset(&total, 0, sizeof(total));
+  flags = spin_lock_irqsave(&g_memprof_lock);
+  for (i = 0; i < g_memprof_nsites; i++)
+    {
+      total.inuse_objs  += g_memprof_sites[i].inuse_objs;
+      total.inuse_bytes += g_memprof_sites[i].inuse_bytes;
+      total.alloc_objs  += g_memprof_sites[i].alloc_objs;
+      total.alloc_bytes += g_memprof_sites[i].alloc_bytes;
+    }
+
+  spin_unlock_irqrestore(&g_memprof_lock, flags);
+
+  linesize = procfs_snprintf(procfile->line, MEMPROF_LINELEN,
+                             "heap profile: %zu: %zu [%zu: %zu] "
+                             "@ heap_v2/%d\n",
+                             total.inuse_objs, total.inuse_bytes,
+                             total.alloc_objs, total.alloc_bytes,
+                             CONFIG_MM_MEMPROF_RATE);
+  copysize = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                           &offset);
+  totalsize += copysize;
+
+  for (i = 0; i < g_memprof_nsites && totalsize < bufsize; i++)
+    {
+      flags = spin_lock_irqsave(&g_memprof_lock);
+      site = g_memprof_sites[i];
+      spin_unlock_irqrestore(&g_memprof_lock, flags);
+
+      if (site.alloc_objs == 0)
+        {
+          continue;
+        }
+
+      linesize = procfs_snprintf(procfile->line, MEMPROF_LINELEN,
+                                 "%zu: %zu [%zu: %zu] @",
+                                 site.inuse_objs, site.inuse_bytes,
+                                 site.alloc_objs, site.alloc_bytes);
+      for (j = 0; j < site.depth; j++)
+        {
+          linesize += procfs_snprintf(procfile->line + linesize,
+                                      MEMPROF_LINELEN - linesize,
+                                      " 0x%" PRIxPTR,
+                                      (uintptr_t)site.stack[j]);
+        }
+
+      linesize += procfs_snprintf(procfile->line + linesize,
+                                  MEMPROF_LINELEN - linesize, "\n");
+
+      buffer   += copysize;
+      buflen   -= copysize;
+      copysize  = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                                &offset);
+      totalsize += copysize;
+    }
+
+  if (totalsize < bufsize)
+    {
+      linesize = procfs_snprintf(procfile->line, MEMPROF_LINELEN,
+                                 "\nMAPPED_LIBRARIES:\n");
+      buffer   += copysize;
+      buflen   -= copysize;
+      copysize  = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                                &offset);
+      totalsize += copysize;
+    }
+
+  filep->f_pos += totalsize;
+  return totalsize;
+}
+
+/****************************************************************************
+ * Name: memprof_dup
+ ****************************************************************************/
+
+static int memprof_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct memprof_file_s *newattr;
+
+  newattr = kmm_malloc(sizeof(struct memprof_file_s));
+  if (newattr == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memcpy(newattr, oldp->f_priv, sizeof(struct memprof_file_s));
+  newp->f_priv = newattr;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memprof_stat
+ ****************************************************************************/
+
+static int memprof_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return 0;
+}
+
+#endif /* MEMPROF_PROCFS */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_memprof_alloc
+ *
+ * Description:
+ *   Account an allocation to the sampling heap profiler.  On average one
+ *   allocation is sampled every CONFIG_MM_MEMPROF_RATE bytes; the call
+ *   stack of a sampled allocation is recorded and the allocation is
+ *   tracked until it is freed.
+ *
+ * Input Parameters:
+ *   heap - The heap the memory was allocated from
+ *   mem  - The allocated memory
+ *   size - The size of the allocation
+ *
+ ****************************************************************************/
+
+void mm_memprof_alloc(FAR struct mm_heap_s *heap, FAR void *mem,
+                      size_t size)
+{
+  FAR void *stack[CONFIG_MM_MEMPROF_DEPTH];
+  FAR struct memprof_site_s *site;
+  FAR uint8_t *filter;
+  irqstate_t flags;
+  size_t slot;
+  int depth = 0;
+  int cpu = this_cpu();
+
+  if (mem == NULL)
+    {
+      return;
+    }
+
+  /* This is the fast path taken by all allocations but the sampled ones */
+
+  g_memprof_countdown[cpu] -= size;
+  if (g_memprof_countdown[cpu] > 0)
+    {
+      return;
+    }
+
+  g_memprof_countdown[cpu] = memprof_interval(cpu);
+
+  if (!up_interrupt_context())
+    {
+      depth = sched_backtrace(_SCHED_GETTID(), stack,
+                              CONFIG_MM_MEMPROF_DEPTH,
+                              CONFIG_MM_MEMPROF_SKIP);
+      if (depth < 0)
+        {
+          depth = 0;
+        }
+    }
+
+  flags = spin_lock_irqsave(&g_memprof_lock);
+
+  site = memprof_find_site(stack, depth);
+  site->alloc_objs++;
+  site->alloc_bytes += size;
+
+  /* The live allocation is tracked only while there is room for it */
+
+  slot = memprof_find_sample(mem);
+  if (g_memprof_samples[slot].mem == NULL &&
+      g_memprof_nsamples < CONFIG_MM_MEMPROF_NSAMPLES)
+    {
+      g_memprof_samples[slot].mem  = mem;
+      g_memprof_samples[slot].size = size;
+      g_memprof_samples[slot].site = site - g_memprof_sites;
+      g_memprof_nsamples++;
+      site->inuse_objs++;
+      site->inuse_bytes += size;
+
+      filter = &g_memprof_filter[memprof_ptrhash(mem) % MEMPROF_NFILTER];
+      if (*filter != UINT8_MAX)
+        {
+          (*filter)++;
+        }
+    }
+
+  spin_unlock_irqrestore(&g_memprof_lock, flags);
+}
+
+/****************************************************************************
+ * Name: mm_memprof_free
+ *
+ * Description:
+ *   Tell the sampling heap profiler that memory is being freed.  Nothing
+ *   is done unless the memory was sampled when it was allocated.
+ *
+ * Input Parameters:
+ *   heap - The heap the memory is released to
+ *   mem  - The memory being freed
+ *
+ ****************************************************************************/
+
+void mm_memprof_free(FAR struct mm_heap_s *heap, FAR void *mem)
+{
+  irqstate_t flags;
+  size_t slot;
+
+  /* This is the fast path taken by all frees but the sampled ones */
+
+  if (g_memprof_filter[memprof_ptrhash(mem) % MEMPROF_NFILTER] == 0)
+    {
+      return;
+    }
+
+  flags = spin_lock_irqsave(&g_memprof_lock);
+  slot = memprof_find_sample(mem);
+  if (g_memprof_samples[slot].mem != NULL)
+    {
+      memprof_remove_sample(slot);
+    }
+
+  spin_unlock_irqrestore(&g_memprof_lock, flags);
+}
+
+#endif /* MM_MEMPROF */
@@ -31,8 +31,10 @@
 
 #include <nuttx/mutex.h>
 #include <nuttx/sched.h>
+#include <nuttx/spinlock.h>
 #include <nuttx/fs/procfs.h>
 #include <nuttx/lib/math32.h>
+#include <nuttx/mm/gran.h>
 #include <nuttx/mm/mempool.h>
 #include <nuttx/mm/mm.h>
 
@@ -48,6 +50,19 @@
 
 /* Configuration ************************************************************/
 
+/* The page granular large allocation area is set up lazily from the heap
+ * itself and needs the kernel granule allocator, so it is only available
+ * to the heaps managed from the kernel side.
+ */
+
+#if CONFIG_MM_HEAP_LARGE_THRESHOLD > 0
+#  define MM_LARGE_NBUCKETS  8
+#  define MM_LARGE_PAGESIZE  (1 << CONFIG_MM_HEAP_LARGE_LOG2GRAN)
+#  if defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__)
+#    define MM_HEAP_LARGE
+#  endif
+#endif
+
 /* Chunk Header Definitions *************************************************/
 
 /* These definitions define the characteristics of the allocator:
@@ -214,6 +229,20 @@ struct mm_delaynode_s
   FAR struct mm_delaynode_s *flink;
 };
 
+/* This describes a block of the large allocation area.  The header sits
+ * at the start of the granules and the caller's memory follows it.
+ */
+
+#if CONFIG_MM_HEAP_LARGE_THRESHOLD > 0
+struct mm_largenode_s
+{
+  size_t                     size;  /* Size of the granules of the block */
+  FAR struct mm_largenode_s *flink; /* Next block in the recycle bucket */
+};
+
+#  define MM_SIZEOF_LARGENODE MM_ALIGN_UP(sizeof(struct mm_largenode_s))
+#endif
+
 /* This describes one heap (possibly with multiple regions) */
 
 struct mm_heap_s
@@ -265,6 +294,20 @@ struct mm_heap_s
   FAR struct mempool_multiple_s *mm_mpool;
 #endif
 
+  /* The page granular area for large allocations, carved from the heap
+   * on first use, and its buckets of recently freed blocks.
+   */
+
+#if CONFIG_MM_HEAP_LARGE_THRESHOLD > 0
+  uint8_t                        mm_largestate;
+  GRAN_HANDLE                    mm_large;
+  FAR char                      *mm_largestart;
+  FAR char                      *mm_largeend;
+  spinlock_t                     mm_largelock;
+  FAR struct mm_largenode_s     *mm_largecache[MM_LARGE_NBUCKETS];
+  size_t                         mm_largecount[MM_LARGE_NBUCKETS];
+#endif
+
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMINFO)
   struct procfs_meminfo_entry_s mm_procfs;
 #endif
@@ -300,6 +343,25 @@ void mm_foreach(FAR struct mm_heap_s *heap, mm_node_handler_t handler,
 
 void mm_delayfree(FAR struct mm_heap_s *heap, FAR void *mem, bool delay);
 
+/* Functions contained in mm_malloc.c ***************************************/
+
+#ifdef MM_HEAP_LARGE
+FAR void *mm_malloc_chunk(FAR struct mm_heap_s *heap, size_t size);
+#else
+#  define mm_malloc_chunk(heap, size) mm_malloc(heap, size)
+#endif
+
+/* Functions contained in mm_large.c ****************************************/
+
+#ifdef MM_HEAP_LARGE
+FAR void *mm_large_alloc(FAR struct mm_heap_s *heap, size_t size);
+bool mm_large_free(FAR struct mm_heap_s *heap, FAR void *mem);
+ssize_t mm_large_size(FAR struct mm_heap_s *heap, FAR void *mem);
+void mm_large_mallinfo(FAR struct mm_heap_s *heap,
+                       FAR struct mallinfo *info);
+void mm_large_uninitialize(FAR struct mm_heap_s *heap);
+#endif
+
 /****************************************************************************
  * Inline Functions
  ****************************************************************************/
@@ -33,6 +33,7 @@
 #include <nuttx/sched.h>
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
+#include <nuttx/mm/memprof.h>
 #include <nuttx/sched_note.h>
 
 #include "mm_heap/mm.h"
@@ -241,6 +242,14 @@ void mm_free(FAR struct mm_heap_s *heap, FAR void *mem)
     }
 
   DEBUGASSERT(mm_heapmember(heap, mem));
+  mm_memprof_free(heap, mem);
+
+#ifdef MM_HEAP_LARGE
+  if (mm_large_free(heap, mem))
+    {
+      return;
+    }
+#endif
 
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   if (heap->mm_mpool)
@@ -270,6 +270,9 @@ FAR struct mm_heap_s *mm_initialize(FAR const char *name,
    */
 
   nxmutex_init(&heap->mm_lock);
+#ifdef MM_HEAP_LARGE
+  spin_lock_init(&heap->mm_largelock);
+#endif
 
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_MEMINFO)
 #  if defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__)
@@ -375,6 +378,10 @@ void mm_uninitialize(FAR struct mm_heap_s *heap)
   mempool_multiple_deinit(heap->mm_mpool);
 #endif
 
+#ifdef MM_HEAP_LARGE
+  mm_large_uninitialize(heap);
+#endif
+
   for (i = 0; i < CONFIG_MM_REGIONS; i++)
     {
       kasan_unregister(heap->mm_heapstart[i]);
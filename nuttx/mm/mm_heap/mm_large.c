@@ -0,0 +1,395 @@
+/****************************************************************************
+ * mm/mm_heap/mm_large.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <debug.h>
+#include <errno.h>
+#include <strings.h>
+#include <sys/param.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/nuttx.h>
+#include <nuttx/mm/gran.h>
+#include <nuttx/mm/mm.h>
+
+#include "mm_heap/mm.h"
+
+#ifdef MM_HEAP_LARGE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The states of the large allocation area of a heap */
+
+#define MM_LARGE_NONE      0 /* Not set up yet */
+#define MM_LARGE_BUSY      1 /* Being carved from the heap */
+#define MM_LARGE_READY     2 /* Ready for use */
+#define MM_LARGE_FAILED    3 /* Could not be set up, never retried */
+
+#define MM_LARGE_MEMBER(heap, mem) \
+  ((FAR char *)(mem) >= (heap)->mm_largestart && \
+   (FAR char *)(mem) < (heap)->mm_largeend)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_large_bucket
+ *
+ * Description:
+ *   Return the recycle bucket of a block of size bytes.  Bucket n holds the
+ *   blocks of [2^n, 2^(n+1)) granules, the last one all larger blocks.
+ *
+ ****************************************************************************/
+
+static unsigned int mm_large_bucket(size_t size)
+{
+  unsigned int ndx = fls(size >> CONFIG_MM_HEAP_LARGE_LOG2GRAN) - 1;
+
+  return MIN(ndx, MM_LARGE_NBUCKETS - 1);
+}
+
+/****************************************************************************
+ * Name: mm_large_setup
+ *
+ * Description:
+ *   Carve the large allocation area from the heap on first use.  The
+ *   granule allocator needs the kernel heap for its own state, which is
+ *   not usable yet while the heap itself is being initialized.  Any large
+ *   request made while the area is being set up, including the one that
+ *   carves it, is served by the general heap.
+ *
+ ****************************************************************************/
+
+static bool mm_large_setup(FAR struct mm_heap_s *heap)
+{
+  GRAN_HANDLE gran = NULL;
+  FAR char *start;
+  uint8_t state;
+
+  if (mm_lock(heap) < 0)
+    {
+      return false;
+    }
+
+  state = heap->mm_largestate;
+  if (state == MM_LARGE_NONE)
+    {
+      heap->mm_largestate = MM_LARGE_BUSY;
+    }
+
+  mm_unlock(heap);
+  if (state != MM_LARGE_NONE)
+    {
+      return state == MM_LARGE_READY;
+    }
+
+  start = mm_memalign(heap, MM_LARGE_PAGESIZE, CONFIG_MM_HEAP_LARGE_SIZE);
+  if (start != NULL)
+    {
+      gran = gran_initialize(start, CONFIG_MM_HEAP_LARGE_SIZE,
+                             CONFIG_MM_HEAP_LARGE_LOG2GRAN,
+                             CONFIG_MM_HEAP_LARGE_LOG2GRAN);
+      if (gran == NULL)
+        {
+          mm_free(heap, start);
+        }
+    }
+
+  DEBUGVERIFY(mm_lock(heap));
+  if (gran != NULL)
+    {
+      heap->mm_largestart = start;
+      heap->mm_largeend   = start + CONFIG_MM_HEAP_LARGE_SIZE;
+      heap->mm_large      = gran;
+      heap->mm_largestate = MM_LARGE_READY;
+    }
+  else
+    {
+      mwarn("WARNING: No large allocation area for heap %p\n", heap);
+      heap->mm_largestate = MM_LARGE_FAILED;
+    }
+
+  mm_unlock(heap);
+  return gran != NULL;
+}
+
+/****************************************************************************
+ * Name: mm_large_drain
+ *
+ * Description:
+ *   Give all recycled blocks back to the granule allocator so that they
+ *   can be merged into longer free runs.
+ *
+ ****************************************************************************/
+
+static void mm_large_drain(FAR struct mm_heap_s *heap)
+{
+  FAR struct mm_largenode_s *node;
+  FAR struct mm_largenode_s *next;
+  irqstate_t flags;
+  int i;
+
+  for (i = 0; i < MM_LARGE_NBUCKETS; i++)
+    {
+      flags = spin_lock_irqsave(&heap->mm_largelock);
+      node = heap->mm_largecache[i];
+      heap->mm_largecache[i] = NULL;
+      heap->mm_largecount[i] = 0;
+      spin_unlock_irqrestore(&heap->mm_largelock, flags);
+
+      for (; node != NULL; node = next)
+        {
+          next = node->flink;
+          gran_free(heap->mm_large, node, node->size);
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_large_alloc
+ *
+ * Description:
+ *   Allocate a block of at least size bytes from the page granular large
+ *   allocation area, preferring a recently freed block of the same bucket.
+ *
+ * Returned Value:
+ *   The allocated memory, or NULL if the area can't serve the request and
+ *   it must be served by the general heap.
+ *
+ ****************************************************************************/
+
+FAR void *mm_large_alloc(FAR struct mm_heap_s *heap, size_t size)
+{
+  FAR struct mm_largenode_s **prev;
+  FAR struct mm_largenode_s *node;
+  irqstate_t flags;
+  unsigned int ndx;
+  size_t need;
+
+  if (heap->mm_large == NULL && !mm_large_setup(heap))
+    {
+      return NULL;
+    }
+
+  need = ALIGN_UP(size + MM_SIZEOF_LARGENODE, MM_LARGE_PAGESIZE);
+  if (need < size)
+    {
+      return NULL;
+    }
+
+  /* A recycled block may be larger than needed, but not twice as large */
+
+  ndx = mm_large_bucket(need);
+  flags = spin_lock_irqsave(&heap->mm_largelock);
+  for (prev = &heap->mm_largecache[ndx]; (node = *prev) != NULL;
+       prev = &node->flink)
+    {
+      if (node->size >= need && node->size / 2 < need)
+        {
+          *prev = node->flink;
+          heap->mm_largecount[ndx]--;
+          break;
+        }
+    }
+
+  spin_unlock_irqrestore(&heap->mm_largelock, flags);
+
+  if (node == NULL)
+    {
+      node = gran_alloc(heap->mm_large, need);
+      if (node == NULL)
+        {
+          mm_large_drain(heap);
+          node = gran_alloc(heap->mm_large, need);
+          if (node == NULL)
+            {
+              return NULL;
+            }
+        }
+
+      node->size = need;
+    }
+
+  return (FAR char *)node + MM_SIZEOF_LARGENODE;
+}
+
+/****************************************************************************
+ * Name: mm_large_free
+ *
+ * Description:
+ *   Free a block if it belongs to the large allocation area.  Up to
+ *   CONFIG_MM_HEAP_LARGE_NCACHE blocks per bucket are kept for reuse, the
+ *   others go back to the granule allocator.  Blocks freed where the
+ *   granule allocator can't be locked are always kept.
+ *
+ * Returned Value:
+ *   true if the block was freed, false if it belongs to the general heap.
+ *
+ ****************************************************************************/
+
+bool mm_large_free(FAR struct mm_heap_s *heap, FAR void *mem)
+{
+  FAR struct mm_largenode_s *node;
+  irqstate_t flags;
+  unsigned int ndx;
+
+  if (!MM_LARGE_MEMBER(heap, mem))
+    {
+      return false;
+    }
+
+  node = (FAR struct mm_largenode_s *)
+         ((FAR char *)mem - MM_SIZEOF_LARGENODE);
+  ndx  = mm_large_bucket(node->size);
+
+  flags = spin_lock_irqsave(&heap->mm_largelock);
+  if (heap->mm_largecount[ndx] < CONFIG_MM_HEAP_LARGE_NCACHE ||
+      up_interrupt_context() || _SCHED_GETTID() < 0)
+    {
+      node->flink = heap->mm_largecache[ndx];
+      heap->mm_largecache[ndx] = node;
+      heap->mm_largecount[ndx]++;
+      node = NULL;
+    }
+
+  spin_unlock_irqrestore(&heap->mm_largelock, flags);
+
+  if (node != NULL)
+    {
+      gran_free(heap->mm_large, node, node->size);
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: mm_large_size
+ *
+ * Description:
+ *   Return the usable size of a block of the large allocation area, or
+ *   -EINVAL if it belongs to the general heap.
+ *
+ ****************************************************************************/
+
+ssize_t mm_large_size(FAR struct mm_heap_s *heap, FAR void *mem)
+{
+  FAR struct mm_largenode_s *node;
+
+  if (!MM_LARGE_MEMBER(heap, mem))
+    {
+      return -EINVAL;
+    }
+
+  node = (FAR struct mm_largenode_s *)
+         ((FAR char *)mem - MM_SIZEOF_LARGENODE);
+  return node->size - MM_SIZEOF_LARGENODE;
+}
+
+/****************************************************************************
+ * Name: mm_large_mallinfo
+ *
+ * Description:
+ *   The large allocation area is a single used chunk of the general heap.
+ *   Move its free and recycled granules to the free statistics.
+ *
+ ****************************************************************************/
+
+void mm_large_mallinfo(FAR struct mm_heap_s *heap,
+                       FAR struct mallinfo *info)
+{
+  FAR struct mm_largenode_s *node;
+  struct graninfo_s graninfo;
+  irqstate_t flags;
+  size_t mxfree;
+  size_t nfree;
+  int i;
+
+  if (heap->mm_large == NULL)
+    {
+      return;
+    }
+
+  gran_info(heap->mm_large, &graninfo);
+  nfree  = (size_t)graninfo.nfree << CONFIG_MM_HEAP_LARGE_LOG2GRAN;
+  mxfree = (size_t)graninfo.mxfree << CONFIG_MM_HEAP_LARGE_LOG2GRAN;
+
+  flags = spin_lock_irqsave(&heap->mm_largelock);
+  for (i = 0; i < MM_LARGE_NBUCKETS; i++)
+    {
+      for (node = heap->mm_largecache[i]; node != NULL; node = node->flink)
+        {
+          nfree += node->size;
+        }
+    }
+
+  spin_unlock_irqrestore(&heap->mm_largelock, flags);
+
+  info->uordblks -= nfree;
+  info->fordblks += nfree;
+  if (info->mxordblk < mxfree)
+    {
+      info->mxordblk = mxfree;
+    }
+}
+
+/****************************************************************************
+ * Name: mm_large_uninitialize
+ *
+ * Description:
+ *   Release the large allocation area back to the heap.
+ *
+ ****************************************************************************/
+
+void mm_large_uninitialize(FAR struct mm_heap_s *heap)
+{
+  FAR char *start = heap->mm_largestart;
+
+  if (heap->mm_large == NULL)
+    {
+      return;
+    }
+
+  mm_large_drain(heap);
+  gran_release(heap->mm_large);
+  heap->mm_large      = NULL;
+  heap->mm_largestart = NULL;
+  heap->mm_largeend   = NULL;
+
+  /* Now the area is an ordinary chunk of the heap */
+
+  mm_free(heap, start);
+}
+
+#endif /* MM_HEAP_LARGE */
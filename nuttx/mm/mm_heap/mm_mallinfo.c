@@ -146,6 +146,10 @@ struct mallinfo mm_mallinfo(FAR struct mm_heap_s *heap)
   info.fordblks += poolinfo.fordblks;
 #endif
 
+#ifdef MM_HEAP_LARGE
+  mm_large_mallinfo(heap, &info);
+#endif
+
   DEBUGASSERT(info.uordblks + info.fordblks == info.arena);
 
   return info;
@@ -33,6 +33,7 @@
 #include <nuttx/arch.h>
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
+#include <nuttx/mm/memprof.h>
 #include <nuttx/sched.h>
 #include <nuttx/sched_note.h>
 
@@ -137,37 +138,18 @@ void mm_mempool_dump_handle(FAR struct mempool_s *pool, FAR void *arg)
 #endif
 
 /****************************************************************************
- * Public Functions
- ****************************************************************************/
-
-/****************************************************************************
- * Name: mm_free_delaylist
- *
- * Description:
- *   force freeing the delaylist of this heap.
- *
- ****************************************************************************/
-
-void mm_free_delaylist(FAR struct mm_heap_s *heap)
-{
-  if (heap)
-    {
-       free_delaylist(heap, true);
-    }
-}
-
-/****************************************************************************
- * Name: mm_malloc
+ * Name: mm_malloc_internal
  *
  * Description:
  *  Find the smallest chunk that satisfies the request. Take the memory from
- *  that chunk, save the remaining, smaller chunk (if any).
- *
- *  8-byte alignment of the allocated data is assured.
+ *  that chunk, save the remaining, smaller chunk (if any).  Large requests
+ *  are only sent to the large allocation area if 'large' is true, the
+ *  callers that need a chunk with an allocation node header pass false.
  *
  ****************************************************************************/
 
-FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
+static FAR void *mm_malloc_internal(FAR struct mm_heap_s *heap, size_t size,
+                                    bool large)
 {
   FAR struct mm_freenode_s *node;
   size_t alignsize;
@@ -185,6 +167,21 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
       ret = mempool_multiple_alloc(heap->mm_mpool, size);
       if (ret != NULL)
         {
+          mm_memprof_alloc(heap, ret, size);
+          return ret;
+        }
+    }
+#endif
+
+#ifdef MM_HEAP_LARGE
+  /* Keep large buffers out of the free lists of the general heap */
+
+  if (large && size >= CONFIG_MM_HEAP_LARGE_THRESHOLD)
+    {
+      ret = mm_large_alloc(heap, size);
+      if (ret != NULL)
+        {
+          mm_memprof_alloc(heap, ret, size);
           return ret;
         }
     }
@@ -340,6 +337,7 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
 #ifdef CONFIG_DEBUG_MM
       minfo("Allocated %p, size %zu\n", ret, alignsize);
 #endif
+      mm_memprof_alloc(heap, ret, size);
     }
 
 #if CONFIG_MM_FREE_DELAYCOUNT_MAX > 0
@@ -347,7 +345,7 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
 
   else if (free_delaylist(heap, true))
     {
-      return mm_malloc(heap, size);
+      return mm_malloc_internal(heap, size, large);
     }
 #endif
 
@@ -411,3 +409,55 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
   DEBUGASSERT(ret == NULL || ((uintptr_t)ret) % MM_ALIGN == 0);
   return ret;
 }
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mm_free_delaylist
+ *
+ * Description:
+ *   force freeing the delaylist of this heap.
+ *
+ ****************************************************************************/
+
+void mm_free_delaylist(FAR struct mm_heap_s *heap)
+{
+  if (heap)
+    {
+       free_delaylist(heap, true);
+    }
+}
+
+/****************************************************************************
+ * Name: mm_malloc
+ *
+ * Description:
+ *  Find the smallest chunk that satisfies the request. Take the memory from
+ *  that chunk, save the remaining, smaller chunk (if any).
+ *
+ *  8-byte alignment of the allocated data is assured.
+ *
+ ****************************************************************************/
+
+FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
+{
+  return mm_malloc_internal(heap, size, true);
+}
+
+/****************************************************************************
+ * Name: mm_malloc_chunk
+ *
+ * Description:
+ *  Like mm_malloc(), but always allocate a chunk of the general heap, so
+ *  that the caller may split it as mm_memalign() does.
+ *
+ ****************************************************************************/
+
+#ifdef MM_HEAP_LARGE
+FAR void *mm_malloc_chunk(FAR struct mm_heap_s *heap, size_t size)
+{
+  return mm_malloc_internal(heap, size, false);
+}
+#endif
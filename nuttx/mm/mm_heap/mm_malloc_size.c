@@ -45,6 +45,15 @@ size_t mm_malloc_size(FAR struct mm_heap_s *heap, FAR void *mem)
   bool flag;
 
   flag = kasan_bypass(true);
+#ifdef MM_HEAP_LARGE
+  size = mm_large_size(heap, mem);
+  if (size >= 0)
+    {
+      kasan_bypass(flag);
+      return size;
+    }
+#endif
+
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   if (heap->mm_mpool)
     {
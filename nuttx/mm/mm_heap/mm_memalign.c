@@ -31,6 +31,7 @@
 
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
+#include <nuttx/mm/memprof.h>
 #include <nuttx/sched_note.h>
 
 #include "mm_heap/mm.h"
@@ -82,6 +83,7 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
       node = mempool_multiple_memalign(heap->mm_mpool, alignment, size);
       if (node != NULL)
         {
+          mm_memprof_alloc(heap, node, size);
           return node;
         }
     }
@@ -131,14 +133,20 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
       return NULL;
     }
 
-  /* Then malloc that size */
+  /* Then malloc that size.  The chunk is split below, so it must not come
+   * from the large allocation area, which has no allocation node headers.
+   */
 
-  rawchunk = (uintptr_t)mm_malloc(heap, allocsize);
+  rawchunk = (uintptr_t)mm_malloc_chunk(heap, allocsize);
   if (rawchunk == 0)
     {
       return NULL;
     }
 
+  /* The raw chunk is not what the caller gets back */
+
+  mm_memprof_free(heap, (FAR void *)rawchunk);
+
   kasan_poison((FAR void *)rawchunk,
                mm_malloc_size(heap, (FAR void *)rawchunk));
 
@@ -290,5 +298,7 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
   DEBUGASSERT(alignedchunk % alignment == 0);
   minfo("Aligned %"PRIxPTR" to %"PRIxPTR", size %zu\n",
         rawchunk, alignedchunk, size);
+  mm_memprof_alloc(heap, (FAR void *)alignedchunk,
+                   size - MM_ALLOCNODE_OVERHEAD);
   return (FAR void *)alignedchunk;
 }
@@ -34,6 +34,7 @@
 
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
+#include <nuttx/mm/memprof.h>
 #include <nuttx/sched_note.h>
 
 #include "mm_heap/mm.h"
@@ -76,6 +77,9 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
   size_t prevsize = 0;
   size_t nextsize = 0;
   FAR void *newmem;
+#ifdef MM_HEAP_LARGE
+  ssize_t largesize;
+#endif
 
   /* If oldmem is NULL, then realloc is equivalent to malloc */
 
@@ -86,12 +90,37 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
   DEBUGASSERT(mm_heapmember(heap, oldmem));
 
+#ifdef MM_HEAP_LARGE
+  largesize = mm_large_size(heap, oldmem);
+  if (largesize >= 0)
+    {
+      oldsize = largesize;
+      if (size <= oldsize && size >= CONFIG_MM_HEAP_LARGE_THRESHOLD)
+        {
+          mm_memprof_free(heap, oldmem);
+          mm_memprof_alloc(heap, oldmem, size);
+          return oldmem;
+        }
+
+      newmem = mm_malloc(heap, size);
+      if (newmem != NULL)
+        {
+          memcpy(newmem, oldmem, MIN(size, oldsize));
+          mm_free(heap, oldmem);
+        }
+
+      return newmem;
+    }
+#endif
+
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   if (heap->mm_mpool)
     {
       newmem = mempool_multiple_realloc(heap->mm_mpool, oldmem, size);
       if (newmem != NULL)
         {
+          mm_memprof_free(heap, oldmem);
+          mm_memprof_alloc(heap, newmem, size);
           return newmem;
         }
       else if (size <= heap->mm_threshold ||
@@ -161,6 +190,8 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
       mm_unlock(heap);
       MM_ADD_BACKTRACE(heap, oldnode);
+      mm_memprof_free(heap, oldmem);
+      mm_memprof_alloc(heap, oldmem, size);
 
       return oldmem;
     }
@@ -394,6 +425,8 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       MM_ADD_BACKTRACE(heap, (FAR char *)newmem - MM_SIZEOF_ALLOCNODE);
 
       newmem = kasan_unpoison(newmem, size - MM_ALLOCNODE_OVERHEAD);
+      mm_memprof_free(heap, oldmem);
+      mm_memprof_alloc(heap, newmem, size - MM_ALLOCNODE_OVERHEAD);
 
       oldmem = kasan_set_tag(oldmem, kasan_get_tag(newmem));
       if (newmem != oldmem)
@@ -37,11 +37,14 @@
 #include <sys/param.h>
 
 #include <nuttx/arch.h>
+#include <nuttx/atomic.h>
 #include <nuttx/fs/procfs.h>
 #include <nuttx/mutex.h>
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/kasan.h>
 #include <nuttx/mm/mempool.h>
+#include <nuttx/mm/memprof.h>
+#include <nuttx/nuttx.h>
 #include <nuttx/sched_note.h>
 
 #include "tlsf/tlsf.h"
@@ -54,6 +57,20 @@
 #  define MEMPOOL_NPOOLS (CONFIG_MM_HEAP_MEMPOOL_THRESHOLD / tlsf_align_size())
 #endif
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+#  define MM_NARENAS CONFIG_SMP_NCPUS
+
+/* A region is only cut across the arenas when each slice gets at least
+ * this much memory, otherwise the whole region goes to a single arena.
+ */
+
+#  define MM_ARENA_MINSIZE 4096
+
+#  define mm_slice_arena(heap, region, slice) \
+     (&(heap)->mm_arena[((heap)->mm_firstarena[region] + (slice)) % \
+                        MM_NARENAS])
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -63,6 +80,36 @@ struct mm_delaynode_s
   FAR struct mm_delaynode_s *flink;
 };
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+
+/* The remote free list of an arena is a pointer sized atomic, pushed with
+ * compare-and-exchange and taken as a whole by the owner of the lock.
+ */
+
+#  if UINTPTR_MAX > UINT32_MAX
+typedef atomic64_t mm_remote_t;
+typedef int64_t mm_remoteval_t;
+#    define mm_remote_read(r)       atomic64_read(r)
+#    define mm_remote_take(r)       atomic64_xchg(r, 0)
+#    define mm_remote_push(r, o, n) atomic64_try_cmpxchg_release(r, o, n)
+#  else
+typedef atomic_t mm_remote_t;
+typedef int32_t mm_remoteval_t;
+#    define mm_remote_read(r)       atomic_read(r)
+#    define mm_remote_take(r)       atomic_xchg(r, 0)
+#    define mm_remote_push(r, o, n) atomic_try_cmpxchg_release(r, o, n)
+#  endif
+
+struct mm_arena_s
+{
+  mutex_t     lock;    /* Serializes the TLSF context of the arena */
+  tlsf_t      tlsf;    /* The TLSF context of the arena */
+  size_t      curused; /* The current used size of the arena */
+  size_t      maxused; /* The maximum used size of the arena */
+  mm_remote_t remote;  /* Blocks freed while the arena was not available */
+};
+#endif
+
 struct mm_heap_s
 {
   /* Mutually exclusive access to this data set is enforced with
@@ -92,7 +139,20 @@ struct mm_heap_s
   int mm_nregions;
 #endif
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* The per-CPU arenas.  Region r is cut into mm_nslices[r] slices of
+   * mm_slicesize[r] bytes (the last one takes the remainder), slice i is
+   * the pool mm_pool[r][i] of the arena mm_firstarena[r] + i.
+   */
+
+  struct mm_arena_s mm_arena[MM_NARENAS];
+  FAR void *mm_pool[CONFIG_MM_REGIONS][MM_NARENAS];
+  size_t mm_slicesize[CONFIG_MM_REGIONS];
+  uint8_t mm_nslices[CONFIG_MM_REGIONS];
+  uint8_t mm_firstarena[CONFIG_MM_REGIONS];
+#else
   tlsf_t mm_tlsf; /* The tlfs context */
+#endif
 
   /* The is a multiple mempool of the heap */
 
@@ -488,23 +548,23 @@ static void mallinfo_task_handler(FAR void *ptr, size_t size, int used,
 }
 
 /****************************************************************************
- * Name: mm_lock
+ * Name: mm_lock_mutex
  *
  * Description:
- *   Take the MM mutex. This may be called from the OS in certain conditions
+ *   Take a MM mutex. This may be called from the OS in certain conditions
  *   when it is impossible to wait on a mutex:
  *     1.The idle process performs the memory corruption check.
  *     2.The task/thread free the memory in the exiting process.
  *
  * Input Parameters:
- *   heap  - heap instance want to take mutex
+ *   lock  - The heap or arena mutex to take
  *
  * Returned Value:
  *   0 if the lock can be taken, otherwise negative errno.
  *
  ****************************************************************************/
 
-static int mm_lock(FAR struct mm_heap_s *heap)
+static int mm_lock_mutex(FAR mutex_t *lock)
 {
 #if defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__)
   /* Check current environment */
@@ -516,7 +576,7 @@ static int mm_lock(FAR struct mm_heap_s *heap)
        * Or, touch the heap internal data directly.
        */
 
-      return nxmutex_is_locked(&heap->mm_lock) ? -EAGAIN : 0;
+      return nxmutex_is_locked(lock) ? -EAGAIN : 0;
 #else
       /* Can't take mutex in SMP interrupt handler */
 
@@ -542,19 +602,19 @@ static int mm_lock(FAR struct mm_heap_s *heap)
     }
   else
     {
-      return nxmutex_lock(&heap->mm_lock);
+      return nxmutex_lock(lock);
     }
 }
 
 /****************************************************************************
- * Name: mm_unlock
+ * Name: mm_unlock_mutex
  *
  * Description:
- *   Release the MM mutex when it is not longer needed.
+ *   Release a MM mutex when it is not longer needed.
  *
  ****************************************************************************/
 
-static void mm_unlock(FAR struct mm_heap_s *heap)
+static void mm_unlock_mutex(FAR mutex_t *lock)
 {
 #if defined(CONFIG_BUILD_FLAT) || defined(__KERNEL__)
   if (up_interrupt_context())
@@ -563,7 +623,33 @@ static void mm_unlock(FAR struct mm_heap_s *heap)
     }
 #endif
 
-  DEBUGVERIFY(nxmutex_unlock(&heap->mm_lock));
+  DEBUGVERIFY(nxmutex_unlock(lock));
+}
+
+/****************************************************************************
+ * Name: mm_lock
+ *
+ * Description:
+ *   Take the MM mutex of the heap (see mm_lock_mutex).
+ *
+ ****************************************************************************/
+
+static int mm_lock(FAR struct mm_heap_s *heap)
+{
+  return mm_lock_mutex(&heap->mm_lock);
+}
+
+/****************************************************************************
+ * Name: mm_unlock
+ *
+ * Description:
+ *   Release the MM mutex of the heap.
+ *
+ ****************************************************************************/
+
+static void mm_unlock(FAR struct mm_heap_s *heap)
+{
+  mm_unlock_mutex(&heap->mm_lock);
 }
 
 /****************************************************************************
@@ -607,6 +693,303 @@ static void memdump_handler(FAR void *ptr, size_t size, int used,
     }
 }
 
+/****************************************************************************
+ * Name: mm_heap_curused
+ *
+ * Description:
+ *   Return the current used size of the heap.
+ *
+ ****************************************************************************/
+
+static size_t mm_heap_curused(FAR struct mm_heap_s *heap)
+{
+#ifdef CONFIG_MM_TLSF_ARENAS
+  size_t curused = 0;
+  int i;
+
+  for (i = 0; i < MM_NARENAS; i++)
+    {
+      curused += heap->mm_arena[i].curused;
+    }
+
+  return curused;
+#else
+  return heap->mm_curused;
+#endif
+}
+
+#ifdef CONFIG_MM_TLSF_ARENAS
+
+/****************************************************************************
+ * Name: mm_arena_owner
+ *
+ * Description:
+ *   Return the arena whose TLSF pool the memory belongs to.
+ *
+ ****************************************************************************/
+
+static FAR struct mm_arena_s *mm_arena_owner(FAR struct mm_heap_s *heap,
+                                             FAR void *mem)
+{
+  size_t slice;
+#if CONFIG_MM_REGIONS > 1
+  int region;
+#else
+#  define region 0
+#endif
+
+#if CONFIG_MM_REGIONS > 1
+  for (region = 0; region < heap->mm_nregions; region++)
+#endif
+    {
+      if (mem >= heap->mm_heapstart[region] &&
+          mem < heap->mm_heapend[region])
+        {
+          /* The last slice also owns the memory added by mm_extend() */
+
+          slice = ((uintptr_t)mem - (uintptr_t)heap->mm_heapstart[region]) /
+                  heap->mm_slicesize[region];
+          if (slice >= heap->mm_nslices[region])
+            {
+              slice = heap->mm_nslices[region] - 1;
+            }
+
+          return mm_slice_arena(heap, region, slice);
+        }
+    }
+#undef region
+
+  DEBUGPANIC();
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: mm_arena_free
+ *
+ * Description:
+ *   Return memory to the TLSF pool of its arena.  The caller holds the
+ *   arena mutex.
+ *
+ ****************************************************************************/
+
+static void mm_arena_free(FAR struct mm_heap_s *heap,
+                          FAR struct mm_arena_s *arena, FAR void *mem)
+{
+  size_t size = mm_malloc_size(heap, mem);
+
+  arena->curused -= size;
+  sched_note_heap(NOTE_HEAP_FREE, heap, mem, size, mm_heap_curused(heap));
+  tlsf_free(arena->tlsf, mem);
+}
+
+/****************************************************************************
+ * Name: mm_arena_defer
+ *
+ * Description:
+ *   Queue memory on the remote free list of its arena, without taking any
+ *   lock.  This is how memory is freed from another CPU or when the arena
+ *   mutex cannot be taken (see the comment in mm_lock_mutex).
+ *
+ ****************************************************************************/
+
+static void mm_arena_defer(FAR struct mm_arena_s *arena, FAR void *mem)
+{
+  FAR struct mm_delaynode_s *node = mem;
+  mm_remoteval_t head = mm_remote_read(&arena->remote);
+
+  do
+    {
+      node->flink = (FAR struct mm_delaynode_s *)(uintptr_t)head;
+    }
+  while (!mm_remote_push(&arena->remote, &head,
+                         (mm_remoteval_t)(uintptr_t)node));
+}
+
+/****************************************************************************
+ * Name: mm_arena_drain
+ *
+ * Description:
+ *   Free the memory queued on the remote free list of an arena.  The
+ *   caller holds the arena mutex.
+ *
+ ****************************************************************************/
+
+static void mm_arena_drain(FAR struct mm_heap_s *heap,
+                           FAR struct mm_arena_s *arena)
+{
+  FAR struct mm_delaynode_s *tmp;
+  FAR void *address;
+
+  if (mm_remote_read(&arena->remote) == 0)
+    {
+      return;
+    }
+
+  tmp = (FAR struct mm_delaynode_s *)(uintptr_t)
+        mm_remote_take(&arena->remote);
+  while (tmp)
+    {
+      address = tmp;
+      tmp = tmp->flink;
+      mm_arena_free(heap, arena, address);
+    }
+}
+
+/****************************************************************************
+ * Name: mm_arena_alloc
+ *
+ * Description:
+ *   Allocate from the arena of this CPU, falling back to the other arenas
+ *   when it cannot satisfy the request.
+ *
+ ****************************************************************************/
+
+static FAR void *mm_arena_alloc(FAR struct mm_heap_s *heap,
+                                size_t alignment, size_t size)
+{
+  FAR struct mm_arena_s *arena;
+  FAR void *ret = NULL;
+  size_t nodesize;
+  int cpu = this_cpu();
+  int i;
+
+  for (i = 0; i < MM_NARENAS && ret == NULL; i++)
+    {
+      arena = &heap->mm_arena[(cpu + i) % MM_NARENAS];
+      if (mm_lock_mutex(&arena->lock) < 0)
+        {
+          continue;
+        }
+
+      mm_arena_drain(heap, arena);
+
+      if (alignment > 0)
+        {
+          ret = tlsf_memalign(arena->tlsf, alignment, size);
+        }
+      else
+        {
+          ret = tlsf_malloc(arena->tlsf, size);
+        }
+
+      if (ret)
+        {
+          nodesize = mm_malloc_size(heap, ret);
+          arena->curused += nodesize;
+          if (arena->curused > arena->maxused)
+            {
+              arena->maxused = arena->curused;
+            }
+
+          sched_note_heap(NOTE_HEAP_ALLOC, heap, ret, nodesize,
+                          mm_heap_curused(heap));
+        }
+
+      mm_unlock_mutex(&arena->lock);
+    }
+
+  return ret;
+}
+
+#endif /* CONFIG_MM_TLSF_ARENAS */
+
+/****************************************************************************
+ * Name: mm_walk_pools
+ *
+ * Description:
+ *   Walk all the TLSF pools of the heap.
+ *
+ ****************************************************************************/
+
+static void mm_walk_pools(FAR struct mm_heap_s *heap, tlsf_walker walker,
+                          FAR void *user)
+{
+#ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+  int slice;
+#endif
+#if CONFIG_MM_REGIONS > 1
+  int region;
+#else
+#  define region 0
+#endif
+
+  /* Visit each region */
+
+#if CONFIG_MM_REGIONS > 1
+  for (region = 0; region < heap->mm_nregions; region++)
+#endif
+    {
+#ifdef CONFIG_MM_TLSF_ARENAS
+      for (slice = 0; slice < heap->mm_nslices[region]; slice++)
+        {
+          /* The remote frees are settled first, so that the walk sees
+           * the same heap as a single arena would.
+           */
+
+          arena = mm_slice_arena(heap, region, slice);
+          DEBUGVERIFY(mm_lock_mutex(&arena->lock));
+          mm_arena_drain(heap, arena);
+          tlsf_walk_pool(heap->mm_pool[region][slice], walker, user);
+          mm_unlock_mutex(&arena->lock);
+        }
+#else
+      /* Retake the mutex for each region to reduce latencies */
+
+      DEBUGVERIFY(mm_lock(heap));
+      tlsf_walk_pool(heap->mm_heapstart[region], walker, user);
+      mm_unlock(heap);
+#endif
+    }
+#undef region
+}
+
+#ifdef CONFIG_MM_TLSF_ARENAS
+
+/****************************************************************************
+ * Name: mm_delayfree
+ *
+ * Description:
+ *   Delay free memory if `delay` is true, otherwise free it immediately
+ *   when it belongs to the arena of this CPU, or queue it to its arena.
+ *
+ ****************************************************************************/
+
+static void mm_delayfree(FAR struct mm_heap_s *heap, FAR void *mem,
+                         bool delay)
+{
+  FAR struct mm_arena_s *arena = mm_arena_owner(heap, mem);
+  size_t size = mm_malloc_size(heap, mem);
+  UNUSED(size);
+
+#ifdef CONFIG_MM_FILL_ALLOCATIONS
+#if CONFIG_MM_FREE_DELAYCOUNT_MAX > 0
+  if (delay)
+#endif
+    {
+      memset(mem, MM_FREE_MAGIC, size);
+    }
+#endif
+
+  kasan_poison(mem, size);
+
+  if (delay)
+    {
+      add_delaylist(heap, mem);
+    }
+  else if (arena == &heap->mm_arena[this_cpu()] &&
+           mm_lock_mutex(&arena->lock) == 0)
+    {
+      mm_arena_free(heap, arena, mem);
+      mm_unlock_mutex(&arena->lock);
+    }
+  else
+    {
+      mm_arena_defer(arena, mem);
+    }
+}
+
+#else
 /****************************************************************************
  * Name: mm_delayfree
  *
@@ -663,6 +1046,7 @@ static void mm_delayfree(FAR struct mm_heap_s *heap, FAR void *mem,
       add_delaylist(heap, mem);
     }
 }
+#endif
 
 /****************************************************************************
  * Public Functions
@@ -689,6 +1073,12 @@ static void mm_delayfree(FAR struct mm_heap_s *heap, FAR void *mem,
 void mm_addregion(FAR struct mm_heap_s *heap, FAR void *heapstart,
                   size_t heapsize)
 {
+#ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+  size_t slicesize;
+  int nslices;
+  int i;
+#endif
 #if CONFIG_MM_REGIONS > 1
   int idx;
 
@@ -729,15 +1119,43 @@ void mm_addregion(FAR struct mm_heap_s *heap, FAR void *heapstart,
   heap->mm_heapstart[idx] = heapstart;
   heap->mm_heapend[idx]   = heapstart + heapsize;
 
-#undef idx
-
 #if CONFIG_MM_REGIONS > 1
   heap->mm_nregions++;
 #endif
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Cut the region into one slice per arena, so that each CPU allocates
+   * from memory of its own.  A small region goes to a single arena.
+   */
+
+  nslices = heapsize / MM_NARENAS >= MM_ARENA_MINSIZE ? MM_NARENAS : 1;
+  slicesize = ALIGN_DOWN(heapsize / nslices, tlsf_align_size());
+
+  heap->mm_nslices[idx]    = nslices;
+  heap->mm_slicesize[idx]  = slicesize;
+  heap->mm_firstarena[idx] = nslices > 1 ? 0 : idx % MM_NARENAS;
+
+  /* Add each slice to the tlsf pool of its arena */
+
+  for (i = 0; i < nslices; i++)
+    {
+      arena = mm_slice_arena(heap, idx, i);
+
+      DEBUGVERIFY(mm_lock_mutex(&arena->lock));
+      heap->mm_pool[idx][i] =
+        tlsf_add_pool(arena->tlsf, heapstart + i * slicesize,
+                      i < nslices - 1 ? slicesize :
+                                        heapsize - i * slicesize);
+      mm_unlock_mutex(&arena->lock);
+    }
+#else
   /* Add memory to the tlsf pool */
 
   tlsf_add_pool(heap->mm_tlsf, heapstart, heapsize);
+#endif
+
+#undef idx
+
   sched_note_heap(NOTE_HEAP_ADD, heap, heapstart, heapsize,
                   heap->mm_curused);
   mm_unlock(heap);
@@ -804,6 +1222,10 @@ FAR void *mm_calloc(FAR struct mm_heap_s *heap, size_t n, size_t elem_size)
 
 void mm_checkcorruption(FAR struct mm_heap_s *heap)
 {
+#ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+  int slice;
+#endif
 #if CONFIG_MM_REGIONS > 1
   int region;
 #else
@@ -815,6 +1237,30 @@ void mm_checkcorruption(FAR struct mm_heap_s *heap)
 #if CONFIG_MM_REGIONS > 1
   for (region = 0; region < heap->mm_nregions; region++)
 #endif
+#ifdef CONFIG_MM_TLSF_ARENAS
+    {
+      for (slice = 0; slice < heap->mm_nslices[region]; slice++)
+        {
+          arena = mm_slice_arena(heap, region, slice);
+          if (mm_lock_mutex(&arena->lock) < 0)
+            {
+              return;
+            }
+
+          /* Check the tlsf control block of each arena in the first
+           * pass, then the pool of each slice.
+           */
+
+          if (region == 0)
+            {
+              tlsf_check(arena->tlsf);
+            }
+
+          tlsf_check_pool(heap->mm_pool[region][slice]);
+          mm_unlock_mutex(&arena->lock);
+        }
+    }
+#else
     {
       /* Retake the mutex for each region to reduce latencies */
 
@@ -838,6 +1284,7 @@ void mm_checkcorruption(FAR struct mm_heap_s *heap)
 
       mm_unlock(heap);
     }
+#endif
 #undef region
 }
 #endif
@@ -854,6 +1301,10 @@ void mm_checkcorruption(FAR struct mm_heap_s *heap)
 void mm_extend(FAR struct mm_heap_s *heap, FAR void *mem, size_t size,
                int region)
 {
+#ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+  int slice;
+#endif
   size_t oldsize;
 
   /* Make sure that we were passed valid parameters */
@@ -869,10 +1320,22 @@ void mm_extend(FAR struct mm_heap_s *heap, FAR void *mem, size_t size,
 
   DEBUGVERIFY(mm_lock(heap));
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Extend the tlsf pool of the last slice of the region */
+
+  slice   = heap->mm_nslices[region] - 1;
+  arena   = mm_slice_arena(heap, region, slice);
+  oldsize = heap->mm_heapend[region] - heap->mm_pool[region][slice];
+
+  DEBUGVERIFY(mm_lock_mutex(&arena->lock));
+  tlsf_extend_pool(arena->tlsf, heap->mm_pool[region][slice], oldsize, size);
+  mm_unlock_mutex(&arena->lock);
+#else
   /* Extend the tlsf pool */
 
   oldsize = heap->mm_heapend[region] - heap->mm_heapstart[region];
   tlsf_extend_pool(heap->mm_tlsf, heap->mm_heapstart[region], oldsize, size);
+#endif
 
   /* Save the new size */
 
@@ -903,6 +1366,7 @@ void mm_free(FAR struct mm_heap_s *heap, FAR void *mem)
     }
 
   DEBUGASSERT(mm_heapmember(heap, mem));
+  mm_memprof_free(heap, mem);
 
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   if (heap->mm_mpool)
@@ -997,6 +1461,9 @@ FAR struct mm_heap_s *mm_initialize(FAR const char *name,
                                     FAR void *heapstart, size_t heapsize)
 {
   FAR struct mm_heap_s *heap;
+#ifdef CONFIG_MM_TLSF_ARENAS
+  int i;
+#endif
 
   minfo("Heap: name=%s start=%p size=%zu\n", name, heapstart, heapsize);
 
@@ -1008,12 +1475,25 @@ FAR struct mm_heap_s *mm_initialize(FAR const char *name,
   heapstart += sizeof(struct mm_heap_s);
   heapsize -= sizeof(struct mm_heap_s);
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Allocate and create the TLSF context and mutex of each arena */
+
+  for (i = 0; i < MM_NARENAS; i++)
+    {
+      DEBUGASSERT(heapsize > tlsf_size());
+      heap->mm_arena[i].tlsf = tlsf_create(heapstart);
+      nxmutex_init(&heap->mm_arena[i].lock);
+      heapstart += tlsf_size();
+      heapsize -= tlsf_size();
+    }
+#else
   /* Allocate and create TLSF context */
 
   DEBUGASSERT(heapsize > tlsf_size());
   heap->mm_tlsf = tlsf_create(heapstart);
   heapstart += tlsf_size();
   heapsize -= tlsf_size();
+#endif
 
   /* Initialize the malloc mutex (to support one-at-
    * a-time access to private data sets).
@@ -1111,32 +1591,26 @@ struct mallinfo mm_mallinfo(FAR struct mm_heap_s *heap)
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   struct mallinfo poolinfo;
 #endif
-#if CONFIG_MM_REGIONS > 1
-  int region;
-#else
-#  define region 0
+#ifdef CONFIG_MM_TLSF_ARENAS
+  int i;
 #endif
 
   memset(&info, 0, sizeof(struct mallinfo));
 
-  /* Visit each region */
-
-#if CONFIG_MM_REGIONS > 1
-  for (region = 0; region < heap->mm_nregions; region++)
-#endif
-    {
-      /* Retake the mutex for each region to reduce latencies */
-
-      DEBUGVERIFY(mm_lock(heap));
-      tlsf_walk_pool(heap->mm_heapstart[region],
-                     mallinfo_handler, &info);
-      mm_unlock(heap);
-    }
-#undef region
+  mm_walk_pools(heap, mallinfo_handler, &info);
 
   info.arena    = heap->mm_heapsize;
   info.uordblks = info.arena - info.fordblks;
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* The arenas do not peak together, their sum bounds the heap peak */
+
+  for (i = 0; i < MM_NARENAS; i++)
+    {
+      info.usmblks += heap->mm_arena[i].maxused;
+    }
+#else
   info.usmblks  = heap->mm_maxused;
+#endif
 
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   poolinfo = mempool_multiple_mallinfo(heap->mm_mpool);
@@ -1157,30 +1631,13 @@ struct mallinfo_task mm_mallinfo_task(FAR struct mm_heap_s *heap,
       0, 0
     };
 
-#if CONFIG_MM_REGIONS > 1
-  int region;
-#else
-#define region 0
-#endif
-
 #ifdef CONFIG_MM_HEAP_MEMPOOL
   info = mempool_multiple_info_task(heap->mm_mpool, task);
 #endif
 
   handle.task = task;
   handle.info = &info;
-#if CONFIG_MM_REGIONS > 1
-  for (region = 0; region < heap->mm_nregions; region++)
-#endif
-    {
-      /* Retake the mutex for each region to reduce latencies */
-
-      DEBUGVERIFY(mm_lock(heap));
-      tlsf_walk_pool(heap->mm_heapstart[region],
-                     mallinfo_task_handler, &handle);
-      mm_unlock(heap);
-    }
-#undef region
+  mm_walk_pools(heap, mallinfo_task_handler, &handle);
 
   return info;
 }
@@ -1199,11 +1656,6 @@ struct mallinfo_task mm_mallinfo_task(FAR struct mm_heap_s *heap,
 void mm_memdump(FAR struct mm_heap_s *heap,
                 FAR const struct mm_memdump_s *dump)
 {
-#if CONFIG_MM_REGIONS > 1
-  int region;
-#else
-#  define region 0
-#endif
   struct mm_memdump_priv_s priv;
   pid_t pid = dump->pid;
 
@@ -1269,17 +1721,7 @@ void mm_memdump(FAR struct mm_heap_s *heap,
 #endif
 
   memdump_dump_pool(&priv, heap);
-
-#if CONFIG_MM_REGIONS > 1
-  for (region = 0; region < heap->mm_nregions; region++)
-#endif
-    {
-      DEBUGVERIFY(mm_lock(heap));
-      tlsf_walk_pool(heap->mm_heapstart[region],
-                     memdump_handler, &priv);
-      mm_unlock(heap);
-    }
-#undef region
+  mm_walk_pools(heap, memdump_handler, &priv);
 
 #if CONFIG_MM_HEAP_BIGGEST_COUNT > 0
   if (pid == PID_MM_BIGGEST)
@@ -1345,6 +1787,7 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
       ret = mempool_multiple_alloc(heap->mm_mpool, size);
       if (ret != NULL)
         {
+          mm_memprof_alloc(heap, ret, size);
           return ret;
         }
     }
@@ -1354,6 +1797,17 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
 
   free_delaylist(heap, false);
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Allocate from the tlsf pool of an arena */
+
+#  if CONFIG_MM_BACKTRACE >= 0
+  ret = mm_arena_alloc(heap, 0, size + sizeof(struct memdump_backtrace_s));
+#  else
+  ret = mm_arena_alloc(heap, 0, size);
+#  endif
+
+  nodesize = mm_malloc_size(heap, ret);
+#else
   /* Allocate from the tlsf pool */
 
   DEBUGVERIFY(mm_lock(heap));
@@ -1378,6 +1832,7 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
     }
 
   mm_unlock(heap);
+#endif
 
   if (ret)
     {
@@ -1392,6 +1847,7 @@ FAR void *mm_malloc(FAR struct mm_heap_s *heap, size_t size)
 #ifdef CONFIG_MM_FILL_ALLOCATIONS
       memset(ret, MM_ALLOC_MAGIC, nodesize);
 #endif
+      mm_memprof_alloc(heap, ret, size);
     }
 
 #if CONFIG_MM_FREE_DELAYCOUNT_MAX > 0
@@ -1431,6 +1887,7 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
       ret = mempool_multiple_memalign(heap->mm_mpool, alignment, size);
       if (ret != NULL)
         {
+          mm_memprof_alloc(heap, ret, size);
           return ret;
         }
     }
@@ -1440,6 +1897,19 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
 
   free_delaylist(heap, false);
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Allocate from the tlsf pool of an arena */
+
+#  if CONFIG_MM_BACKTRACE >= 0
+  ret = mm_arena_alloc(heap, alignment, size +
+                       sizeof(struct memdump_backtrace_s));
+#  else
+  ret = mm_arena_alloc(heap, alignment, size);
+#  endif
+
+  nodesize = mm_malloc_size(heap, ret);
+  UNUSED(nodesize);
+#else
   /* Allocate from the tlsf pool */
 
   DEBUGVERIFY(mm_lock(heap));
@@ -1464,6 +1934,7 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
     }
 
   mm_unlock(heap);
+#endif
 
   if (ret)
     {
@@ -1473,6 +1944,7 @@ FAR void *mm_memalign(FAR struct mm_heap_s *heap, size_t alignment,
       memdump_backtrace(heap, buf);
 #endif
       ret = kasan_unpoison(ret, nodesize);
+      mm_memprof_alloc(heap, ret, size);
     }
 
 #if CONFIG_MM_FREE_DELAYCOUNT_MAX > 0
@@ -1515,6 +1987,9 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 {
   FAR void *newmem;
 #ifndef CONFIG_MM_KASAN
+#  ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+#  endif
   size_t oldsize;
   size_t newsize;
 #endif
@@ -1541,6 +2016,8 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       newmem = mempool_multiple_realloc(heap->mm_mpool, oldmem, size);
       if (newmem != NULL)
         {
+          mm_memprof_free(heap, oldmem);
+          mm_memprof_alloc(heap, newmem, size);
           return newmem;
         }
       else if (size <= heap->mm_threshold ||
@@ -1574,6 +2051,43 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
   free_delaylist(heap, false);
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* Reallocate within the tlsf pool of the arena owning the memory */
+
+  arena = mm_arena_owner(heap, oldmem);
+  DEBUGVERIFY(mm_lock_mutex(&arena->lock));
+  mm_arena_drain(heap, arena);
+  oldsize = mm_malloc_size(heap, oldmem);
+  arena->curused -= oldsize;
+#  if CONFIG_MM_BACKTRACE >= 0
+  newmem = tlsf_realloc(arena->tlsf, oldmem, size +
+                        sizeof(struct memdump_backtrace_s));
+#  else
+  newmem = tlsf_realloc(arena->tlsf, oldmem, size);
+#  endif
+
+  newsize = mm_malloc_size(heap, newmem);
+  arena->curused += newmem ? newsize : oldsize;
+  if (arena->curused > arena->maxused)
+    {
+      arena->maxused = arena->curused;
+    }
+
+  if (newmem)
+    {
+      /* Drop the sample of the old block before it can be handed out
+       * again by another thread.  A failed realloc keeps it.
+       */
+
+      mm_memprof_free(heap, oldmem);
+      sched_note_heap(NOTE_HEAP_FREE, heap, oldmem, oldsize,
+                      mm_heap_curused(heap) - newsize);
+      sched_note_heap(NOTE_HEAP_ALLOC, heap, newmem, newsize,
+                      mm_heap_curused(heap));
+    }
+
+  mm_unlock_mutex(&arena->lock);
+#else
   /* Allocate from the tlsf pool */
 
   DEBUGVERIFY(mm_lock(heap));
@@ -1595,6 +2109,11 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
 
   if (newmem)
     {
+      /* Drop the sample of the old block before it can be handed out
+       * again by another thread.  A failed realloc keeps it.
+       */
+
+      mm_memprof_free(heap, oldmem);
       sched_note_heap(NOTE_HEAP_FREE, heap, oldmem, oldsize,
                       heap->mm_curused - newsize);
       sched_note_heap(NOTE_HEAP_ALLOC, heap, newmem, newsize,
@@ -1602,6 +2121,7 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
     }
 
   mm_unlock(heap);
+#endif
 
   if (newmem)
     {
@@ -1609,6 +2129,7 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
       FAR struct memdump_backtrace_s *buf = newmem + newsize;
       memdump_backtrace(heap, buf);
 #endif
+      mm_memprof_alloc(heap, newmem, size);
     }
 
 #if CONFIG_MM_FREE_DELAYCOUNT_MAX > 0
@@ -1620,6 +2141,20 @@ FAR void *mm_realloc(FAR struct mm_heap_s *heap, FAR void *oldmem,
     }
 #endif
 
+#ifdef CONFIG_MM_TLSF_ARENAS
+  /* The owning arena is full, move the memory to another one */
+
+  else
+    {
+      newmem = mm_malloc(heap, size);
+      if (newmem)
+        {
+          memcpy(newmem, oldmem, MIN(size, oldsize));
+          mm_free(heap, oldmem);
+        }
+    }
+#endif
+
 #endif
   return newmem;
 }
@@ -1660,7 +2195,15 @@ void mm_uninitialize(FAR struct mm_heap_s *heap)
 #  endif
 #endif
   nxmutex_destroy(&heap->mm_lock);
+#ifdef CONFIG_MM_TLSF_ARENAS
+  for (i = 0; i < MM_NARENAS; i++)
+    {
+      nxmutex_destroy(&heap->mm_arena[i].lock);
+      tlsf_destroy(heap->mm_arena[i].tlsf);
+    }
+#else
   tlsf_destroy(&heap->mm_tlsf);
+#endif
 }
 
 /****************************************************************************
@@ -1693,9 +2236,28 @@ FAR void *mm_zalloc(FAR struct mm_heap_s *heap, size_t size)
 
 void mm_free_delaylist(FAR struct mm_heap_s *heap)
 {
+#ifdef CONFIG_MM_TLSF_ARENAS
+  FAR struct mm_arena_s *arena;
+  int i;
+#endif
+
   if (heap)
     {
        free_delaylist(heap, true);
+
+#ifdef CONFIG_MM_TLSF_ARENAS
+      /* And the remote free lists of the arenas */
+
+      for (i = 0; i < MM_NARENAS; i++)
+        {
+          arena = &heap->mm_arena[i];
+          if (mm_lock_mutex(&arena->lock) == 0)
+            {
+              mm_arena_drain(heap, arena);
+              mm_unlock_mutex(&arena->lock);
+            }
+        }
+#endif
     }
 }
 
@@ -1709,7 +2271,7 @@ void mm_free_delaylist(FAR struct mm_heap_s *heap)
 
 size_t mm_heapfree(FAR struct mm_heap_s *heap)
 {
-  return heap->mm_heapsize - heap->mm_curused;
+  return heap->mm_heapsize - mm_heap_curused(heap);
 }
 
 /****************************************************************************
@@ -77,7 +77,14 @@ int file_mq_getattr(FAR struct file *mq, FAR struct mq_attr *mq_stat)
   mq_stat->mq_maxmsg  = msgq->maxmsgs;
   mq_stat->mq_msgsize = msgq->maxmsgsize;
   mq_stat->mq_flags   = mq->f_oflags;
-  mq_stat->mq_curmsgs = msgq->nmsgs;
+  mq_stat->mq_curmsgs = nxmq_nmsgs(msgq);
+
+#ifdef CONFIG_MQ_SPSC
+  if (msgq->ring != NULL)
+    {
+      mq_stat->mq_flags |= MQ_SPSC;
+    }
+#endif
 
   return 0;
 }
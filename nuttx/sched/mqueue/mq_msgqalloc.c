@@ -28,6 +28,7 @@
 
 #include <mqueue.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/sched.h>
@@ -68,6 +69,11 @@ int nxmq_alloc_msgq(FAR struct mq_attr *attr,
                     FAR struct mqueue_inode_s **pmsgq)
 {
   FAR struct mqueue_inode_s *msgq;
+#ifdef CONFIG_MQ_SPSC
+  size_t ringsize = 0;
+  uint16_t slotsize = 0;
+  int16_t nslots = 0;
+#endif
 
   /* Check if the caller is attempting to allocate a message for messages
    * larger than the configured maximum message size.
@@ -79,10 +85,39 @@ int nxmq_alloc_msgq(FAR struct mq_attr *attr,
       return -EINVAL;
     }
 
+#ifdef CONFIG_MQ_SPSC
+  /* An MQ_SPSC queue carries its ring of fixed-size slots in the same
+   * allocation.  The number of slots is rounded up to a power of two so
+   * that the free-running indices can be masked.
+   */
+
+  if (attr && (attr->mq_flags & MQ_SPSC) != 0)
+    {
+      if (attr->mq_maxmsg > (INT16_MAX + 1) / 2)
+        {
+          return -EINVAL;
+        }
+
+      nslots = 1;
+      while (nslots < attr->mq_maxmsg)
+        {
+          nslots <<= 1;
+        }
+
+      slotsize = MQ_SLOT_SIZE(attr->mq_msgsize);
+      ringsize = (size_t)nslots * slotsize;
+    }
+
+  /* Allocate memory for the new message queue (and its ring). */
+
+  msgq = (FAR struct mqueue_inode_s *)
+    kmm_zalloc(sizeof(struct mqueue_inode_s) + ringsize);
+#else
   /* Allocate memory for the new message queue. */
 
   msgq = (FAR struct mqueue_inode_s *)
     kmm_zalloc(sizeof(struct mqueue_inode_s));
+#endif
 
   if (msgq)
     {
@@ -100,6 +135,15 @@ int nxmq_alloc_msgq(FAR struct mq_attr *attr,
           msgq->maxmsgsize = MQ_MAX_BYTES;
         }
 
+#ifdef CONFIG_MQ_SPSC
+      if (ringsize > 0)
+        {
+          msgq->ring     = (FAR uint8_t *)(msgq + 1);
+          msgq->slotsize = slotsize;
+          msgq->maxmsgs  = nslots;
+        }
+#endif
+
 #ifndef CONFIG_DISABLE_MQUEUE_NOTIFICATION
       msgq->ntpid = INVALID_PROCESS_ID;
 #endif
@@ -173,6 +173,15 @@ ssize_t file_mq_timedreceive_internal(FAR struct file *mq, FAR char *msg,
 
   msgq = mq->f_inode->i_private;
 
+#ifdef CONFIG_MQ_SPSC
+  /* MQ_SPSC queues copy straight out of the oldest ring slot */
+
+  if (msgq->ring != NULL)
+    {
+      return nxmq_spsc_receive(mq, msg, msglen, prio, abstime, ticks);
+    }
+#endif
+
   /* Furthermore, nxmq_wait_receive() expects to have interrupts disabled
    * because messages can be sent from interrupt level.
    */
@@ -306,6 +306,15 @@ int file_mq_timedsend_internal(FAR struct file *mq, FAR const char *msg,
 
   msgq = mq->f_inode->i_private;
 
+#ifdef CONFIG_MQ_SPSC
+  /* MQ_SPSC queues copy straight into the next ring slot */
+
+  if (msgq->ring != NULL)
+    {
+      return nxmq_spsc_send(mq, msg, msglen, prio, abstime, ticks);
+    }
+#endif
+
   /* Pre-allocate a message structure */
 
   mqmsg = nxmq_alloc_msg(msglen);
@@ -0,0 +1,737 @@
+/****************************************************************************
+ * sched/mqueue/mq_spsc.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/sched.h>
+#include <nuttx/clock.h>
+#include <nuttx/wdog.h>
+#include <nuttx/cancelpt.h>
+#include <nuttx/mqueue.h>
+
+#include "sched/sched.h"
+#include "mqueue/mqueue.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxmq_spsc_full/nxmq_spsc_empty
+ *
+ * Description:
+ *   Ring state checks used on the blocking path.  The peer index is read
+ *   with a read-modify-write so that it is ordered against the peer's
+ *   publishing fetch-add: either this side observes the new index, or the
+ *   peer observes the waiter count incremented just before the check.
+ *
+ ****************************************************************************/
+
+static inline bool nxmq_spsc_full(FAR struct mqueue_inode_s *msgq)
+{
+  uint32_t head = atomic_read(&msgq->head);
+  uint32_t tail = atomic_fetch_add(&msgq->tail, 0);
+
+  return head - tail >= (uint32_t)msgq->maxmsgs;
+}
+
+static inline bool nxmq_spsc_empty(FAR struct mqueue_inode_s *msgq)
+{
+  uint32_t head = atomic_fetch_add(&msgq->head, 0);
+  uint32_t tail = atomic_read(&msgq->tail);
+
+  return head == tail;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_timeout
+ *
+ * Description:
+ *   This function is called if the timeout elapses before the ring becomes
+ *   non-full (producer) or non-empty (consumer).
+ *
+ * Input Parameters:
+ *   arg - The argument that was provided when the timeout was configured.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void nxmq_spsc_timeout(wdparm_t arg)
+{
+  FAR struct tcb_s *wtcb = (FAR struct tcb_s *)(uintptr_t)arg;
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+
+  if (wtcb->task_state == TSTATE_WAIT_MQNOTFULL ||
+      wtcb->task_state == TSTATE_WAIT_MQNOTEMPTY)
+    {
+      nxmq_wait_irq(wtcb, ETIMEDOUT);
+    }
+
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_wait
+ *
+ * Description:
+ *   Block the caller until the ring is no longer full (send) or no longer
+ *   empty (receive).  This is the only place where the SPSC queue enters a
+ *   critical section on behalf of the caller.
+ *
+ * Input Parameters:
+ *   msgq    - Message queue descriptor
+ *   send    - True to wait for a free slot, false to wait for a message
+ *   abstime - The absolute time to wait until (may be NULL)
+ *   ticks   - Relative timeout in ticks, used if abstime is NULL (< 0 to
+ *             wait forever)
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure (EINTR,
+ *   ETIMEDOUT or ECANCELED).
+ *
+ ****************************************************************************/
+
+static int nxmq_spsc_wait(FAR struct mqueue_inode_s *msgq, bool send,
+                          FAR const struct timespec *abstime,
+                          sclock_t ticks)
+{
+  FAR struct tcb_s *rtcb = this_task();
+  bool timed = abstime != NULL || ticks >= 0;
+  clock_t deadline = 0;
+  irqstate_t flags;
+  int ret = OK;
+
+  flags = enter_critical_section();
+
+#ifdef CONFIG_CANCELLATION_POINTS
+  if (check_cancellation_point())
+    {
+      leave_critical_section(flags);
+      return -ECANCELED;
+    }
+#endif
+
+  /* The peer cancels the watchdog when it wakes us up, and we may have to
+   * block again if the other side raced us to the ring.  Compute the
+   * deadline once so that every re-block waits only for the remainder.
+   */
+
+  if (abstime)
+    {
+      clock_realtime2absticks(abstime, &deadline);
+    }
+  else if (ticks >= 0)
+    {
+      deadline = clock_systime_ticks() + ticks;
+    }
+
+  for (; ; )
+    {
+      /* Announce the waiter first, then re-check the ring.  The peer
+       * checks the waiter count only after publishing its index.
+       */
+
+      if (send)
+        {
+          msgq->cmn.nwaitnotfull++;
+          if (!nxmq_spsc_full(msgq))
+            {
+              msgq->cmn.nwaitnotfull--;
+              break;
+            }
+        }
+      else
+        {
+          msgq->cmn.nwaitnotempty++;
+          if (!nxmq_spsc_empty(msgq))
+            {
+              msgq->cmn.nwaitnotempty--;
+              break;
+            }
+        }
+
+      if (timed)
+        {
+          if (clock_compare(deadline, clock_systime_ticks()))
+            {
+              if (send)
+                {
+                  msgq->cmn.nwaitnotfull--;
+                }
+              else
+                {
+                  msgq->cmn.nwaitnotempty--;
+                }
+
+              ret = -ETIMEDOUT;
+              break;
+            }
+
+          wd_start_abstick(&rtcb->waitdog, deadline,
+                           nxmq_spsc_timeout, (wdparm_t)rtcb);
+        }
+
+      rtcb->waitobj = msgq;
+      rtcb->errcode = OK;
+
+      DEBUGASSERT(!is_idle_task(rtcb));
+
+      nxsched_remove_self(rtcb);
+
+      if (send)
+        {
+          rtcb->task_state = TSTATE_WAIT_MQNOTFULL;
+          nxsched_add_prioritized(rtcb, MQ_WNFLIST(msgq->cmn));
+        }
+      else
+        {
+          rtcb->task_state = TSTATE_WAIT_MQNOTEMPTY;
+          nxsched_add_prioritized(rtcb, MQ_WNELIST(msgq->cmn));
+        }
+
+      up_switch_context(this_task(), rtcb);
+
+      /* We were either woken by the peer (and loop to re-check the ring)
+       * or by a signal/timeout.
+       */
+
+      if (rtcb->errcode != OK)
+        {
+          ret = -rtcb->errcode;
+          break;
+        }
+    }
+
+  if (timed)
+    {
+      wd_cancel(&rtcb->waitdog);
+    }
+
+  leave_critical_section(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_get
+ *
+ * Description:
+ *   Return the message queue behind 'mq' if it is an MQ_SPSC queue opened
+ *   with the access mode in 'oflag'.
+ *
+ ****************************************************************************/
+
+static int nxmq_spsc_get(FAR struct file *mq, int oflag,
+                         FAR struct mqueue_inode_s **msgq)
+{
+  if (mq == NULL)
+    {
+      return -EINVAL;
+    }
+
+  if (mq->f_inode == NULL || (mq->f_oflags & oflag) == 0)
+    {
+      return -EBADF;
+    }
+
+  *msgq = mq->f_inode->i_private;
+  if (*msgq == NULL || (*msgq)->ring == NULL)
+    {
+      return -EINVAL;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_reserve
+ *
+ * Description:
+ *   Return the slot at the producer index, waiting for the consumer to
+ *   free one if the ring is full.
+ *
+ ****************************************************************************/
+
+static int nxmq_spsc_reserve(FAR struct file *mq,
+                             FAR struct mqueue_inode_s *msgq,
+                             FAR const struct timespec *abstime,
+                             sclock_t ticks,
+                             FAR struct mqueue_slot_s **slot)
+{
+  uint32_t head = atomic_read(&msgq->head);
+  int ret;
+
+  /* The acquire load pairs with the consumer's release of the slot so that
+   * we never overwrite a message that is still being read.
+   */
+
+  if (head - (uint32_t)atomic_read_acquire(&msgq->tail) >=
+      (uint32_t)msgq->maxmsgs)
+    {
+      if (up_interrupt_context() || (mq->f_oflags & O_NONBLOCK) != 0)
+        {
+          return -EAGAIN;
+        }
+
+      ret = nxmq_spsc_wait(msgq, true, abstime, ticks);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  *slot = MQ_SLOT(msgq, head);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_publish
+ *
+ * Description:
+ *   Publish the slot at the producer index and, only if the queue was
+ *   empty or a receiver is blocked, notify the consumer side.
+ *
+ ****************************************************************************/
+
+static void nxmq_spsc_publish(FAR struct mqueue_inode_s *msgq,
+                              FAR struct mqueue_slot_s *slot,
+                              size_t msglen, unsigned int prio)
+{
+  uint32_t head;
+  irqstate_t flags;
+
+  slot->msglen   = msglen;
+  slot->priority = prio;
+
+  head = atomic_fetch_add(&msgq->head, 1);
+
+  if (head == (uint32_t)atomic_read(&msgq->tail) ||
+      msgq->cmn.nwaitnotempty > 0)
+    {
+      flags = enter_critical_section();
+      nxmq_pollnotify(msgq, POLLIN);
+      nxmq_notify_send(msgq);
+      leave_critical_section(flags);
+    }
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_peek
+ *
+ * Description:
+ *   Return the slot at the consumer index, waiting for the producer to
+ *   commit a message if the ring is empty.
+ *
+ ****************************************************************************/
+
+static int nxmq_spsc_peek(FAR struct file *mq,
+                          FAR struct mqueue_inode_s *msgq,
+                          FAR const struct timespec *abstime,
+                          sclock_t ticks,
+                          FAR struct mqueue_slot_s **slot)
+{
+  uint32_t tail = atomic_read(&msgq->tail);
+  int ret;
+
+  DEBUGASSERT(up_interrupt_context() == false);
+
+  /* The acquire load pairs with the producer's publishing fetch-add so
+   * that the slot contents are visible.
+   */
+
+  if ((uint32_t)atomic_read_acquire(&msgq->head) == tail)
+    {
+      if ((mq->f_oflags & O_NONBLOCK) != 0)
+        {
+          return -EAGAIN;
+        }
+
+      ret = nxmq_spsc_wait(msgq, false, abstime, ticks);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  *slot = MQ_SLOT(msgq, tail);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_release
+ *
+ * Description:
+ *   Hand the slot at the consumer index back to the producer and, only if
+ *   the queue was full or a sender is blocked, notify the producer side.
+ *
+ ****************************************************************************/
+
+static void nxmq_spsc_release(FAR struct mqueue_inode_s *msgq)
+{
+  uint32_t tail;
+  irqstate_t flags;
+
+  tail = atomic_fetch_add(&msgq->tail, 1);
+
+  if ((uint32_t)atomic_read(&msgq->head) - tail >=
+      (uint32_t)msgq->maxmsgs || msgq->cmn.nwaitnotfull > 0)
+    {
+      flags = enter_critical_section();
+      nxmq_pollnotify(msgq, POLLOUT);
+      nxmq_notify_receive(msgq);
+      leave_critical_section(flags);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxmq_spsc_send
+ *
+ * Description:
+ *   Copying send used by [nx]mq_[timed]send() on MQ_SPSC queues.
+ *
+ * Assumptions:
+ *   The caller has validated msglen and prio.
+ *
+ ****************************************************************************/
+
+int nxmq_spsc_send(FAR struct file *mq, FAR const char *msg, size_t msglen,
+                   unsigned int prio, FAR const struct timespec *abstime,
+                   sclock_t ticks)
+{
+  FAR struct mqueue_inode_s *msgq = mq->f_inode->i_private;
+  FAR struct mqueue_slot_s *slot;
+  int ret;
+
+  if (msglen > (size_t)msgq->maxmsgsize)
+    {
+      return -EMSGSIZE;
+    }
+
+  ret = nxmq_spsc_reserve(mq, msgq, abstime, ticks, &slot);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memcpy(slot->mail, msg, msglen);
+  nxmq_spsc_publish(msgq, slot, msglen, prio);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxmq_spsc_receive
+ *
+ * Description:
+ *   Copying receive used by [nx]mq_[timed]receive() on MQ_SPSC queues.
+ *
+ * Assumptions:
+ *   The caller has validated msglen.
+ *
+ ****************************************************************************/
+
+ssize_t nxmq_spsc_receive(FAR struct file *mq, FAR char *msg,
+                          size_t msglen, FAR unsigned int *prio,
+                          FAR const struct timespec *abstime,
+                          sclock_t ticks)
+{
+  FAR struct mqueue_inode_s *msgq = mq->f_inode->i_private;
+  FAR struct mqueue_slot_s *slot;
+  ssize_t ret;
+
+  ret = nxmq_spsc_peek(mq, msgq, abstime, ticks, &slot);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (msglen < slot->msglen)
+    {
+      return -EMSGSIZE;
+    }
+
+  if (prio)
+    {
+      *prio = slot->priority;
+    }
+
+  ret = slot->msglen;
+  memcpy(msg, slot->mail, ret);
+  nxmq_spsc_release(msgq);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: file_mq_send_acquire
+ *
+ * Description:
+ *   See include/nuttx/mqueue.h
+ *
+ ****************************************************************************/
+
+int file_mq_send_acquire(FAR struct file *mq, FAR void **buf,
+                         FAR const struct timespec *abstime)
+{
+  FAR struct mqueue_inode_s *msgq;
+  FAR struct mqueue_slot_s *slot;
+  int ret;
+
+  if (buf == NULL ||
+      (abstime && (abstime->tv_nsec < 0 ||
+                   abstime->tv_nsec >= 1000000000)))
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmq_spsc_get(mq, O_WROK, &msgq);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = nxmq_spsc_reserve(mq, msgq, abstime, -1, &slot);
+  if (ret >= 0)
+    {
+      *buf = slot->mail;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: file_mq_send_commit
+ *
+ * Description:
+ *   See include/nuttx/mqueue.h
+ *
+ ****************************************************************************/
+
+int file_mq_send_commit(FAR struct file *mq, size_t msglen,
+                        unsigned int prio)
+{
+  FAR struct mqueue_inode_s *msgq;
+  uint32_t head;
+  int ret;
+
+  ret = nxmq_spsc_get(mq, O_WROK, &msgq);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (prio >= MQ_PRIO_MAX)
+    {
+      return -EINVAL;
+    }
+
+  if (msglen > (size_t)msgq->maxmsgsize)
+    {
+      return -EMSGSIZE;
+    }
+
+  head = atomic_read(&msgq->head);
+  if (head - (uint32_t)atomic_read_acquire(&msgq->tail) >=
+      (uint32_t)msgq->maxmsgs)
+    {
+      return -EINVAL;
+    }
+
+  nxmq_spsc_publish(msgq, MQ_SLOT(msgq, head), msglen, prio);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: file_mq_receive_acquire
+ *
+ * Description:
+ *   See include/nuttx/mqueue.h
+ *
+ ****************************************************************************/
+
+ssize_t file_mq_receive_acquire(FAR struct file *mq, FAR void **buf,
+                                FAR unsigned int *prio,
+                                FAR const struct timespec *abstime)
+{
+  FAR struct mqueue_inode_s *msgq;
+  FAR struct mqueue_slot_s *slot;
+  int ret;
+
+  if (buf == NULL ||
+      (abstime && (abstime->tv_nsec < 0 ||
+                   abstime->tv_nsec >= 1000000000)))
+    {
+      return -EINVAL;
+    }
+
+  ret = nxmq_spsc_get(mq, O_RDOK, &msgq);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = nxmq_spsc_peek(mq, msgq, abstime, -1, &slot);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (prio)
+    {
+      *prio = slot->priority;
+    }
+
+  *buf = slot->mail;
+  return slot->msglen;
+}
+
+/****************************************************************************
+ * Name: file_mq_receive_commit
+ *
+ * Description:
+ *   See include/nuttx/mqueue.h
+ *
+ ****************************************************************************/
+
+int file_mq_receive_commit(FAR struct file *mq)
+{
+  FAR struct mqueue_inode_s *msgq;
+  int ret;
+
+  ret = nxmq_spsc_get(mq, O_RDOK, &msgq);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if ((uint32_t)atomic_read_acquire(&msgq->head) ==
+      (uint32_t)atomic_read(&msgq->tail))
+    {
+      return -EINVAL;
+    }
+
+  nxmq_spsc_release(msgq);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxmq_send_acquire
+ ****************************************************************************/
+
+int nxmq_send_acquire(mqd_t mqdes, FAR void **buf,
+                      FAR const struct timespec *abstime)
+{
+  FAR struct file *filep;
+  int ret;
+
+  ret = file_get(mqdes, &filep);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = file_mq_send_acquire(filep, buf, abstime);
+  file_put(filep);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxmq_send_commit
+ ****************************************************************************/
+
+int nxmq_send_commit(mqd_t mqdes, size_t msglen, unsigned int prio)
+{
+  FAR struct file *filep;
+  int ret;
+
+  ret = file_get(mqdes, &filep);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = file_mq_send_commit(filep, msglen, prio);
+  file_put(filep);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxmq_receive_acquire
+ ****************************************************************************/
+
+ssize_t nxmq_receive_acquire(mqd_t mqdes, FAR void **buf,
+                             FAR unsigned int *prio,
+                             FAR const struct timespec *abstime)
+{
+  FAR struct file *filep;
+  ssize_t ret;
+
+  ret = file_get(mqdes, &filep);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = file_mq_receive_acquire(filep, buf, prio, abstime);
+  file_put(filep);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nxmq_receive_commit
+ ****************************************************************************/
+
+int nxmq_receive_commit(mqd_t mqdes)
+{
+  FAR struct file *filep;
+  int ret;
+
+  ret = file_get(mqdes, &filep);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = file_mq_receive_commit(filep);
+  file_put(filep);
+  return ret;
+}
@@ -37,6 +37,7 @@
 #include <mqueue.h>
 #include <sched.h>
 
+#include <nuttx/nuttx.h>
 #include <nuttx/spinlock.h>
 #include <nuttx/mqueue.h>
 
@@ -52,6 +53,14 @@
 
 #define MQ_MSG_SIZE(n) (sizeof(struct mqueue_msg_s) + (n) - 1)
 
+#ifdef CONFIG_MQ_SPSC
+#  define MQ_SLOT_SIZE(n) \
+   ALIGN_UP(sizeof(struct mqueue_slot_s) + (n) - 1, sizeof(uintptr_t))
+#  define MQ_SLOT(msgq, i) \
+   ((FAR struct mqueue_slot_s *) \
+    ((msgq)->ring + ((i) & ((msgq)->maxmsgs - 1)) * (msgq)->slotsize))
+#endif
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
@@ -78,6 +87,17 @@ struct mqueue_msg_s
   char mail[1];            /* Message data */
 };
 
+#ifdef CONFIG_MQ_SPSC
+/* This structure describes one slot of an MQ_SPSC ring. */
+
+struct mqueue_slot_s
+{
+  uint16_t msglen;         /* Message data length */
+  uint8_t priority;        /* Priority of message */
+  char mail[1];            /* Message data */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -138,6 +158,18 @@ int nxmq_wait_send(FAR struct mqueue_inode_s *msgq,
                    sclock_t ticks);
 void nxmq_notify_send(FAR struct mqueue_inode_s *msgq);
 
+/* mq_spsc.c ****************************************************************/
+
+#ifdef CONFIG_MQ_SPSC
+int nxmq_spsc_send(FAR struct file *mq, FAR const char *msg, size_t msglen,
+                   unsigned int prio, FAR const struct timespec *abstime,
+                   sclock_t ticks);
+ssize_t nxmq_spsc_receive(FAR struct file *mq, FAR char *msg,
+                          size_t msglen, FAR unsigned int *prio,
+                          FAR const struct timespec *abstime,
+                          sclock_t ticks);
+#endif
+
 /* mq_recover.c *************************************************************/
 
 void nxmq_recover(FAR struct tcb_s *tcb);
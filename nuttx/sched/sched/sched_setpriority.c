@@ -36,6 +36,7 @@
 
 #include "irq/irq.h"
 #include "sched/sched.h"
+#include "semaphore/semaphore.h"
 
 /****************************************************************************
  * Private Functions
@@ -221,6 +222,15 @@ static inline void nxsched_blocked_setpriority(FAR struct tcb_s *tcb,
 
       tcb->sched_priority = (uint8_t)sched_priority;
     }
+
+  /* A thread waiting for a semaphore donates its priority to the holders
+   * of the semaphore.
+   */
+
+  if (task_state == TSTATE_WAIT_SEM)
+    {
+      nxsem_reprioritize(tcb);
+    }
 }
 
 /****************************************************************************
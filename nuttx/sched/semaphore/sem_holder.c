@@ -60,6 +60,202 @@ static struct semholder_s g_holderalloc[CONFIG_SEM_PREALLOCHOLDERS];
 static FAR struct semholder_s *g_freeholders;
 #endif
 
+/****************************************************************************
+ * Name: nxsem_heap_meld
+ *
+ * Description:
+ *   Each thread keeps the holders through which it has received a priority
+ *   donation in a pairing heap ordered by the donated priority, so that its
+ *   effective priority can be found in O(1) and a donation can be inserted
+ *   in O(1) and removed in amortized O(log n), no matter how many
+ *   semaphores the thread holds.
+ *
+ *   Meld two heap roots and return the new root.  The losing root becomes
+ *   the leftmost child of the winner.
+ *
+ ****************************************************************************/
+
+static FAR struct semholder_s *
+nxsem_heap_meld(FAR struct semholder_s *a, FAR struct semholder_s *b)
+{
+  FAR struct semholder_s *tmp;
+
+  if (a == NULL)
+    {
+      return b;
+    }
+
+  if (b == NULL)
+    {
+      return a;
+    }
+
+  if (b->dprio > a->dprio)
+    {
+      tmp = a;
+      a   = b;
+      b   = tmp;
+    }
+
+  b->pprev = a;
+  b->pnext = a->pchild;
+  if (a->pchild != NULL)
+    {
+      a->pchild->pprev = b;
+    }
+
+  a->pchild = b;
+  return a;
+}
+
+/****************************************************************************
+ * Name: nxsem_heap_mergepairs
+ *
+ * Description:
+ *   Standard two-pass pairing of a list of siblings: meld them pairwise
+ *   from left to right, then meld the pairs together from right to left.
+ *
+ ****************************************************************************/
+
+static FAR struct semholder_s *
+nxsem_heap_mergepairs(FAR struct semholder_s *first)
+{
+  FAR struct semholder_s *pairs = NULL;
+  FAR struct semholder_s *root = NULL;
+  FAR struct semholder_s *a;
+  FAR struct semholder_s *b;
+
+  /* First pass: pairs are pushed in reverse order onto 'pairs' */
+
+  while (first != NULL)
+    {
+      a     = first;
+      b     = a->pnext;
+      first = b != NULL ? b->pnext : NULL;
+
+      a->pprev = NULL;
+      a->pnext = NULL;
+      if (b != NULL)
+        {
+          b->pprev = NULL;
+          b->pnext = NULL;
+          a = nxsem_heap_meld(a, b);
+        }
+
+      a->pnext = pairs;
+      pairs    = a;
+    }
+
+  /* Second pass: meld the pairs from the last one back to the first */
+
+  while (pairs != NULL)
+    {
+      a        = pairs;
+      pairs    = a->pnext;
+      a->pnext = NULL;
+      root     = nxsem_heap_meld(root, a);
+    }
+
+  return root;
+}
+
+/****************************************************************************
+ * Name: nxsem_heap_remove
+ ****************************************************************************/
+
+static void nxsem_heap_remove(FAR struct tcb_s *htcb,
+                              FAR struct semholder_s *pholder)
+{
+  FAR struct semholder_s *sub;
+
+  sub = nxsem_heap_mergepairs(pholder->pchild);
+
+  if (htcb->donors == pholder)
+    {
+      htcb->donors = sub;
+    }
+  else
+    {
+      /* pprev is either the parent (if we are its leftmost child) or the
+       * previous sibling.
+       */
+
+      if (pholder->pprev->pchild == pholder)
+        {
+          pholder->pprev->pchild = pholder->pnext;
+        }
+      else
+        {
+          pholder->pprev->pnext = pholder->pnext;
+        }
+
+      if (pholder->pnext != NULL)
+        {
+          pholder->pnext->pprev = pholder->pprev;
+        }
+
+      htcb->donors = nxsem_heap_meld(htcb->donors, sub);
+    }
+
+  pholder->pchild = NULL;
+  pholder->pnext  = NULL;
+  pholder->pprev  = NULL;
+}
+
+/****************************************************************************
+ * Name: nxsem_set_donation
+ *
+ * Description:
+ *   Set the priority donated to the holder's thread through this holder.
+ *   A donated priority of zero means that nobody is waiting and removes
+ *   the holder from the thread's donation heap.
+ *
+ ****************************************************************************/
+
+static void nxsem_set_donation(FAR struct semholder_s *pholder,
+                               uint8_t dprio)
+{
+  FAR struct tcb_s *htcb = pholder->htcb;
+
+  if (pholder->dprio == dprio)
+    {
+      return;
+    }
+
+  if (pholder->dprio != 0)
+    {
+      nxsem_heap_remove(htcb, pholder);
+    }
+
+  pholder->dprio = dprio;
+  if (dprio != 0)
+    {
+      htcb->donors = nxsem_heap_meld(htcb->donors, pholder);
+    }
+}
+
+/****************************************************************************
+ * Name: nxsem_waiterprio
+ *
+ * Description:
+ *   Return the priority of the highest priority thread waiting for the
+ *   semaphore, ignoring 'exclude', or zero if there is none.  The wait list
+ *   is kept in priority order, so only the first two entries are examined.
+ *
+ ****************************************************************************/
+
+static uint8_t nxsem_waiterprio(FAR sem_t *sem, FAR struct tcb_s *exclude)
+{
+  FAR struct tcb_s *stcb = (FAR struct tcb_s *)dq_peek(SEM_WAITLIST(sem));
+
+  if (stcb != NULL && stcb == exclude)
+    {
+      stcb = (FAR struct tcb_s *)dq_next((FAR dq_entry_t *)stcb);
+    }
+
+  return stcb != NULL ? stcb->sched_priority : 0;
+}
+
 /****************************************************************************
  * Name: nxsem_allocholder
  ****************************************************************************/
@@ -104,7 +300,11 @@ nxsem_allocholder(FAR sem_t *sem, FAR struct tcb_s *htcb)
 
   pholder->sem    = sem;
   pholder->htcb   = htcb;
+  pholder->pchild = NULL;
+  pholder->pnext  = NULL;
+  pholder->pprev  = NULL;
   pholder->counts = 0;
+  pholder->dprio  = 0;
 
   /* Put it into the task's list */
 
@@ -185,6 +385,10 @@ static inline void nxsem_freeholder(FAR sem_t *sem,
 {
   FAR struct semholder_s * FAR *curr;
 
+  /* Withdraw any priority donated through this holder */
+
+  nxsem_set_donation(pholder, 0);
+
   /* Remove the holder from the task's list */
 
   for (curr = &pholder->htcb->holdsem;
@@ -318,6 +522,16 @@ static int nxsem_boostholderprio(FAR struct semholder_s *pholder,
   FAR struct tcb_s *htcb = pholder->htcb;
   FAR struct tcb_s *rtcb = (FAR struct tcb_s *)arg;
 
+  /* Record the donation even if no boost is needed right now, so that
+   * the holder's priority can later be restored without looking at the
+   * wait lists of every semaphore that it holds.
+   */
+
+  if (rtcb && htcb && rtcb->sched_priority > pholder->dprio)
+    {
+      nxsem_set_donation(pholder, rtcb->sched_priority);
+    }
+
   /* If the priority of the thread that is waiting for a count is less than
    * or equal to the priority of the thread holding a count, then do nothing
    * because the thread is already running at a sufficient priority.
@@ -400,37 +614,48 @@ static void nxsem_restore_priority(FAR struct tcb_s *htcb)
   hpriority = htcb->boost_priority > htcb->base_priority ?
               htcb->boost_priority : htcb->base_priority;
 
-  /* Was the priority of the holder thread boosted? If so, then drop its
-   * priority back to the correct level.  What is the correct level?
+  /* The highest priority across all the threads that are waiting for any
+   * semaphore held by htcb is at the root of its donation heap.
    */
 
-  if (htcb->sched_priority != hpriority)
+  if (htcb->donors != NULL && htcb->donors->dprio > hpriority)
     {
-      FAR struct semholder_s *pholder;
+      hpriority = htcb->donors->dprio;
+    }
 
-      /* Try to find the highest priority across all the threads that are
-       * waiting for any semaphore held by htcb.
-       */
+  /* Apply the selected priority to the thread (hopefully back to the
+   * threads base_priority).
+   */
 
-      for (pholder = htcb->holdsem; pholder != NULL;
-           pholder = pholder->tlink)
-        {
-          FAR struct tcb_s *stcb;
+  if (htcb->sched_priority != hpriority)
+    {
+      nxsched_set_priority(htcb, hpriority);
+    }
+}
 
-          stcb = (FAR struct tcb_s *)dq_peek(SEM_WAITLIST(pholder->sem));
+/****************************************************************************
+ * Name: nxsem_donateholderprio
+ ****************************************************************************/
 
-          if (stcb != NULL && stcb->sched_priority > hpriority)
-            {
-              hpriority = stcb->sched_priority;
-            }
-        }
+static int nxsem_donateholderprio(FAR struct semholder_s *pholder,
+                                  FAR sem_t *sem, FAR void *arg)
+{
+  nxsem_set_donation(pholder, (uint8_t)(uintptr_t)arg);
+  return 0;
+}
 
-      /* Apply the selected priority to the thread (hopefully back to the
-       * threads base_priority).
-       */
+/****************************************************************************
+ * Name: nxsem_redonateholderprio
+ ****************************************************************************/
 
-      nxsched_set_priority(htcb, hpriority);
-    }
+static int nxsem_redonateholderprio(FAR struct semholder_s *pholder,
+                                    FAR sem_t *sem, FAR void *arg)
+{
+  FAR struct tcb_s *htcb = pholder->htcb;
+
+  nxsem_set_donation(pholder, (uint8_t)(uintptr_t)arg);
+  nxsem_restore_priority(htcb);
+  return 0;
 }
 
 /****************************************************************************
@@ -806,6 +1031,13 @@ void nxsem_restore_baseprio(FAR struct tcb_s *stcb, FAR sem_t *sem)
 
   DEBUGASSERT(!up_interrupt_context());
 
+  /* The donation made through each holder is now that of the highest
+   * priority thread still waiting for the semaphore.
+   */
+
+  nxsem_foreachholder(sem, nxsem_donateholderprio,
+                      (FAR void *)(uintptr_t)nxsem_waiterprio(sem, NULL));
+
   /* Perform the following actions only if a new thread was given a count.
    * The thread that received the count should be the highest priority
    * of all threads waiting for a count from the semaphore.  So in that
@@ -884,11 +1116,50 @@ void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem)
   DEBUGASSERT(!NXSEM_IS_MUTEX(sem) ||
               NXSEM_MACQUIRED(atomic_read(NXSEM_MHOLDER(sem))));
 
+  /* stcb is still in the wait list, but no longer donates its priority */
+
+  nxsem_foreachholder(sem, nxsem_donateholderprio,
+                      (FAR void *)(uintptr_t)nxsem_waiterprio(sem, stcb));
+
   /* Adjust the priority of every holder as necessary */
 
   nxsem_foreachholder(sem, nxsem_restoreholderprio, stcb);
 }
 
+/****************************************************************************
+ * Name: nxsem_reprioritize
+ *
+ * Description:
+ *   Called when the priority of a thread waiting for a semaphore has been
+ *   changed.  The donation made to each holder of the semaphore is updated
+ *   and their priority is raised or dropped accordingly.  Since this may in
+ *   turn reprioritize a holder that is itself waiting for a semaphore, the
+ *   donation is propagated along the whole chain of blocked holders.
+ *
+ * Input Parameters:
+ *   wtcb - The TCB of the reprioritized thread, in the TSTATE_WAIT_SEM
+ *     state.
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void nxsem_reprioritize(FAR struct tcb_s *wtcb)
+{
+  FAR sem_t *sem = wtcb->waitobj;
+
+  if (sem != NULL && (sem->flags & SEM_PRIO_MASK) == SEM_PRIO_INHERIT)
+    {
+      nxsem_foreachholder(sem, nxsem_redonateholderprio,
+                          (FAR void *)(uintptr_t)nxsem_waiterprio(sem,
+                                                                  NULL));
+    }
+}
+
 /****************************************************************************
  * Name: sem_enumholders
  *
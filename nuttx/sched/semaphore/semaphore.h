@@ -84,6 +84,7 @@ void nxsem_boost_priority(FAR sem_t *sem);
 void nxsem_release_holder(FAR sem_t *sem);
 void nxsem_restore_baseprio(FAR struct tcb_s *stcb, FAR sem_t *sem);
 void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem);
+void nxsem_reprioritize(FAR struct tcb_s *wtcb);
 void nxsem_release_all(FAR struct tcb_s *stcb);
 #else
 #  define nxsem_initialize_holders()
@@ -94,6 +95,7 @@ void nxsem_release_all(FAR struct tcb_s *stcb);
 #  define nxsem_release_holder(sem)
 #  define nxsem_restore_baseprio(stcb,sem)
 #  define nxsem_canceled(stcb,sem)
+#  define nxsem_reprioritize(wtcb)
 #  define nxsem_release_all(stcb)
 #endif
 
@@ -151,7 +151,6 @@ static void lpwork_restoreworker(pid_t wpid, uint8_t reqprio)
 
   if (wtcb->sched_priority != wtcb->base_priority)
     {
-      FAR struct semholder_s *pholder;
       uint8_t wpriority;
 
       /* We attempt to restore task priority to its base priority.  If there
@@ -161,21 +160,13 @@ static void lpwork_restoreworker(pid_t wpid, uint8_t reqprio)
 
       wpriority = wtcb->base_priority;
 
-      /* Try to find the highest priority across all the tasks that are
-       * waiting for any semaphore held by wtcb.
+      /* The highest priority across all the tasks that are waiting for any
+       * semaphore held by wtcb is at the root of its donation heap.
        */
 
-      for (pholder = wtcb->holdsem; pholder != NULL;
-           pholder = pholder->tlink)
+      if (wtcb->donors != NULL && wtcb->donors->dprio > wpriority)
         {
-          FAR struct tcb_s *stcb;
-
-          stcb = (FAR struct tcb_s *)dq_peek(SEM_WAITLIST(pholder->sem));
-
-          if (stcb != NULL && stcb->sched_priority > wpriority)
-            {
-              wpriority = stcb->sched_priority;
-            }
+          wpriority = wtcb->donors->dprio;
         }
 
       /* Apply the selected priority to the worker thread (hopefully back
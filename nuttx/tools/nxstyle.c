@@ -636,6 +636,14 @@ static const char *g_white_content_list[] =
   "unzGetCurrentFileInfo64",
   "unzGoToNextFile",
   "unzGoToFirstFile",
+  "unzGetGlobalInfo64",
+  "unzGetFilePos64",
+  "unzGoToFilePos64",
+  "unzGetCurrentFileZStreamPos64",
+  "inflateInit2",
+  "inflateReset",
+  "inflatePrime",
+  "inflateSetDictionary",
 
   /* Ref:
    * apps/netutils/telnetc/telnetc.c